@@ -0,0 +1,259 @@
+/* CSV kernel benchmark.
+ *
+ * Times the per-dtype kernels CsvSource and CSVSink resolve at worker start
+ * against the per-value dtype switch they replaced, on the same rows, and
+ * prints old/new ratios. Then writes a file through CSVSink and reads it
+ * back with CsvSource for end-to-end rates.
+ *
+ * Prints numbers only: there are no thresholds and it is not part of
+ * `make test`. Build and run with `make bench`.
+ */
+#define _GNU_SOURCE  // For usleep
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "csv_sink.h"
+#include "csv_source.h"
+#include "signal_generator.h"
+
+#define N_ROWS 4096
+#define N_COLS 8
+#define STORE_REPS 200
+#define FORMAT_REPS 10
+#define ROUNDS 5
+#define ROUND_TRIP_SAMPLES 200000
+
+#define CHECK(expr)                                              \
+  do {                                                           \
+    Bp_EC _err = (expr);                                         \
+    if (_err != Bp_EC_OK) {                                      \
+      fprintf(stderr, "%s:%d: error %d\n", __FILE__, __LINE__, \
+              _err);                                             \
+      exit(1);                                                   \
+    }                                                            \
+  } while (0)
+
+/* Results are summed here so the timed loops are not optimised away */
+static volatile size_t sink_hole;
+
+/* The per-value switch the store kernels replaced */
+static void store_switch(SampleDtype_t dtype, void* data, size_t pos,
+                         size_t stride, const double* values, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    size_t at = pos + i * stride;
+    switch (dtype) {
+      case DTYPE_FLOAT:
+        ((float*) data)[at] = (float) values[i];
+        break;
+      case DTYPE_I32:
+        ((int32_t*) data)[at] = (int32_t) values[i];
+        break;
+      case DTYPE_U32:
+        ((uint32_t*) data)[at] = (uint32_t) values[i];
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/* The per-value switch the row formatters replaced */
+static size_t format_switch(SampleDtype_t dtype, char* line, size_t cap,
+                            const void* data, size_t n, size_t stride,
+                            char delim, int precision)
+{
+  size_t len = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (i > 0) line[len++] = delim;
+    const void* el = (const char*) data + i * stride;
+    switch (dtype) {
+      case DTYPE_FLOAT:
+        len += snprintf(line + len, cap - len, "%.*f", precision,
+                        *(const float*) el);
+        break;
+      case DTYPE_I32:
+        len += snprintf(line + len, cap - len, "%d", *(const int32_t*) el);
+        break;
+      case DTYPE_U32:
+        len += snprintf(line + len, cap - len, "%u", *(const uint32_t*) el);
+        break;
+      default:
+        break;
+    }
+  }
+  return len;
+}
+
+static double store_ns_per_row(SampleDtype_t dtype, bool specialised,
+                               const double* values, void* data)
+{
+  CsvStoreFn store = csvsource_store_fn(dtype);
+  long long start = now_ns(CLOCK_MONOTONIC);
+  for (int r = 0; r < STORE_REPS; r++) {
+    for (size_t row = 0; row < N_ROWS; row++) {
+      if (specialised) {
+        store(data, row * N_COLS, 1, values + row * N_COLS, N_COLS);
+      } else {
+        store_switch(dtype, data, row * N_COLS, 1, values + row * N_COLS,
+                     N_COLS);
+      }
+    }
+    sink_hole += ((const uint8_t*) data)[r % N_ROWS];
+  }
+  return (double) (now_ns(CLOCK_MONOTONIC) - start) /
+         ((double) STORE_REPS * N_ROWS);
+}
+
+static double format_ns_per_row(SampleDtype_t dtype, bool specialised,
+                                const void* data)
+{
+  CsvRowFormatFn format = csv_sink_row_formatter(dtype);
+  size_t width = bb_getdatawidth(dtype);
+  char line[1024];
+  long long start = now_ns(CLOCK_MONOTONIC);
+  for (int r = 0; r < FORMAT_REPS; r++) {
+    for (size_t row = 0; row < N_ROWS; row++) {
+      const char* frame = (const char*) data + row * N_COLS * width;
+      sink_hole += specialised
+                       ? format(line, sizeof(line), frame, N_COLS, width, ',',
+                                6)
+                       : format_switch(dtype, line, sizeof(line), frame,
+                                       N_COLS, width, ',', 6);
+    }
+  }
+  return (double) (now_ns(CLOCK_MONOTONIC) - start) /
+         ((double) FORMAT_REPS * N_ROWS);
+}
+
+/* Best of ROUNDS for each variant, alternating so drift hits both alike */
+static void bench_kernels(SampleDtype_t dtype, const char* name,
+                          const double* values, void* data)
+{
+  double store_old = 1e30, store_new = 1e30;
+  double fmt_old = 1e30, fmt_new = 1e30;
+  for (int round = 0; round < ROUNDS; round++) {
+    store_old = MIN(store_old, store_ns_per_row(dtype, false, values, data));
+    store_new = MIN(store_new, store_ns_per_row(dtype, true, values, data));
+  }
+  for (int round = 0; round < ROUNDS; round++) {
+    fmt_old = MIN(fmt_old, format_ns_per_row(dtype, false, data));
+    fmt_new = MIN(fmt_new, format_ns_per_row(dtype, true, data));
+  }
+  printf("%-6s store  switch %7.1f ns/row  kernel %7.1f ns/row  x%.2f\n",
+         name, store_old, store_new, store_old / store_new);
+  printf("%-6s format switch %7.1f ns/row  kernel %7.1f ns/row  x%.2f\n",
+         name, fmt_old, fmt_new, fmt_old / fmt_new);
+}
+
+static void bench_round_trip(void)
+{
+  const char* path = "bench_round_trip.csv";
+  unlink(path);
+
+  SignalGenerator_t source;
+  SignalGenerator_config_t source_cfg = {
+      .name = "bench_source",
+      .waveform_type = WAVEFORM_SINE,
+      .frequency_hz = 1000.0,
+      .sample_period_ns = 1000,
+      .amplitude = 1.0,
+      .max_samples = ROUND_TRIP_SAMPLES,
+      .buff_config = {.dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = 10,
+                      .ring_capacity_expo = 4}};
+  CHECK(signal_generator_init(&source, source_cfg));
+
+  CSVSink_t sink;
+  CSVSink_config_t sink_cfg = {.name = "bench_sink",
+                               .output_path = path,
+                               .format = CSV_FORMAT_SIMPLE,
+                               .write_header = true,
+                               .precision = 6,
+                               .buff_config = {.dtype = DTYPE_FLOAT,
+                                               .batch_capacity_expo = 10,
+                                               .ring_capacity_expo = 4}};
+  CHECK(csv_sink_init(&sink, sink_cfg));
+  CHECK(filt_sink_connect(&source.base, 0, sink.base.input_buffers[0]));
+
+  long long start = now_ns(CLOCK_MONOTONIC);
+  CHECK(filt_start(&sink.base));
+  CHECK(filt_start(&source.base));
+  while (atomic_load(&source.base.running) ||
+         atomic_load(&sink.base.running)) {
+    usleep(1000);
+  }
+  double write_s = (double) (now_ns(CLOCK_MONOTONIC) - start) / 1e9;
+  CHECK(filt_stop(&sink.base));
+  CHECK(filt_stop(&source.base));
+  CHECK(sink.base.worker_err_info.ec);
+  size_t written = sink.samples_written;
+  CHECK(filt_deinit(&sink.base));
+  CHECK(filt_deinit(&source.base));
+
+  CsvSource_t reader;
+  CsvSource_config_t reader_cfg = {.name = "bench_reader",
+                                   .file_path = path,
+                                   .delimiter = ',',
+                                   .has_header = true,
+                                   .ts_column_name = "timestamp_ns",
+                                   .data_column_names = {"value", NULL},
+                                   .detect_regular_timing = true,
+                                   .timeout_us = 1000000};
+  CHECK(csvsource_init(&reader, reader_cfg));
+
+  Batch_buff_t out;
+  BatchBuffer_config out_cfg = {.dtype = DTYPE_FLOAT,
+                                .batch_capacity_expo = 10,
+                                .ring_capacity_expo = 4,
+                                .overflow_behaviour = OVERFLOW_BLOCK};
+  CHECK(bb_init(&out, "bench_out", out_cfg));
+  CHECK(bb_start(&out));
+  CHECK(filt_sink_connect(&reader.base, 0, &out));
+
+  size_t read = 0;
+  Bp_EC err = Bp_EC_OK;
+  start = now_ns(CLOCK_MONOTONIC);
+  CHECK(filt_start(&reader.base));
+  for (;;) {
+    Batch_t* batch = bb_get_tail(&out, 1000000, &err);
+    if (batch == NULL) break;
+    bool done = batch->ec == Bp_EC_COMPLETE;
+    read += batch->head;
+    bb_del_tail(&out);
+    if (done) break;
+  }
+  double read_s = (double) (now_ns(CLOCK_MONOTONIC) - start) / 1e9;
+  filt_stop(&reader.base);
+  bb_stop(&out);
+  bb_deinit(&out);
+  csvsource_destroy(&reader);
+  unlink(path);
+  CHECK(err);
+
+  printf("CSVSink   %zu samples  %.2f Msamples/sec\n", written,
+         (double) written / write_s / 1e6);
+  printf("CsvSource %zu samples  %.2f Msamples/sec\n", read,
+         (double) read / read_s / 1e6);
+}
+
+int main(void)
+{
+  double* values = malloc(N_ROWS * N_COLS * sizeof(double));
+  void* data = malloc(N_ROWS * N_COLS * sizeof(double));
+  if (values == NULL || data == NULL) return 1;
+  for (size_t i = 0; i < N_ROWS * N_COLS; i++) {
+    values[i] = 1000.0 * (double) (i % 977) / 977.0 - 300.0;
+  }
+
+  printf("%d rows x %d columns, best of %d\n", N_ROWS, N_COLS, ROUNDS);
+  bench_kernels(DTYPE_FLOAT, "float", values, data);
+  bench_kernels(DTYPE_I32, "i32", values, data);
+  bench_round_trip();
+
+  free(values);
+  free(data);
+  return 0;
+}
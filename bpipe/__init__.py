@@ -0,0 +1,29 @@
+"""Python interface to the bpipe C filters.
+
+Batches export their ring memory through the buffer protocol, so
+``numpy.asarray(batch)`` is a zero-copy view of the samples.
+"""
+
+from ._bpipe import (
+    EC_COMPLETE,
+    EC_OK,
+    Batch,
+    BpipeError,
+    Buffer,
+    Filter,
+    create_debug_output,
+    create_passthrough,
+    create_signal_generator,
+)
+
+__all__ = [
+    "EC_COMPLETE",
+    "EC_OK",
+    "Batch",
+    "BpipeError",
+    "Buffer",
+    "Filter",
+    "create_debug_output",
+    "create_passthrough",
+    "create_signal_generator",
+]
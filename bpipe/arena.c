@@ -0,0 +1,73 @@
+#define _GNU_SOURCE  // For MAP_HUGETLB // NOLINT(bugprone-reserved-identifier)
+#include "arena.h"
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+Bp_EC arena_init(Arena_t* arena, size_t size, bool huge_pages)
+{
+  if (!arena) return Bp_EC_NULL_POINTER;
+  if (size == 0) return Bp_EC_INVALID_CONFIG;
+
+  memset(arena, 0, sizeof(*arena));
+
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+  flags |= MAP_POPULATE;
+#endif
+
+  void* mem = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (huge_pages) {
+    size_t huge_size = arena_align_up(size, ARENA_HUGE_PAGE_SIZE);
+    mem = mmap(NULL, huge_size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1,
+               0);
+    if (mem != MAP_FAILED) {
+      size = huge_size;
+      arena->huge_pages = true;
+    }
+  }
+#endif
+
+  if (mem == MAP_FAILED) {
+    mem = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mem == MAP_FAILED) return Bp_EC_MALLOC_FAIL;
+#ifdef MADV_HUGEPAGE
+    /* No reserved huge pages - fall back to THP, best effort */
+    if (huge_pages) madvise(mem, size, MADV_HUGEPAGE);
+#endif
+  }
+
+  arena->base = mem;
+  arena->size = size;
+  return Bp_EC_OK;
+}
+
+void* arena_alloc(Arena_t* arena, size_t size, size_t align)
+{
+  if (!arena || !arena->base) return NULL;
+  if (align == 0) align = ARENA_ALIGN;
+
+  size_t offset = arena_align_up(arena->used, align);
+  if (offset > arena->size || size > arena->size - offset) return NULL;
+
+  arena->used = offset + size;
+  arena->n_allocs++;
+  return arena->base + offset;
+}
+
+bool arena_contains(const Arena_t* arena, const void* ptr)
+{
+  if (!arena || !arena->base) return false;
+  uintptr_t p = (uintptr_t) ptr;
+  uintptr_t b = (uintptr_t) arena->base;
+  return p >= b && p < b + arena->size;
+}
+
+Bp_EC arena_deinit(Arena_t* arena)
+{
+  if (!arena) return Bp_EC_NULL_POINTER;
+  if (arena->base) munmap(arena->base, arena->size);
+  memset(arena, 0, sizeof(*arena));
+  return Bp_EC_OK;
+}
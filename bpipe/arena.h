@@ -0,0 +1,44 @@
+#ifndef BPIPE_ARENA_H
+#define BPIPE_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "bperr.h"
+
+/* Bump allocator over a single anonymous mapping.
+ *
+ * Allocations are never freed individually; the whole region is released
+ * by arena_deinit. Pages are pre-faulted at init so nothing on the data path
+ * takes a first-touch fault once the pipeline is running.
+ */
+
+#define ARENA_ALIGN 64                   /* Default alignment (cache line) */
+#define ARENA_HUGE_PAGE_SIZE (2UL << 20) /* x86_64 2 MiB huge page */
+
+typedef struct _Arena_t {
+  char* base;      /* Start of mapping, NULL when uninitialised */
+  size_t size;     /* Mapped bytes */
+  size_t used;     /* Bytes handed out, including alignment padding */
+  size_t n_allocs; /* Number of successful arena_alloc calls */
+  bool huge_pages; /* Backed by explicit (MAP_HUGETLB) huge pages */
+} Arena_t;
+
+static inline size_t arena_align_up(size_t n, size_t align)
+{
+  return (n + align - 1) & ~(align - 1);
+}
+
+/* Map `size` bytes. With huge_pages set, explicit huge pages are tried first
+ * and transparent huge pages are requested if none are reserved. */
+Bp_EC arena_init(Arena_t* arena, size_t size, bool huge_pages);
+
+/* Returns NULL when the arena is exhausted. align must be a power of two;
+ * 0 selects ARENA_ALIGN. */
+void* arena_alloc(Arena_t* arena, size_t size, size_t align);
+
+/* True if ptr points into the arena's mapping. */
+bool arena_contains(const Arena_t* arena, const void* ptr);
+
+Bp_EC arena_deinit(Arena_t* arena);
+
+#endif /* BPIPE_ARENA_H */
@@ -0,0 +1,375 @@
+#include "asof_join.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+/* Frame i of a batch into/out of a packed (interleaved) scratch frame */
+static void frame_load(const Batch_buff_t* buf, const Batch_t* batch, size_t i,
+                       void* dst)
+{
+  size_t width = bb_getdatawidth(buf->dtype);
+  if (buf->layout != BATCH_LAYOUT_PLANAR || buf->n_channels == 1) {
+    memcpy(dst, (const char*) batch->data + i * bb_frame_size(buf),
+           bb_frame_size(buf));
+    return;
+  }
+  for (size_t c = 0; c < buf->n_channels; c++) {
+    memcpy((char*) dst + c * width,
+           (const char*) bb_channel_ptr(buf, batch, c) + i * width, width);
+  }
+}
+
+static void frame_store(const Batch_buff_t* buf, Batch_t* batch, size_t i,
+                        const void* src)
+{
+  size_t width = bb_getdatawidth(buf->dtype);
+  if (buf->layout != BATCH_LAYOUT_PLANAR || buf->n_channels == 1) {
+    memcpy((char*) batch->data + i * bb_frame_size(buf), src,
+           bb_frame_size(buf));
+    return;
+  }
+  for (size_t c = 0; c < buf->n_channels; c++) {
+    memcpy((char*) bb_channel_ptr(buf, batch, c) + i * width,
+           (const char*) src + c * width, width);
+  }
+}
+
+/* Tail fetch for input `port`. The primary keeps waiting while the filter
+ * runs. A secondary waits at most timeout_us, or only polls once it has gone
+ * idle, and then reports Bp_EC_TIMEOUT. The completion batch is released here
+ * and reported as Bp_EC_COMPLETE. */
+static Bp_EC asof_fetch(AsofJoin_t* join, size_t port, Batch_t** out)
+{
+  Filter_t* f = &join->base;
+  bool idle = port > 0 && join->secondaries[port - 1].idle;
+  for (;;) {
+    uint32_t ready;
+    Bp_EC err;
+    if (idle) {
+      bb_waitset_watch(&join->ws, 1u << port, 0);
+      err = bb_await_any(&join->ws, BB_AWAIT_POLL, &ready, NULL);
+    } else {
+      err = filt_await_inputs(f, &join->ws, 1u << port, &ready);
+    }
+    if (err == Bp_EC_TIMEOUT && port == 0) continue;
+    if (err != Bp_EC_OK) return err;
+    Batch_t* batch = bb_get_tail(f->input_buffers[port], f->timeout_us, &err);
+    if (!batch) {
+      if (err == Bp_EC_TIMEOUT && atomic_load(&f->running)) continue;
+      return err == Bp_EC_TIMEOUT ? Bp_EC_STOPPED : err;
+    }
+    if (batch->ec != Bp_EC_OK) {
+      Bp_EC ec = batch->ec;
+      bb_del_tail(f->input_buffers[port]);
+      return ec;
+    }
+    if (batch->head == 0) {
+      bb_del_tail(f->input_buffers[port]);
+      continue;
+    }
+    *out = batch;
+    return Bp_EC_OK;
+  }
+}
+
+/* Move secondary j forward so `held` is its latest sample at or before t.
+ * Whole batches at or before t are passed at once; inside a batch the
+ * boundary is found by galloping from the cursor, so a dense secondary costs
+ * O(log gap) per primary sample rather than O(gap). Blocks until the
+ * secondary has data after t or completes, or for at most timeout_us: an
+ * idle secondary is answered from its held value until it produces again. */
+static Bp_EC asof_advance(AsofJoin_t* join, size_t j, long long t)
+{
+  AsofSecondary_t* s = &join->secondaries[j];
+  Batch_buff_t* buf = join->base.input_buffers[j + 1];
+
+  while (!s->done) {
+    if (!s->batch) {
+      Bp_EC err = asof_fetch(join, j + 1, &s->batch);
+      if (err == Bp_EC_TIMEOUT) {
+        s->idle = true;
+        break;
+      }
+      if (err == Bp_EC_COMPLETE) {
+        s->done = true;
+        break;
+      }
+      if (err != Bp_EC_OK) return err;
+      s->idx = 0;
+      s->idle = false;
+    }
+
+    const Batch_t* b = s->batch;
+    size_t last = b->head - 1;
+    if (bb_sample_t_ns(b, s->idx) > t) break; /* Nothing new yet */
+
+    if (bb_sample_t_ns(b, last) <= t) {
+      /* Entire remainder is not after t: keep its last sample, move on */
+      frame_load(buf, b, last, s->held);
+      s->held_t = bb_sample_t_ns(b, last);
+      s->held_valid = true;
+      bb_del_tail(buf);
+      s->batch = NULL;
+      continue;
+    }
+
+    /* Gallop: lo is known <= t, hi is known > t */
+    size_t lo = s->idx, step = 1;
+    while (lo + step < last && bb_sample_t_ns(b, lo + step) <= t) {
+      lo += step;
+      step <<= 1;
+    }
+    size_t hi = MIN(lo + step, last);
+    while (hi - lo > 1) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (bb_sample_t_ns(b, mid) <= t) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    join->gallops++;
+
+    frame_load(buf, b, lo, s->held);
+    s->held_t = bb_sample_t_ns(b, lo);
+    s->held_valid = true;
+    s->idx = lo + 1;
+    break;
+  }
+  return Bp_EC_OK;
+}
+
+static Bp_EC asof_fill_frame(AsofJoin_t* join, SampleDtype_t dtype,
+                             size_t n_channels)
+{
+  switch (dtype) {
+#define ASOF_FILL(NAME, TYPE)                                \
+  case DTYPE_##NAME:                                         \
+    for (size_t c = 0; c < n_channels; c++) {                \
+      ((TYPE*) join->fill_frame)[c] = (TYPE) join->fill_value; \
+    }                                                        \
+    return Bp_EC_OK;
+    BP_NUMERIC_DTYPES(ASOF_FILL)
+#undef ASOF_FILL
+    default:
+      return Bp_EC_TYPE_ERROR;
+  }
+}
+
+static void asof_send_complete(AsofJoin_t* join)
+{
+  Filter_t* f = &join->base;
+  for (size_t p = 0; p <= join->n_secondaries; p++) {
+    Batch_t* done = bb_get_head(f->sinks[p]);
+    done->head = 0;
+    done->ec = Bp_EC_COMPLETE;
+    bb_submit(f->sinks[p], f->timeout_us);
+  }
+}
+
+/* Join frames [off, off + n) of primary batch `in` into one output batch per
+ * port. */
+static Bp_EC asof_emit(AsofJoin_t* join, const Batch_t* in, size_t off,
+                       size_t n)
+{
+  Filter_t* f = &join->base;
+  size_t n_ports = join->n_secondaries + 1;
+  Batch_t* outs[MAX_SINKS] = {NULL};
+
+  for (size_t p = 0; p < n_ports; p++) {
+    outs[p] = bb_get_head(f->sinks[p]);
+    outs[p]->t_ns = bb_sample_t_ns(in, off);
+    outs[p]->period_ns = in->period_ns;
+    outs[p]->batch_id = in->batch_id;
+    outs[p]->head = n;
+    outs[p]->ec = Bp_EC_OK;
+    if (bb_batch_has_ts(in)) {
+      memcpy(outs[p]->ts, in->ts + off, n * sizeof(long long));
+    }
+  }
+
+  /* Primary passes straight through */
+  bb_copy_frames(f->sinks[0], outs[0], 0, f->input_buffers[0], in, off, n);
+
+  for (size_t j = 0; j < join->n_secondaries; j++) {
+    AsofSecondary_t* s = &join->secondaries[j];
+    Batch_buff_t* out_buf = f->sinks[j + 1];
+    for (size_t k = 0; k < n; k++) {
+      long long t = bb_sample_t_ns(in, off + k);
+      Bp_EC err = asof_advance(join, j, t);
+      if (err != Bp_EC_OK) return err;
+
+      bool stale = !s->held_valid || (join->max_staleness_ns > 0 &&
+                                      t - s->held_t > join->max_staleness_ns);
+      if (stale) join->fills++;
+      frame_store(out_buf, outs[j + 1], k, stale ? join->fill_frame : s->held);
+    }
+  }
+
+  for (size_t p = 0; p < n_ports; p++) {
+    bb_submit(f->sinks[p], f->timeout_us);
+  }
+  join->samples_joined += n;
+  f->metrics.samples_processed += n;
+  f->metrics.n_batches++;
+  return Bp_EC_OK;
+}
+
+static void* asof_join_worker(void* arg)
+{
+  AsofJoin_t* join = (AsofJoin_t*) arg;
+  Filter_t* f = &join->base;
+  Batch_buff_t* primary = f->input_buffers[0];
+
+  size_t out_samples = SIZE_MAX;
+  for (size_t p = 0; p <= join->n_secondaries; p++) {
+    BP_WORKER_ASSERT(f, f->sinks[p] != NULL, Bp_EC_NO_SINK);
+    BP_WORKER_ASSERT(f, f->sinks[p]->dtype == primary->dtype,
+                     Bp_EC_DTYPE_MISMATCH);
+    BP_WORKER_ASSERT(f, f->sinks[p]->n_channels == primary->n_channels,
+                     Bp_EC_WIDTH_MISMATCH);
+    out_samples = MIN(out_samples, (size_t) bb_batch_size(f->sinks[p]));
+  }
+
+  /* Held frames come from init; restart every secondary empty */
+  for (size_t j = 0; j < join->n_secondaries; j++) {
+    join->secondaries[j] = (AsofSecondary_t){
+        .held = (char*) join->fill_frame + (j + 1) * join->frame_size};
+  }
+
+  Bp_EC err = filt_waitset_inputs(f, &join->ws);
+  BP_WORKER_ASSERT(f, err == Bp_EC_OK, err);
+
+  while (atomic_load(&f->running)) {
+    Batch_t* in;
+    err = asof_fetch(join, 0, &in);
+    if (err != Bp_EC_OK) break;
+
+    /* Output batches follow the primary, split if a sink is smaller */
+    for (size_t off = 0; off < in->head && err == Bp_EC_OK;) {
+      size_t n = MIN(in->head - off, out_samples);
+      err = asof_emit(join, in, off, n);
+      off += n;
+    }
+    bb_del_tail(primary);
+    if (err != Bp_EC_OK) break;
+  }
+
+  if (err == Bp_EC_COMPLETE) asof_send_complete(join);
+
+  for (size_t j = 0; j < join->n_secondaries; j++) {
+    if (join->secondaries[j].batch) {
+      bb_del_tail(f->input_buffers[j + 1]);
+      join->secondaries[j].batch = NULL;
+    }
+  }
+  bb_waitset_deinit(&join->ws);
+
+  BP_WORKER_ASSERT(f, err == Bp_EC_OK || err == Bp_EC_COMPLETE ||
+                          err == Bp_EC_STOPPED ||
+                          err == Bp_EC_FILTER_STOPPING,
+                   err);
+  return NULL;
+}
+
+/* Outputs follow the primary's dtype and width, and carry its timestamp
+ * column if it has one: irregular primaries are copied out sample by
+ * sample. Checked here so the worker never finds out mid-batch. */
+static Bp_EC asof_join_sink_connect(Filter_t* self, size_t output_port,
+                                   Batch_buff_t* sink)
+{
+  Batch_buff_t* primary = self->input_buffers[0];
+  if (sink != NULL && primary->ts_ring != NULL && sink->ts_ring == NULL) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+  return filt_attach_sink(self, output_port, sink, primary->dtype,
+                          primary->n_channels);
+}
+
+static Bp_EC asof_join_deinit(Filter_t* self)
+{
+  AsofJoin_t* join = (AsofJoin_t*) self;
+  free(join->fill_frame);
+  join->fill_frame = NULL;
+  for (size_t j = 0; j < join->n_secondaries; j++) {
+    join->secondaries[j].held = NULL;
+  }
+
+  filt_release_inputs(self);
+  return Bp_EC_OK;
+}
+
+static Bp_EC asof_join_describe(Filter_t* self, char* buffer, size_t size)
+{
+  AsofJoin_t* join = (AsofJoin_t*) self;
+  snprintf(buffer, size,
+           "AsofJoin: %s\n"
+           "  Secondaries: %zu\n"
+           "  Max staleness: %lld ns\n"
+           "  Fill value: %g\n"
+           "  Samples joined: %lu\n"
+           "  Fills: %lu\n",
+           self->name, join->n_secondaries, join->max_staleness_ns,
+           join->fill_value, join->samples_joined, join->fills);
+  return Bp_EC_OK;
+}
+
+Bp_EC asof_join_init(AsofJoin_t* join, AsofJoin_config_t config)
+{
+  if (join == NULL) return Bp_EC_NULL_FILTER;
+  if (config.n_secondaries < 1 || config.n_secondaries >= MAX_INPUTS ||
+      config.n_secondaries >= MAX_SINKS || config.max_staleness_ns < 0) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+  /* Joins copy frames sample by sample; record streams have none */
+  if (config.buff_config.dtype == DTYPE_RECORD) return Bp_EC_INVALID_CONFIG;
+
+  Core_filt_config_t core_config = {
+      .name = config.name,
+      .filt_type = FILT_T_MIMO_ASOF_JOIN,
+      .size = sizeof(AsofJoin_t),
+      .n_inputs = config.n_secondaries + 1,
+      .max_supported_sinks = config.n_secondaries + 1,
+      .buff_config = config.buff_config,
+      .timeout_us = config.timeout_us > 0 ? config.timeout_us : 1000000,
+      .worker = asof_join_worker};
+
+  Bp_EC err = filt_init(&join->base, core_config);
+  if (err != Bp_EC_OK) return err;
+
+  join->n_secondaries = config.n_secondaries;
+  join->max_staleness_ns = config.max_staleness_ns;
+  join->fill_value = config.fill_value;
+  memset(join->secondaries, 0, sizeof(join->secondaries));
+  join->samples_joined = 0;
+  join->fills = 0;
+  join->gallops = 0;
+
+  /* One fill frame plus one held frame per secondary */
+  Batch_buff_t* primary = join->base.input_buffers[0];
+  join->frame_size = bb_frame_size(primary);
+  join->fill_frame = calloc(join->n_secondaries + 1, join->frame_size);
+  if (join->fill_frame == NULL) {
+    filt_deinit(&join->base);
+    return Bp_EC_MALLOC_FAIL;
+  }
+  err = asof_fill_frame(join, primary->dtype, primary->n_channels);
+  if (err != Bp_EC_OK) {
+    free(join->fill_frame);
+    join->fill_frame = NULL;
+    filt_deinit(&join->base);
+    return err;
+  }
+
+  join->base.ops.deinit = asof_join_deinit;
+  join->base.ops.describe = asof_join_describe;
+  join->base.ops.sink_connect = asof_join_sink_connect;
+
+  /* Regular or irregular inputs; no period constraint */
+  prop_constraints_from_buffer_append(&join->base, &config.buff_config, true);
+  prop_set_output_behavior_for_buffer_filter(&join->base, &config.buff_config,
+                                             false, false);
+
+  return Bp_EC_OK;
+}
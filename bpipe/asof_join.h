@@ -0,0 +1,68 @@
+#ifndef BPIPE_ASOF_JOIN_H
+#define BPIPE_ASOF_JOIN_H
+
+#include "batch_buffer.h"
+#include "core.h"
+
+/* AsofJoin: for every sample of a primary stream, the latest sample of each
+ * of K secondary streams at or before that timestamp.
+ *
+ * Input 0 is the primary, inputs 1..K are secondaries. Output 0 carries the
+ * primary samples unchanged and output j carries the value joined from input
+ * j, so all outputs share timing and length batch for batch. Inputs may be
+ * regular or carry per-sample timestamps (bb_sample_t_ns); when the primary
+ * is irregular every output buffer needs sample_timestamps.
+ *
+ * A secondary value older than max_staleness_ns, or a secondary that has
+ * not produced anything yet, is replaced by fill_value. Only one batch per
+ * secondary is held; the primary waits (through backpressure) until each
+ * secondary has moved past the primary timestamp or completed, so memory
+ * is bounded by the input rings and the skew between streams. The wait is
+ * bounded by timeout_us: a secondary with nothing newer by then goes idle and
+ * its last-known value is emitted, without further waits, until it produces
+ * again. Samples it delivers late are not re-joined.
+ */
+
+typedef struct _AsofJoin_config_t {
+  const char* name;
+  BatchBuffer_config buff_config; /* Applied to every input */
+  size_t n_secondaries;           /* 1..MAX_INPUTS-1 */
+  long long max_staleness_ns;     /* 0 = values never go stale */
+  double fill_value;              /* Emitted for stale/missing values */
+  long timeout_us;
+} AsofJoin_config_t;
+
+typedef struct _AsofSecondary_t {
+  Batch_t* batch;   /* Held input batch, NULL if none */
+  size_t idx;       /* First frame of `batch` not yet passed */
+  bool done;        /* Input completed, the held value is final */
+  bool idle;        /* Last fetch timed out; poll instead of waiting */
+  bool held_valid;  /* `held` contains a sample */
+  long long held_t; /* Timestamp of the held sample */
+  void* held;       /* Latest sample at or before the last query */
+} AsofSecondary_t;
+
+typedef struct _AsofJoin_t {
+  Filter_t base;
+
+  size_t n_secondaries;
+  long long max_staleness_ns;
+  double fill_value;
+
+  /* Scratch from init: fill frame, then one held frame per secondary */
+  void* fill_frame; /* fill_value converted to the input dtype */
+  size_t frame_size;
+
+  /* Runtime state, set up at worker start */
+  BbWaitSet_t ws; /* All inputs, registered while the worker runs */
+  AsofSecondary_t secondaries[MAX_INPUTS - 1];
+
+  /* Statistics */
+  uint64_t samples_joined; /* Primary samples emitted */
+  uint64_t fills;          /* Secondary values replaced by fill_value */
+  uint64_t gallops;        /* Searches within a secondary batch */
+} AsofJoin_t;
+
+Bp_EC asof_join_init(AsofJoin_t* join, AsofJoin_config_t config);
+
+#endif /* BPIPE_ASOF_JOIN_H */
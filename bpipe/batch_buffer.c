@@ -6,7 +6,13 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "arena.h"
 #include "bperr.h"
+#include "utils.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /* Branch prediction hints */
 #ifndef likely
@@ -16,12 +22,22 @@
 #define unlikely(x) __builtin_expect(!!(x), 0)
 #endif
 
+#define DTYPE_SIZE_ENTRY(NAME, TYPE) [DTYPE_##NAME] = sizeof(TYPE),
 size_t _data_size_lut[] = {
     [DTYPE_NDEF] = 0,
-    [DTYPE_I32] = sizeof(int32_t),
-    [DTYPE_FLOAT] = sizeof(float),
-    [DTYPE_U32] = sizeof(uint32_t),
+    BP_NUMERIC_DTYPES(DTYPE_SIZE_ENTRY)  // FLOAT, I32, U32, I16
+    [DTYPE_RECORD] = 1,
 };
+#undef DTYPE_SIZE_ENTRY
+
+/* Wake whichever wait sets watch this buffer (stop / force return) */
+static void bb_notify_waitsets(Batch_buff_t *buff)
+{
+  BbWaitSet_t *ws = atomic_load(&buff->consumer_ws);
+  if (ws) bb_waitset_notify(ws);
+  ws = atomic_load(&buff->producer_ws);
+  if (ws) bb_waitset_notify(ws);
+}
 
 /* Wait for buffer to have space available
  * @param buf Buffer to wait on
@@ -90,7 +106,8 @@ Bp_EC bb_await_notempty(Batch_buff_t *buff, long long timeout_us)
     abs_timeout = future_ts(timeout_us * 1000, CLOCK_REALTIME);
   }
 
-  while (bb_isempy(buff) && atomic_load(&buff->running) &&
+  while (bb_isempy(buff) && atomic_load(&buff->spill_pending) == 0 &&
+         atomic_load(&buff->running) &&
          !atomic_load(&buff->force_return_tail)) {
     int ret = 0;
     if (timeout_us == 0) {
@@ -127,21 +144,109 @@ Bp_EC bb_await_notempty(Batch_buff_t *buff, long long timeout_us)
   return ec;
 }
 
+/* Advance the tail past the current slot and wake a producer waiting for
+ * space. Consumer side only. */
+static inline void bb_release_tail(Batch_buff_t *buff, size_t current_tail)
+{
+  size_t new_tail = (current_tail + 1) & bb_modulo_mask(buff);
+  atomic_store_explicit(&buff->consumer.tail, new_tail, memory_order_release);
+
+  /* Signal producer that buffer isn't full. Mutex does not need to be aquired
+   * for this step given SPSC*/
+  pthread_cond_signal(&buff->not_full);
+
+  BbWaitSet_t *ws = atomic_load_explicit(&buff->producer_ws,
+                                         memory_order_relaxed);
+  if (ws) bb_waitset_notify(ws);
+}
+
+/* OVERFLOW_DROP_STALE: release queued data batches that are older than
+ * max_age_ns. Stops at the first fresh batch, at a control batch (completion
+ * and errors must always be delivered) or at a slot the consumer already
+ * holds. Returns true if the buffer was emptied by skipping. */
+static bool bb_skip_stale(Batch_buff_t *buff)
+{
+  if (buff->consumer.tail_handed_out) return false;
+
+  long long now = now_ns(buff->age_from_t_ns ? CLOCK_REALTIME
+                                             : CLOCK_MONOTONIC);
+  size_t skipped = 0;
+  for (;;) {
+    size_t head =
+        atomic_load_explicit(&buff->producer.head, memory_order_acquire);
+    size_t tail =
+        atomic_load_explicit(&buff->consumer.tail, memory_order_relaxed);
+    if (head == tail) break;
+
+    const Batch_t *batch = &buff->batch_ring[tail];
+    if (batch->ec != Bp_EC_OK) break;
+    long long born = buff->age_from_t_ns ? batch->t_ns : batch->submit_ns;
+    if (now - born <= buff->max_age_ns) break;
+
+    bb_release_tail(buff, tail);
+    skipped++;
+  }
+  if (skipped) {
+    atomic_fetch_add_explicit(&buff->consumer.dropped_stale, skipped,
+                              memory_order_relaxed);
+  }
+  return skipped && bb_isempy_lockfree(buff);
+}
+
+/* OVERFLOW_DROP_STALE: track whether the consumer holds the tail slot, so
+ * bb_skip_stale leaves it alone. No other mode reads the flag. */
+static inline void bb_mark_handed_out(Batch_buff_t *buff, bool held)
+{
+  if (unlikely(buff->overflow_behaviour == OVERFLOW_DROP_STALE)) {
+    buff->consumer.tail_handed_out = held;
+  }
+}
+
 /* Get the oldest consumable data batch. Doesn't change head or tail idx.
  * Returns NULL on timeout. */
 Batch_t *bb_get_tail(Batch_buff_t *buff, unsigned long timeout_us, Bp_EC *err)
 {
+  if (unlikely(buff->overflow_behaviour == OVERFLOW_DROP_STALE)) {
+    bb_skip_stale(buff);
+  }
+  if (unlikely(buff->spill != NULL)) {
+    Batch_t *spilled = bb_spill_tail(buff);
+    if (spilled) {
+      *err = Bp_EC_OK;
+      return spilled;
+    }
+  }
+
   /* Fast path - check if data available without locks */
   if (!bb_isempy_lockfree(buff)) {
     size_t idx = bb_get_tail_idx(buff);
     /* Memory fence ensures we see the batch data written by producer */
     atomic_thread_fence(memory_order_acquire);
     *err = Bp_EC_OK;
+    bb_mark_handed_out(buff, true);
     return &buff->batch_ring[idx];
   }
 
-  /* Slow path - wait for data */
-  Bp_EC rc = bb_await_notempty(buff, timeout_us);
+  /* Slow path - wait for data. Batches that are already stale on arrival
+   * (t_ns ages) are skipped and the wait resumes for what is left of the
+   * timeout. */
+  bool stale = unlikely(buff->overflow_behaviour == OVERFLOW_DROP_STALE);
+  long long deadline = stale && timeout_us > 0
+                           ? now_ns(CLOCK_MONOTONIC) +
+                                 (long long) timeout_us * 1000
+                           : 0;
+  long long wait_us = (long long) timeout_us;
+  Bp_EC rc;
+  for (;;) {
+    rc = bb_await_notempty(buff, wait_us);
+    if (rc != Bp_EC_OK || !stale || !bb_skip_stale(buff)) break;
+    if (deadline == 0) continue; /* Waiting indefinitely */
+    wait_us = (deadline - now_ns(CLOCK_MONOTONIC)) / 1000;
+    if (wait_us <= 0) {
+      rc = Bp_EC_TIMEOUT;
+      break;
+    }
+  }
   if (err != NULL) {
     *err = rc;
   }
@@ -149,7 +254,12 @@ Batch_t *bb_get_tail(Batch_buff_t *buff, unsigned long timeout_us, Bp_EC *err)
   if (rc != Bp_EC_OK) {
     return NULL;
   }
+  if (unlikely(buff->spill != NULL)) {
+    Batch_t *spilled = bb_spill_tail(buff);
+    if (spilled) return spilled;
+  }
   size_t idx = bb_get_tail_idx(buff);
+  bb_mark_handed_out(buff, true);
   return &buff->batch_ring[idx];
 }
 
@@ -158,6 +268,10 @@ Batch_t *bb_get_tail(Batch_buff_t *buff, unsigned long timeout_us, Bp_EC *err)
  */
 Bp_EC bb_del_tail(Batch_buff_t *buff)
 {
+  if (unlikely(buff->spill != NULL) && bb_spill_release(buff)) {
+    return Bp_EC_OK;
+  }
+
   /* Fast path - check without locks */
   size_t current_head =
       atomic_load_explicit(&buff->producer.head, memory_order_acquire);
@@ -170,16 +284,103 @@ Bp_EC bb_del_tail(Batch_buff_t *buff)
   }
 
   /* Not empty, increment tail */
-  size_t new_tail = (current_tail + 1) & bb_modulo_mask(buff);
-  atomic_store_explicit(&buff->consumer.tail, new_tail, memory_order_release);
-
-  /* Signal producer that buffer isn't full. Mutex does not need to be aquired
-   * for this step given SPSC*/
-  pthread_cond_signal(&buff->not_full);
+  bb_mark_handed_out(buff, false);
+  bb_release_tail(buff, current_tail);
 
   return Bp_EC_OK;
 }
 
+/* OVERFLOW_DECIMATE: pick the factor for the batch about to be submitted.
+ * The factor doubles while occupancy sits at or above the high-water mark
+ * and is not falling, and halves once it drops to the low-water mark. On a
+ * change the skip count is rebased so the first kept frame is one new
+ * period after the last kept frame. */
+static void bb_decimation_update(Batch_buff_t *buff)
+{
+  size_t occ = bb_occupancy(buff);
+  unsigned expo = atomic_load_explicit(&buff->producer.decim_expo,
+                                       memory_order_relaxed);
+  unsigned next = expo;
+  if (occ >= buff->high_water && occ >= buff->producer.decim_last_occ &&
+      expo < buff->max_decimation_expo) {
+    next = expo + 1;
+  } else if (occ <= buff->low_water && expo > 0) {
+    next = expo - 1;
+  }
+  buff->producer.decim_last_occ = occ;
+  if (next == expo) return;
+
+  size_t since_kept = ((size_t) 1 << expo) - buff->producer.decim_skip;
+  size_t factor = (size_t) 1 << next;
+  buff->producer.decim_skip = since_kept >= factor ? 0 : factor - since_kept;
+  atomic_store_explicit(&buff->producer.decim_expo, next,
+                        memory_order_relaxed);
+  atomic_fetch_add_explicit(&buff->producer.decim_changes, 1,
+                            memory_order_relaxed);
+}
+
+/* OVERFLOW_DECIMATE: thin the head batch in place to every 2^decim_expo-th
+ * frame, keeping the phase continuous across batches. Regular batches get
+ * t_ns moved to the first kept frame and period_ns scaled; irregular ones
+ * keep the matching timestamps. Control batches pass untouched. Returns
+ * false if no frame of the batch survives and it must not be published. */
+static bool bb_decimate_head(Batch_buff_t *buff)
+{
+  size_t head =
+      atomic_load_explicit(&buff->producer.head, memory_order_relaxed);
+  Batch_t *batch = &buff->batch_ring[head];
+  if (batch->ec != Bp_EC_OK) return true;
+
+  bb_decimation_update(buff);
+  size_t factor = (size_t) 1
+                  << atomic_load_explicit(&buff->producer.decim_expo,
+                                          memory_order_relaxed);
+  size_t skip = buff->producer.decim_skip;
+  size_t n = batch->head;
+  if (factor == 1 && skip == 0) return true;
+
+  if (n <= skip) {
+    buff->producer.decim_skip = skip - n;
+    atomic_fetch_add_explicit(&buff->producer.frames_decimated, n,
+                              memory_order_relaxed);
+    return false;
+  }
+
+  size_t kept = (n - skip + factor - 1) / factor;
+  size_t width = bb_getdatawidth(buff->dtype);
+  char *data = batch->data;
+  if (buff->layout == BATCH_LAYOUT_PLANAR) {
+    for (size_t c = 0; c < buff->n_channels; c++) {
+      char *plane = data + ((c * width) << buff->batch_capacity_expo);
+      for (size_t k = 0; k < kept; k++) {
+        memmove(plane + k * width, plane + (skip + k * factor) * width,
+                width);
+      }
+    }
+  } else {
+    size_t frame = width * buff->n_channels;
+    for (size_t k = 0; k < kept; k++) {
+      memmove(data + k * frame, data + (skip + k * factor) * frame, frame);
+    }
+  }
+
+  if (bb_batch_has_ts(batch)) {
+    for (size_t k = 0; k < kept; k++) {
+      batch->ts[k] = batch->ts[skip + k * factor];
+    }
+    batch->t_ns = batch->ts[0];
+  } else {
+    batch->t_ns += (long long) (skip * batch->period_ns);
+    batch->period_ns *= factor;
+  }
+  batch->head = kept;
+
+  buff->producer.decim_skip = skip + kept * factor - n;
+  atomic_fetch_add_explicit(&buff->producer.frames_decimated, n - kept,
+                            memory_order_relaxed);
+  return true;
+}
+
 /* Submit new batch - lock-free implementation for SPSC scenario.
  *
  * Dropping behaviour:
@@ -193,6 +394,16 @@ Bp_EC bb_del_tail(Batch_buff_t *buff)
  */
 Bp_EC bb_submit(Batch_buff_t *buff, unsigned long timeout_us)
 {
+  if (unlikely(buff->overflow_behaviour == OVERFLOW_DECIMATE) &&
+      !bb_decimate_head(buff)) {
+    return Bp_EC_OK;
+  }
+
+  if (unlikely(buff->spill != NULL)) {
+    Bp_EC rc;
+    if (bb_spill_offer(buff, timeout_us, &rc)) return rc;
+  }
+
   /* Fast path - check if full without locks */
   size_t current_head =
       atomic_load_explicit(&buff->producer.head, memory_order_relaxed);
@@ -227,7 +438,7 @@ Bp_EC bb_submit(Batch_buff_t *buff, unsigned long timeout_us)
 
       pthread_mutex_unlock(&buff->mutex);
     } else {
-      /* OVERFLOW_BLOCK - wait for space */
+      /* OVERFLOW_BLOCK / DROP_STALE / DECIMATE - wait for space */
       Bp_EC rc = bb_await_notfull(buff, timeout_us);
       if (rc != Bp_EC_OK) {
         return rc;
@@ -237,15 +448,284 @@ Bp_EC bb_submit(Batch_buff_t *buff, unsigned long timeout_us)
     /* Re-read tail after waiting/dropping */
   }
 
+  if (buff->overflow_behaviour == OVERFLOW_DROP_STALE) {
+    buff->batch_ring[current_head].submit_ns = now_ns(CLOCK_MONOTONIC);
+  }
+
   /* Fast path - we have space, update head */
   atomic_store_explicit(&buff->producer.head, next_head, memory_order_release);
   atomic_fetch_add(&buff->producer.total_batches, 1);
 
   pthread_cond_signal(&buff->not_empty);
 
+  BbWaitSet_t *ws = atomic_load_explicit(&buff->consumer_ws,
+                                         memory_order_relaxed);
+  if (ws) bb_waitset_notify(ws);
+
   return Bp_EC_OK;
 }
 
+/* Scalar transpose used for odd geometries and vector tails.
+ * Interleaved index f * n_channels + c <-> planar index c * stride + f. */
+static void transpose_scalar(void *dst, const void *src, size_t f0, size_t f1,
+                             size_t c0, size_t c1, size_t n_channels,
+                             size_t plane_stride, size_t width, bool interleave)
+{
+  char *d = dst;
+  const char *s = src;
+  for (size_t f = f0; f < f1; f++) {
+    for (size_t c = c0; c < c1; c++) {
+      size_t il = (f * n_channels + c) * width;
+      size_t pl = (c * plane_stride + f) * width;
+      if (interleave) {
+        memcpy(d + il, s + pl, width);
+      } else {
+        memcpy(d + pl, s + il, width);
+      }
+    }
+  }
+}
+
+#ifdef __SSE2__
+/* In-register 4x4 transpose of 32-bit lanes. */
+static inline void transpose4x4_epi32(__m128i *r0, __m128i *r1, __m128i *r2,
+                                      __m128i *r3)
+{
+  __m128i t0 = _mm_unpacklo_epi32(*r0, *r1);
+  __m128i t1 = _mm_unpacklo_epi32(*r2, *r3);
+  __m128i t2 = _mm_unpackhi_epi32(*r0, *r1);
+  __m128i t3 = _mm_unpackhi_epi32(*r2, *r3);
+  *r0 = _mm_unpacklo_epi64(t0, t1);
+  *r1 = _mm_unpackhi_epi64(t0, t1);
+  *r2 = _mm_unpacklo_epi64(t2, t3);
+  *r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+/* Vectorised 4-byte transpose. Handles the frame/channel range that is a
+ * multiple of the vector block and returns the number of frames covered;
+ * the caller finishes the rest with transpose_scalar. */
+static size_t transpose_sse2_u32(void *dst, const void *src, size_t n_frames,
+                                 size_t n_channels, size_t plane_stride,
+                                 bool interleave)
+{
+  uint32_t *d = dst;
+  const uint32_t *s = src;
+  size_t n_vec = n_frames & ~(size_t) 3;
+
+  if (n_channels == 2) {
+    for (size_t f = 0; f < n_vec; f += 4) {
+      if (interleave) {
+        __m128i a = _mm_loadu_si128((const __m128i *) (s + f));
+        __m128i b = _mm_loadu_si128((const __m128i *) (s + plane_stride + f));
+        _mm_storeu_si128((__m128i *) (d + 2 * f), _mm_unpacklo_epi32(a, b));
+        _mm_storeu_si128((__m128i *) (d + 2 * f + 4),
+                         _mm_unpackhi_epi32(a, b));
+      } else {
+        __m128i x = _mm_loadu_si128((const __m128i *) (s + 2 * f));
+        __m128i y = _mm_loadu_si128((const __m128i *) (s + 2 * f + 4));
+        x = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 1, 2, 0));
+        y = _mm_shuffle_epi32(y, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128((__m128i *) (d + f), _mm_unpacklo_epi64(x, y));
+        _mm_storeu_si128((__m128i *) (d + plane_stride + f),
+                         _mm_unpackhi_epi64(x, y));
+      }
+    }
+    return n_vec;
+  }
+
+  if ((n_channels & 3) != 0) {
+    return 0;
+  }
+
+  for (size_t f = 0; f < n_vec; f += 4) {
+    for (size_t c = 0; c < n_channels; c += 4) {
+      __m128i r0, r1, r2, r3;
+      if (interleave) {
+        r0 = _mm_loadu_si128((const __m128i *) (s + c * plane_stride + f));
+        r1 = _mm_loadu_si128(
+            (const __m128i *) (s + (c + 1) * plane_stride + f));
+        r2 = _mm_loadu_si128(
+            (const __m128i *) (s + (c + 2) * plane_stride + f));
+        r3 = _mm_loadu_si128(
+            (const __m128i *) (s + (c + 3) * plane_stride + f));
+        transpose4x4_epi32(&r0, &r1, &r2, &r3);
+        _mm_storeu_si128((__m128i *) (d + f * n_channels + c), r0);
+        _mm_storeu_si128((__m128i *) (d + (f + 1) * n_channels + c), r1);
+        _mm_storeu_si128((__m128i *) (d + (f + 2) * n_channels + c), r2);
+        _mm_storeu_si128((__m128i *) (d + (f + 3) * n_channels + c), r3);
+      } else {
+        r0 = _mm_loadu_si128((const __m128i *) (s + f * n_channels + c));
+        r1 = _mm_loadu_si128((const __m128i *) (s + (f + 1) * n_channels + c));
+        r2 = _mm_loadu_si128((const __m128i *) (s + (f + 2) * n_channels + c));
+        r3 = _mm_loadu_si128((const __m128i *) (s + (f + 3) * n_channels + c));
+        transpose4x4_epi32(&r0, &r1, &r2, &r3);
+        _mm_storeu_si128((__m128i *) (d + c * plane_stride + f), r0);
+        _mm_storeu_si128((__m128i *) (d + (c + 1) * plane_stride + f), r1);
+        _mm_storeu_si128((__m128i *) (d + (c + 2) * plane_stride + f), r2);
+        _mm_storeu_si128((__m128i *) (d + (c + 3) * plane_stride + f), r3);
+      }
+    }
+  }
+  return n_vec;
+}
+#endif
+
+static void transpose(void *dst, const void *src, size_t n_frames,
+                      size_t n_channels, size_t plane_stride, size_t width,
+                      bool interleave)
+{
+  size_t done = 0;
+#ifdef __SSE2__
+  if (width == sizeof(uint32_t)) {
+    done = transpose_sse2_u32(dst, src, n_frames, n_channels, plane_stride,
+                              interleave);
+  }
+#endif
+  transpose_scalar(dst, src, done, n_frames, 0, n_channels, n_channels,
+                   plane_stride, width, interleave);
+}
+
+void bb_interleave(void *dst, const void *src, size_t n_frames,
+                   size_t n_channels, size_t plane_stride, size_t width)
+{
+  transpose(dst, src, n_frames, n_channels, plane_stride, width, true);
+}
+
+void bb_deinterleave(void *dst, const void *src, size_t n_frames,
+                     size_t n_channels, size_t plane_stride, size_t width)
+{
+  transpose(dst, src, n_frames, n_channels, plane_stride, width, false);
+}
+
+void bb_copy_frames(const Batch_buff_t *dst_buf, Batch_t *dst, size_t dst_off,
+                    const Batch_buff_t *src_buf, const Batch_t *src,
+                    size_t src_off, size_t n)
+{
+  assert(dst_buf->dtype == src_buf->dtype);
+  assert(dst_buf->n_channels == src_buf->n_channels);
+  assert(dst->ts != NULL || !bb_batch_has_ts(src));
+
+  size_t width = bb_getdatawidth(src_buf->dtype);
+  size_t n_ch = src_buf->n_channels;
+  bool src_planar = src_buf->layout == BATCH_LAYOUT_PLANAR && n_ch > 1;
+  bool dst_planar = dst_buf->layout == BATCH_LAYOUT_PLANAR && n_ch > 1;
+
+  if (n == 0) return;
+
+  if (dst->ts && bb_batch_has_ts(src)) {
+    memcpy(dst->ts + dst_off, src->ts + src_off, n * sizeof(long long));
+  }
+
+  if (!src_planar && !dst_planar) {
+    memcpy((char *) dst->data + dst_off * width * n_ch,
+           (const char *) src->data + src_off * width * n_ch, n * width * n_ch);
+  } else if (src_planar && dst_planar) {
+    for (size_t c = 0; c < n_ch; c++) {
+      memcpy((char *) bb_channel_ptr(dst_buf, dst, c) + dst_off * width,
+             (const char *) bb_channel_ptr(src_buf, src, c) + src_off * width,
+             n * width);
+    }
+  } else if (src_planar) {
+    bb_interleave((char *) dst->data + dst_off * width * n_ch,
+                  (const char *) src->data + src_off * width, n, n_ch,
+                  (size_t) 1 << src_buf->batch_capacity_expo, width);
+  } else {
+    bb_deinterleave((char *) dst->data + dst_off * width,
+                    (const char *) src->data + src_off * width * n_ch, n, n_ch,
+                    (size_t) 1 << dst_buf->batch_capacity_expo, width);
+  }
+}
+
+void *bb_record_reserve(Batch_buff_t *buff, Batch_t *batch, size_t max_len)
+{
+  assert(buff->dtype == DTYPE_RECORD);
+  size_t capacity = (size_t) 1 << buff->batch_capacity_expo;
+  if (batch->head + bb_record_footprint(max_len) > capacity) {
+    return NULL;
+  }
+  /* The header holds the reservation until bb_record_commit */
+  BbRecord_t *rec = (BbRecord_t *) ((char *) batch->data + batch->head);
+  rec->len = (uint32_t) max_len;
+  rec->next = (uint32_t) bb_record_footprint(max_len);
+  return bb_record_payload(rec);
+}
+
+void bb_record_commit(Batch_t *batch, size_t len, long long t_ns)
+{
+  BbRecord_t *rec = (BbRecord_t *) ((char *) batch->data + batch->head);
+  /* A longer record would run past the space that was checked */
+  assert(len <= rec->len);
+  if (len > rec->len) len = rec->len;
+  rec->len = (uint32_t) len;
+  rec->next = (uint32_t) bb_record_footprint(len);
+  rec->t_ns = t_ns;
+  if (batch->head == 0) {
+    batch->t_ns = t_ns;
+    batch->period_ns = 0;
+  }
+  batch->head += rec->next;
+}
+
+size_t bb_record_reserve_n(Batch_buff_t *buff, Batch_t *batch, size_t n,
+                           size_t max_len, void **payloads)
+{
+  assert(buff->dtype == DTYPE_RECORD);
+  size_t capacity = (size_t) 1 << buff->batch_capacity_expo;
+  size_t stride = bb_record_footprint(max_len);
+  size_t fit = (capacity - batch->head) / stride;
+  if (fit > n) fit = n;
+
+  char *base = (char *) batch->data + batch->head;
+  for (size_t i = 0; i < fit; i++) {
+    payloads[i] = bb_record_payload((BbRecord_t *) (base + i * stride));
+  }
+  return fit;
+}
+
+void bb_record_commit_n(Batch_t *batch, size_t n, size_t max_len,
+                        const size_t *lens, const long long *t_ns)
+{
+  size_t stride = bb_record_footprint(max_len);
+  char *base = (char *) batch->data + batch->head;
+  for (size_t i = 0; i < n; i++) {
+    BbRecord_t *rec = (BbRecord_t *) (base + i * stride);
+    assert(lens[i] <= max_len);
+    rec->len = (uint32_t) (lens[i] < max_len ? lens[i] : max_len);
+    rec->next = (uint32_t) stride;
+    rec->t_ns = t_ns[i];
+  }
+  if (n > 0 && batch->head == 0) {
+    batch->t_ns = t_ns[0];
+    batch->period_ns = 0;
+  }
+  batch->head += n * stride;
+}
+
+Bp_EC bb_record_append(Batch_buff_t *buff, Batch_t *batch, const void *payload,
+                       size_t len, long long t_ns)
+{
+  if (len > bb_record_max_len(buff)) {
+    return Bp_EC_INVALID_DATA;
+  }
+  void *dst = bb_record_reserve(buff, batch, len);
+  if (!dst) {
+    return Bp_EC_NO_SPACE;
+  }
+  memcpy(dst, payload, len);
+  bb_record_commit(batch, len, t_ns);
+  return Bp_EC_OK;
+}
+
+size_t bb_record_count(const Batch_t *batch)
+{
+  size_t n = 0;
+  for (BbRecord_t *rec = bb_record_first(batch); rec;
+       rec = bb_record_next(batch, rec)) {
+    n++;
+  }
+  return n;
+}
+
 /* Initialize a batch buffer with specified parameters
  * @param buff Buffer to initialize
  * @param name Buffer name (e.g., "filter1.input[0]")
@@ -275,6 +755,37 @@ Bp_EC bb_init(Batch_buff_t *buff, const char *name, BatchBuffer_config config)
   if (config.overflow_behaviour > OVERFLOW_MAX) {
     return Bp_EC_INVALID_CONFIG;
   }
+
+  if (config.overflow_behaviour == OVERFLOW_DROP_STALE &&
+      config.max_age_us == 0) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+
+  if (config.n_channels > BB_MAX_CHANNELS ||
+      config.layout >= BATCH_LAYOUT_MAX) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+
+  /* Decimation thresholds must leave a hysteresis band inside the ring */
+  size_t high_water = config.high_water;
+  size_t low_water = config.low_water;
+  if (config.overflow_behaviour == OVERFLOW_DECIMATE) {
+    size_t usable = (1UL << config.ring_capacity_expo) - 1;
+    if (high_water == 0) high_water = MAX(usable * 3 / 4, 1);
+    if (low_water == 0) low_water = usable / 4;
+    if (config.dtype == DTYPE_RECORD || high_water > usable ||
+        low_water >= high_water || config.max_decimation_expo > 16) {
+      return Bp_EC_INVALID_CONFIG;
+    }
+  }
+
+  /* Record streams are single-channel byte rings with their own timestamps,
+   * and a batch must be able to hold at least one header plus payload */
+  if (config.dtype == DTYPE_RECORD &&
+      (config.n_channels > 1 || config.sample_timestamps ||
+       config.batch_capacity_expo < BB_RECORD_MIN_BATCH_EXPO)) {
+    return Bp_EC_INVALID_CONFIG;
+  }
   /* Clear the structure */
   memset(buff, 0, sizeof(Batch_buff_t));
 
@@ -287,11 +798,19 @@ Bp_EC bb_init(Batch_buff_t *buff, const char *name, BatchBuffer_config config)
   buff->ring_capacity_expo = config.ring_capacity_expo;
   buff->batch_capacity_expo = config.batch_capacity_expo;
   buff->overflow_behaviour = config.overflow_behaviour;
-
-  /* Calculate sizes */
+  buff->max_age_ns = (long long) config.max_age_us * 1000LL;
+  buff->age_from_t_ns = config.age_from_t_ns;
+  buff->high_water = high_water;
+  buff->low_water = low_water;
+  buff->max_decimation_expo =
+      config.max_decimation_expo ? config.max_decimation_expo : 4;
+  buff->n_channels = config.n_channels ? config.n_channels : 1;
+  buff->layout = config.layout;
+
+  /* Calculate sizes. A slot holds batch_capacity frames of n_channels. */
   size_t ring_capacity = 1UL << config.ring_capacity_expo;
   size_t batch_capacity = 1UL << config.batch_capacity_expo;
-  size_t data_width = bb_getdatawidth(config.dtype);
+  size_t data_width = bb_getdatawidth(config.dtype) * buff->n_channels;
 
   /* Allocate ring buffers */
   buff->batch_ring = calloc(ring_capacity, sizeof(Batch_t));
@@ -306,8 +825,21 @@ Bp_EC bb_init(Batch_buff_t *buff, const char *name, BatchBuffer_config config)
     return Bp_EC_MALLOC_FAIL;
   }
 
+  /* Optional timestamp column, laid out slot-for-slot with data_ring */
+  if (config.sample_timestamps) {
+    buff->ts_ring = calloc(ring_capacity * batch_capacity, sizeof(long long));
+    if (!buff->ts_ring) {
+      free(buff->data_ring);
+      free(buff->batch_ring);
+      buff->data_ring = NULL;
+      buff->batch_ring = NULL;
+      return Bp_EC_MALLOC_FAIL;
+    }
+  }
+
   /* Initialize synchronization primitives */
   if (pthread_mutex_init(&buff->mutex, NULL) != 0) {
+    free(buff->ts_ring);
     free(buff->data_ring);
     free(buff->batch_ring);
     return Bp_EC_MUTEX_INIT_FAIL;
@@ -315,6 +847,7 @@ Bp_EC bb_init(Batch_buff_t *buff, const char *name, BatchBuffer_config config)
 
   if (pthread_cond_init(&buff->not_empty, NULL) != 0) {
     pthread_mutex_destroy(&buff->mutex);
+    free(buff->ts_ring);
     free(buff->data_ring);
     free(buff->batch_ring);
     return Bp_EC_COND_INIT_FAIL;
@@ -323,6 +856,7 @@ Bp_EC bb_init(Batch_buff_t *buff, const char *name, BatchBuffer_config config)
   if (pthread_cond_init(&buff->not_full, NULL) != 0) {
     pthread_cond_destroy(&buff->not_empty);
     pthread_mutex_destroy(&buff->mutex);
+    free(buff->ts_ring);
     free(buff->data_ring);
     free(buff->batch_ring);
     return Bp_EC_COND_INIT_FAIL;
@@ -334,6 +868,8 @@ Bp_EC bb_init(Batch_buff_t *buff, const char *name, BatchBuffer_config config)
   atomic_store(&buff->producer.total_batches, 0);
   atomic_store(&buff->producer.dropped_batches, 0);
   atomic_store(&buff->consumer.dropped_by_producer, 0);
+  atomic_store(&buff->consumer.dropped_stale, 0);
+  buff->consumer.tail_handed_out = false;
   atomic_store(&buff->running, true);
 
   /* Initialize force return fields */
@@ -342,14 +878,28 @@ Bp_EC bb_init(Batch_buff_t *buff, const char *name, BatchBuffer_config config)
   buff->force_return_head_code = Bp_EC_OK;
   buff->force_return_tail_code = Bp_EC_OK;
 
+  buff->owns_storage = true;
+
   /* Populate key batch data*/
   for (int i = 0; i < bb_n_batches(buff); i++) {
     buff->batch_ring[i].head = 0;
     buff->batch_ring[i].t_ns = -1;
+    buff->batch_ring[i].n_channels = (unsigned) buff->n_channels;
+    buff->batch_ring[i].layout = buff->layout;
+    buff->batch_ring[i].ts =
+        buff->ts_ring ? buff->ts_ring + bb_batch_size(buff) * i : NULL;
     buff->batch_ring[i].data =
         (char *) buff->data_ring + (bb_batch_size(buff) * data_width * i);
   }
 
+  if (config.overflow_behaviour == OVERFLOW_SPILL) {
+    Bp_EC rc = bb_spill_init(buff, &config);
+    if (rc != Bp_EC_OK) {
+      bb_deinit(buff);
+      return rc;
+    }
+  }
+
   return Bp_EC_OK;
 }
 
@@ -384,12 +934,26 @@ Bp_EC bb_deinit(Batch_buff_t *buff)
   pthread_cond_destroy(&buff->not_empty);
   pthread_mutex_destroy(&buff->mutex);
 
-  /* Free memory */
+  bb_spill_deinit(buff);
+  bb_share_leave(buff);
+
+  /* Free memory, unless it belongs to someone else (e.g. a pipeline arena) */
+  if (!buff->owns_storage) {
+    buff->data_ring = NULL;
+    buff->ts_ring = NULL;
+    buff->batch_ring = NULL;
+  }
+
   if (buff->data_ring) {
     free(buff->data_ring);
     buff->data_ring = NULL;
   }
 
+  if (buff->ts_ring) {
+    free(buff->ts_ring);
+    buff->ts_ring = NULL;
+  }
+
   if (buff->batch_ring) {
     free(buff->batch_ring);
     buff->batch_ring = NULL;
@@ -401,6 +965,243 @@ Bp_EC bb_deinit(Batch_buff_t *buff)
   return Bp_EC_OK;
 }
 
+#define BB_STORAGE_ALIGN 64
+
+static size_t bb_storage_sections(const Batch_buff_t *buff, size_t *slots,
+                                  size_t *data, size_t *ts)
+{
+  size_t ring_capacity = 1UL << buff->ring_capacity_expo;
+  size_t samples = ring_capacity << buff->batch_capacity_expo;
+  *slots = ring_capacity * sizeof(Batch_t);
+  *data = samples * bb_getdatawidth(buff->dtype) * bb_n_channels(buff);
+  *ts = buff->ts_ring ? samples * sizeof(long long) : 0;
+  return arena_align_up(*slots, BB_STORAGE_ALIGN) +
+         arena_align_up(*data, BB_STORAGE_ALIGN) +
+         arena_align_up(*ts, BB_STORAGE_ALIGN);
+}
+
+/* Copy the rings into new storage and re-point every slot at its data/ts
+ * window there. Heap copies the buffer owned are freed. */
+static void bb_move_rings(Batch_buff_t *buff, Batch_t *batch_ring,
+                          char *data_ring, long long *ts_ring, size_t slots,
+                          size_t data, size_t ts)
+{
+  memcpy(batch_ring, buff->batch_ring, slots);
+  memcpy(data_ring, buff->data_ring, data);
+  if (ts_ring) memcpy(ts_ring, buff->ts_ring, ts);
+
+  size_t slot_bytes = bb_batch_bytes(buff);
+  for (size_t i = 0; i < bb_n_batches(buff); i++) {
+    batch_ring[i].data = data_ring + slot_bytes * i;
+    batch_ring[i].ts = ts_ring ? ts_ring + bb_batch_size(buff) * i : NULL;
+  }
+
+  if (buff->owns_storage) {
+    free(buff->ts_ring);
+    free(buff->data_ring);
+    free(buff->batch_ring);
+  }
+  buff->batch_ring = batch_ring;
+  buff->data_ring = data_ring;
+  buff->ts_ring = ts_ring;
+}
+
+size_t bb_storage_size(const Batch_buff_t *buff)
+{
+  size_t slots, data, ts;
+  if (!buff || !buff->batch_ring) return 0;
+  return bb_storage_sections(buff, &slots, &data, &ts);
+}
+
+Bp_EC bb_adopt_storage(Batch_buff_t *buff, void *mem, size_t size)
+{
+  if (!buff || !mem) return Bp_EC_NULL_POINTER;
+  if (!buff->batch_ring) return Bp_EC_NULL_BUFF;
+  if ((uintptr_t) mem % BB_STORAGE_ALIGN != 0) return Bp_EC_INVALID_CONFIG;
+  if (!bb_isempy(buff)) return Bp_EC_INVALID_CONFIG;
+  /* Slots may point into other buffers' rings after bb_swap_data */
+  if (atomic_load(&buff->share) != NULL) return Bp_EC_INVALID_CONFIG;
+
+  size_t slots, data, ts;
+  if (size < bb_storage_sections(buff, &slots, &data, &ts)) {
+    return Bp_EC_NO_SPACE;
+  }
+
+  char *p = mem;
+  Batch_t *batch_ring = (Batch_t *) p;
+  p += arena_align_up(slots, BB_STORAGE_ALIGN);
+  char *data_ring = p;
+  p += arena_align_up(data, BB_STORAGE_ALIGN);
+  long long *ts_ring = ts ? (long long *) p : NULL;
+
+  bb_move_rings(buff, batch_ring, data_ring, ts_ring, slots, data, ts);
+  buff->owns_storage = false;
+  return Bp_EC_OK;
+}
+
+Bp_EC bb_release_storage(Batch_buff_t *buff)
+{
+  if (!buff) return Bp_EC_NULL_POINTER;
+  if (!buff->batch_ring) return Bp_EC_NULL_BUFF;
+  if (buff->owns_storage) return Bp_EC_OK;
+  if (!bb_isempy(buff)) return Bp_EC_INVALID_CONFIG;
+  if (atomic_load(&buff->share) != NULL) return Bp_EC_INVALID_CONFIG;
+
+  size_t slots, data, ts;
+  bb_storage_sections(buff, &slots, &data, &ts);
+  Batch_t *batch_ring = malloc(slots);
+  char *data_ring = malloc(data);
+  long long *ts_ring = ts ? malloc(ts) : NULL;
+  if (!batch_ring || !data_ring || (ts && !ts_ring)) {
+    free(ts_ring);
+    free(data_ring);
+    free(batch_ring);
+    return Bp_EC_MALLOC_FAIL;
+  }
+
+  bb_move_rings(buff, batch_ring, data_ring, ts_ring, slots, data, ts);
+  buff->owns_storage = true;
+  return Bp_EC_OK;
+}
+
+/* Frames [0, n) of a batch, one contiguous run per plane */
+static Bp_EC bb_ckpt_frames(const Batch_buff_t *buff, Batch_t *batch,
+                            size_t n, Checkpoint_t *ck, bool store)
+{
+  size_t width = bb_getdatawidth(buff->dtype);
+  bool planar = buff->layout == BATCH_LAYOUT_PLANAR && buff->n_channels > 1;
+  size_t runs = planar ? buff->n_channels : 1;
+  size_t run_bytes = planar ? n * width : n * bb_frame_size(buff);
+
+  for (size_t c = 0; c < runs; c++) {
+    void *p = planar ? bb_channel_ptr(buff, batch, c) : batch->data;
+    Bp_EC err = store ? ckpt_write(ck, p, run_bytes)
+                      : ckpt_read(ck, p, run_bytes);
+    if (err != Bp_EC_OK) return err;
+  }
+  return Bp_EC_OK;
+}
+
+/* Batch fields in a checkpoint; `meta` is a pointer and is not kept */
+typedef struct {
+  uint64_t head;
+  int64_t t_ns;
+  uint64_t batch_id;
+  uint32_t period_ns;
+  int32_t ec;
+  uint32_t has_ts;
+} BbCkptBatch_t;
+
+/* Ring shape in a checkpoint; a restore target must match all of it */
+typedef struct {
+  uint32_t n_batches; /* Batches that follow */
+  uint32_t frame_size;
+  uint32_t batch_capacity_expo;
+  uint32_t dtype;
+  uint32_t layout;
+  uint32_t n_channels;
+} BbCkptGeometry_t;
+
+static BbCkptGeometry_t bb_ckpt_geometry(const Batch_buff_t *buff,
+                                         uint32_t n_batches)
+{
+  return (BbCkptGeometry_t){
+      .n_batches = n_batches,
+      .frame_size = (uint32_t) bb_frame_size(buff),
+      .batch_capacity_expo = (uint32_t) buff->batch_capacity_expo,
+      .dtype = (uint32_t) buff->dtype,
+      .layout = (uint32_t) buff->layout,
+      .n_channels = (uint32_t) buff->n_channels};
+}
+
+Bp_EC bb_checkpoint(Batch_buff_t *buff, Checkpoint_t *ck)
+{
+  if (buff == NULL || ck == NULL) return Bp_EC_NULL_POINTER;
+  /* Spilled batches live in the spill file, outside the ring */
+  if (atomic_load(&buff->spill_pending) > 0) return Bp_EC_NOT_IMPLEMENTED;
+
+  size_t mask = bb_modulo_mask(buff);
+  size_t tail = atomic_load(&buff->consumer.tail);
+  size_t head = atomic_load(&buff->producer.head);
+  BbCkptGeometry_t geom =
+      bb_ckpt_geometry(buff, (uint32_t) ((head - tail) & mask));
+  Bp_EC err = CKPT_PUT(ck, geom);
+
+  for (size_t i = tail; err == Bp_EC_OK && i != head; i = (i + 1) & mask) {
+    Batch_t *batch = &buff->batch_ring[i];
+    BbCkptBatch_t rec = {.head = batch->head,
+                         .t_ns = batch->t_ns,
+                         .batch_id = batch->batch_id,
+                         .period_ns = batch->period_ns,
+                         .ec = batch->ec,
+                         .has_ts = bb_batch_has_ts(batch)};
+    err = CKPT_PUT(ck, rec);
+    if (err == Bp_EC_OK) err = bb_ckpt_frames(buff, batch, rec.head, ck, true);
+    if (err == Bp_EC_OK && rec.has_ts) {
+      err = ckpt_write(ck, batch->ts, rec.head * sizeof(long long));
+    }
+  }
+  return err;
+}
+
+/* Validate a ring record against `buff`; queue its batches if `apply`,
+ * otherwise only step over them. */
+static Bp_EC bb_ckpt_load(Batch_buff_t *buff, Checkpoint_t *ck, bool apply)
+{
+  if (!bb_isempy(buff)) return Bp_EC_INVALID_CONFIG;
+
+  BbCkptGeometry_t geom;
+  Bp_EC err = CKPT_GET(ck, geom);
+  if (err != Bp_EC_OK) return err;
+  BbCkptGeometry_t want = bb_ckpt_geometry(buff, geom.n_batches);
+  if (geom.n_batches >= bb_n_batches(buff) ||
+      memcmp(&geom, &want, sizeof(geom)) != 0) {
+    return Bp_EC_INVALID_DATA;
+  }
+
+  size_t mask = bb_modulo_mask(buff);
+  size_t head = atomic_load(&buff->producer.head);
+  for (uint32_t n = 0; n < geom.n_batches; n++) {
+    Batch_t *batch = &buff->batch_ring[head];
+    BbCkptBatch_t rec;
+    err = CKPT_GET(ck, rec);
+    if (err != Bp_EC_OK) return err;
+    if (rec.head > bb_batch_size(buff) || (rec.has_ts && !batch->ts)) {
+      return Bp_EC_INVALID_DATA;
+    }
+    size_t ts_bytes = rec.has_ts ? rec.head * sizeof(long long) : 0;
+    if (!apply) {
+      err = ckpt_skip(ck, rec.head * bb_frame_size(buff) + ts_bytes);
+      if (err != Bp_EC_OK) return err;
+      continue;
+    }
+    err = bb_ckpt_frames(buff, batch, rec.head, ck, false);
+    if (err == Bp_EC_OK && rec.has_ts) err = ckpt_read(ck, batch->ts, ts_bytes);
+    if (err != Bp_EC_OK) return err;
+    batch->head = rec.head;
+    batch->t_ns = rec.t_ns;
+    batch->batch_id = rec.batch_id;
+    batch->period_ns = rec.period_ns;
+    batch->ec = (Bp_EC) rec.ec;
+    batch->meta = NULL;
+    head = (head + 1) & mask;
+    atomic_store(&buff->producer.head, head);
+  }
+  return Bp_EC_OK;
+}
+
+Bp_EC bb_restore(Batch_buff_t *buff, Checkpoint_t *ck)
+{
+  if (buff == NULL || ck == NULL) return Bp_EC_NULL_POINTER;
+  return bb_ckpt_load(buff, ck, true);
+}
+
+Bp_EC bb_restore_check(Batch_buff_t *buff, Checkpoint_t *ck)
+{
+  if (buff == NULL || ck == NULL) return Bp_EC_NULL_POINTER;
+  return bb_ckpt_load(buff, ck, false);
+}
+
 /* Start the buffer (set running flag)
  * @param buff Buffer to start
  * @return Bp_EC_OK on success
@@ -415,6 +1216,31 @@ Bp_EC bb_start(Batch_buff_t *buff)
   return Bp_EC_OK;
 }
 
+/* Snapshot the buffer's counters. Each field is read atomically but the set
+ * is not a consistent cut while producer and consumer are running. */
+Bp_EC bb_get_stats(const Batch_buff_t *buff, BbStats_t *stats)
+{
+  if (!buff || !stats) {
+    return Bp_EC_NULL_POINTER;
+  }
+
+  memset(stats, 0, sizeof(*stats));
+  stats->total_batches = atomic_load(&buff->producer.total_batches);
+  stats->dropped_head = atomic_load(&buff->producer.dropped_batches);
+  stats->dropped_tail = atomic_load(&buff->consumer.dropped_by_producer);
+  stats->dropped_stale = atomic_load(&buff->consumer.dropped_stale);
+  stats->dropped_total =
+      stats->dropped_head + stats->dropped_tail + stats->dropped_stale;
+  stats->blocked_time_ns = buff->producer.blocked_time_ns;
+  stats->occupancy = bb_occupancy(buff);
+  stats->decimation_factor = (size_t) 1 << atomic_load(
+                                 &buff->producer.decim_expo);
+  stats->decimation_changes = atomic_load(&buff->producer.decim_changes);
+  stats->frames_decimated = atomic_load(&buff->producer.frames_decimated);
+  bb_spill_stats(buff, stats);
+  return Bp_EC_OK;
+}
+
 /* Stop the buffer (clear running flag and wake waiting threads)
  * @param buff Buffer to stop
  * @return Bp_EC_OK on success
@@ -433,6 +1259,8 @@ Bp_EC bb_stop(Batch_buff_t *buff)
   pthread_cond_broadcast(&buff->not_full);
   pthread_mutex_unlock(&buff->mutex);
 
+  bb_notify_waitsets(buff);
+
   return Bp_EC_OK;
 }
 
@@ -454,6 +1282,7 @@ Bp_EC bb_force_return_head(Batch_buff_t *buff, Bp_EC return_code)
   atomic_store(&buff->force_return_head, true);
   pthread_cond_signal(&buff->not_full); /* Wake producer if waiting */
   pthread_mutex_unlock(&buff->mutex);
+  bb_notify_waitsets(buff);
 
   return Bp_EC_OK;
 }
@@ -476,6 +1305,7 @@ Bp_EC bb_force_return_tail(Batch_buff_t *buff, Bp_EC return_code)
   atomic_store(&buff->force_return_tail, true);
   pthread_cond_signal(&buff->not_empty); /* Wake consumer if waiting */
   pthread_mutex_unlock(&buff->mutex);
+  bb_notify_waitsets(buff);
 
   return Bp_EC_OK;
 }
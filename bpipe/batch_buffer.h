@@ -15,27 +15,79 @@
 #include <time.h>
 #include <unistd.h>
 #include "bperr.h"
+#include "checkpoint.h"
 
 typedef enum _SampleType {
   DTYPE_NDEF = 0,
   DTYPE_FLOAT,
   DTYPE_I32,
   DTYPE_U32,
+  DTYPE_I16,     // Q15 fixed-point and raw 16-bit ADC samples
+  DTYPE_RECORD,  // Byte stream of variable-length records (see bb_record_*)
   DTYPE_MAX,
 } SampleDtype_t;
 
+/* Numeric sample types as an X-macro: X(DTYPE suffix, C element type).
+ * Expand it to stamp out one copy of a kernel per dtype and index the
+ * resulting table by SampleDtype_t, so the dtype is resolved once when a
+ * worker starts rather than per sample. */
+#define BP_NUMERIC_DTYPES(X) \
+  X(FLOAT, float)            \
+  X(I32, int32_t)            \
+  X(U32, uint32_t)           \
+  X(I16, int16_t)
+
 typedef enum _OverflowBehaviour {
   OVERFLOW_BLOCK = 0,  // Block when buffer is full (default/current behavior)
   OVERFLOW_DROP_HEAD = 1,  // Drop new samples when buffer is full
   OVERFLOW_DROP_TAIL = 2,  // Drop oldest batch when buffer is full
+  OVERFLOW_DROP_STALE = 3,  // Block when full; consumer skips aged batches
+  OVERFLOW_DECIMATE = 4,    // Thin batches 2x, 4x, ... while backlogged
+  OVERFLOW_SPILL = 5,       // Queue overflow in a memory-mapped spill file
   OVERFLOW_MAX
 } OverflowBehaviour_t;
 
+/* Memory layout of multi-channel batches. Single channel buffers are
+ * identical in either layout. */
+typedef enum _BatchLayout {
+  BATCH_LAYOUT_INTERLEAVED = 0,  // Frame-major: c0 c1 .. cN-1 c0 c1 ..
+  BATCH_LAYOUT_PLANAR = 1,       // Channel-major: one plane per channel
+  BATCH_LAYOUT_MAX
+} BatchLayout_t;
+
+/* Upper bound on channels per buffer (sanity limit for bb_init). */
+#define BB_MAX_CHANNELS 1024
+
 typedef struct _BatchBuffer_config {
   SampleDtype_t dtype;
   size_t batch_capacity_expo;
   size_t ring_capacity_expo;
   OverflowBehaviour_t overflow_behaviour;
+  size_t n_channels;       // Channels per sample frame (0 is treated as 1)
+  BatchLayout_t layout;    // Channel layout within a batch
+  bool sample_timestamps;  // Allocate a per-sample timestamp column
+
+  /* OVERFLOW_DROP_STALE only. A batch older than max_age_us when the
+   * consumer reaches it is skipped. Age is measured from bb_submit, or from
+   * t_ns against CLOCK_REALTIME when age_from_t_ns is set (sources must then
+   * stamp wall-clock time). */
+  unsigned long max_age_us;
+  bool age_from_t_ns;
+
+  /* OVERFLOW_DECIMATE only. At submit, occupancy (in batches) at or above
+   * high_water doubles the decimation factor and at or below low_water
+   * halves it, up to 2^max_decimation_expo. Zeros select 3/4 and 1/4 of the
+   * ring and a 16x cap. Not available for record streams. */
+  size_t high_water;
+  size_t low_water;
+  unsigned max_decimation_expo;
+
+  /* OVERFLOW_SPILL only. Batches that find the ring full go to an unlinked
+   * file in spill_dir (NULL = $TMPDIR or /tmp) holding 2^spill_capacity_expo
+   * batches (0 = 256). When that is full too the producer blocks for up to
+   * its timeout; with timeout 0 bb_submit returns Bp_EC_TIMEOUT at once. */
+  const char *spill_dir;
+  size_t spill_capacity_expo;
 } BatchBuffer_config;
 
 extern size_t _data_size_lut[DTYPE_MAX];
@@ -70,6 +122,8 @@ static inline struct timespec future_ts(long long time_ns, clockid_t clock)
 }
 
 typedef struct _Batch {
+  /* Number of sample frames in the batch. A frame holds one sample per
+   * channel, so a single-channel batch has head == number of samples. */
   size_t head;
   // int capacity;
   long long t_ns;
@@ -90,17 +144,84 @@ typedef struct _Batch {
    * all data types.
    */
   void *data;
+
+  /* Channel geometry, copied from the owning buffer at bb_init. Planar
+   * batches store channel c at data + c * batch_capacity * data_width. */
+  unsigned n_channels;
+  BatchLayout_t layout;
+
+  /* Per-sample timestamps, one per frame. NULL unless the buffer was created
+   * with sample_timestamps. Only meaningful when period_ns == 0; regular
+   * batches keep using t_ns + i * period_ns and never touch this column. */
+  long long *ts;
+
+  /* CLOCK_MONOTONIC time of bb_submit, stamped for OVERFLOW_DROP_STALE. */
+  long long submit_ns;
 } Batch_t;
 
 #define BATCH_GET_SAMPLE_U32(batch, idx) (((uint32_t *) (batch)->data) + (idx))
 
+/* Record streams (DTYPE_RECORD).
+ *
+ * A record buffer is a byte ring: batch capacity is in bytes and `head` is
+ * the number of bytes used. Each batch holds a contiguous run of records,
+ * every record being a header followed by its payload. `next` is the offset
+ * from this header to the following one, which lets bulk reservations commit
+ * records shorter than the slot they reserved without compacting. Headers are
+ * 8-byte aligned. Passthrough-style filters move record batches unchanged as
+ * they simply copy `head` bytes.
+ */
+typedef struct _BbRecord {
+  uint32_t len;  /* Payload length in bytes */
+  uint32_t next; /* Offset to the next record header */
+  long long t_ns;
+} BbRecord_t;
+
+#define BB_RECORD_ALIGN 8
+/* Smallest batch that can hold a record, as batch_capacity_expo. */
+#define BB_RECORD_MIN_BATCH_EXPO 5
+
+static inline size_t bb_record_footprint(size_t len)
+{
+  return sizeof(BbRecord_t) +
+         ((len + BB_RECORD_ALIGN - 1) & ~(size_t) (BB_RECORD_ALIGN - 1));
+}
+
+static inline void *bb_record_payload(const BbRecord_t *rec)
+{
+  return (void *) (rec + 1);
+}
+
+/* First record of a batch, NULL if the batch is empty. */
+static inline BbRecord_t *bb_record_first(const Batch_t *batch)
+{
+  return batch->head > 0 ? (BbRecord_t *) batch->data : NULL;
+}
+
+/* Record following `rec`, NULL at the end of the batch. */
+static inline BbRecord_t *bb_record_next(const Batch_t *batch,
+                                         const BbRecord_t *rec)
+{
+  char *next = (char *) rec + rec->next;
+  return next < (char *) batch->data + batch->head ? (BbRecord_t *) next
+                                                   : NULL;
+}
+
+struct _BbWaitSet;
+struct _BbSpill;
+struct _BbShare;
+
 typedef struct _Bp_BatchBuffer {
   /* Existing synchronization and storage */
   char name[32]; /* e.g., "filter1.input[0]" */
   SampleDtype_t dtype;
+  size_t n_channels;    /* Channels per frame, always >= 1 */
+  BatchLayout_t layout; /* Interleaved or planar channel storage */
 
   void *data_ring;
+  long long *ts_ring; /* Per-sample timestamp column, NULL if disabled */
   Batch_t *batch_ring;
+  bool owns_storage; /* false once rings live in external memory (arena) */
 
   /* CRITICAL DESIGN DECISION: Producer and consumer fields are separated into
    * different cache lines to prevent false sharing. False sharing occurs when
@@ -116,6 +237,13 @@ typedef struct _Bp_BatchBuffer {
     _Atomic uint64_t total_batches;   /* Total batches submitted */
     _Atomic uint64_t dropped_batches; /* Dropped due to overflow */
     uint64_t blocked_time_ns;         /* Time spent blocking */
+
+    /* OVERFLOW_DECIMATE state */
+    _Atomic unsigned decim_expo;        /* Current factor is 2^decim_expo */
+    size_t decim_skip;                  /* Frames to drop before next keep */
+    size_t decim_last_occ;              /* Occupancy at the previous submit */
+    _Atomic uint64_t decim_changes;     /* Factor changes, up or down */
+    _Atomic uint64_t frames_decimated;  /* Frames removed by decimation */
   } producer __attribute__((aligned(64)));
 
   /* Consumer-only fields - modified only by consumer thread */
@@ -123,6 +251,8 @@ typedef struct _Bp_BatchBuffer {
     _Atomic size_t tail; /* Next slot to read */
     _Atomic uint64_t
         dropped_by_producer; /* Batches dropped by producer in DROP_TAIL mode */
+    _Atomic uint64_t dropped_stale; /* Skipped as too old in DROP_STALE mode */
+    bool tail_handed_out; /* bb_get_tail returned the current tail slot */
   } consumer __attribute__((aligned(64)));
 
   /* Shared fields - accessed by both threads but only on slow path */
@@ -142,6 +272,25 @@ typedef struct _Bp_BatchBuffer {
   Bp_EC force_return_tail_code;   /* Error code for consumer */
 
   OverflowBehaviour_t overflow_behaviour;
+  long long max_age_ns; /* OVERFLOW_DROP_STALE age limit */
+  bool age_from_t_ns;   /* Age measured from t_ns instead of submit time */
+  size_t high_water;    /* OVERFLOW_DECIMATE thresholds, in batches */
+  size_t low_water;
+  unsigned max_decimation_expo;
+
+  /* Wait sets notified on submit (consumer side) and on tail release
+   * (producer side). NULL unless registered with bb_waitset_add_*. */
+  struct _BbWaitSet *_Atomic consumer_ws;
+  struct _BbWaitSet *_Atomic producer_ws;
+
+  /* OVERFLOW_SPILL: spill area and the number of batches queued in it.
+   * Spilled batches are always newer than everything in the ring. */
+  struct _BbSpill *spill;
+  _Atomic size_t spill_pending;
+
+  /* Buffers this one has swapped batch storage with (bb_swap_data); they
+   * own their rings jointly. NULL until the first swap. */
+  struct _BbShare *_Atomic share;
 } Batch_buff_t;
 
 static inline size_t bb_get_tail_idx(Batch_buff_t *buff)
@@ -168,6 +317,51 @@ static inline unsigned long bb_batch_size(Batch_buff_t *buf)
   return 1u << buf->batch_capacity_expo;
 }
 
+static inline size_t bb_n_channels(const Batch_buff_t *buf)
+{
+  return buf->n_channels;
+}
+
+/* Bytes occupied by one sample frame (all channels). */
+static inline size_t bb_frame_size(const Batch_buff_t *buf)
+{
+  return bb_getdatawidth(buf->dtype) * buf->n_channels;
+}
+
+/* Bytes occupied by one batch slot. */
+static inline size_t bb_batch_bytes(const Batch_buff_t *buf)
+{
+  return bb_frame_size(buf) << buf->batch_capacity_expo;
+}
+
+/* Start of channel `ch` for a batch of `buf`. For interleaved batches the
+ * returned pointer has a stride of n_channels elements, for planar batches it
+ * is contiguous. */
+static inline void *bb_channel_ptr(const Batch_buff_t *buf,
+                                   const Batch_t *batch, size_t ch)
+{
+  size_t width = bb_getdatawidth(buf->dtype);
+  if (buf->layout == BATCH_LAYOUT_PLANAR) {
+    return (char *) batch->data + ((ch * width) << buf->batch_capacity_expo);
+  }
+  return (char *) batch->data + ch * width;
+}
+
+/* True if `batch` carries its timing in the per-sample timestamp column. */
+static inline bool bb_batch_has_ts(const Batch_t *batch)
+{
+  return batch->ts != NULL && batch->period_ns == 0;
+}
+
+/* Timestamp of frame `i` of `batch`, from whichever timing model it uses. */
+static inline long long bb_sample_t_ns(const Batch_t *batch, size_t i)
+{
+  if (bb_batch_has_ts(batch)) {
+    return batch->ts[i];
+  }
+  return batch->t_ns + (long long) i * batch->period_ns;
+}
+
 static inline unsigned long bb_modulo_mask(const Batch_buff_t *buff)
 {
   return (1u << buff->ring_capacity_expo) - 1u;
@@ -246,7 +440,10 @@ __attribute__((returns_nonnull)) static inline Batch_t *bb_get_head(
   return &buff->batch_ring[idx];
 }
 
-/* Get the oldest consumable data batch. Doesn't change head or tail idx. */
+/* Get the oldest consumable data batch. Doesn't change head or tail idx.
+ * In OVERFLOW_DROP_STALE mode data batches that have aged past the limit are
+ * released first (control batches such as Bp_EC_COMPLETE never are); a slot
+ * already handed out is not dropped until bb_del_tail. */
 Batch_t *bb_get_tail(Batch_buff_t *buff, unsigned long timeout_us, Bp_EC *err);
 
 /* Delete oldest batch and increment the tail pointer marking the slot as
@@ -268,14 +465,192 @@ Bp_EC bb_init(Batch_buff_t *buff, const char *name, BatchBuffer_config config);
 
 Bp_EC bb_deinit(Batch_buff_t *buff);
 
+/* External ring storage. bb_storage_size reports the bytes (64-byte aligned
+ * sections for slots, data and timestamps) needed to host an initialised
+ * buffer's rings. bb_adopt_storage moves the rings into `mem`, frees the heap
+ * copies and leaves the caller responsible for `mem`. bb_release_storage moves
+ * adopted rings back onto the heap, after which `mem` may be freed. In both
+ * cases the buffer must be empty and not in use by any thread.
+ */
+size_t bb_storage_size(const Batch_buff_t *buff);
+Bp_EC bb_adopt_storage(Batch_buff_t *buff, void *mem, size_t size);
+Bp_EC bb_release_storage(Batch_buff_t *buff);
+
+/* Queued batches for warm restarts. bb_checkpoint writes every batch between
+ * tail and head (data, timing and timestamps, not `meta`); bb_restore queues
+ * them again in an empty buffer of the same geometry (frame size, batch
+ * capacity, dtype, layout and channel count). bb_restore_check runs the same
+ * checks and skips the record without touching the buffer. None may run
+ * while a producer or consumer is active. Buffers with spilled batches are
+ * not supported.
+ */
+Bp_EC bb_checkpoint(Batch_buff_t *buff, Checkpoint_t *ck);
+Bp_EC bb_restore(Batch_buff_t *buff, Checkpoint_t *ck);
+Bp_EC bb_restore_check(Batch_buff_t *buff, Checkpoint_t *ck);
+
 Bp_EC bb_start(Batch_buff_t *buff);
 
+/* Snapshot of a buffer's counters. Safe to call from any thread. */
+typedef struct _BbStats_t {
+  uint64_t total_batches;   /* Batches submitted */
+  uint64_t dropped_head;    /* DROP_HEAD: new batches discarded */
+  uint64_t dropped_tail;    /* DROP_TAIL: oldest batches overwritten */
+  uint64_t dropped_stale;   /* DROP_STALE: aged batches skipped */
+  uint64_t dropped_total;   /* Sum of the above */
+  uint64_t blocked_time_ns; /* Producer time spent waiting for space */
+  size_t occupancy;         /* Batches currently queued */
+  size_t decimation_factor; /* DECIMATE: current factor, 1 = full rate */
+  uint64_t decimation_changes; /* DECIMATE: factor changes so far */
+  uint64_t frames_decimated;   /* DECIMATE: frames thinned out */
+  uint64_t spilled_batches;    /* SPILL: batches written to the spill file */
+  uint64_t spilled_bytes;      /* SPILL: payload bytes written */
+  uint64_t spill_bytes_per_s;  /* SPILL: mean rate since the first spill */
+  size_t spill_occupancy;      /* SPILL: batches waiting in the spill file */
+  size_t spill_peak;           /* SPILL: highest spill occupancy */
+} BbStats_t;
+
+Bp_EC bb_get_stats(const Batch_buff_t *buff, BbStats_t *stats);
+
+/* OVERFLOW_SPILL internals (batch_buffer_spill.c), used by bb_init,
+ * bb_submit, bb_get_tail and bb_del_tail. */
+Bp_EC bb_spill_init(Batch_buff_t *buff, const BatchBuffer_config *config);
+void bb_spill_deinit(Batch_buff_t *buff);
+bool bb_spill_offer(Batch_buff_t *buff, unsigned long timeout_us, Bp_EC *rc);
+Batch_t *bb_spill_tail(Batch_buff_t *buff);
+bool bb_spill_release(Batch_buff_t *buff);
+void bb_spill_stats(const Batch_buff_t *buff, BbStats_t *stats);
+
+/* Shared ring storage (batch_buffer_swap.c), used by bb_deinit. Leaves the
+ * buffer's share group and clears data_ring/ts_ring if it had joined one. */
+void bb_share_leave(Batch_buff_t *buff);
+
 Bp_EC bb_stop(Batch_buff_t *buff);
 
 /* Force return functions for clean filter stopping */
 Bp_EC bb_force_return_head(Batch_buff_t *buff, Bp_EC return_code);
 Bp_EC bb_force_return_tail(Batch_buff_t *buff, Bp_EC return_code);
 
+/* Record stream API (DTYPE_RECORD buffers only).
+ *
+ * Single records: bb_record_reserve returns a payload pointer for up to
+ * `max_len` bytes in the head batch, or NULL if the batch cannot fit it (the
+ * caller submits the batch and retries on the next one). bb_record_commit
+ * publishes `len` bytes and advances head; `len` must not exceed the
+ * reserved `max_len` (asserted, clamped in release builds).
+ *
+ * Bulk: bb_record_reserve_n hands out up to `n` payload slots of `max_len`
+ * bytes and returns how many fit; bb_record_commit_n publishes the first
+ * `n` of them with their actual lengths (at most `max_len` each) and
+ * timestamps in one step.
+ */
+void *bb_record_reserve(Batch_buff_t *buff, Batch_t *batch, size_t max_len);
+void bb_record_commit(Batch_t *batch, size_t len, long long t_ns);
+size_t bb_record_reserve_n(Batch_buff_t *buff, Batch_t *batch, size_t n,
+                           size_t max_len, void **payloads);
+void bb_record_commit_n(Batch_t *batch, size_t n, size_t max_len,
+                        const size_t *lens, const long long *t_ns);
+
+/* Copy-in convenience wrapper around reserve/commit. */
+Bp_EC bb_record_append(Batch_buff_t *buff, Batch_t *batch, const void *payload,
+                       size_t len, long long t_ns);
+
+/* Number of records in a batch (walks the batch). */
+size_t bb_record_count(const Batch_t *batch);
+
+/* Largest payload a single batch of `buff` can carry. */
+static inline size_t bb_record_max_len(const Batch_buff_t *buff)
+{
+  return ((size_t) 1 << buff->batch_capacity_expo) - sizeof(BbRecord_t);
+}
+
+/* Copy `n` frames from src[src_off..] to dst[dst_off..]. Both buffers must
+ * share dtype and channel count; layouts may differ, in which case the frames
+ * are transposed on the fly. Per-sample timestamps are copied when the source
+ * batch uses them; the destination buffer must then have a timestamp column
+ * (default_sink_connect refuses sinks without one).
+ */
+void bb_copy_frames(const Batch_buff_t *dst_buf, Batch_t *dst, size_t dst_off,
+                    const Batch_buff_t *src_buf, const Batch_t *src,
+                    size_t src_off, size_t n);
+
+/* Zero-copy alternative to copying a whole batch. bb_swap_data exchanges the
+ * data and timestamp storage of `in_batch` (the tail of `in`) with that of
+ * `out_batch` (the head of `out`); header fields are left to the caller,
+ * who then submits the output and releases the input with bb_del_tail as
+ * usual. Requires matching dtype, channels, layout, batch capacity and
+ * timestamp column, rings owned by the buffers and not spilling, and an
+ * input that is not OVERFLOW_DROP_TAIL; otherwise nothing is touched and
+ * the error tells the caller to copy.
+ * Buffers that have swapped own their rings jointly until the last of them
+ * is deinitialised, and can no longer adopt external storage.
+ */
+Bp_EC bb_swap_data(Batch_buff_t *in, Batch_t *in_batch, Batch_buff_t *out,
+                   Batch_t *out_batch);
+
+/* Layout transposition helpers. `plane_stride` is the distance between
+ * channel planes in elements (normally the batch capacity). `width` is the
+ * element size in bytes; 4-byte elements take a vectorised path.
+ */
+void bb_interleave(void *dst, const void *src, size_t n_frames,
+                   size_t n_channels, size_t plane_stride, size_t width);
+void bb_deinterleave(void *dst, const void *src, size_t n_frames,
+                     size_t n_channels, size_t plane_stride, size_t width);
+
+/* Wait sets: block until any of several buffers is ready.
+ *
+ * A filter registers the inputs it consumes and, optionally, the outputs it
+ * produces into. bb_await_any then sleeps until an input is non-empty or an
+ * output is non-full, and reports which ones via bitmasks (bit i = i-th
+ * registered buffer). Stopped or force-returned buffers also count as ready
+ * so the caller's next bb_get_tail/bb_submit observes the condition.
+ *
+ * Wake-ups go through one eventfd per set; producers and consumers only
+ * write to it while a waiter is actually asleep. bb_waitset_fd exposes the
+ * eventfd for epoll/poll integration; once it has been requested every
+ * state change signals it, and the caller should follow a wake-up with
+ * bb_await_any(ws, BB_AWAIT_POLL, ...) to collect ready masks and re-arm.
+ *
+ * A buffer can be an input of at most one set and an output of at most one
+ * set, matching its single consumer / single producer.
+ */
+#define BB_WAITSET_MAX 32
+
+typedef struct _BbWaitSet {
+  int efd;            /* eventfd, -1 when uninitialised */
+  _Atomic bool armed; /* Waiter asleep, or fd handed out */
+  bool external;      /* bb_waitset_fd was called */
+  Batch_buff_t *inputs[BB_WAITSET_MAX];
+  size_t n_inputs;
+  Batch_buff_t *outputs[BB_WAITSET_MAX];
+  size_t n_outputs;
+  uint32_t watch_in;  /* Members bb_await_any reports; all by default */
+  uint32_t watch_out;
+} BbWaitSet_t;
+
+Bp_EC bb_waitset_init(BbWaitSet_t *ws);
+Bp_EC bb_waitset_deinit(BbWaitSet_t *ws); /* Also detaches all buffers */
+Bp_EC bb_waitset_add_input(BbWaitSet_t *ws, Batch_buff_t *buff);
+Bp_EC bb_waitset_add_output(BbWaitSet_t *ws, Batch_buff_t *buff);
+int bb_waitset_fd(BbWaitSet_t *ws);
+
+/* Restrict bb_await_any to the members in the `inputs`/`outputs` masks, e.g.
+ * the inputs a worker still needs. A held tail keeps an input ready, so
+ * inputs the worker is not waiting on should be masked out. */
+void bb_waitset_watch(BbWaitSet_t *ws, uint32_t inputs, uint32_t outputs);
+
+/* Timeout for bb_await_any that checks readiness without sleeping */
+#define BB_AWAIT_POLL (-1LL)
+
+/* @param timeout_us 0 waits indefinitely, as in bb_await_notempty;
+ *        BB_AWAIT_POLL (any negative value) returns without sleeping
+ * @return Bp_EC_OK with at least one bit set, or Bp_EC_TIMEOUT
+ */
+Bp_EC bb_await_any(BbWaitSet_t *ws, long long timeout_us, uint32_t *ready_in,
+                   uint32_t *ready_out);
+
+/* Called by the buffer on state changes; cheap when nobody is waiting. */
+void bb_waitset_notify(BbWaitSet_t *ws);
+
 /* Pretty printing functions */
 void bb_print(Batch_buff_t *buff);
 void bb_print_summary(Batch_buff_t *buff);
@@ -17,13 +17,15 @@
 
 static const char* dtype_to_string(SampleDtype_t dtype)
 {
+#define DTYPE_NAME_CASE(NAME, TYPE) \
+  case DTYPE_##NAME:                \
+    return #NAME;
+
   switch (dtype) {
-    case DTYPE_FLOAT:
-      return "FLOAT";
-    case DTYPE_I32:
-      return "I32";
-    case DTYPE_U32:
-      return "U32";
+    BP_NUMERIC_DTYPES(DTYPE_NAME_CASE)
+#undef DTYPE_NAME_CASE
+    case DTYPE_RECORD:
+      return "RECORD";
     case DTYPE_NDEF:
       return "UNDEFINED";
     default:
@@ -40,6 +42,12 @@ static const char* overflow_to_string(OverflowBehaviour_t behaviour)
       return "DROP_HEAD";
     case OVERFLOW_DROP_TAIL:
       return "DROP_TAIL";
+    case OVERFLOW_DROP_STALE:
+      return "DROP_STALE";
+    case OVERFLOW_DECIMATE:
+      return "DECIMATE";
+    case OVERFLOW_SPILL:
+      return "SPILL";
     default:
       return "UNKNOWN";
   }
@@ -157,8 +165,10 @@ void bb_print(Batch_buff_t* buff)
       head, tail, used, n_batches - 1, status_text);
 
   /* Statistics */
-  uint64_t total = atomic_load(&buff->producer.total_batches);
-  uint64_t dropped = atomic_load(&buff->producer.dropped_batches);
+  BbStats_t stats;
+  bb_get_stats(buff, &stats);
+  uint64_t total = stats.total_batches;
+  uint64_t dropped = stats.dropped_total;
   printf(
       "║ Total: %-8llu │ Dropped: %-8llu │ Drop Rate: %5.1f%%                  "
       "    ║\n", /* 79->80: added 1 more space */
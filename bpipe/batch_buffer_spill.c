@@ -0,0 +1,275 @@
+#define _GNU_SOURCE  // For mkstemp // NOLINT(bugprone-reserved-identifier)
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "batch_buffer.h"
+#include "utils.h"
+
+/* OVERFLOW_SPILL.
+ *
+ * The spill area is a second ring of fixed-size records in an unlinked,
+ * memory-mapped file. Each record holds a copy of the Batch_t header, the
+ * used part of the data area and the timestamp column.
+ *
+ * Ordering: once a batch is spilled, every later batch is spilled too until
+ * the spill drains, and the consumer only reads from the spill once the RAM
+ * ring is empty. The RAM ring therefore always holds the oldest data, and
+ * the producer never writes to it while the consumer reads spilled records.
+ * Producer-side spill state is guarded by the buffer mutex; the consumer
+ * side only uses the pending count. */
+
+#define SPILL_ALIGN 64
+#define SPILL_DEFAULT_EXPO 8
+
+typedef struct _BbSpill {
+  int fd;
+  char *map;
+  size_t map_bytes;
+  size_t slot_bytes;
+  size_t data_offset; /* Record offset of the data area */
+  size_t ts_offset;   /* Record offset of the timestamp column */
+  size_t n_slots;
+
+  size_t write_idx; /* Producer, under mutex */
+  size_t read_idx;  /* Consumer */
+  Batch_t staged;   /* Consumer view of the record at read_idx */
+  bool is_staged;
+
+  /* Statistics */
+  _Atomic uint64_t batches;
+  _Atomic uint64_t bytes;
+  _Atomic size_t peak;
+  _Atomic long long first_ns; /* CLOCK_MONOTONIC of the first spill */
+} BbSpill_t;
+
+static size_t align_up(size_t n)
+{
+  return (n + SPILL_ALIGN - 1) & ~(size_t) (SPILL_ALIGN - 1);
+}
+
+Bp_EC bb_spill_init(Batch_buff_t *buff, const BatchBuffer_config *config)
+{
+  size_t expo =
+      config->spill_capacity_expo ? config->spill_capacity_expo
+                                  : SPILL_DEFAULT_EXPO;
+  if (expo > 24) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+
+  BbSpill_t *sp = calloc(1, sizeof(BbSpill_t));
+  if (!sp) {
+    return Bp_EC_MALLOC_FAIL;
+  }
+  sp->n_slots = (size_t) 1 << expo;
+  sp->data_offset = align_up(sizeof(Batch_t));
+  sp->ts_offset = sp->data_offset + align_up(bb_batch_bytes(buff));
+  sp->slot_bytes =
+      sp->ts_offset +
+      (buff->ts_ring ? align_up(bb_batch_size(buff) * sizeof(long long)) : 0);
+  sp->map_bytes = sp->slot_bytes * sp->n_slots;
+
+  const char *dir = config->spill_dir;
+  if (!dir) dir = getenv("TMPDIR");
+  if (!dir) dir = "/tmp";
+  char path[512];
+  snprintf(path, sizeof(path), "%s/bpipe-spill-XXXXXX", dir);
+
+  sp->fd = mkstemp(path);
+  if (sp->fd < 0) {
+    free(sp);
+    return Bp_EC_INVALID_CONFIG;
+  }
+  /* Nothing else needs the name; the space is reclaimed on close */
+  unlink(path);
+
+  if (ftruncate(sp->fd, (off_t) sp->map_bytes) != 0) {
+    close(sp->fd);
+    free(sp);
+    return Bp_EC_ALLOC;
+  }
+  sp->map = mmap(NULL, sp->map_bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 sp->fd, 0);
+  if (sp->map == MAP_FAILED) {
+    close(sp->fd);
+    free(sp);
+    return Bp_EC_ALLOC;
+  }
+
+  atomic_store(&buff->spill_pending, 0);
+  buff->spill = sp;
+  return Bp_EC_OK;
+}
+
+void bb_spill_deinit(Batch_buff_t *buff)
+{
+  BbSpill_t *sp = buff->spill;
+  if (!sp) return;
+  munmap(sp->map, sp->map_bytes);
+  close(sp->fd);
+  free(sp);
+  buff->spill = NULL;
+}
+
+/* Bytes of the data area a batch actually uses. Planar batches keep their
+ * plane stride so bb_channel_ptr works on the staged copy. */
+static size_t used_bytes(const Batch_buff_t *buff, const Batch_t *batch)
+{
+  size_t n = MIN(batch->head, (size_t) 1 << buff->batch_capacity_expo);
+  if (buff->layout == BATCH_LAYOUT_PLANAR && buff->n_channels > 1) {
+    return bb_getdatawidth(buff->dtype) *
+           (((buff->n_channels - 1) << buff->batch_capacity_expo) + n);
+  }
+  return n * bb_frame_size(buff);
+}
+
+static void spill_write(Batch_buff_t *buff, const Batch_t *batch)
+{
+  BbSpill_t *sp = buff->spill;
+  char *rec = sp->map + sp->write_idx * sp->slot_bytes;
+  size_t n_bytes = used_bytes(buff, batch);
+
+  memcpy(rec, batch, sizeof(Batch_t));
+  memcpy(rec + sp->data_offset, batch->data, n_bytes);
+  if (batch->ts) {
+    size_t n = MIN(batch->head, bb_batch_size(buff));
+    memcpy(rec + sp->ts_offset, batch->ts, n * sizeof(long long));
+    n_bytes += n * sizeof(long long);
+  }
+  sp->write_idx = (sp->write_idx + 1) & (sp->n_slots - 1);
+
+  if (atomic_load(&sp->first_ns) == 0) {
+    atomic_store(&sp->first_ns, now_ns(CLOCK_MONOTONIC));
+  }
+  atomic_fetch_add_explicit(&sp->batches, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&sp->bytes, n_bytes, memory_order_relaxed);
+}
+
+/* Producer side. Returns false if the batch should take the normal ring
+ * path, true if it was spilled (or the wait for spill space failed, with
+ * the reason in *rc). */
+bool bb_spill_offer(Batch_buff_t *buff, unsigned long timeout_us, Bp_EC *rc)
+{
+  BbSpill_t *sp = buff->spill;
+  if (atomic_load_explicit(&buff->spill_pending, memory_order_acquire) == 0 &&
+      !bb_isfull_lockfree(buff)) {
+    return false;
+  }
+
+  *rc = Bp_EC_OK;
+  pthread_mutex_lock(&buff->mutex);
+
+  struct timespec abs_timeout;
+  if (timeout_us > 0) {
+    abs_timeout = future_ts((long long) timeout_us * 1000, CLOCK_REALTIME);
+  }
+
+  while (atomic_load(&buff->running) &&
+         !atomic_load(&buff->force_return_head)) {
+    size_t pending = atomic_load(&buff->spill_pending);
+    if (pending == 0 && !bb_isfull(buff)) {
+      pthread_mutex_unlock(&buff->mutex);
+      return false;
+    }
+    if (pending < sp->n_slots) {
+      spill_write(buff, &buff->batch_ring[bb_get_head_idx(buff)]);
+      /* The consumer decrements without the mutex: no load/store pair */
+      pending = atomic_fetch_add_explicit(&buff->spill_pending, 1,
+                                          memory_order_release) +
+                1;
+      if (pending > atomic_load(&sp->peak)) {
+        atomic_store(&sp->peak, pending);
+      }
+      atomic_fetch_add(&buff->producer.total_batches, 1);
+      pthread_cond_signal(&buff->not_empty);
+      pthread_mutex_unlock(&buff->mutex);
+
+      BbWaitSet_t *ws = atomic_load_explicit(&buff->consumer_ws,
+                                             memory_order_relaxed);
+      if (ws) bb_waitset_notify(ws);
+      return true;
+    }
+
+    /* Spill full as well - wait for the consumer, unless non-blocking */
+    if (timeout_us == 0 ||
+        pthread_cond_timedwait(&buff->not_full, &buff->mutex, &abs_timeout) !=
+            0) {
+      *rc = Bp_EC_TIMEOUT;
+      break;
+    }
+  }
+
+  if (atomic_load(&buff->force_return_head)) {
+    *rc = buff->force_return_head_code;
+    atomic_store(&buff->force_return_head, false);
+  }
+  if (*rc == Bp_EC_OK && !atomic_load(&buff->running)) {
+    *rc = Bp_EC_STOPPED;
+  }
+  pthread_mutex_unlock(&buff->mutex);
+  return true;
+}
+
+/* Consumer side. The oldest spilled batch once the RAM ring is empty, NULL
+ * if the consumer should read the ring (or nothing is queued). */
+Batch_t *bb_spill_tail(Batch_buff_t *buff)
+{
+  BbSpill_t *sp = buff->spill;
+  if (sp->is_staged) return &sp->staged;
+  /* Pending first: while it is non-zero the producer only spills, so an
+   * empty ring seen afterwards stays empty. The other order could miss
+   * batches the producer put in the ring between the two loads. */
+  if (atomic_load_explicit(&buff->spill_pending, memory_order_acquire) == 0 ||
+      !bb_isempy_lockfree(buff)) {
+    return NULL;
+  }
+
+  char *rec = sp->map + sp->read_idx * sp->slot_bytes;
+  memcpy(&sp->staged, rec, sizeof(Batch_t));
+  sp->staged.data = rec + sp->data_offset;
+  sp->staged.ts = sp->staged.ts ? (long long *) (rec + sp->ts_offset) : NULL;
+  sp->is_staged = true;
+  return &sp->staged;
+}
+
+/* Consumer side. Releases the staged batch; false if the tail is in the RAM
+ * ring. */
+bool bb_spill_release(Batch_buff_t *buff)
+{
+  BbSpill_t *sp = buff->spill;
+  if (!sp->is_staged && bb_spill_tail(buff) == NULL) return false;
+
+  sp->is_staged = false;
+  sp->read_idx = (sp->read_idx + 1) & (sp->n_slots - 1);
+  atomic_fetch_sub_explicit(&buff->spill_pending, 1, memory_order_release);
+
+  pthread_mutex_lock(&buff->mutex);
+  pthread_cond_signal(&buff->not_full);
+  pthread_mutex_unlock(&buff->mutex);
+
+  BbWaitSet_t *ws = atomic_load_explicit(&buff->producer_ws,
+                                         memory_order_relaxed);
+  if (ws) bb_waitset_notify(ws);
+  return true;
+}
+
+void bb_spill_stats(const Batch_buff_t *buff, BbStats_t *stats)
+{
+  const BbSpill_t *sp = buff->spill;
+  if (!sp) return;
+  stats->spilled_batches = atomic_load(&sp->batches);
+  stats->spilled_bytes = atomic_load(&sp->bytes);
+  stats->spill_occupancy = atomic_load(&buff->spill_pending);
+  stats->spill_peak = atomic_load(&sp->peak);
+  long long first_ns = atomic_load(&sp->first_ns);
+  if (first_ns != 0) {
+    long long elapsed = now_ns(CLOCK_MONOTONIC) - first_ns;
+    if (elapsed > 0) {
+      stats->spill_bytes_per_s =
+          (uint64_t) ((double) stats->spilled_bytes * 1e9 / (double) elapsed);
+    }
+  }
+}
@@ -0,0 +1,178 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include "batch_buffer.h"
+
+/* Zero-copy hand-over between rings.
+ *
+ * bb_swap_data trades the data (and timestamp) window of a consumed input
+ * slot for that of the output head slot. From then on a slot no longer
+ * points into its own buffer's rings: windows migrate between every buffer
+ * they are swapped through. Windows are never freed individually, so the
+ * buffers involved form a share group that owns the union of their rings.
+ * A member leaving the group (bb_deinit) keeps its rings alive for the
+ * others; the last member to leave frees them all.
+ *
+ * Groups only ever grow or merge while their members run, so the per-batch
+ * check is a comparison of two group pointers; the lock below is taken once
+ * per pair of buffers, on their first swap, and on bb_deinit. */
+
+typedef struct _BbShare {
+  Batch_buff_t **members;
+  size_t n_members;
+  size_t cap_members;
+  void **blocks; /* data_ring and ts_ring of every buffer that joined */
+  size_t n_blocks;
+  size_t cap_blocks;
+} BbShare_t;
+
+static pthread_mutex_t share_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static bool grow(void ***arr, size_t *cap, size_t need)
+{
+  if (need <= *cap) return true;
+  size_t cap_new = *cap ? *cap : 4;
+  while (cap_new < need) cap_new *= 2;
+  void **p = realloc(*arr, cap_new * sizeof(void *));
+  if (!p) return false;
+  *arr = p;
+  *cap = cap_new;
+  return true;
+}
+
+/* Make room for `members` more members and `blocks` more blocks, so the
+ * appends that follow cannot fail half-way. */
+static bool share_reserve(BbShare_t *g, size_t members, size_t blocks)
+{
+  return grow((void ***) &g->members, &g->cap_members,
+              g->n_members + members) &&
+         grow(&g->blocks, &g->cap_blocks, g->n_blocks + blocks);
+}
+
+static void share_add(BbShare_t *g, Batch_buff_t *buff)
+{
+  g->members[g->n_members++] = buff;
+  g->blocks[g->n_blocks++] = buff->data_ring;
+  if (buff->ts_ring) g->blocks[g->n_blocks++] = buff->ts_ring;
+  atomic_store(&buff->share, g);
+}
+
+static void share_free(BbShare_t *g)
+{
+  for (size_t i = 0; i < g->n_blocks; i++) free(g->blocks[i]);
+  free(g->blocks);
+  free(g->members);
+  free(g);
+}
+
+/* Put `a` and `b` in the same group, creating or merging groups as needed */
+static Bp_EC share_link(Batch_buff_t *a, Batch_buff_t *b)
+{
+  Bp_EC rc = Bp_EC_OK;
+  pthread_mutex_lock(&share_lock);
+  BbShare_t *ga = atomic_load(&a->share);
+  BbShare_t *gb = atomic_load(&b->share);
+  if (ga != NULL && ga == gb) goto out;
+
+  if (ga == NULL && gb != NULL) { /* Join b's group instead */
+    Batch_buff_t *t = a;
+    a = b;
+    b = t;
+    ga = gb;
+    gb = NULL;
+  }
+
+  BbShare_t *created = NULL;
+  if (ga == NULL) {
+    ga = created = calloc(1, sizeof(BbShare_t));
+    if (!ga) {
+      rc = Bp_EC_ALLOC;
+      goto out;
+    }
+  }
+
+  /* A merged group keeps the blocks of members that already left, so its
+   * block count is not tied to its member count */
+  size_t members = (created ? 1 : 0) + (gb ? gb->n_members : 1);
+  size_t blocks = (created ? 2 : 0) + (gb ? gb->n_blocks : 2);
+  if (!share_reserve(ga, members, blocks)) {
+    if (created) share_free(created);
+    rc = Bp_EC_ALLOC;
+    goto out;
+  }
+
+  if (created) share_add(ga, a);
+  if (gb == NULL) {
+    share_add(ga, b);
+  } else {
+    for (size_t i = 0; i < gb->n_members; i++) {
+      ga->members[ga->n_members++] = gb->members[i];
+      atomic_store(&gb->members[i]->share, ga);
+    }
+    for (size_t i = 0; i < gb->n_blocks; i++) {
+      ga->blocks[ga->n_blocks++] = gb->blocks[i];
+    }
+    gb->n_blocks = 0;
+    share_free(gb);
+  }
+
+out:
+  pthread_mutex_unlock(&share_lock);
+  return rc;
+}
+
+Bp_EC bb_swap_data(Batch_buff_t *in, Batch_t *in_batch, Batch_buff_t *out,
+                   Batch_t *out_batch)
+{
+  if (!in || !in_batch || !out || !out_batch) return Bp_EC_NULL_POINTER;
+  if (in == out) return Bp_EC_INVALID_CONFIG;
+  if (in->dtype != out->dtype) return Bp_EC_DTYPE_MISMATCH;
+  if (in->batch_capacity_expo != out->batch_capacity_expo) {
+    return Bp_EC_CAPACITY_MISMATCH;
+  }
+  if (in->n_channels != out->n_channels || in->layout != out->layout ||
+      (in->ts_ring == NULL) != (out->ts_ring == NULL)) {
+    return Bp_EC_WIDTH_MISMATCH;
+  }
+  /* Arena-backed rings cannot change hands; spilled batches live in the
+   * spill file, not in a ring window; a DROP_TAIL producer may reclaim the
+   * input slot while it is being handed on. */
+  if (!in->owns_storage || !out->owns_storage || in->spill || out->spill ||
+      in->overflow_behaviour == OVERFLOW_DROP_TAIL) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+
+  BbShare_t *g = atomic_load_explicit(&in->share, memory_order_acquire);
+  if (g == NULL ||
+      g != atomic_load_explicit(&out->share, memory_order_acquire)) {
+    Bp_EC rc = share_link(in, out);
+    if (rc != Bp_EC_OK) return rc;
+  }
+
+  void *data = in_batch->data;
+  in_batch->data = out_batch->data;
+  out_batch->data = data;
+  long long *ts = in_batch->ts;
+  in_batch->ts = out_batch->ts;
+  out_batch->ts = ts;
+  return Bp_EC_OK;
+}
+
+void bb_share_leave(Batch_buff_t *buff)
+{
+  pthread_mutex_lock(&share_lock);
+  BbShare_t *g = atomic_load(&buff->share);
+  if (g != NULL) {
+    for (size_t i = 0; i < g->n_members; i++) {
+      if (g->members[i] == buff) {
+        g->members[i] = g->members[--g->n_members];
+        break;
+      }
+    }
+    if (g->n_members == 0) share_free(g);
+    atomic_store(&buff->share, NULL);
+    /* The rings now belong to the group (or were just freed with it) */
+    buff->data_ring = NULL;
+    buff->ts_ring = NULL;
+  }
+  pthread_mutex_unlock(&share_lock);
+}
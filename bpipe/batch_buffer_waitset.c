@@ -0,0 +1,186 @@
+#define _GNU_SOURCE  // For ppoll // NOLINT(bugprone-reserved-identifier)
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "batch_buffer.h"
+
+/* Ready conditions include stop/force-return so the caller's next buffer
+ * operation returns the corresponding code instead of sleeping again. */
+static bool input_ready(const Batch_buff_t *buff)
+{
+  return !bb_isempy_lockfree(buff) || atomic_load(&buff->spill_pending) ||
+         !atomic_load(&buff->running) ||
+         atomic_load(&buff->force_return_tail);
+}
+
+static bool output_ready(const Batch_buff_t *buff)
+{
+  return !bb_isfull_lockfree(buff) || !atomic_load(&buff->running) ||
+         atomic_load(&buff->force_return_head);
+}
+
+static bool collect_ready(const BbWaitSet_t *ws, uint32_t *ready_in,
+                          uint32_t *ready_out)
+{
+  uint32_t in = 0, out = 0;
+  for (size_t i = 0; i < ws->n_inputs; i++) {
+    if ((ws->watch_in & (1u << i)) && input_ready(ws->inputs[i])) {
+      in |= 1u << i;
+    }
+  }
+  for (size_t i = 0; i < ws->n_outputs; i++) {
+    if ((ws->watch_out & (1u << i)) && output_ready(ws->outputs[i])) {
+      out |= 1u << i;
+    }
+  }
+  if (ready_in) *ready_in = in;
+  if (ready_out) *ready_out = out;
+  return (in | out) != 0;
+}
+
+static void drain(const BbWaitSet_t *ws)
+{
+  uint64_t count;
+  while (read(ws->efd, &count, sizeof(count)) == sizeof(count)) {
+  }
+}
+
+Bp_EC bb_waitset_init(BbWaitSet_t *ws)
+{
+  if (!ws) return Bp_EC_NULL_POINTER;
+
+  memset(ws, 0, sizeof(*ws));
+  ws->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (ws->efd < 0) return Bp_EC_COND_INIT_FAIL;
+  atomic_store(&ws->armed, false);
+  return Bp_EC_OK;
+}
+
+Bp_EC bb_waitset_deinit(BbWaitSet_t *ws)
+{
+  if (!ws) return Bp_EC_NULL_POINTER;
+
+  for (size_t i = 0; i < ws->n_inputs; i++) {
+    BbWaitSet_t *expected = ws;
+    atomic_compare_exchange_strong(&ws->inputs[i]->consumer_ws, &expected,
+                                   NULL);
+  }
+  for (size_t i = 0; i < ws->n_outputs; i++) {
+    BbWaitSet_t *expected = ws;
+    atomic_compare_exchange_strong(&ws->outputs[i]->producer_ws, &expected,
+                                   NULL);
+  }
+  if (ws->efd >= 0) close(ws->efd);
+
+  memset(ws, 0, sizeof(*ws));
+  ws->efd = -1;
+  return Bp_EC_OK;
+}
+
+Bp_EC bb_waitset_add_input(BbWaitSet_t *ws, Batch_buff_t *buff)
+{
+  if (!ws || !buff) return Bp_EC_NULL_POINTER;
+  if (ws->n_inputs >= BB_WAITSET_MAX) return Bp_EC_INVALID_CONFIG;
+
+  BbWaitSet_t *expected = NULL;
+  if (!atomic_compare_exchange_strong(&buff->consumer_ws, &expected, ws)) {
+    return Bp_EC_ALREADY_REGISTERED;
+  }
+  ws->watch_in |= 1u << ws->n_inputs;
+  ws->inputs[ws->n_inputs++] = buff;
+  return Bp_EC_OK;
+}
+
+Bp_EC bb_waitset_add_output(BbWaitSet_t *ws, Batch_buff_t *buff)
+{
+  if (!ws || !buff) return Bp_EC_NULL_POINTER;
+  if (ws->n_outputs >= BB_WAITSET_MAX) return Bp_EC_INVALID_CONFIG;
+
+  BbWaitSet_t *expected = NULL;
+  if (!atomic_compare_exchange_strong(&buff->producer_ws, &expected, ws)) {
+    return Bp_EC_ALREADY_REGISTERED;
+  }
+  ws->watch_out |= 1u << ws->n_outputs;
+  ws->outputs[ws->n_outputs++] = buff;
+  return Bp_EC_OK;
+}
+
+void bb_waitset_watch(BbWaitSet_t *ws, uint32_t inputs, uint32_t outputs)
+{
+  uint32_t all_in = ws->n_inputs ? ~0u >> (32 - ws->n_inputs) : 0;
+  uint32_t all_out = ws->n_outputs ? ~0u >> (32 - ws->n_outputs) : 0;
+  ws->watch_in = inputs & all_in;
+  ws->watch_out = outputs & all_out;
+}
+
+int bb_waitset_fd(BbWaitSet_t *ws)
+{
+  if (!ws) return -1;
+  /* An external poller may sleep at any time, so keep signalling */
+  ws->external = true;
+  atomic_store(&ws->armed, true);
+  return ws->efd;
+}
+
+void bb_waitset_notify(BbWaitSet_t *ws)
+{
+  /* Pairs with the fence in bb_await_any: either the waiter sees our state
+   * change on its re-check, or we see it armed and wake it. */
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&ws->armed, memory_order_relaxed)) {
+    uint64_t one = 1;
+    ssize_t rc = write(ws->efd, &one, sizeof(one));
+    (void) rc; /* EAGAIN only if the counter is saturated - still readable */
+  }
+}
+
+Bp_EC bb_await_any(BbWaitSet_t *ws, long long timeout_us, uint32_t *ready_in,
+                   uint32_t *ready_out)
+{
+  if (!ws) return Bp_EC_NULL_POINTER;
+
+  if (collect_ready(ws, ready_in, ready_out)) {
+    if (ws->external) drain(ws);
+    return Bp_EC_OK;
+  }
+  if (timeout_us < 0) return Bp_EC_TIMEOUT; /* BB_AWAIT_POLL */
+
+  long long deadline_ns =
+      timeout_us > 0 ? now_ns(CLOCK_MONOTONIC) + timeout_us * 1000LL : 0;
+
+  for (;;) {
+    atomic_store(&ws->armed, true);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    /* Re-check after arming so a state change between the first check and
+     * arming is not lost */
+    bool ready = collect_ready(ws, ready_in, ready_out);
+    if (!ready) {
+      struct timespec rel;
+      struct timespec *rel_p = NULL;
+      if (timeout_us > 0) {
+        long long left = deadline_ns - now_ns(CLOCK_MONOTONIC);
+        if (left < 0) left = 0;
+        rel = ts_from_ns(left);
+        rel_p = &rel;
+      }
+      struct pollfd pfd = {.fd = ws->efd, .events = POLLIN};
+      int rc = ppoll(&pfd, 1, rel_p, NULL);
+      if (rc < 0 && errno != EINTR) {
+        if (!ws->external) atomic_store(&ws->armed, false);
+        return Bp_EC_PTHREAD_UNKOWN;
+      }
+    }
+
+    drain(ws);
+    if (!ws->external) atomic_store(&ws->armed, false);
+
+    if (ready || collect_ready(ws, ready_in, ready_out)) return Bp_EC_OK;
+    if (timeout_us > 0 && now_ns(CLOCK_MONOTONIC) >= deadline_ns) {
+      return Bp_EC_TIMEOUT;
+    }
+  }
+}
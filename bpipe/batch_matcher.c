@@ -1,6 +1,7 @@
 #include "batch_matcher.h"
 #include <stdlib.h>
 #include <string.h>
+#include "utils.h"
 
 // Custom filter operations
 static Bp_EC batch_matcher_start_impl(Filter_t* self)
@@ -50,14 +51,6 @@ static Bp_EC batch_matcher_stop(Filter_t* self)
 
 static Bp_EC batch_matcher_deinit(Filter_t* self)
 {
-  BatchMatcher_t* bm = (BatchMatcher_t*) self;
-
-  // Free accumulator
-  if (bm->accumulator != NULL) {
-    free(bm->accumulator);
-    bm->accumulator = NULL;
-  }
-
   // Do default deinit actions
   for (int i = 0; i < self->n_input_buffers; i++) {
     Bp_EC rc = bb_deinit(self->input_buffers[i]);
@@ -86,6 +79,7 @@ static Bp_EC batch_matcher_get_stats(Filter_t* self, void* stats_out)
     uint64_t samples_processed;
     uint64_t batches_matched;
     uint64_t samples_skipped;
+    uint64_t batches_passed_whole;
   } BatchMatcherStats;
 
   BatchMatcherStats* stats = (BatchMatcherStats*) stats_out;
@@ -93,6 +87,7 @@ static Bp_EC batch_matcher_get_stats(Filter_t* self, void* stats_out)
   stats->samples_processed = bm->samples_processed;
   stats->batches_matched = bm->batches_matched;
   stats->samples_skipped = bm->samples_skipped;
+  stats->batches_passed_whole = bm->batches_passed_whole;
 
   return Bp_EC_OK;
 }
@@ -119,11 +114,57 @@ static Bp_EC batch_matcher_describe(Filter_t* self, char* buffer,
   return Bp_EC_OK;
 }
 
+/* Checkpoint: the output grid and the position within the current frame.
+ * A restored matcher continues the frame like after an early flush; samples
+ * of it still in the unsubmitted head batch at stop time are not kept. */
+static Bp_EC batch_matcher_checkpoint(Filter_t* self, Checkpoint_t* ck)
+{
+  BatchMatcher_t* bm = (BatchMatcher_t*) self;
+  uint64_t accumulated = bm->accumulated;
+  uint64_t frame = bm->output_batch_samples;
+  Bp_EC err = CKPT_PUT(ck, frame);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, bm->period_ns);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, bm->batch_period_ns);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, bm->next_boundary_ns);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, accumulated);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, bm->samples_processed);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, bm->batches_matched);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, bm->samples_skipped);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, bm->batches_passed_whole);
+  return err;
+}
+
+static Bp_EC batch_matcher_restore(Filter_t* self, Checkpoint_t* ck)
+{
+  BatchMatcher_t* bm = (BatchMatcher_t*) self;
+  uint64_t frame, accumulated;
+  Bp_EC err = CKPT_GET(ck, frame);
+  if (err != Bp_EC_OK) return err;
+  /* The grid only carries over to a sink with the same frame size */
+  if (frame != bm->output_batch_samples) return Bp_EC_INVALID_DATA;
+  err = CKPT_GET(ck, bm->period_ns);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, bm->batch_period_ns);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, bm->next_boundary_ns);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, accumulated);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, bm->samples_processed);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, bm->batches_matched);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, bm->samples_skipped);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, bm->batches_passed_whole);
+  if (err != Bp_EC_OK) return err;
+  if (accumulated >= frame && frame > 0) return Bp_EC_INVALID_DATA;
+  bm->accumulated = (size_t) accumulated;
+  return Bp_EC_OK;
+}
+
 Bp_EC batch_matcher_init(BatchMatcher_t* matcher, BatchMatcher_config_t config)
 {
   if (matcher == NULL) {
     return Bp_EC_NULL_FILTER;
   }
+  // Record batches are sized in bytes, not samples: nothing to rechunk
+  if (config.buff_config.dtype == DTYPE_RECORD) {
+    return Bp_EC_INVALID_CONFIG;
+  }
 
   // Initialize base filter
   Core_filt_config_t core_config = {.name = config.name,
@@ -146,20 +187,21 @@ Bp_EC batch_matcher_init(BatchMatcher_t* matcher, BatchMatcher_config_t config)
   matcher->base.ops.deinit = batch_matcher_deinit;
   matcher->base.ops.get_stats = batch_matcher_get_stats;
   matcher->base.ops.describe = batch_matcher_describe;
+  matcher->base.ops.checkpoint = batch_matcher_checkpoint;
+  matcher->base.ops.restore = batch_matcher_restore;
 
   // Initialize BatchMatcher specific fields
+  matcher->requested_batch_samples = config.output_batch_samples;
   matcher->output_batch_samples = 0;
   matcher->size_detected = false;
   matcher->period_ns = 0;
   matcher->batch_period_ns = 0;
   matcher->next_boundary_ns = 0;
-  matcher->accumulator = NULL;
-  matcher->accumulator_capacity = 0;
   matcher->accumulated = 0;
-  matcher->data_width = bb_getdatawidth(config.buff_config.dtype);
   matcher->samples_processed = 0;
   matcher->batches_matched = 0;
   matcher->samples_skipped = 0;
+  matcher->batches_passed_whole = 0;
 
   // Set input constraints
   prop_constraints_from_buffer_append(&matcher->base, &config.buff_config,
@@ -182,6 +224,16 @@ Bp_EC batch_matcher_init(BatchMatcher_t* matcher, BatchMatcher_config_t config)
   return Bp_EC_OK;
 }
 
+/* Submit the part of the current frame gathered so far. The frame keeps its
+ * boundary: the next output batch carries on from the first missing sample
+ * and the frame is complete once `accumulated` reaches the frame size. */
+static void batch_matcher_flush_partial(BatchMatcher_t* bm, Batch_t** output)
+{
+  (*output)->batch_id = bm->batches_matched++;
+  bb_submit(bm->base.sinks[0], bm->base.timeout_us);
+  *output = NULL;
+}
+
 void* batch_matcher_worker(void* arg)
 {
   BatchMatcher_t* bm = (BatchMatcher_t*) arg;
@@ -200,19 +252,26 @@ void* batch_matcher_worker(void* arg)
   Bp_EC err = Bp_EC_OK;
   Batch_t* input_batch = NULL;
   Batch_t* output_batch = NULL;
-  bool first_batch = true;
+  bool first_batch = bm->period_ns == 0; /* Not yet on the input grid */
 
   while (f->running) {
     // Get input batch
-    input_batch = bb_get_tail(f->input_buffers[0], f->timeout_us, &err);
+    input_batch = bb_get_tail(f->input_buffers[0], filt_wait_us(f), &err);
+    if (err == Bp_EC_OK && input_batch->ec == Bp_EC_COMPLETE) {
+      // Completion arrives in-band as an empty batch
+      bb_del_tail(f->input_buffers[0]);
+      err = Bp_EC_COMPLETE;
+    }
     if (err != Bp_EC_OK) {
       if (err == Bp_EC_TIMEOUT) {
+        if (filt_flush_due(f, 0, output_batch, false)) {
+          batch_matcher_flush_partial(bm, &output_batch);
+        }
         continue;
       } else if (err == Bp_EC_COMPLETE || err == Bp_EC_STOPPED) {
         // Propagate completion
-        if (bm->accumulated > 0 && output_batch != NULL) {
+        if (output_batch != NULL && output_batch->head > 0) {
           // Flush partial batch
-          output_batch->head = bm->accumulated;
           output_batch->batch_id = bm->batches_matched++;
           bb_submit(f->sinks[0], f->timeout_us);
           output_batch = NULL;
@@ -263,24 +322,13 @@ void* batch_matcher_worker(void* arg)
 
       bm->batch_period_ns = bm->period_ns * bm->output_batch_samples;
 
-      // Align to t=0 (or nearest batch boundary before first sample)
-      bm->next_boundary_ns = 0;
-      while (bm->next_boundary_ns + bm->batch_period_ns <= input_batch->t_ns) {
-        bm->next_boundary_ns += bm->batch_period_ns;
-      }
-
-      // Allocate accumulator
-      bm->accumulator_capacity = bm->output_batch_samples * bm->data_width;
-      bm->accumulator = malloc(bm->accumulator_capacity);
-      if (bm->accumulator == NULL) {
-        bb_del_tail(f->input_buffers[0]);
-        f->worker_err_info.ec = Bp_EC_MALLOC_FAIL;
-        f->worker_err_info.function = __FUNCTION__;
-        f->worker_err_info.filename = __FILE__;
-        f->worker_err_info.line_no = __LINE__;
-        f->running = false;
-        return NULL;
-      }
+      // Align to the first batch boundary (multiple of the batch period from
+      // t=0) at or after the first sample; a leading partial frame would
+      // otherwise be stamped with the boundary before its first sample
+      bm->next_boundary_ns =
+          ((input_batch->t_ns + bm->batch_period_ns - 1) /
+           bm->batch_period_ns) *
+          bm->batch_period_ns;
 
       first_batch = false;
     }
@@ -290,54 +338,68 @@ void* batch_matcher_worker(void* arg)
     size_t input_idx = 0;
     uint64_t current_timestamp = input_batch->t_ns;
 
+    // Whole batch already lines up with an output batch: forward it with
+    // its metadata intact, handing over its storage when the rings allow
+    if (output_batch == NULL && bm->accumulated == 0 &&
+        input_samples == bm->output_batch_samples &&
+        current_timestamp == bm->next_boundary_ns) {
+      output_batch = bb_get_head(f->sinks[0]);
+      if (bb_swap_data(f->input_buffers[0], input_batch, f->sinks[0],
+                       output_batch) != Bp_EC_OK) {
+        bb_copy_frames(f->sinks[0], output_batch, 0, f->input_buffers[0],
+                       input_batch, 0, input_samples);
+      }
+      output_batch->t_ns = input_batch->t_ns;
+      output_batch->period_ns = input_batch->period_ns;
+      output_batch->head = input_samples;
+      output_batch->ec = Bp_EC_OK;
+      output_batch->meta = input_batch->meta;
+      output_batch->batch_id = bm->batches_matched++;
+      bm->samples_processed += input_samples;
+      bm->batches_passed_whole++;
+      bm->next_boundary_ns += bm->batch_period_ns;
+      bb_submit(f->sinks[0], f->timeout_us);
+      output_batch = NULL;
+      bb_del_tail(f->input_buffers[0]);
+      continue;
+    }
+
     while (input_idx < input_samples && f->running) {
-      // Skip samples before next boundary
+      // Skip samples before next boundary in one step
       if (current_timestamp < bm->next_boundary_ns) {
-        bm->samples_skipped++;
-        input_idx++;
-        current_timestamp += bm->period_ns;
+        size_t skip = (bm->next_boundary_ns - current_timestamp +
+                       bm->period_ns - 1) /
+                      bm->period_ns;
+        skip = MIN(skip, input_samples - input_idx);
+        bm->samples_skipped += skip;
+        input_idx += skip;
+        current_timestamp += skip * bm->period_ns;
         continue;
       }
 
       // Get output batch if needed
       if (output_batch == NULL) {
         output_batch = bb_get_head(f->sinks[0]);
-        if (output_batch == NULL) {
-          bb_del_tail(f->input_buffers[0]);
-          BP_WORKER_ASSERT(f, false, Bp_EC_NOSPACE);
-        }
 
-        // Set output batch metadata
-        output_batch->t_ns = bm->next_boundary_ns;
+        // Set output batch metadata; after an early flush the batch
+        // continues the current frame
+        output_batch->t_ns =
+            bm->next_boundary_ns + bm->accumulated * bm->period_ns;
         output_batch->period_ns = bm->period_ns;
         output_batch->head = 0;
         output_batch->ec = Bp_EC_OK;
-        bm->accumulated = 0;
-      }
-
-      // Copy samples to accumulator
-      size_t samples_to_copy = input_samples - input_idx;
-      size_t space_in_accumulator = bm->output_batch_samples - bm->accumulated;
-      if (samples_to_copy > space_in_accumulator) {
-        samples_to_copy = space_in_accumulator;
       }
 
-      // Check if we'll cross a boundary
-      uint64_t end_timestamp =
-          current_timestamp + (samples_to_copy * bm->period_ns);
-      if (end_timestamp > bm->next_boundary_ns + bm->batch_period_ns) {
-        // Only copy up to the boundary
-        samples_to_copy =
-            (bm->next_boundary_ns + bm->batch_period_ns - current_timestamp) /
-            bm->period_ns;
-      }
-
-      // Copy data
-      void* src = (char*) input_batch->data + (input_idx * bm->data_width);
-      void* dst =
-          (char*) output_batch->data + (bm->accumulated * bm->data_width);
-      memcpy(dst, src, samples_to_copy * bm->data_width);
+      // Copy the longest run that fits: frame space bounds it to the
+      // current boundary because accumulation starts on one
+      size_t samples_to_copy =
+          MIN(input_samples - input_idx,
+              bm->output_batch_samples - bm->accumulated);
+      bb_copy_frames(f->sinks[0], output_batch, output_batch->head,
+                     f->input_buffers[0], input_batch, input_idx,
+                     samples_to_copy);
 
+      output_batch->head += samples_to_copy;
       bm->accumulated += samples_to_copy;
       bm->samples_processed += samples_to_copy;
       input_idx += samples_to_copy;
@@ -345,22 +407,20 @@ void* batch_matcher_worker(void* arg)
 
       // Submit output batch if full
       if (bm->accumulated == bm->output_batch_samples) {
-        output_batch->head = bm->accumulated;
         output_batch->batch_id = bm->batches_matched++;
         bb_submit(f->sinks[0], f->timeout_us);
         output_batch = NULL;
+        bm->accumulated = 0;
         bm->next_boundary_ns += bm->batch_period_ns;
       }
     }
 
     // Release input batch
     bb_del_tail(f->input_buffers[0]);
-  }
 
-  // Cleanup
-  if (bm->accumulator != NULL) {
-    free(bm->accumulator);
-    bm->accumulator = NULL;
+    if (filt_flush_due(f, 0, output_batch, true)) {
+      batch_matcher_flush_partial(bm, &output_batch);
+    }
   }
 
   return NULL;
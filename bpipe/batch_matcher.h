@@ -7,30 +7,30 @@
 typedef struct _BatchMatcher_config_t {
   const char* name;
   BatchBuffer_config buff_config;  // For input buffer only
+  size_t output_batch_samples;     // 0 = sink capacity, else any size <= it
 } BatchMatcher_config_t;
 
 typedef struct _BatchMatcher_t {
   Filter_t base;
 
   // Auto-detected configuration
-  size_t output_batch_samples;  // From sink's batch_capacity_expo
-  bool size_detected;           // Has sink been connected?
+  size_t requested_batch_samples;  // From config, 0 = auto
+  size_t output_batch_samples;     // Requested size or sink capacity
+  bool size_detected;              // Has sink been connected?
 
   // Runtime state
   uint64_t period_ns;         // From first input batch
   uint64_t batch_period_ns;   // period_ns * output_batch_samples
   uint64_t next_boundary_ns;  // Next output batch start time
 
-  // Accumulation
-  void* accumulator;            // Building current output batch
-  size_t accumulator_capacity;  // Allocated size of accumulator
-  size_t accumulated;           // Samples in accumulator
-  size_t data_width;            // Size of each sample
+  // Accumulation (directly into the sink's head batch)
+  size_t accumulated;  // Samples of the current frame, early flushes included
 
   // Statistics
   uint64_t samples_processed;
   uint64_t batches_matched;
-  uint64_t samples_skipped;  // Before first boundary
+  uint64_t samples_skipped;       // Before first boundary
+  uint64_t batches_passed_whole;  // Input batch already on a boundary
 } BatchMatcher_t;
 
 // Filter operations
@@ -0,0 +1,352 @@
+#include "calibration_map.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+typedef struct _CalibLut {
+  size_t n_points;
+  size_t n_cells;
+  float x0, x_end;
+  float inv_cell; /* Grid cells per unit of x */
+  float u_max;    /* n_cells - 1 */
+  bool extrapolate;
+  bool direct;   /* Cell c is segment c; no index table lookup */
+  bool one_step; /* Every cell holds at most one interior breakpoint */
+
+  /* Per segment i (n_points - 1 of them):
+   * y = ys[i] + (v - xs[i]) * slope[i], valid while v < xnext[i] */
+  float* xs;
+  float* ys;
+  float* slope;
+  float* xnext; /* xs[i + 1], +inf for the last segment */
+  uint16_t* idx; /* First segment that can contain a value in each cell */
+} CalibLut_t;
+
+/* Shared by table construction and evaluation: both must map a value to
+ * the same cell for the index table to be exact */
+static inline size_t lut_cell(const CalibLut_t* lut, float v)
+{
+  float u = (v - lut->x0) * lut->inv_cell;
+  u = u >= 0.0f ? u : 0.0f; /* Also maps NaN to cell 0 */
+  u = u <= lut->u_max ? u : lut->u_max;
+  return (size_t) u;
+}
+
+static inline float lut_value(const CalibLut_t* lut, float v)
+{
+  if (!lut->extrapolate) {
+    v = v < lut->x0 ? lut->x0 : (v > lut->x_end ? lut->x_end : v);
+  }
+  size_t c = lut_cell(lut, v);
+  size_t i = lut->direct ? c : lut->idx[c];
+  /* +inf is not below the last segment's +inf bound: never step past it */
+  size_t last = lut->n_points - 2;
+  if (lut->one_step) {
+    i += v >= lut->xnext[i] && i < last;
+  } else {
+    while (i < last && v >= lut->xnext[i]) i++;
+  }
+  return lut->ys[i] + (v - lut->xs[i]) * lut->slope[i];
+}
+
+static Bp_EC lut_build(const CalibrationTable_t* table, CalibLut_t** out)
+{
+  if (table == NULL || out == NULL) return Bp_EC_NULL_POINTER;
+  size_t n = table->n_points;
+  if (table->x == NULL || table->y == NULL) return Bp_EC_NULL_POINTER;
+  if (n < 2 || n > CALIB_MAX_POINTS) return Bp_EC_INVALID_CONFIG;
+
+  float min_dx = INFINITY;
+  for (size_t i = 0; i < n; i++) {
+    if (!isfinite(table->x[i]) || !isfinite(table->y[i])) {
+      return Bp_EC_INVALID_CONFIG;
+    }
+    if (i > 0) {
+      float dx = table->x[i] - table->x[i - 1];
+      if (!(dx > 0.0f)) return Bp_EC_INVALID_CONFIG;
+      min_dx = MIN(min_dx, dx);
+    }
+  }
+
+  /* Enough cells that each holds at most one breakpoint, within limits.
+   * The slack keeps evenly spaced tables at one cell per segment despite
+   * rounding in min_dx. */
+  size_t n_seg = n - 1;
+  float range = table->x[n - 1] - table->x[0];
+  double want = ceil((double) range / (double) min_dx - 1e-3);
+  size_t n_cells = (size_t) 1 << CALIB_MAX_GRID_EXPO;
+  if (want < (double) n_cells) n_cells = MAX(n_seg, (size_t) want);
+
+  size_t bytes = sizeof(CalibLut_t) + (n + 3 * n_seg) * sizeof(float) +
+                 n_cells * sizeof(uint16_t);
+  CalibLut_t* lut = malloc(bytes);
+  uint32_t* count = calloc(n_cells, sizeof(uint32_t));
+  if (lut == NULL || count == NULL) {
+    free(lut);
+    free(count);
+    return Bp_EC_MALLOC_FAIL;
+  }
+
+  lut->n_points = n;
+  lut->n_cells = n_cells;
+  lut->x0 = table->x[0];
+  lut->x_end = table->x[n - 1];
+  lut->inv_cell = (float) ((double) n_cells / (double) range);
+  lut->u_max = (float) (n_cells - 1);
+  lut->extrapolate = table->extrapolate;
+  lut->xs = (float*) (lut + 1);
+  lut->ys = lut->xs + n;
+  lut->slope = lut->ys + n_seg;
+  lut->xnext = lut->slope + n_seg;
+  lut->idx = (uint16_t*) (lut->xnext + n_seg);
+
+  for (size_t i = 0; i < n_seg; i++) {
+    lut->xs[i] = table->x[i];
+    lut->ys[i] = table->y[i];
+    lut->slope[i] = (table->y[i + 1] - table->y[i]) /
+                    (table->x[i + 1] - table->x[i]);
+    lut->xnext[i] = i + 1 < n_seg ? table->x[i + 1] : INFINITY;
+  }
+  lut->xs[n_seg] = table->x[n_seg];
+
+  /* Each interior breakpoint lands in the cell lut_cell gives it. As the
+   * mapping is monotonic, every value in cell c lies at or above all
+   * breakpoints of earlier cells and below those of later ones, so the
+   * running count is the lowest possible segment and a cell's own count
+   * bounds the steps needed from there. */
+  for (size_t j = 1; j < n_seg; j++) count[lut_cell(lut, lut->xs[j])]++;
+  uint32_t seg = 0, max_count = 0;
+  bool identity = n_cells == n_seg;
+  for (size_t c = 0; c < n_cells; c++) {
+    lut->idx[c] = (uint16_t) seg;
+    identity &= seg == c;
+    seg += count[c];
+    max_count = MAX(max_count, count[c]);
+  }
+  lut->one_step = max_count <= 1;
+  lut->direct = identity;
+  free(count);
+
+  *out = lut;
+  return Bp_EC_OK;
+}
+
+static uint64_t lut_eval(const CalibLut_t* lut, SampleDtype_t dtype,
+                         const void* in, float* out, size_t n)
+{
+  uint64_t clamped = 0;
+  size_t k = 0;
+  if (dtype == DTYPE_I32) {
+    const int32_t* raw = (const int32_t*) in;
+    for (; k < n; k++) {
+      float v = (float) raw[k];
+      clamped += (v < lut->x0) | (v > lut->x_end);
+      out[k] = lut_value(lut, v);
+    }
+  } else {
+    const float* x = (const float*) in;
+    for (; k < n; k++) {
+      clamped += (x[k] < lut->x0) | (x[k] > lut->x_end);
+      out[k] = lut_value(lut, x[k]);
+    }
+  }
+  return lut->extrapolate ? 0 : clamped;
+}
+
+static void* calibration_map_worker(void* arg)
+{
+  CalibrationMap_t* cal = (CalibrationMap_t*) arg;
+  Filter_t* f = &cal->base;
+  Batch_buff_t* in_buf = f->input_buffers[0];
+  Batch_buff_t* out_buf = f->sinks[0];
+  Bp_EC err = Bp_EC_OK;
+
+  BP_WORKER_ASSERT(f, out_buf != NULL, Bp_EC_NO_SINK);
+  BP_WORKER_ASSERT(f,
+                   in_buf->dtype == DTYPE_I32 || in_buf->dtype == DTYPE_FLOAT,
+                   Bp_EC_TYPE_MISMATCH);
+  BP_WORKER_ASSERT(f, out_buf->dtype == DTYPE_FLOAT, Bp_EC_TYPE_MISMATCH);
+  BP_WORKER_ASSERT(f,
+                   out_buf->n_channels == in_buf->n_channels &&
+                       out_buf->layout == in_buf->layout &&
+                       out_buf->batch_capacity_expo >=
+                           in_buf->batch_capacity_expo,
+                   Bp_EC_INVALID_CONFIG);
+
+  const size_t n_channels = in_buf->n_channels;
+  const bool planar = n_channels > 1 && in_buf->layout == BATCH_LAYOUT_PLANAR;
+  const size_t n_planes = planar ? n_channels : 1;
+
+  while (atomic_load(&f->running)) {
+    Batch_t* input = bb_get_tail(in_buf, f->timeout_us, &err);
+    if (!input) {
+      if (err == Bp_EC_TIMEOUT) continue;
+      break;
+    }
+
+    /* Swaps take effect between batches; checked after the wait so a batch
+     * submitted after filt_reconfigure returns sees the new table */
+    CalibLut_t* next = atomic_exchange(&cal->pending, NULL);
+    if (next) {
+      /* describe reads the table under the filter mutex; once the new one
+       * is published there, nobody can still hold the old one */
+      pthread_mutex_lock(&f->filter_mutex);
+      CalibLut_t* old = atomic_exchange(&cal->active, next);
+      pthread_mutex_unlock(&f->filter_mutex);
+      free(old);
+      atomic_fetch_add(&cal->tables_swapped, 1);
+    }
+    const CalibLut_t* lut =
+        atomic_load_explicit(&cal->active, memory_order_relaxed);
+
+    if (input->ec == Bp_EC_COMPLETE) {
+      filt_send_complete(f, out_buf);
+      bb_del_tail(in_buf);
+      break;
+    }
+    BP_WORKER_ASSERT(f, input->ec == Bp_EC_OK, input->ec);
+    Batch_t* output = bb_get_head(out_buf);
+    BP_WORKER_ASSERT(f, !bb_batch_has_ts(input) || output->ts != NULL,
+                     Bp_EC_INVALID_CONFIG);
+
+    output->batch_id = input->batch_id;
+    output->t_ns = input->t_ns;
+    output->period_ns = input->period_ns;
+    output->ec = Bp_EC_OK;
+    output->head = input->head;
+    if (bb_batch_has_ts(input)) {
+      memcpy(output->ts, input->ts, input->head * sizeof(long long));
+    }
+
+    size_t n = planar ? input->head : input->head * n_channels;
+    uint64_t clamped = 0;
+    for (size_t p = 0; p < n_planes; p++) {
+      clamped += lut_eval(lut, in_buf->dtype, bb_channel_ptr(in_buf, input, p),
+                          (float*) bb_channel_ptr(out_buf, output, p), n);
+    }
+    atomic_fetch_add_explicit(&cal->samples_clamped, clamped,
+                              memory_order_relaxed);
+
+    err = bb_submit(out_buf, f->timeout_us);
+    if (err != Bp_EC_OK) break;
+    bb_del_tail(in_buf);
+
+    f->metrics.samples_processed += input->head;
+    f->metrics.n_batches++;
+  }
+
+  BP_WORKER_ASSERT(f, BP_WORKER_CLEAN_EXIT(err), err);
+  return NULL;
+}
+
+/* Output is float whatever the input dtype, so the default same-dtype check
+ * does not apply */
+static Bp_EC calibration_map_sink_connect(Filter_t* self, size_t output_port,
+                                          Batch_buff_t* sink)
+{
+  return filt_attach_sink(self, output_port, sink, DTYPE_FLOAT,
+                          self->input_buffers[0]->n_channels);
+}
+
+/* config: const CalibrationTable_t* */
+static Bp_EC calibration_map_reconfigure(Filter_t* self, void* config)
+{
+  CalibrationMap_t* cal = (CalibrationMap_t*) self;
+  CalibLut_t* lut;
+  Bp_EC err = lut_build((const CalibrationTable_t*) config, &lut);
+  if (err != Bp_EC_OK) return err;
+
+  /* A table the worker has not picked up yet is simply replaced */
+  free(atomic_exchange(&cal->pending, lut));
+  return Bp_EC_OK;
+}
+
+static Bp_EC calibration_map_describe(Filter_t* self, char* buffer,
+                                      size_t size)
+{
+  CalibrationMap_t* cal = (CalibrationMap_t*) self;
+  if (buffer == NULL) return Bp_EC_NULL_POINTER;
+
+  /* The worker frees a replaced table only after publishing its successor
+   * under this mutex */
+  pthread_mutex_lock(&self->filter_mutex);
+  const CalibLut_t* lut = atomic_load(&cal->active);
+  snprintf(buffer, size,
+           "CalibrationMap: %s\n"
+           "  Breakpoints: %zu over [%g, %g]%s\n"
+           "  Index: %s, %zu cells\n"
+           "  Tables swapped: %llu\n"
+           "  Samples clamped: %llu",
+           self->name, lut->n_points, (double) lut->x0, (double) lut->x_end,
+           lut->extrapolate ? ", extrapolated" : "",
+           lut->direct ? "direct" : (lut->one_step ? "one step" : "walk"),
+           lut->n_cells, (unsigned long long) atomic_load(&cal->tables_swapped),
+           (unsigned long long) atomic_load(&cal->samples_clamped));
+  pthread_mutex_unlock(&self->filter_mutex);
+  return Bp_EC_OK;
+}
+
+static Bp_EC calibration_map_deinit(Filter_t* self)
+{
+  CalibrationMap_t* cal = (CalibrationMap_t*) self;
+
+  free(atomic_exchange(&cal->active, NULL));
+  free(atomic_exchange(&cal->pending, NULL));
+
+  filt_release_inputs(self);
+  return Bp_EC_OK;
+}
+
+Bp_EC calibration_map_init(CalibrationMap_t* cal,
+                           CalibrationMap_config_t config)
+{
+  if (cal == NULL) return Bp_EC_NULL_FILTER;
+  if (config.buff_config.dtype != DTYPE_I32 &&
+      config.buff_config.dtype != DTYPE_FLOAT) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+
+  CalibLut_t* lut;
+  Bp_EC err = lut_build(&config.table, &lut);
+  if (err != Bp_EC_OK) return err;
+
+  Core_filt_config_t core_config = {
+      .name = config.name,
+      .filt_type = FILT_T_CALIBRATION_MAP,
+      .size = sizeof(CalibrationMap_t),
+      .n_inputs = 1,
+      .max_supported_sinks = 1,
+      .buff_config = config.buff_config,
+      .timeout_us = config.timeout_us > 0 ? config.timeout_us : 1000000,
+      .worker = calibration_map_worker};
+
+  err = filt_init(&cal->base, core_config);
+  if (err != Bp_EC_OK) {
+    free(lut);
+    return err;
+  }
+
+  atomic_init(&cal->active, lut);
+  atomic_init(&cal->pending, NULL);
+  atomic_init(&cal->tables_swapped, 0);
+  atomic_init(&cal->samples_clamped, 0);
+
+  cal->base.ops.describe = calibration_map_describe;
+  cal->base.ops.sink_connect = calibration_map_sink_connect;
+  cal->base.ops.reconfigure = calibration_map_reconfigure;
+  cal->base.ops.deinit = calibration_map_deinit;
+
+  prop_constraints_from_buffer_append(&cal->base, &config.buff_config, true);
+  SampleDtype_t out_dtype = DTYPE_FLOAT;
+  prop_append_behavior(&cal->base, PROP_DATA_TYPE, BEHAVIOR_OP_SET,
+                       &out_dtype, OUTPUT_ALL);
+  prop_append_behavior(&cal->base, PROP_SAMPLE_PERIOD_NS,
+                       BEHAVIOR_OP_PRESERVE, NULL, OUTPUT_ALL);
+  cal->base.output_properties[0] =
+      prop_propagate(NULL, 0, &cal->base.contract, 0);
+
+  return Bp_EC_OK;
+}
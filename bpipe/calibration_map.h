@@ -0,0 +1,65 @@
+#ifndef BPIPE_CALIBRATION_MAP_H
+#define BPIPE_CALIBRATION_MAP_H
+
+#include <stdatomic.h>
+#include "batch_buffer.h"
+#include "core.h"
+
+/* CalibrationMap: piecewise-linear calibration, raw sample -> float.
+ *
+ * The curve is given as breakpoints (x[i], y[i]) with strictly increasing
+ * x. Input is DTYPE_I32 (raw ADC counts) or DTYPE_FLOAT; output is always
+ * DTYPE_FLOAT with the input's timing, layout and channel count, batch for
+ * batch. Values outside [x[0], x[n-1]] are clamped to the end points unless
+ * `extrapolate` is set, in which case the end segments are extended.
+ *
+ * No per-sample search: uniformly spaced breakpoints are indexed directly,
+ * and non-uniform ones through a precomputed index table over a uniform
+ * grid, fine enough that each cell holds at most one breakpoint where
+ * possible. The table is resolved to a segment with one compare, and the
+ * slope of every segment is precomputed, so the inner loop is loads,
+ * a multiply and an add. Tables whose grid cells can hold several
+ * breakpoints (very uneven spacing beyond the 64k-cell grid) walk forward
+ * from the cell's first segment instead. With `extrapolate`, +-inf map
+ * through the end segments and NaN stays NaN.
+ *
+ * filt_reconfigure(&cal->base, &table) installs a new CalibrationTable_t
+ * while running. The table is compiled on the caller's thread and picked
+ * up by the worker at the next batch boundary.
+ */
+
+#define CALIB_MAX_POINTS 4096
+#define CALIB_MAX_GRID_EXPO 16 /* Largest index table: 64k cells */
+
+typedef struct _CalibrationTable_t {
+  const float* x;   /* Breakpoints, strictly increasing */
+  const float* y;   /* Value at each breakpoint */
+  size_t n_points;  /* 2..CALIB_MAX_POINTS */
+  bool extrapolate; /* Extend end segments instead of clamping */
+} CalibrationTable_t;
+
+typedef struct _CalibrationMap_config_t {
+  const char* name;
+  BatchBuffer_config buff_config; /* Input buffer; dtype I32 or FLOAT */
+  CalibrationTable_t table;
+  long timeout_us;
+} CalibrationMap_config_t;
+
+/* Compiled form of a CalibrationTable_t, private to the filter */
+struct _CalibLut;
+
+typedef struct _CalibrationMap_t {
+  Filter_t base;
+
+  _Atomic(struct _CalibLut*) pending; /* Set by reconfigure */
+  _Atomic(struct _CalibLut*) active;  /* Worker's table, see describe */
+
+  /* Statistics */
+  _Atomic uint64_t tables_swapped;
+  _Atomic uint64_t samples_clamped; /* Inputs outside the table range */
+} CalibrationMap_t;
+
+Bp_EC calibration_map_init(CalibrationMap_t* cal,
+                           CalibrationMap_config_t config);
+
+#endif /* BPIPE_CALIBRATION_MAP_H */
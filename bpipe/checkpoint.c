@@ -0,0 +1,52 @@
+#include "checkpoint.h"
+#include <string.h>
+
+void ckpt_writer(Checkpoint_t* ck, void* data, size_t size, bool with_rings)
+{
+  ck->data = (uint8_t*) data;
+  ck->size = data ? size : 0;
+  ck->pos = 0;
+  ck->with_rings = with_rings;
+  ck->n_cold = 0;
+}
+
+void ckpt_reader(Checkpoint_t* ck, const void* data, size_t size)
+{
+  ck->data = (uint8_t*) data;
+  ck->size = data ? size : 0;
+  ck->pos = 0;
+  ck->with_rings = false;
+  ck->n_cold = 0;
+}
+
+Bp_EC ckpt_write(Checkpoint_t* ck, const void* src, size_t n)
+{
+  if (ck->data != NULL) {
+    if (n > ck->size - ck->pos) return Bp_EC_NO_SPACE;
+    memcpy(ck->data + ck->pos, src, n);
+  }
+  ck->pos += n;
+  return Bp_EC_OK;
+}
+
+Bp_EC ckpt_read(Checkpoint_t* ck, void* dst, size_t n)
+{
+  if (ck->data == NULL || n > ck->size - ck->pos) return Bp_EC_INVALID_DATA;
+  memcpy(dst, ck->data + ck->pos, n);
+  ck->pos += n;
+  return Bp_EC_OK;
+}
+
+Bp_EC ckpt_skip(Checkpoint_t* ck, size_t n)
+{
+  if (ck->data == NULL || n > ck->size - ck->pos) return Bp_EC_INVALID_DATA;
+  ck->pos += n;
+  return Bp_EC_OK;
+}
+
+void ckpt_patch(Checkpoint_t* ck, size_t offset, const void* src, size_t n)
+{
+  if (ck->data != NULL && offset + n <= ck->size) {
+    memcpy(ck->data + offset, src, n);
+  }
+}
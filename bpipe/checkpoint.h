@@ -0,0 +1,49 @@
+#ifndef BPIPE_CHECKPOINT_H
+#define BPIPE_CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bperr.h"
+
+/* Checkpoint: a compact binary snapshot of filter state, for warm restarts.
+ *
+ * A Checkpoint_t is a cursor over a caller-owned byte buffer. Writers append
+ * fields with ckpt_write; with a NULL buffer nothing is stored and `pos`
+ * only counts bytes, which sizes the blob before allocating it. Readers
+ * consume the same fields in the same order with ckpt_read, which fails
+ * with Bp_EC_INVALID_DATA instead of reading past the end.
+ *
+ * Fields are stored in host byte order with no padding: a blob restores
+ * into the same build on the same kind of machine, which is what a restart
+ * needs. filt_checkpoint / filt_restore frame each filter's state into a
+ * record that also checks the filter's type and name.
+ */
+
+#define CKPT_MAGIC 0x4B435042u /* "BPCK" */
+
+typedef struct _Checkpoint_t {
+  uint8_t* data; /* NULL: sizing pass, bytes are counted only */
+  size_t size;   /* Capacity when writing, blob length when reading */
+  size_t pos;    /* Bytes written or read so far */
+
+  bool with_rings; /* Writing: also capture batches queued in input rings */
+  size_t n_cold;   /* Filters recorded without state (no checkpoint op) */
+} Checkpoint_t;
+
+/* Cursor over `data[0..size)`; data may be NULL to size a blob */
+void ckpt_writer(Checkpoint_t* ck, void* data, size_t size, bool with_rings);
+void ckpt_reader(Checkpoint_t* ck, const void* data, size_t size);
+
+Bp_EC ckpt_write(Checkpoint_t* ck, const void* src, size_t n);
+Bp_EC ckpt_read(Checkpoint_t* ck, void* dst, size_t n);
+Bp_EC ckpt_skip(Checkpoint_t* ck, size_t n);
+
+/* Overwrite n bytes written earlier at `offset`, e.g. a length prefix */
+void ckpt_patch(Checkpoint_t* ck, size_t offset, const void* src, size_t n);
+
+/* Write or read one lvalue, e.g. CKPT_PUT(ck, sg->next_t_ns) */
+#define CKPT_PUT(ck, field) ckpt_write((ck), &(field), sizeof(field))
+#define CKPT_GET(ck, field) ckpt_read((ck), &(field), sizeof(field))
+
+#endif /* BPIPE_CHECKPOINT_H */
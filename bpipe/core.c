@@ -43,10 +43,6 @@ static Bp_EC default_sink_connect(Filter_t* self, size_t output_port,
   if (sink == NULL) {
     return Bp_EC_NULL_BUFF;
   }
-  if (output_port >= MAX_SINKS) {
-    return Bp_EC_INVALID_SINK_IDX;
-  }
-
   // Check against filter's configured maximum sinks
   if (output_port >= self->max_supported_sinks) {
     return Bp_EC_INVALID_SINK_IDX;
@@ -66,22 +62,41 @@ static Bp_EC default_sink_connect(Filter_t* self, size_t output_port,
       pthread_mutex_unlock(&self->filter_mutex);
       return Bp_EC_DTYPE_MISMATCH;
     }
+    // Same assumption for the channel count: frames must be the same width
+    if (sink->n_channels != self->input_buffers[0]->n_channels) {
+      pthread_mutex_unlock(&self->filter_mutex);
+      return Bp_EC_WIDTH_MISMATCH;
+    }
+    // And for per-sample timestamps: a sink without a timestamp column
+    // would have them dropped by bb_copy_frames
+    if (self->input_buffers[0]->ts_ring != NULL && sink->ts_ring == NULL) {
+      pthread_mutex_unlock(&self->filter_mutex);
+      return Bp_EC_INVALID_CONFIG;
+    }
   }
 
   // Note: Property validation should be done at a higher level where we have
   // access to both the source and destination filters. For now, we skip
   // property validation here.
 
-  self->sinks[output_port] = sink;
-  self->n_sinks++;
-
-  // Special handling for BatchMatcher auto-detection
+  // Special handling for BatchMatcher auto-detection. An explicit size may be
+  // any length that fits in the sink's batches.
   if (self->filt_type == FILT_T_BATCH_MATCHER && output_port == 0) {
     BatchMatcher_t* matcher = (BatchMatcher_t*) self;
-    matcher->output_batch_samples = 1 << sink->batch_capacity_expo;
+    size_t capacity = bb_batch_size(sink);
+    if (matcher->requested_batch_samples > capacity) {
+      pthread_mutex_unlock(&self->filter_mutex);
+      return Bp_EC_CAPACITY_MISMATCH;
+    }
+    matcher->output_batch_samples = matcher->requested_batch_samples
+                                        ? matcher->requested_batch_samples
+                                        : capacity;
     matcher->size_detected = true;
   }
 
+  self->sinks[output_port] = sink;
+  self->n_sinks++;
+
   pthread_mutex_unlock(&self->filter_mutex);
 
   return Bp_EC_OK;
@@ -192,6 +207,79 @@ static const FilterOps default_ops = {
     .handle_error = default_handle_error,
     .recover = default_recover};
 
+/* Sections of a port block start on this boundary */
+#define PORT_BLOCK_ALIGN 16
+
+static size_t port_block_round(size_t n)
+{
+  return (n + PORT_BLOCK_ALIGN - 1) & ~(size_t) (PORT_BLOCK_ALIGN - 1);
+}
+
+/* Hot block: input and sink pointers with the per-sink flush state. Cold
+ * block: property constraints, behaviors and tables. Each is one zeroed
+ * allocation whose first section is the pointer that gets freed. Every
+ * port array has at least one slot, so input_buffers[0] and sinks[0] read
+ * as NULL on sources and sinks. */
+static bool filt_alloc_ports(Filter_t* f, size_t n_inputs, size_t n_sinks)
+{
+  n_inputs = MAX(n_inputs, 1);
+  n_sinks = MAX(n_sinks, 1);
+  const size_t n_out_tables = n_sinks;
+  const size_t sinks_at = port_block_round(n_inputs * sizeof(Batch_buff_t*));
+  const size_t policy_at =
+      sinks_at + port_block_round(n_sinks * sizeof(Batch_buff_t*));
+  const size_t state_at =
+      policy_at + port_block_round(n_sinks * sizeof(FlushPolicy_t));
+  const size_t hot_size =
+      state_at + port_block_round(n_sinks * sizeof(FlushState_t));
+
+  const size_t behaviors_at =
+      port_block_round(MAX_CONSTRAINTS * sizeof(InputConstraint_t));
+  const size_t out_at =
+      behaviors_at + port_block_round(MAX_BEHAVIORS * sizeof(OutputBehavior_t));
+  const size_t in_at =
+      out_at + port_block_round(n_out_tables * sizeof(PropertyTable_t));
+  const size_t cold_size =
+      in_at + port_block_round(n_inputs * sizeof(PropertyTable_t));
+
+  char* hot = calloc(1, hot_size);
+  char* cold = calloc(1, cold_size);
+  if (hot == NULL || cold == NULL) {
+    free(hot);
+    free(cold);
+    return false;
+  }
+
+  f->input_buffers = (Batch_buff_t**) hot;
+  f->sinks = (Batch_buff_t**) (hot + sinks_at);
+  f->flush_policy = (FlushPolicy_t*) (hot + policy_at);
+  f->flush_state = (FlushState_t*) (hot + state_at);
+
+  f->input_constraints = (InputConstraint_t*) cold;
+  f->output_behaviors = (OutputBehavior_t*) (cold + behaviors_at);
+  f->output_properties = (PropertyTable_t*) (cold + out_at);
+  f->input_properties = (PropertyTable_t*) (cold + in_at);
+  return true;
+}
+
+static void filt_free_ports(Filter_t* f)
+{
+  free(f->input_buffers);
+  free(f->input_constraints);
+  f->input_buffers = NULL;
+  f->sinks = NULL;
+  f->flush_policy = NULL;
+  f->flush_state = NULL;
+  f->input_constraints = NULL;
+  f->output_behaviors = NULL;
+  f->output_properties = NULL;
+  f->input_properties = NULL;
+  f->contract.input_constraints = NULL;
+  f->contract.output_behaviors = NULL;
+  f->n_input_buffers = 0;
+  f->max_supported_sinks = 0;
+}
+
 /* Configuration-based initialization API */
 Bp_EC filt_init(Filter_t* f, Core_filt_config_t config)
 {
@@ -218,21 +306,25 @@ Bp_EC filt_init(Filter_t* f, Core_filt_config_t config)
   }
   f->size = config.size;
 
-  if (config.max_supported_sinks > MAX_SINKS) {
+  if (config.max_supported_sinks > MAX_PORTS) {
     return Bp_EC_INVALID_CONFIG_MAX_SINKS;
   }
   f->max_supported_sinks = config.max_supported_sinks;
 
-  if (config.n_inputs > MAX_INPUTS) {
+  if (config.n_inputs > MAX_PORTS) {
     return Bp_EC_INVALID_CONFIG_MAX_INPUTS;
   }
-  f->n_input_buffers = config.n_inputs;
 
   if (config.worker == NULL) {
     return Bp_EC_INVALID_CONFIG_WORKER;
   }
   f->worker = config.worker;
 
+  if (!filt_alloc_ports(f, config.n_inputs, config.max_supported_sinks)) {
+    return Bp_EC_ALLOC;
+  }
+  f->n_input_buffers = config.n_inputs;
+
   // Allocate and initialize input buffers
   for (int i = 0; i < config.n_inputs; i++) {
     f->input_buffers[i] = malloc(sizeof(Batch_buff_t));
@@ -242,6 +334,7 @@ Bp_EC filt_init(Filter_t* f, Core_filt_config_t config)
         bb_deinit(f->input_buffers[j]);
         free(f->input_buffers[j]);
       }
+      filt_free_ports(f);
       return Bp_EC_ALLOC;
     }
 
@@ -253,15 +346,11 @@ Bp_EC filt_init(Filter_t* f, Core_filt_config_t config)
         bb_deinit(f->input_buffers[j]);
         free(f->input_buffers[j]);
       }
+      filt_free_ports(f);
       return rc;
     }
   }
 
-  // Initialize remaining pointers to NULL
-  for (int i = config.n_inputs; i < MAX_INPUTS; i++) {
-    f->input_buffers[i] = NULL;
-  }
-
   if (config.name != NULL) {
     strncpy(f->name, config.name, sizeof(f->name) - 1);
     f->name[sizeof(f->name) - 1] = '\0';
@@ -279,6 +368,7 @@ Bp_EC filt_init(Filter_t* f, Core_filt_config_t config)
       bb_deinit(f->input_buffers[i]);
       free(f->input_buffers[i]);
     }
+    filt_free_ports(f);
     return Bp_EC_MUTEX_INIT_FAIL;
   }
 
@@ -294,7 +384,8 @@ Bp_EC filt_init(Filter_t* f, Core_filt_config_t config)
   // Initialize operations interface with defaults
   f->ops = default_ops;
 
-  // Initialize property system arrays and counts
+  // Initialize property system arrays and counts (block from
+  // filt_alloc_ports)
   for (int i = 0; i < MAX_CONSTRAINTS; i++) {
     f->input_constraints[i].property = PROP_SLOT_AVAILABLE;
   }
@@ -314,12 +405,12 @@ Bp_EC filt_init(Filter_t* f, Core_filt_config_t config)
   // Initialize output properties (default to 1 output for backward
   // compatibility)
   f->n_outputs = 1;
-  for (int i = 0; i < MAX_OUTPUTS; i++) {
+  for (size_t i = 0; i < MAX(f->max_supported_sinks, 1); i++) {
     f->output_properties[i] = prop_table_init();
   }
 
   // Initialize input properties
-  for (int i = 0; i < MAX_INPUTS; i++) {
+  for (int i = 0; i < MAX(f->n_input_buffers, 1); i++) {
     f->input_properties[i] = prop_table_init();
   }
 
@@ -337,12 +428,28 @@ Bp_EC filt_deinit(Filter_t* f)
     return Bp_EC_INVALID_CONFIG;
   }
 
-  // Use custom deinit operation if available
+  // Use custom deinit operation if available. It releases the filter's own
+  // state and input buffers; the port arrays are released here.
   if (f->ops.deinit != NULL && f->ops.deinit != default_deinit) {
-    return f->ops.deinit(f);
+    Bp_EC rc = f->ops.deinit(f);
+    if (rc == Bp_EC_OK) {
+      filt_free_ports(f);
+      f->filt_type = FILT_T_NDEF;
+    }
+    return rc;
   }
 
-  // Free allocated input buffers
+  filt_release_inputs(f);
+  filt_free_ports(f);
+
+  // Reset filter type to indicate it's deinitialized
+  f->filt_type = FILT_T_NDEF;
+
+  return Bp_EC_OK;
+}
+
+void filt_release_inputs(Filter_t* f)
+{
   for (int i = 0; i < f->n_input_buffers; i++) {
     if (f->input_buffers[i]) {
       bb_deinit(f->input_buffers[i]);
@@ -350,16 +457,59 @@ Bp_EC filt_deinit(Filter_t* f)
       f->input_buffers[i] = NULL;
     }
   }
-
-  // Destroy mutex
   pthread_mutex_destroy(&f->filter_mutex);
+}
 
-  // Reset filter type to indicate it's deinitialized
-  f->filt_type = FILT_T_NDEF;
+Bp_EC filt_attach_sink(Filter_t* f, size_t port, Batch_buff_t* sink,
+                       SampleDtype_t dtype, size_t n_channels)
+{
+  if (f == NULL) return Bp_EC_NULL_FILTER;
+  if (sink == NULL) return Bp_EC_NULL_BUFF;
+  if (port >= f->max_supported_sinks) return Bp_EC_INVALID_SINK_IDX;
+  if (sink->dtype != dtype) return Bp_EC_DTYPE_MISMATCH;
+  if (sink->n_channels != n_channels) return Bp_EC_WIDTH_MISMATCH;
 
+  pthread_mutex_lock(&f->filter_mutex);
+  if (f->sinks[port] != NULL) {
+    pthread_mutex_unlock(&f->filter_mutex);
+    return Bp_EC_CONNECTION_OCCUPIED;
+  }
+  f->sinks[port] = sink;
+  f->n_sinks++;
+  pthread_mutex_unlock(&f->filter_mutex);
   return Bp_EC_OK;
 }
 
+Bp_EC filt_send_complete(Filter_t* f, Batch_buff_t* out)
+{
+  Batch_t* batch = bb_get_head(out);
+  batch->ec = Bp_EC_COMPLETE;
+  batch->head = 0;
+  return bb_submit(out, f->timeout_us);
+}
+
+Bp_EC filt_waitset_inputs(Filter_t* f, BbWaitSet_t* ws)
+{
+  Bp_EC err = bb_waitset_init(ws);
+  for (int i = 0; i < f->n_input_buffers && err == Bp_EC_OK; i++) {
+    err = bb_waitset_add_input(ws, f->input_buffers[i]);
+  }
+  if (err != Bp_EC_OK) bb_waitset_deinit(ws);
+  return err;
+}
+
+Bp_EC filt_await_inputs(Filter_t* f, BbWaitSet_t* ws, uint32_t want,
+                        uint32_t* ready)
+{
+  *ready = 0;
+  bb_waitset_watch(ws, want, 0);
+  Bp_EC err = bb_await_any(ws, f->timeout_us, ready, NULL);
+  if (err == Bp_EC_TIMEOUT && !atomic_load(&f->running)) {
+    return Bp_EC_STOPPED;
+  }
+  return err;
+}
+
 /* Multi-I/O connection functions */
 Bp_EC filt_sink_connect(Filter_t* f, size_t sink_idx, Batch_buff_t* dest_buffer)
 {
@@ -376,7 +526,7 @@ Bp_EC filt_sink_disconnect(Filter_t* f, size_t sink_idx)
   if (f == NULL) {
     return Bp_EC_NULL_FILTER;
   }
-  if (sink_idx >= MAX_SINKS) {
+  if (sink_idx >= f->max_supported_sinks) {
     return Bp_EC_INVALID_SINK_IDX;
   }
 
@@ -489,6 +639,10 @@ Bp_EC filt_connect(Filter_t* source, size_t source_output, Filter_t* sink,
     return Bp_EC_NULL_FILTER;
   }
 
+  // Port tables are sized at init: range-check before indexing them
+  if (source_output >= source->max_supported_sinks) {
+    return Bp_EC_INVALID_SINK_IDX;
+  }
   if (sink_input >= sink->n_input_buffers) {
     return Bp_EC_INVALID_SINK_IDX;
   }
@@ -541,9 +695,12 @@ void* matched_passthroug(void* arg)
                        f->input_buffers[0]->batch_capacity_expo,
                    Bp_EC_CAPACITY_MISMATCH);
   BP_WORKER_ASSERT(f, f->sinks[0]->dtype < DTYPE_MAX, Bp_EC_DTYPE_INVALID);
+  BP_WORKER_ASSERT(f,
+                   f->sinks[0]->n_channels == f->input_buffers[0]->n_channels &&
+                       f->sinks[0]->layout == f->input_buffers[0]->layout,
+                   Bp_EC_WIDTH_MISMATCH);
 
-  size_t copy_size =
-      bb_batch_size(f->sinks[0]) * _data_size_lut[f->sinks[0]->dtype];
+  size_t copy_size = bb_batch_bytes(f->sinks[0]);
 
   while (f->running) {
     input = bb_get_tail(f->input_buffers[0], f->timeout_us, &err);
@@ -562,8 +719,11 @@ void* matched_passthroug(void* arg)
     output = bb_get_head(f->sinks[0]);
     BP_WORKER_ASSERT(f, output != NULL, Bp_EC_GET_HEAD_NULL);
 
-    BP_WORKER_ASSERT(f, memcpy(output->data, input->data, copy_size) != NULL,
-                     Bp_EC_MALLOC_FAIL);
+    // Hand the input's storage over when the rings allow it, else copy
+    if (bb_swap_data(f->input_buffers[0], input, f->sinks[0], output) !=
+        Bp_EC_OK) {
+      memcpy(output->data, input->data, copy_size);
+    }
 
     // Copy batch metadata
     output->head = input->head;
@@ -663,6 +823,168 @@ Bp_EC filt_dump_state(Filter_t* filter, char* buffer, size_t buffer_size)
   return filter->ops.dump_state(filter, buffer, buffer_size);
 }
 
+/* Checkpoint record: header, then the state and the ring contents, each
+ * behind a uint64_t byte count so a reader can check or skip them */
+typedef struct {
+  uint32_t magic;
+  uint32_t filt_type;
+  char name[32];
+} CkptHeader_t;
+
+static Bp_EC ckpt_section_begin(Checkpoint_t* ck, size_t* offset)
+{
+  uint64_t len = 0;
+  *offset = ck->pos;
+  return CKPT_PUT(ck, len);
+}
+
+static void ckpt_section_end(Checkpoint_t* ck, size_t offset)
+{
+  uint64_t len = ck->pos - offset - sizeof(len);
+  ckpt_patch(ck, offset, &len, sizeof(len));
+}
+
+/* Next section of `ck` as a cursor of its own, so a section cannot be
+ * overrun; `ck` moves past it */
+static Bp_EC ckpt_section(Checkpoint_t* ck, Checkpoint_t* section)
+{
+  uint64_t len;
+  Bp_EC err = CKPT_GET(ck, len);
+  if (err != Bp_EC_OK) return err;
+  if (len > ck->size - ck->pos) return Bp_EC_INVALID_DATA;
+  ckpt_reader(section, ck->data + ck->pos, (size_t) len);
+  ck->pos += (size_t) len;
+  return Bp_EC_OK;
+}
+
+static Bp_EC ckpt_check_header(const Filter_t* f, Checkpoint_t* ck)
+{
+  CkptHeader_t hdr;
+  Bp_EC err = CKPT_GET(ck, hdr);
+  if (err != Bp_EC_OK) return err;
+  if (hdr.magic != CKPT_MAGIC || hdr.filt_type != (uint32_t) f->filt_type ||
+      strncmp(hdr.name, f->name, sizeof(hdr.name)) != 0) {
+    return Bp_EC_INVALID_DATA;
+  }
+  return Bp_EC_OK;
+}
+
+/* A pipeline's input ring belongs to its input filter */
+static size_t ckpt_n_rings(const Filter_t* f, const Checkpoint_t* ck)
+{
+  if (!ck->with_rings || f->filt_type == FILT_T_PIPELINE) return 0;
+  return (size_t) f->n_input_buffers;
+}
+
+Bp_EC filt_checkpoint(Filter_t* filter, Checkpoint_t* ck)
+{
+  if (filter == NULL) {
+    return Bp_EC_NULL_FILTER;
+  }
+  if (ck == NULL) {
+    return Bp_EC_NULL_POINTER;
+  }
+  if (filter->filt_type == FILT_T_NDEF) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+  if (atomic_load(&filter->running)) {
+    return Bp_EC_ALREADY_RUNNING;
+  }
+
+  CkptHeader_t hdr = {.magic = CKPT_MAGIC,
+                      .filt_type = (uint32_t) filter->filt_type};
+  memcpy(hdr.name, filter->name, sizeof(hdr.name));
+  Bp_EC err = CKPT_PUT(ck, hdr);
+
+  size_t offset;
+  if (err == Bp_EC_OK) err = ckpt_section_begin(ck, &offset);
+  if (err == Bp_EC_OK) {
+    if (filter->ops.checkpoint != NULL) {
+      err = filter->ops.checkpoint(filter, ck);
+    } else {
+      ck->n_cold++;
+    }
+    ckpt_section_end(ck, offset);
+  }
+
+  if (err == Bp_EC_OK) err = ckpt_section_begin(ck, &offset);
+  if (err == Bp_EC_OK) {
+    uint32_t n_rings = (uint32_t) ckpt_n_rings(filter, ck);
+    err = CKPT_PUT(ck, n_rings);
+    for (uint32_t i = 0; i < n_rings && err == Bp_EC_OK; i++) {
+      err = bb_checkpoint(filter->input_buffers[i], ck);
+    }
+    ckpt_section_end(ck, offset);
+  }
+  return err;
+}
+
+Bp_EC filt_restore(Filter_t* filter, Checkpoint_t* ck)
+{
+  if (filter == NULL) {
+    return Bp_EC_NULL_FILTER;
+  }
+  if (ck == NULL) {
+    return Bp_EC_NULL_POINTER;
+  }
+  if (filter->filt_type == FILT_T_NDEF) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+  if (atomic_load(&filter->running)) {
+    return Bp_EC_ALREADY_RUNNING;
+  }
+
+  Checkpoint_t state, rings;
+  Bp_EC err = ckpt_check_header(filter, ck);
+  if (err == Bp_EC_OK) err = ckpt_section(ck, &state);
+  if (err == Bp_EC_OK) err = ckpt_section(ck, &rings);
+  if (err != Bp_EC_OK) return err;
+
+  if (state.size > 0) {
+    if (filter->ops.restore == NULL) {
+      return Bp_EC_NOT_IMPLEMENTED;
+    }
+    err = filter->ops.restore(filter, &state);
+    if (err != Bp_EC_OK) return err;
+    if (state.pos != state.size) return Bp_EC_INVALID_DATA;
+  }
+
+  uint32_t n_rings;
+  err = CKPT_GET(&rings, n_rings);
+  if (err != Bp_EC_OK) return err;
+  if (n_rings != 0 && n_rings != (uint32_t) filter->n_input_buffers) {
+    return Bp_EC_INVALID_DATA;
+  }
+  for (uint32_t i = 0; i < n_rings && err == Bp_EC_OK; i++) {
+    err = bb_restore(filter->input_buffers[i], &rings);
+  }
+  return err;
+}
+
+Bp_EC filt_skip_record(const Filter_t* filter, Checkpoint_t* ck)
+{
+  if (filter == NULL) {
+    return Bp_EC_NULL_FILTER;
+  }
+  Checkpoint_t state, rings;
+  Bp_EC err = ckpt_check_header(filter, ck);
+  if (err == Bp_EC_OK) err = ckpt_section(ck, &state);
+  if (err == Bp_EC_OK) err = ckpt_section(ck, &rings);
+  if (err != Bp_EC_OK) return err;
+
+  /* State can only be checked by applying it; ring geometry can be now */
+  uint32_t n_rings;
+  err = CKPT_GET(&rings, n_rings);
+  if (err != Bp_EC_OK) return err;
+  if (n_rings != 0 && n_rings != (uint32_t) filter->n_input_buffers) {
+    return Bp_EC_INVALID_DATA;
+  }
+  for (uint32_t i = 0; i < n_rings && err == Bp_EC_OK; i++) {
+    err = bb_restore_check(filter->input_buffers[i], &rings);
+  }
+  return err;
+}
+
 Bp_EC filt_handle_error(Filter_t* filter, Bp_EC error)
 {
   if (filter == NULL) {
@@ -678,3 +1000,74 @@ Bp_EC filt_recover(Filter_t* filter)
   }
   return filter->ops.recover(filter);
 }
+
+Bp_EC filt_set_flush_policy(Filter_t* filter, size_t port,
+                            FlushPolicy_t policy)
+{
+  if (filter == NULL) {
+    return Bp_EC_NULL_FILTER;
+  }
+  if (port >= filter->max_supported_sinks) {
+    return Bp_EC_INVALID_SINK_IDX;
+  }
+  if (atomic_load(&filter->running)) {
+    return Bp_EC_ALREADY_RUNNING;
+  }
+  filter->flush_policy[port] = policy;
+  filter->flush_state[port].open = false;
+  return Bp_EC_OK;
+}
+
+bool filt_flush_due(Filter_t* filter, size_t port, const Batch_t* out,
+                    bool input_boundary)
+{
+  const FlushPolicy_t* policy = &filter->flush_policy[port];
+  FlushState_t* state = &filter->flush_state[port];
+  Batch_buff_t* sink = filter->sinks[port];
+
+  if (out == NULL || out->head == 0) {
+    state->open = false;
+    return false;
+  }
+  if (out->head >= bb_batch_size(sink)) {
+    return true;
+  }
+  if (policy->max_latency_us == 0) {
+    return false;
+  }
+
+  /* A new head slot restarts the clock */
+  size_t seq = atomic_load_explicit(&sink->producer.head, memory_order_relaxed);
+  long long now = now_ns(CLOCK_MONOTONIC);
+  if (!state->open || state->seq != seq) {
+    state->open = true;
+    state->seq = seq;
+    state->opened_ns = now;
+  }
+
+  bool due = (input_boundary && !policy->coalesce) ||
+             now - state->opened_ns >= (long long) policy->max_latency_us * 1000;
+  if (due) {
+    filter->metrics.deadline_flushes++;
+  }
+  return due;
+}
+
+unsigned long filt_wait_us(Filter_t* filter)
+{
+  unsigned long wait = filter->timeout_us;
+  long long now = 0;
+
+  for (size_t port = 0; port < filter->max_supported_sinks; port++) {
+    const FlushState_t* state = &filter->flush_state[port];
+    unsigned long latency = filter->flush_policy[port].max_latency_us;
+    if (!state->open || latency == 0) continue;
+
+    if (now == 0) now = now_ns(CLOCK_MONOTONIC);
+    long long left_us =
+        (state->opened_ns + (long long) latency * 1000 - now) / 1000;
+    /* Wake at least 1us out so an expired deadline still yields a poll */
+    wait = MIN(wait, (unsigned long) MAX(left_us, 1LL));
+  }
+  return wait;
+}
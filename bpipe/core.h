@@ -22,12 +22,13 @@
 #include <unistd.h>
 #include "batch_buffer.h"
 #include "bperr.h"
+#include "checkpoint.h"
 #include "properties.h"
 #include "utils.h"
 
-#define MAX_SINKS 10
-#define MAX_INPUTS 10
-#define MAX_OUTPUTS 8              // max 8 output ports per filter
+#define MAX_SINKS 10   // Fan-out of filters with fixed per-output tables
+#define MAX_INPUTS 10  // Fan-in of filters with fixed per-input tables
+#define MAX_PORTS 256  // Inputs or sinks of one filter, sized by filt_init
 #define MAX_CAPACITY_EXPO 30       // max 1GB capacity
 #define MAX_RING_CAPACITY_EXPO 12  // max 4016 entries in ring buffer
 //
@@ -52,6 +53,14 @@ typedef enum _CORE_FILT_T {
   FILT_T_SAMPLE_ALIGNER, /* Corrects phase offset in regular data to align to
                             sample grid */
   FILT_T_PIPELINE,       /* Container for filter DAGs */
+  FILT_T_MIMO_ASOF_JOIN, /* Latest secondary values as of each primary sample
+                          */
+  FILT_T_CALIBRATION_MAP, /* Piecewise-linear calibration to float */
+  FILT_T_FIXED_DSP,       /* Q15/Q31 FIR, biquad and mixer kernels */
+  FILT_T_MOVING_MEDIAN,   /* Running median over a sliding window */
+  FILT_T_XCORR,           /* FFT cross-correlation / delay estimation */
+  FILT_T_COVARIANCE,      /* Sliding covariance / correlation matrix */
+  FILT_T_REORDER,         /* Restores timestamp order within a bound */
   FILT_T_MAX,            /* Overflow guard. */
 } CORE_FILT_T;
 
@@ -91,6 +100,11 @@ typedef struct _FilterOps {
   Bp_EC (*reconfigure)(struct _Filter_t *self, void *config);
   Bp_EC (*validate_connection)(struct _Filter_t *self, size_t sink_idx);
 
+  /* State persistence (optional): write / read the filter's runtime state,
+   * in the same order. Called only while the filter is stopped. */
+  Bp_EC (*checkpoint)(struct _Filter_t *self, Checkpoint_t *ck);
+  Bp_EC (*restore)(struct _Filter_t *self, Checkpoint_t *ck);
+
   /* Debugging operations */
   Bp_EC (*describe)(struct _Filter_t *self, char *buffer, size_t buffer_size);
   Bp_EC (*dump_state)(struct _Filter_t *self, char *buffer, size_t buffer_size);
@@ -119,44 +133,73 @@ typedef struct _Core_filt_config_t {
   Worker_t *worker;
 } Core_filt_config_t;
 
+/* Per-output flush policy. The zero value keeps the default behaviour of
+ * submitting a partial batch only when it is full or the stream ends.
+ *
+ * max_latency_us bounds how long samples may sit in a partial head batch;
+ * workers check it on every input batch and on their timeout_us wake-ups
+ * (shortened by filt_wait_us), so no timer thread is involved. With a
+ * deadline set, coalesce chooses between submitting at every input batch
+ * boundary (false) and merging consecutive input batches until the output
+ * is full or the deadline expires (true). */
+typedef struct _FlushPolicy_t {
+  unsigned long max_latency_us; /* 0 = flush full batches only */
+  bool coalesce;                /* Merge input batches up to the deadline */
+} FlushPolicy_t;
+
+typedef struct _FlushState_t {
+  size_t seq;          /* producer.head of the batch being timed */
+  long long opened_ns; /* When its first sample was seen */
+  bool open;
+} FlushState_t;
+
 typedef struct _Filt_metrics {
   size_t n_batches;
   size_t samples_processed;
+  size_t deadline_flushes; /* Partial batches submitted by flush policy */
 } Filt_metrics;
 
+/* Filter base. Fields the worker reads on every batch come first and fit in
+ * two cache lines; port arrays are sized by filt_init from n_inputs and
+ * max_supported_sinks (at least one slot each). Identity, lifecycle and the property system follow;
+ * the property arrays live in a separate block that the data path never
+ * touches. Both blocks are released by filt_deinit. */
 typedef struct _Filter_t {
+  /* Hot */
+  atomic_bool running;
+  int n_input_buffers;
+  int n_sinks;
+  unsigned long timeout_us;
+  Batch_buff_t **input_buffers;  // [n_input_buffers]
+  Batch_buff_t **sinks;          // [max_supported_sinks], filter_mutex
+  FlushPolicy_t *flush_policy;   // [max_supported_sinks] Partial submission
+  FlushState_t *flush_state;     // [max_supported_sinks] Worker-owned
+  Filt_metrics metrics;
+  size_t data_width;
+
+  /* Cold */
   char name[32];
   size_t size;
   CORE_FILT_T filt_type;
-  atomic_bool running;
   Worker_t *worker;
   Err_info worker_err_info;
-  Filt_metrics metrics;
-  unsigned long timeout_us;
   size_t max_supported_sinks;
-  int n_input_buffers;
   size_t n_sink_buffers;
-  int n_sinks;
-  size_t data_width;
   pthread_t worker_thread;
   pthread_mutex_t filter_mutex;  // Protects sinks arrays
-  Batch_buff_t *input_buffers[MAX_INPUTS];
-  Batch_buff_t *sinks[MAX_SINKS];
-  FilterOps ops;  // Embedded operations interface
+  FilterOps ops;                 // Embedded operations interface
 
-/* Property system - static arrays with explicit counts */
+/* Property system - fixed-capacity arrays with explicit counts */
 #define MAX_CONSTRAINTS 16
 #define MAX_BEHAVIORS 16
-  InputConstraint_t input_constraints[MAX_CONSTRAINTS];
-  size_t n_input_constraints;  // Number of active constraints
-  OutputBehavior_t output_behaviors[MAX_BEHAVIORS];
-  size_t n_output_behaviors;  // Number of active behaviors
-  FilterContract_t contract;  // Uses above arrays
-  PropertyTable_t
-      output_properties[MAX_OUTPUTS];  // Cached output properties per port
-  uint32_t n_outputs;                  // Number of output ports (default 1)
-  PropertyTable_t
-      input_properties[MAX_INPUTS];  // Properties of connected inputs
+  InputConstraint_t *input_constraints;  // [MAX_CONSTRAINTS]
+  size_t n_input_constraints;            // Number of active constraints
+  OutputBehavior_t *output_behaviors;    // [MAX_BEHAVIORS]
+  size_t n_output_behaviors;             // Number of active behaviors
+  FilterContract_t contract;             // Uses above arrays
+  PropertyTable_t *output_properties;    // [max(max_supported_sinks, 1)]
+  uint32_t n_outputs;                    // Number of output ports (default 1)
+  PropertyTable_t *input_properties;     // [max(n_input_buffers, 1)]
 } Filter_t;
 
 Worker_t matched_passthroug;
@@ -166,6 +209,30 @@ Bp_EC filt_init(Filter_t *filter, Core_filt_config_t config);
 
 Bp_EC filt_deinit(Filter_t *filter);
 
+/* Building blocks for filters with their own ops and workers.
+ *
+ * filt_release_inputs frees what filt_init set up besides the ports (input
+ * buffers and filter mutex); a custom deinit calls it after releasing its
+ * own state. filt_attach_sink stores a sink whose dtype and channel count
+ * must be the given ones, for filters whose output frames differ from their
+ * input. filt_send_complete submits an empty COMPLETE batch on `out`. */
+void filt_release_inputs(Filter_t *filter);
+Bp_EC filt_attach_sink(Filter_t *filter, size_t port, Batch_buff_t *sink,
+                       SampleDtype_t dtype, size_t n_channels);
+Bp_EC filt_send_complete(Filter_t *filter, Batch_buff_t *out);
+
+/* Fan-in waits for workers with several inputs.
+ *
+ * filt_waitset_inputs registers every input of `filter` in `ws`, once per
+ * worker run; the worker calls bb_waitset_deinit before it returns.
+ * filt_await_inputs sleeps until one of the inputs in `want` (bit i = input
+ * i) can be read, for at most the filter timeout, and returns the ready ones
+ * in `ready`. Bp_EC_TIMEOUT means nothing arrived; Bp_EC_STOPPED that the
+ * filter was stopped meanwhile. */
+Bp_EC filt_waitset_inputs(Filter_t *filter, BbWaitSet_t *ws);
+Bp_EC filt_await_inputs(Filter_t *filter, BbWaitSet_t *ws, uint32_t want,
+                        uint32_t *ready);
+
 /* Multi-I/O connection functions */
 Bp_EC filt_sink_connect(Filter_t *f, size_t sink_idx,
                         Batch_buff_t *dest_buffer);
@@ -194,4 +261,29 @@ Bp_EC filt_dump_state(Filter_t *filter, char *buffer, size_t buffer_size);
 Bp_EC filt_handle_error(Filter_t *filter, Bp_EC error);
 Bp_EC filt_recover(Filter_t *filter);
 
+/* Warm restart. filt_checkpoint appends a record for a stopped filter to
+ * `ck`: its type and name, its state from ops.checkpoint and, with
+ * ck->with_rings, the batches queued in its input rings. Filters without a
+ * checkpoint op are recorded without state, restart cold and are counted in
+ * ck->n_cold. filt_restore reads the record back into a filter initialised
+ * and connected the same way, before it is started; a record for another
+ * filter is rejected with Bp_EC_INVALID_DATA. Both return
+ * Bp_EC_ALREADY_RUNNING for a running filter. */
+Bp_EC filt_checkpoint(Filter_t *filter, Checkpoint_t *ck);
+Bp_EC filt_restore(Filter_t *filter, Checkpoint_t *ck);
+
+/* Check that the next record in `ck` belongs to `filter` and that its queued
+ * batches fit the filter's input rings, then skip it */
+Bp_EC filt_skip_record(const Filter_t *filter, Checkpoint_t *ck);
+
+/* Flush policy. filt_set_flush_policy is called before start. Workers call
+ * filt_flush_due with their open head batch on `port` whenever they could
+ * submit it (`input_boundary` = an input batch was just finished) and use
+ * filt_wait_us as the timeout for blocking input waits. */
+Bp_EC filt_set_flush_policy(Filter_t *filter, size_t port,
+                            FlushPolicy_t policy);
+bool filt_flush_due(Filter_t *filter, size_t port, const Batch_t *out,
+                    bool input_boundary);
+unsigned long filt_wait_us(Filter_t *filter);
+
 #endif /* BPIPE_CORE_H */
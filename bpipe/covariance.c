@@ -0,0 +1,339 @@
+#include "covariance.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+#define COV_TILE 32
+
+/* row[0..COV_TILE) += a * x[0..COV_TILE); fixed length so it vectorises */
+static inline void cov_axpy(double* restrict row, const double* restrict x,
+                            double a)
+{
+  for (size_t j = 0; j < COV_TILE; j++) row[j] += a * x[j];
+}
+
+/* sum_xx += X^T X for n frames of `stride` doubles, upper block triangle
+ * only. Tiles on the diagonal are updated whole; the part below the
+ * diagonal is never read. */
+static void cov_rank_update(double* sum_xx, const double* x, size_t n,
+                            size_t stride)
+{
+  for (size_t i0 = 0; i0 < stride; i0 += COV_TILE) {
+    for (size_t j0 = i0; j0 < stride; j0 += COV_TILE) {
+      for (size_t k = 0; k < n; k++) {
+        const double* xk = x + k * stride;
+        for (size_t i = i0; i < i0 + COV_TILE; i++) {
+          cov_axpy(sum_xx + i * stride + j0, xk + j0, xk[i]);
+        }
+      }
+    }
+  }
+}
+
+static inline double* cov_hop(Covariance_t* cov, size_t h)
+{
+  return cov->hops + h * cov->hop_words;
+}
+
+/* Accumulate n frames starting at frame `first` of a batch into the
+ * current hop */
+static void cov_accumulate(Covariance_t* cov, const Batch_buff_t* in_buf,
+                           const Batch_t* batch, size_t first, size_t n)
+{
+  const size_t nc = cov->n_channels;
+  const size_t stride = cov->stride;
+  const size_t in_stride =
+      in_buf->layout == BATCH_LAYOUT_PLANAR ? 1 : in_buf->n_channels;
+
+  if (!cov->shifted) {
+    for (size_t c = 0; c < nc; c++) {
+      const float* src = (const float*) bb_channel_ptr(in_buf, batch, c);
+      cov->shift[c] = src[first * in_stride];
+    }
+    cov->shifted = true;
+  }
+
+  /* Shifted, padded frames; the pad columns stay zero */
+  for (size_t c = 0; c < nc; c++) {
+    const float* src = (const float*) bb_channel_ptr(in_buf, batch, c);
+    for (size_t k = 0; k < n; k++) {
+      cov->frames[k * stride + c] =
+          (double) src[(first + k) * in_stride] - cov->shift[c];
+    }
+  }
+
+  double* hop = cov_hop(cov, cov->hop_idx);
+  double* sum = hop + 1;
+  hop[0] += (double) n;
+  for (size_t k = 0; k < n; k++) {
+    const double* xk = cov->frames + k * stride;
+    for (size_t c = 0; c < stride; c++) sum[c] += xk[c];
+  }
+  cov_rank_update(sum + stride, cov->frames, n, stride);
+}
+
+/* Sum the ring into cov->window and turn it into the output matrix */
+static void cov_compute(Covariance_t* cov)
+{
+  const size_t nc = cov->n_channels;
+  const size_t stride = cov->stride;
+  double* w = cov->window;
+
+  memset(w, 0, cov->hop_words * sizeof(double));
+  for (size_t h = 0; h < cov->window_hops; h++) {
+    const double* hop = cov_hop(cov, h);
+    for (size_t i = 0; i < cov->hop_words; i++) w[i] += hop[i];
+  }
+  const double n = w[0];
+  const double* sum = w + 1;
+  const double* sum_xx = sum + stride;
+
+  pthread_mutex_lock(&cov->base.filter_mutex);
+  for (size_t i = 0; i < nc; i++) {
+    for (size_t j = i; j < nc; j++) {
+      double c = (sum_xx[i * stride + j] - sum[i] * sum[j] / n) / (n - 1.0);
+      cov->snapshot[i * nc + j] = (float) c;
+    }
+  }
+  if (cov->output == COVARIANCE_OUT_CORRELATION) {
+    /* Diagonal last, it is the normaliser */
+    for (size_t i = 0; i < nc; i++) {
+      for (size_t j = i + 1; j < nc; j++) {
+        double d = (double) cov->snapshot[i * nc + i] *
+                   (double) cov->snapshot[j * nc + j];
+        cov->snapshot[i * nc + j] =
+            d > 0.0 ? (float) (cov->snapshot[i * nc + j] / sqrt(d)) : 0.0f;
+      }
+    }
+    for (size_t i = 0; i < nc; i++) {
+      cov->snapshot[i * nc + i] = cov->snapshot[i * nc + i] > 0.0f ? 1.0f
+                                                                   : 0.0f;
+    }
+  }
+  for (size_t i = 0; i < nc; i++) {
+    for (size_t j = 0; j < i; j++) {
+      cov->snapshot[i * nc + j] = cov->snapshot[j * nc + i];
+    }
+  }
+  size_t oldest = (cov->hop_idx + 1) % cov->window_hops;
+  cov->snapshot_t_ns = cov->hop_t_ns[oldest];
+  cov->windows_emitted++;
+  pthread_mutex_unlock(&cov->base.filter_mutex);
+}
+
+static Bp_EC cov_emit(Covariance_t* cov)
+{
+  Filter_t* f = &cov->base;
+  Batch_buff_t* out_buf = f->sinks[0];
+  if (out_buf == NULL) return Bp_EC_OK;
+
+  const size_t nc = cov->n_channels;
+  const size_t out_stride =
+      out_buf->layout == BATCH_LAYOUT_PLANAR ? 1 : out_buf->n_channels;
+  Batch_t* out = bb_get_head(out_buf);
+  for (size_t j = 0; j < nc; j++) {
+    float* dst = (float*) bb_channel_ptr(out_buf, out, j);
+    for (size_t i = 0; i < nc; i++) {
+      dst[i * out_stride] = cov->snapshot[i * nc + j];
+    }
+  }
+  out->head = nc;
+  out->t_ns = cov->snapshot_t_ns;
+  out->period_ns = 0;
+  out->batch_id = cov->windows_emitted - 1;
+  out->ec = Bp_EC_OK;
+  return bb_submit(out_buf, f->timeout_us);
+}
+
+static void* covariance_worker(void* arg)
+{
+  Covariance_t* cov = (Covariance_t*) arg;
+  Filter_t* f = &cov->base;
+  Batch_buff_t* in_buf = f->input_buffers[0];
+  Batch_buff_t* out_buf = f->sinks[0];
+  Bp_EC err = Bp_EC_OK;
+
+  while (atomic_load(&f->running)) {
+    Batch_t* input = bb_get_tail(in_buf, f->timeout_us, &err);
+    if (!input) {
+      if (err == Bp_EC_TIMEOUT) continue;
+      break;
+    }
+    if (input->ec == Bp_EC_COMPLETE) {
+      bb_del_tail(in_buf);
+      err = Bp_EC_COMPLETE;
+      break;
+    }
+    BP_WORKER_ASSERT(f, input->ec == Bp_EC_OK, input->ec);
+
+    /* Split the batch at hop boundaries */
+    size_t k = 0;
+    while (k < input->head && err == Bp_EC_OK) {
+      if (cov->in_hop == 0) {
+        cov->hop_t_ns[cov->hop_idx] = bb_sample_t_ns(input, k);
+      }
+      size_t n = MIN(input->head - k, cov->hop_samples - cov->in_hop);
+      cov_accumulate(cov, in_buf, input, k, n);
+      cov->in_hop += n;
+      k += n;
+      if (cov->in_hop < cov->hop_samples) break;
+
+      cov->hops_filled = MIN(cov->hops_filled + 1, cov->window_hops);
+      if (cov->hops_filled == cov->window_hops) {
+        cov_compute(cov);
+        err = cov_emit(cov);
+      }
+      cov->hop_idx = (cov->hop_idx + 1) % cov->window_hops;
+      memset(cov_hop(cov, cov->hop_idx), 0, cov->hop_words * sizeof(double));
+      cov->in_hop = 0;
+    }
+    bb_del_tail(in_buf);
+    f->metrics.samples_processed += input->head;
+    f->metrics.n_batches++;
+    if (err != Bp_EC_OK) break;
+  }
+
+  if (err == Bp_EC_COMPLETE && out_buf != NULL) {
+    filt_send_complete(f, out_buf);
+  }
+  BP_WORKER_ASSERT(f, BP_WORKER_CLEAN_EXIT(err), err);
+  return NULL;
+}
+
+/* Rows of the matrix are frames: N channels and room for N frames */
+static Bp_EC covariance_sink_connect(Filter_t* self, size_t output_port,
+                                     Batch_buff_t* sink)
+{
+  Covariance_t* cov = (Covariance_t*) self;
+  if (sink != NULL && bb_batch_size(sink) < cov->n_channels) {
+    return Bp_EC_CAPACITY_MISMATCH;
+  }
+  return filt_attach_sink(self, output_port, sink, DTYPE_FLOAT,
+                          cov->n_channels);
+}
+
+static Bp_EC covariance_get_stats(Filter_t* self, void* stats_out)
+{
+  Covariance_t* cov = (Covariance_t*) self;
+  Covariance_stats_t* stats = (Covariance_stats_t*) stats_out;
+  if (stats == NULL) return Bp_EC_NULL_POINTER;
+
+  pthread_mutex_lock(&self->filter_mutex);
+  stats->metrics = self->metrics;
+  stats->windows_emitted = cov->windows_emitted;
+  stats->window_t_ns = cov->snapshot_t_ns;
+  stats->n_channels = cov->n_channels;
+  if (stats->matrix != NULL) {
+    memcpy(stats->matrix, cov->snapshot,
+           cov->n_channels * cov->n_channels * sizeof(float));
+  }
+  pthread_mutex_unlock(&self->filter_mutex);
+  return Bp_EC_OK;
+}
+
+static Bp_EC covariance_describe(Filter_t* self, char* buffer, size_t size)
+{
+  Covariance_t* cov = (Covariance_t*) self;
+  if (buffer == NULL) return Bp_EC_NULL_POINTER;
+
+  snprintf(buffer, size,
+           "Covariance: %s\n"
+           "  %zu channels, %s\n"
+           "  Window: %zu x %zu samples\n"
+           "  Windows emitted: %llu",
+           self->name, cov->n_channels,
+           cov->output == COVARIANCE_OUT_CORRELATION ? "correlation"
+                                                     : "covariance",
+           cov->window_hops, cov->hop_samples,
+           (unsigned long long) cov->windows_emitted);
+  return Bp_EC_OK;
+}
+
+static void covariance_free(Covariance_t* cov)
+{
+  free(cov->hops);
+  free(cov->hop_t_ns);
+  free(cov->shift);
+  free(cov->frames);
+  free(cov->window);
+  free(cov->snapshot);
+  cov->hops = cov->window = cov->frames = cov->shift = NULL;
+  cov->hop_t_ns = NULL;
+  cov->snapshot = NULL;
+}
+
+static Bp_EC covariance_deinit(Filter_t* self)
+{
+  covariance_free((Covariance_t*) self);
+
+  filt_release_inputs(self);
+  return Bp_EC_OK;
+}
+
+Bp_EC covariance_init(Covariance_t* cov, Covariance_config_t config)
+{
+  if (cov == NULL) return Bp_EC_NULL_FILTER;
+  const size_t nc = config.buff_config.n_channels;
+  const size_t window_hops = config.window_hops ? config.window_hops : 1;
+  if (config.buff_config.dtype != DTYPE_FLOAT || nc < 2 ||
+      nc > COVARIANCE_MAX_CHANNELS || config.hop_samples < 2 ||
+      window_hops > COVARIANCE_MAX_HOPS ||
+      config.output > COVARIANCE_OUT_CORRELATION) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+
+  Core_filt_config_t core_config = {
+      .name = config.name,
+      .filt_type = FILT_T_COVARIANCE,
+      .size = sizeof(Covariance_t),
+      .n_inputs = 1,
+      .max_supported_sinks = 1,
+      .buff_config = config.buff_config,
+      .timeout_us = config.timeout_us > 0 ? config.timeout_us : 1000000,
+      .worker = covariance_worker};
+
+  Bp_EC err = filt_init(&cov->base, core_config);
+  if (err != Bp_EC_OK) return err;
+
+  const size_t stride = (nc + COV_TILE - 1) / COV_TILE * COV_TILE;
+  const size_t capacity = (size_t) 1 << config.buff_config.batch_capacity_expo;
+  cov->n_channels = nc;
+  cov->stride = stride;
+  cov->hop_samples = config.hop_samples;
+  cov->window_hops = window_hops;
+  cov->output = config.output;
+  cov->hop_words = 1 + stride + stride * stride;
+  cov->hop_idx = 0;
+  cov->hops_filled = 0;
+  cov->in_hop = 0;
+  cov->shifted = false;
+  cov->snapshot_t_ns = 0;
+  cov->windows_emitted = 0;
+
+  cov->hops = calloc(window_hops * cov->hop_words, sizeof(double));
+  cov->hop_t_ns = calloc(window_hops, sizeof(long long));
+  cov->shift = calloc(nc, sizeof(double));
+  cov->frames = calloc(MIN(capacity, config.hop_samples) * stride,
+                       sizeof(double));
+  cov->window = malloc(cov->hop_words * sizeof(double));
+  cov->snapshot = calloc(nc * nc, sizeof(float));
+  if (!cov->hops || !cov->hop_t_ns || !cov->shift || !cov->frames ||
+      !cov->window || !cov->snapshot) {
+    covariance_free(cov);
+    filt_deinit(&cov->base);
+    return Bp_EC_MALLOC_FAIL;
+  }
+
+  cov->base.ops.sink_connect = covariance_sink_connect;
+  cov->base.ops.describe = covariance_describe;
+  cov->base.ops.get_stats = covariance_get_stats;
+  cov->base.ops.deinit = covariance_deinit;
+
+  prop_constraints_from_buffer_append(&cov->base, &config.buff_config, true);
+  cov->base.output_properties[0] =
+      prop_propagate(NULL, 0, &cov->base.contract, 0);
+
+  return Bp_EC_OK;
+}
@@ -0,0 +1,87 @@
+#ifndef BPIPE_COVARIANCE_H
+#define BPIPE_COVARIANCE_H
+
+#include "batch_buffer.h"
+#include "core.h"
+
+/* Covariance: sliding-window covariance or correlation matrix of the
+ * channels of one multi-channel stream.
+ *
+ * Input is DTYPE_FLOAT with N = n_channels channels, interleaved or
+ * planar; use a Synchroniser and a merging map upstream to get separate
+ * streams into that shape. Every `hop_samples` frames the matrix over the
+ * last `window_hops * hop_samples` frames is computed and
+ *   - written to the sink, if one is connected, as one batch of N frames
+ *     of N channels (row i is frame i), stamped with the window's first
+ *     sample time and period_ns 0; the sink needs room for N frames;
+ *   - kept as a snapshot that filt_get_stats copies out, see
+ *     Covariance_stats_t.
+ * Nothing is emitted until the first full window.
+ *
+ * Each hop keeps its own sums (count, per-channel sums and the upper
+ * triangle of X^T X, all in double), so the sliding window is the sum of
+ * the last window_hops hops and never drifts. A batch updates the current
+ * hop with a rank-k update over 32x32 tiles of the matrix, padded so the
+ * inner loops have a fixed length and vectorise. Data are shifted by the
+ * stream's first frame before accumulating, to avoid cancellation when
+ * means are large compared to the spread.
+ */
+
+#define COVARIANCE_MAX_CHANNELS 256
+#define COVARIANCE_MAX_HOPS 64
+
+typedef enum _CovarianceOutput_e {
+  COVARIANCE_OUT_COVARIANCE = 0, /* Sample covariance, n - 1 normalised */
+  COVARIANCE_OUT_CORRELATION,    /* Pearson correlation coefficients */
+} CovarianceOutput_e;
+
+typedef struct _Covariance_config_t {
+  const char* name;
+  BatchBuffer_config buff_config; /* FLOAT, 2..COVARIANCE_MAX_CHANNELS */
+  size_t hop_samples;             /* Emit every this many frames, >= 2 */
+  size_t window_hops; /* Window length in hops, 1..MAX_HOPS; 0 = 1 */
+  CovarianceOutput_e output;
+  long timeout_us;
+} Covariance_config_t;
+
+/* filt_get_stats(&cov->base, &stats) fills this. `matrix` is supplied by
+ * the caller: if non-NULL, the latest N x N matrix is copied into it
+ * (row-major). */
+typedef struct _Covariance_stats_t {
+  Filt_metrics metrics;
+  uint64_t windows_emitted;
+  long long window_t_ns; /* First sample of the latest window */
+  size_t n_channels;
+  float* matrix;
+} Covariance_stats_t;
+
+typedef struct _Covariance_t {
+  Filter_t base;
+
+  size_t n_channels;
+  size_t stride; /* n_channels rounded up to the tile size */
+  size_t hop_samples;
+  size_t window_hops;
+  CovarianceOutput_e output;
+
+  /* Per-hop sums in a ring of window_hops, each hop_words doubles:
+   * count, sum[stride], upper triangle of sum_xx[stride * stride] */
+  double* hops;
+  size_t hop_words;
+  long long* hop_t_ns; /* First sample time of each hop */
+  size_t hop_idx;      /* Hop being filled */
+  size_t hops_filled;  /* Complete hops in the ring, up to window_hops */
+  size_t in_hop;       /* Frames in the current hop */
+
+  double* shift;   /* First frame, subtracted from everything */
+  bool shifted;    /* shift is set */
+  double* frames;  /* Shifted batch frames, stride wide */
+  double* window;  /* Scratch: summed window */
+  float* snapshot; /* Latest matrix, guarded by filter_mutex */
+  long long snapshot_t_ns;
+  uint64_t windows_emitted;
+} Covariance_t;
+
+Bp_EC covariance_init(Covariance_t* cov, Covariance_config_t config);
+
+#endif /* BPIPE_COVARIANCE_H */
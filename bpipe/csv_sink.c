@@ -16,15 +16,75 @@
 
 #define MAX_LINE_LENGTH 4096
 
-// CSV sink worker function forward declaration
+// Per-dtype value formatters
+static inline size_t csv_fmt_FLOAT(char* out, size_t cap, float v,
+                                   int precision)
+{
+  return snprintf(out, cap, "%.*f", precision, v);
+}
+
+static inline size_t csv_fmt_I32(char* out, size_t cap, int32_t v,
+                                 int precision)
+{
+  (void) precision;
+  return snprintf(out, cap, "%d", v);
+}
+
+static inline size_t csv_fmt_U32(char* out, size_t cap, uint32_t v,
+                                 int precision)
+{
+  (void) precision;
+  return snprintf(out, cap, "%u", v);
+}
+
+static inline size_t csv_fmt_I16(char* out, size_t cap, int16_t v,
+                                 int precision)
+{
+  (void) precision;
+  return snprintf(out, cap, "%d", v);
+}
+
+// One row formatter per numeric dtype, so the column loop carries no dtype
+// switch. Selected once in the worker from the input buffer's dtype.
+#define CSV_ROW_FORMATTER(NAME, TYPE)                                         \
+  static size_t csv_row_##NAME(char* line, size_t cap, const void* data,     \
+                               size_t n, size_t stride, char delim,          \
+                               int precision)                                \
+  {                                                                          \
+    size_t len = 0;                                                          \
+    for (size_t i = 0; i < n; i++) {                                         \
+      if (i > 0) {                                                           \
+        if (len + 1 >= cap) return cap;                                      \
+        line[len++] = delim;                                                 \
+      }                                                                      \
+      TYPE v = *(const TYPE*) ((const char*) data + i * stride);             \
+      len += csv_fmt_##NAME(line + len, cap - len, v, precision);            \
+      if (len >= cap) return cap;                                            \
+    }                                                                        \
+    return len;                                                              \
+  }
+BP_NUMERIC_DTYPES(CSV_ROW_FORMATTER)
+#undef CSV_ROW_FORMATTER
+
+#define CSV_ROW_ENTRY(NAME, TYPE) [DTYPE_##NAME] = csv_row_##NAME,
+static const CsvRowFormatFn csv_row_formatters[DTYPE_MAX] = {
+    BP_NUMERIC_DTYPES(CSV_ROW_ENTRY)};
+#undef CSV_ROW_ENTRY
+
+CsvRowFormatFn csv_sink_row_formatter(SampleDtype_t dtype)
+{
+  return dtype < DTYPE_MAX ? csv_row_formatters[dtype] : NULL;
+}
 
 // Forward declarations
 static void* csv_sink_worker(void* arg);
 static Bp_EC open_output_file(CSVSink_t* sink);
 static void close_output_file(CSVSink_t* sink);
 static void write_csv_header(CSVSink_t* sink);
-static void format_csv_line(CSVSink_t* sink, uint64_t t_ns, void* data);
+static Bp_EC format_csv_line(CSVSink_t* sink, uint64_t t_ns, void* data,
+                             size_t column_stride);
 static Bp_EC csv_sink_describe(Filter_t* self, char* buffer, size_t size);
+static Bp_EC csv_sink_deinit(Filter_t* self);
 
 // Initialize CSV sink filter
 Bp_EC csv_sink_init(CSVSink_t* sink, CSVSink_config_t config)
@@ -32,8 +92,16 @@ Bp_EC csv_sink_init(CSVSink_t* sink, CSVSink_config_t config)
   if (sink == NULL) return Bp_EC_NULL_PTR;
   if (config.output_path == NULL) return Bp_EC_INVALID_CONFIG;
 
-  // Validate configuration
+  // Validate configuration. A multichannel input supplies the column count
+  // for MULTI_COL when n_columns is left at 0.
+  size_t n_channels =
+      config.buff_config.n_channels ? config.buff_config.n_channels : 1;
   if (config.format == CSV_FORMAT_MULTI_COL && config.n_columns == 0) {
+    if (n_channels < 2) return Bp_EC_INVALID_CONFIG;
+    config.n_columns = n_channels;
+  }
+  if (n_channels > 1 && config.format == CSV_FORMAT_MULTI_COL &&
+      config.n_columns > n_channels) {
     return Bp_EC_INVALID_CONFIG;
   }
 
@@ -48,9 +116,13 @@ Bp_EC csv_sink_init(CSVSink_t* sink, CSVSink_config_t config)
       .timeout_us = 1000000,  // 1 second timeout
       .worker = csv_sink_worker};
 
-  // Initialize base filter
+  // Initialize base filter. From here on failures go through filt_deinit,
+  // which also releases the filename.
   Bp_EC err = filt_init(&sink->base, core_config);
   if (err != Bp_EC_OK) return err;
+  sink->current_filename = NULL;
+  sink->file = NULL;
+  sink->base.ops.deinit = csv_sink_deinit;
 
   // Cache configuration
   sink->format = config.format;
@@ -66,11 +138,11 @@ Bp_EC csv_sink_init(CSVSink_t* sink, CSVSink_config_t config)
   // Allocate filename buffer
   sink->current_filename = strdup(config.output_path);
   if (!sink->current_filename) {
+    filt_deinit(&sink->base);
     return Bp_EC_ALLOC;
   }
 
   // Store file open parameters
-  sink->file = NULL;
   sink->bytes_written = 0;
   sink->lines_written = 0;
   sink->samples_written = 0;
@@ -79,7 +151,7 @@ Bp_EC csv_sink_init(CSVSink_t* sink, CSVSink_config_t config)
   // Validate file access during init
   err = open_output_file(sink);
   if (err != Bp_EC_OK) {
-    free(sink->current_filename);
+    filt_deinit(&sink->base);
     return err;
   }
   close_output_file(sink);
@@ -106,7 +178,14 @@ static void* csv_sink_worker(void* arg)
   // Validate sink has no outputs
   BP_WORKER_ASSERT(&sink->base, sink->base.n_sinks == 0, Bp_EC_INVALID_CONFIG);
 
-  // Re-open output file (already validated in init)
+  // Resolve the dtype-specialised formatter once, outside the sample loop
+  SampleDtype_t dtype = sink->base.input_buffers[0]->dtype;
+  sink->format_row = csv_sink_row_formatter(dtype);
+  BP_WORKER_ASSERT(&sink->base, sink->format_row != NULL,
+                   Bp_EC_UNSUPPORTED_TYPE);
+
+  // Re-open output file (already validated in init). Every exit from here
+  // on closes it.
   err = open_output_file(sink);
   BP_WORKER_ASSERT(&sink->base, err == Bp_EC_OK, err);
 
@@ -133,28 +212,49 @@ static void* csv_sink_worker(void* arg)
     }
 
     // Validate input
-    BP_WORKER_ASSERT(&sink->base, input->ec == Bp_EC_OK, input->ec);
+    if (input->ec != Bp_EC_OK) {
+      close_output_file(sink);
+      BP_WORKER_ASSERT(&sink->base, false, input->ec);
+    }
 
-    // Get data type info
+    // Data width is known for every dtype with a formatter
     size_t data_width = bb_getdatawidth(sink->base.input_buffers[0]->dtype);
-    BP_WORKER_ASSERT(&sink->base, data_width > 0, Bp_EC_UNSUPPORTED_TYPE);
+
+    // Work out where each frame lives. Interleaved frames are contiguous
+    // (columns one element apart); planar columns are a whole plane apart.
+    Batch_buff_t* in_buf = sink->base.input_buffers[0];
+    size_t frame_stride = data_width;
+    size_t column_stride = data_width;
+    if (in_buf->n_channels > 1) {
+      if (in_buf->layout == BATCH_LAYOUT_PLANAR) {
+        column_stride = data_width * bb_batch_size(in_buf);
+      } else {
+        frame_stride = bb_frame_size(in_buf);
+      }
+    }
 
     // Process batch data
     size_t samples = input->head;
     for (size_t i = 0; i < samples; i++) {
-      // Calculate timestamp for this sample
-      uint64_t sample_time_ns = input->t_ns + i * input->period_ns;
+      // Calculate timestamp for this sample (per-sample column if present)
+      uint64_t sample_time_ns = bb_sample_t_ns(input, i);
 
       // Calculate data pointer
-      char* data_ptr = ((char*) input->data) + i * data_width;
+      char* data_ptr = ((char*) input->data) + i * frame_stride;
 
       // Format and write the CSV line
-      format_csv_line(sink, sample_time_ns, data_ptr);
+      err = format_csv_line(sink, sample_time_ns, data_ptr, column_stride);
+      if (err != Bp_EC_OK) {
+        bb_del_tail(sink->base.input_buffers[0]);
+        close_output_file(sink);
+        BP_WORKER_ASSERT(&sink->base, false, err);
+      }
 
       // Check file size limit
       if (sink->max_file_size_bytes > 0 &&
           sink->bytes_written >= sink->max_file_size_bytes) {
         bb_del_tail(sink->base.input_buffers[0]);
+        close_output_file(sink);
         BP_WORKER_ASSERT(&sink->base, false, Bp_EC_FILE_FULL);
       }
     }
@@ -243,70 +343,32 @@ static void write_csv_header(CSVSink_t* sink)
   sink->bytes_written = ftell(sink->file);
 }
 
-// Format and write CSV line
-static void format_csv_line(CSVSink_t* sink, uint64_t t_ns, void* data)
+// Format and write CSV line. A row that does not fit in MAX_LINE_LENGTH is
+// rejected whole with Bp_EC_NO_SPACE rather than written truncated.
+static Bp_EC format_csv_line(CSVSink_t* sink, uint64_t t_ns, void* data,
+                             size_t column_stride)
 {
   char line[MAX_LINE_LENGTH];
+  size_t line_ending_len = strlen(sink->line_ending);
+  if (line_ending_len + 32 > sizeof(line)) return Bp_EC_NO_SPACE;
+  size_t cap = sizeof(line) - line_ending_len;
   size_t len = 0;
 
-  // Format timestamp (nanoseconds)
-  len += snprintf(line + len, sizeof(line) - len, "%llu",
-                  (unsigned long long) t_ns);
+  // Format timestamp (nanoseconds); at most 20 digits, always fits
+  len += snprintf(line + len, cap - len, "%llu", (unsigned long long) t_ns);
 
   // Add delimiter
   line[len++] = sink->delimiter[0];
 
-  // Format data value(s)
-  SampleDtype_t dtype = sink->base.input_buffers[0]->dtype;
-
-  if (sink->format == CSV_FORMAT_SIMPLE) {
-    // Single value
-    switch (dtype) {
-      case DTYPE_FLOAT:
-        len += snprintf(line + len, sizeof(line) - len, "%.*f", sink->precision,
-                        *(float*) data);
-        break;
-      case DTYPE_I32:
-        len += snprintf(line + len, sizeof(line) - len, "%d", *(int32_t*) data);
-        break;
-      case DTYPE_U32:
-        len +=
-            snprintf(line + len, sizeof(line) - len, "%u", *(uint32_t*) data);
-        break;
-      default:
-        // Should not reach here due to validation
-        return;
-    }
-  } else if (sink->format == CSV_FORMAT_MULTI_COL) {
-    // Multiple values - assume data is array
-    size_t data_width = bb_getdatawidth(dtype);
-    for (size_t i = 0; i < sink->n_columns; i++) {
-      if (i > 0) {
-        line[len++] = sink->delimiter[0];
-      }
-
-      void* element = ((char*) data) + i * data_width;
-      switch (dtype) {
-        case DTYPE_FLOAT:
-          len += snprintf(line + len, sizeof(line) - len, "%.*f",
-                          sink->precision, *(float*) element);
-          break;
-        case DTYPE_I32:
-          len += snprintf(line + len, sizeof(line) - len, "%d",
-                          *(int32_t*) element);
-          break;
-        case DTYPE_U32:
-          len += snprintf(line + len, sizeof(line) - len, "%u",
-                          *(uint32_t*) element);
-          break;
-        default:
-          return;
-      }
-    }
-  }
+  // Format data value(s): one for SIMPLE, one per column for MULTI_COL
+  size_t n_values = sink->format == CSV_FORMAT_SIMPLE ? 1 : sink->n_columns;
+  size_t row_len =
+      sink->format_row(line + len, cap - len, data, n_values, column_stride,
+                       sink->delimiter[0], sink->precision);
+  if (row_len >= cap - len) return Bp_EC_NO_SPACE;
+  len += row_len;
 
   // Add line ending
-  size_t line_ending_len = strlen(sink->line_ending);
   memcpy(line + len, sink->line_ending, line_ending_len);
   len += line_ending_len;
 
@@ -314,6 +376,19 @@ static void format_csv_line(CSVSink_t* sink, uint64_t t_ns, void* data)
   fwrite(line, 1, len, sink->file);
   sink->bytes_written += len;
   sink->lines_written++;
+  return Bp_EC_OK;
+}
+
+// Release the filename. The file itself belongs to the worker, which
+// closes it on every exit path.
+static Bp_EC csv_sink_deinit(Filter_t* self)
+{
+  CSVSink_t* sink = (CSVSink_t*) self;
+  free(sink->current_filename);
+  sink->current_filename = NULL;
+
+  filt_release_inputs(self);
+  return Bp_EC_OK;
 }
 
 // Describe operation
@@ -11,6 +11,13 @@ typedef enum {
   CSV_FORMAT_MULTI_COL,  // timestamp,ch0,ch1,ch2...
 } CSVFormat_e;
 
+// Formats n values spaced `stride` bytes apart, separated by `delim`.
+// Returns the number of characters written to `line`, or `cap` if the row
+// does not fit (the contents of `line` are then unspecified).
+typedef size_t (*CsvRowFormatFn)(char* line, size_t cap, const void* data,
+                                 size_t n, size_t stride, char delim,
+                                 int precision);
+
 // Configuration structure
 typedef struct _CSVSink_config_t {
   const char* name;
@@ -46,6 +53,9 @@ typedef struct _CSVSink_t {
   size_t n_columns;
   bool write_header;
 
+  // Row formatter for the input dtype, resolved at worker start
+  CsvRowFormatFn format_row;
+
   // File management
   FILE* file;
   char* current_filename;
@@ -60,4 +70,7 @@ typedef struct _CSVSink_t {
 // Public API
 Bp_EC csv_sink_init(CSVSink_t* sink, CSVSink_config_t config);
 
+// Row formatter the worker uses for `dtype`, or NULL if unsupported
+CsvRowFormatFn csv_sink_row_formatter(SampleDtype_t dtype);
+
 #endif  // CSV_SINK_H
\ No newline at end of file
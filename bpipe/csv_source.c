@@ -18,6 +18,30 @@
 #define Bp_EC_FORMAT_ERROR Bp_EC_INVALID_DATA
 #define Bp_EC_COLUMN_NOT_FOUND Bp_EC_INVALID_CONFIG
 
+// One store kernel per numeric dtype; the dtype is resolved once per output
+// when the worker starts instead of per value.
+#define CSV_STORE_FN(NAME, TYPE)                                      \
+  static void csv_store_##NAME(void* data, size_t pos, size_t stride, \
+                               const double* values, size_t n)        \
+  {                                                                   \
+    TYPE* out = (TYPE*) data + pos;                                   \
+    for (size_t i = 0; i < n; i++) {                                  \
+      out[i * stride] = (TYPE) values[i];                             \
+    }                                                                 \
+  }
+BP_NUMERIC_DTYPES(CSV_STORE_FN)
+#undef CSV_STORE_FN
+
+#define CSV_STORE_ENTRY(NAME, TYPE) [DTYPE_##NAME] = csv_store_##NAME,
+static const CsvStoreFn csv_store_fns[DTYPE_MAX] = {
+    BP_NUMERIC_DTYPES(CSV_STORE_ENTRY)};
+#undef CSV_STORE_ENTRY
+
+CsvStoreFn csvsource_store_fn(SampleDtype_t dtype)
+{
+  return dtype < DTYPE_MAX ? csv_store_fns[dtype] : NULL;
+}
+
 /* Future extensions to consider:
  * - Support for different timestamp formats (ISO8601, Unix epoch, custom
  * formats)
@@ -126,9 +150,15 @@ Bp_EC csvsource_init(CsvSource_t* self, CsvSource_config_t config)
 
   Bp_EC err = filt_init(&self->base, filter_config);
   if (err != Bp_EC_OK) {
+    csvsource_destroy(self);
     return err;
   }
 
+  // One output per column until the worker sees a multichannel sink
+  self->n_outputs = self->n_data_columns;
+  self->multichannel = false;
+  self->sample_timestamps = false;
+
   // Set operations
   self->base.ops.describe = csvsource_describe;
   self->base.ops.get_stats = csvsource_get_stats;
@@ -297,8 +327,23 @@ typedef struct {
   uint64_t batch_start_time;
   uint64_t expected_delta;
   bool delta_established;
+  bool irregular;  // Timing broke within the batch (timestamp column mode)
 } BatchState;
 
+// Period to publish for the current batch: 0 whenever the samples are not
+// evenly spaced, in which case consumers read the timestamp column instead.
+static uint64_t batch_period_ns(const CsvSource_t* self,
+                                const BatchState* state)
+{
+  if (!state->delta_established || state->irregular) {
+    return 0;
+  }
+  if (self->sample_timestamps && !self->detect_regular_timing) {
+    return 0;
+  }
+  return state->expected_delta;
+}
+
 // Helper to check if we need to submit current batches and get new ones
 static bool need_new_batches(const CsvSource_t* self, const BatchState* state,
                              uint64_t timestamp)
@@ -310,17 +355,22 @@ static bool need_new_batches(const CsvSource_t* self, const BatchState* state,
 
   size_t current_samples = state->batches[0]->head;
 
-  // Force single-sample batches for irregular mode
-  if (!self->detect_regular_timing && current_samples > 0) {
-    return true;
-  }
-
   // Check if batch is full - get batch size from the sink
   size_t batch_capacity = (1 << self->base.sinks[0]->batch_capacity_expo);
   if (current_samples >= batch_capacity) {
     return true;
   }
 
+  // With a timestamp column irregular samples can share a batch
+  if (self->sample_timestamps) {
+    return false;
+  }
+
+  // Force single-sample batches for irregular mode
+  if (!self->detect_regular_timing && current_samples > 0) {
+    return true;
+  }
+
   // Check timing pattern for regular mode
   if (self->detect_regular_timing && current_samples > 1) {
     uint64_t expected_time =
@@ -338,9 +388,13 @@ static Bp_EC submit_and_get_new_batches(CsvSource_t* self, BatchState* state)
 {
   // Submit current batches if they have data
   if (state->batches[0] && state->batches[0]->head > 0) {
-    uint64_t period_ns = state->delta_established ? state->expected_delta : 0;
+    uint64_t period_ns = batch_period_ns(self, state);
 
-    for (size_t col = 0; col < self->n_data_columns; col++) {
+    // Update metrics first: a submitted batch belongs to the consumer
+    self->base.metrics.samples_processed += state->batches[0]->head;
+    self->base.metrics.n_batches++;
+
+    for (size_t col = 0; col < self->n_outputs; col++) {
       Batch_t* batch = state->batches[col];
       batch->t_ns = state->batch_start_time;
       batch->period_ns = period_ns;
@@ -348,20 +402,17 @@ static Bp_EC submit_and_get_new_batches(CsvSource_t* self, BatchState* state)
       batch->ec = Bp_EC_OK;
       bb_submit(self->base.sinks[col], self->base.timeout_us);
     }
-
-    // Update metrics
-    self->base.metrics.samples_processed += state->batches[0]->head;
-    self->base.metrics.n_batches++;
   }
 
   // Get new batches
-  for (size_t col = 0; col < self->n_data_columns; col++) {
+  for (size_t col = 0; col < self->n_outputs; col++) {
     state->batches[col] = bb_get_head(self->base.sinks[col]);
     assert(state->batches[col] != NULL);  // bb_get_head never returns NULL
     state->batches[col]->head = 0;
   }
 
   state->delta_established = false;
+  state->irregular = false;
   return Bp_EC_OK;
 }
 
@@ -381,28 +432,35 @@ static void write_sample_to_batches(CsvSource_t* self, BatchState* state,
     // Second sample establishes delta
     state->expected_delta = timestamp - state->batch_start_time;
     state->delta_established = true;
+  } else if (timestamp !=
+             state->batch_start_time + idx * state->expected_delta) {
+    // Only reachable in timestamp column mode, otherwise the batch is cut
+    state->irregular = true;
+  }
+
+  if (self->sample_timestamps) {
+    for (size_t col = 0; col < self->n_outputs; col++) {
+      state->batches[col]->ts[idx] = (long long) timestamp;
+    }
+  }
+
+  // Multichannel: every column is a channel of the single output batch
+  if (self->multichannel) {
+    Batch_buff_t* out = self->base.sinks[0];
+    bool planar = out->layout == BATCH_LAYOUT_PLANAR;
+    size_t pos = planar ? idx : idx * out->n_channels;
+    size_t stride = planar ? bb_batch_size(out) : 1;
+    self->store_fns[0](state->batches[0]->data, pos, stride, values,
+                       self->n_data_columns);
+    state->batches[0]->head++;
+    return;
   }
 
   // Write value to each column's batch at current tail position
   for (size_t col = 0; col < self->n_data_columns; col++) {
     Batch_t* batch = state->batches[col];
-
-    switch (self->base.sinks[col]->dtype) {
-      case DTYPE_FLOAT:
-        ((float*) batch->data)[idx] =
-            (float) values[col];  // NOLINT(clang-analyzer-core.NullDereference)
-        break;
-      case DTYPE_I32:
-        ((int32_t*) batch->data)[idx] = (int32_t)
-            values[col];  // NOLINT(clang-analyzer-core.NullDereference)
-        break;
-      case DTYPE_U32:
-        ((uint32_t*) batch->data)[idx] = (uint32_t)
-            values[col];  // NOLINT(clang-analyzer-core.NullDereference)
-        break;
-      default:
-        break;
-    }
+    // NOLINTNEXTLINE(clang-analyzer-core.NullDereference)
+    self->store_fns[col](batch->data, idx, 0, &values[col], 1);
 
     // Increment head (write position) for this batch
     batch->head++;
@@ -413,15 +471,40 @@ static void* csvsource_worker(void* arg)
 {
   CsvSource_t* self = (CsvSource_t*) arg;
 
+  // A single sink whose channel count matches the column count receives all
+  // columns as one multichannel batch; otherwise one sink per column.
+  BP_WORKER_ASSERT(&self->base, self->base.sinks[0] != NULL, Bp_EC_NO_SINK);
+  self->multichannel = self->n_data_columns > 1 &&
+                       self->base.sinks[0]->n_channels == self->n_data_columns;
+  self->n_outputs = self->multichannel ? 1 : self->n_data_columns;
+
+  // Full irregular batches are possible only if every output can carry
+  // per-sample timestamps
+  self->sample_timestamps = true;
+  for (size_t i = 0; i < self->n_outputs; i++) {
+    if (!self->base.sinks[i] || !self->base.sinks[i]->ts_ring) {
+      self->sample_timestamps = false;
+    }
+  }
+
   // Validate we have the correct number of sinks connected
-  for (size_t i = 0; i < self->n_data_columns; i++) {
+  for (size_t i = 0; i < self->n_outputs; i++) {
     BP_WORKER_ASSERT(&self->base, self->base.sinks[i] != NULL, Bp_EC_NO_SINK);
+    BP_WORKER_ASSERT(&self->base,
+                     self->multichannel || self->base.sinks[i]->n_channels == 1,
+                     Bp_EC_WIDTH_MISMATCH);
+
+    // Resolve the dtype-specialised store kernel for this output
+    SampleDtype_t dtype = self->base.sinks[i]->dtype;
+    self->store_fns[i] = csvsource_store_fn(dtype);
+    BP_WORKER_ASSERT(&self->base, self->store_fns[i] != NULL,
+                     Bp_EC_TYPE_ERROR);
   }
 
   // Validate all sinks have the same batch capacity
-  if (self->n_data_columns > 1) {
+  if (self->n_outputs > 1) {
     uint8_t expected_capacity_expo = self->base.sinks[0]->batch_capacity_expo;
-    for (size_t i = 1; i < self->n_data_columns; i++) {
+    for (size_t i = 1; i < self->n_outputs; i++) {
       BP_WORKER_ASSERT(
           &self->base,
           self->base.sinks[i]->batch_capacity_expo == expected_capacity_expo,
@@ -429,11 +512,7 @@ static void* csvsource_worker(void* arg)
     }
   }
 
-  double* value_buffer = NULL;
-  if (self->n_data_columns > 0) {
-    value_buffer = malloc(self->n_data_columns * sizeof(double));
-    BP_WORKER_ASSERT(&self->base, value_buffer != NULL, Bp_EC_MALLOC_FAIL);
-  }
+  double* value_buffer = self->value_buffer;
 
   BatchState state = {0};
 
@@ -450,7 +529,6 @@ static void* csvsource_worker(void* arg)
           break;  // Exit loop to submit any remaining data
         }
       } else {
-        free(value_buffer);
         BP_WORKER_ASSERT(&self->base, false, Bp_EC_INVALID_DATA);
       }
     }
@@ -458,20 +536,18 @@ static void* csvsource_worker(void* arg)
     // Check if line was truncated (no newline and not EOF)
     size_t len = strlen(self->line_buffer);
     if (len > 0 && self->line_buffer[len - 1] != '\n' && !feof(self->file)) {
-      free(value_buffer);
       BP_WORKER_ASSERT(&self->base, false, Bp_EC_INVALID_DATA);
     }
 
     self->current_line++;
 
-    uint64_t timestamp;
+    uint64_t timestamp = 0;
     Bp_EC err = parse_line(self, self->line_buffer, &timestamp, value_buffer);
 
     if (err != Bp_EC_OK) {
       if (self->skip_invalid) {
         continue;
       } else {
-        free(value_buffer);
         BP_WORKER_ASSERT(&self->base, false, err);
       }
     }
@@ -481,20 +557,29 @@ static void* csvsource_worker(void* arg)
     if (need_new_batches(self, &state, timestamp)) {
       Bp_EC submit_err = submit_and_get_new_batches(self, &state);
       if (submit_err != Bp_EC_OK) {
-        free(value_buffer);
         BP_WORKER_ASSERT(&self->base, false, submit_err);
       }
     }
 
     // Write sample directly to all column batches
     write_sample_to_batches(self, &state, timestamp, value_buffer);
+
+    // Slow or paced files: output port 0's policy bounds the latency of
+    // every column
+    if (filt_flush_due(&self->base, 0, state.batches[0], false)) {
+      Bp_EC submit_err = submit_and_get_new_batches(self, &state);
+      BP_WORKER_ASSERT(&self->base, submit_err == Bp_EC_OK, submit_err);
+    }
   }
 
   // Submit any remaining samples
   if (state.batches[0] && state.batches[0]->head > 0) {
-    uint64_t period_ns = state.delta_established ? state.expected_delta : 0;
+    uint64_t period_ns = batch_period_ns(self, &state);
 
-    for (size_t col = 0; col < self->n_data_columns; col++) {
+    self->base.metrics.samples_processed += state.batches[0]->head;
+    self->base.metrics.n_batches++;
+
+    for (size_t col = 0; col < self->n_outputs; col++) {
       Batch_t* batch = state.batches[col];
       if (batch) {
         batch->t_ns = state.batch_start_time;
@@ -504,13 +589,10 @@ static void* csvsource_worker(void* arg)
         bb_submit(self->base.sinks[col], self->base.timeout_us);
       }
     }
-
-    self->base.metrics.samples_processed += state.batches[0]->head;
-    self->base.metrics.n_batches++;
   }
 
   // Send completion batch to all outputs
-  for (size_t col = 0; col < self->n_data_columns; col++) {
+  for (size_t col = 0; col < self->n_outputs; col++) {
     Batch_t* completion_batch = bb_get_head(self->base.sinks[col]);
     if (completion_batch) {
       completion_batch->head = 0;
@@ -519,8 +601,6 @@ static void* csvsource_worker(void* arg)
     }
   }
 
-  free(value_buffer);
-
   // Set error code if stopped cleanly (Bp_EC_OK is 0)
   if (self->base.worker_err_info.ec == Bp_EC_OK) {
     self->base.worker_err_info.ec = Bp_EC_STOPPED;
@@ -6,6 +6,11 @@
 
 #define BP_CSV_MAX_COLUMNS 64
 
+// Converts n parsed values to a sink's dtype, storing value i at element
+// pos + i * stride of `data`.
+typedef void (*CsvStoreFn)(void* data, size_t pos, size_t stride,
+                           const double* values, size_t n);
+
 typedef struct _CsvSource_config_t {
   const char* name;
   const char* file_path;
@@ -34,10 +39,15 @@ typedef struct _CsvSource_t {
   int ts_column_index;
   int data_column_indices[BP_CSV_MAX_COLUMNS];
   size_t n_data_columns;
+  size_t n_outputs;        // Output ports in use (1 when multichannel)
+  bool multichannel;       // All columns carried as channels of sinks[0]
+  bool sample_timestamps;  // Sinks have per-sample timestamp columns
+  CsvStoreFn store_fns[BP_CSV_MAX_COLUMNS];  // Per output, set at start
   char** header_names;
   size_t n_header_columns;
 
   double parse_buffer[BP_CSV_MAX_COLUMNS];
+  double value_buffer[BP_CSV_MAX_COLUMNS];  // Selected columns of current row
   size_t current_line;
 
   bool is_regular;
@@ -62,4 +72,7 @@ typedef struct _CsvSource_t {
 Bp_EC csvsource_init(CsvSource_t* self, CsvSource_config_t config);
 void csvsource_destroy(CsvSource_t* self);
 
+// Store kernel the worker uses for `dtype`, or NULL if unsupported
+CsvStoreFn csvsource_store_fn(SampleDtype_t dtype);
+
 #endif
\ No newline at end of file
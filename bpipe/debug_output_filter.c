@@ -1,25 +1,337 @@
 #define _GNU_SOURCE  // For strdup // NOLINT(bugprone-reserved-identifier)
 #include "debug_output_filter.h"
+#include <math.h>
 #include <pthread.h>
+#include <stdarg.h>
 #include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "utils.h"
 
 // Forward declaration
 static Bp_EC debug_output_deinit(Filter_t* base);
 
+// Formats element `idx` of `data` into `out`
+typedef void (*DebugPrintFn)(char* out, size_t n, const void* data,
+                             size_t idx);
+
+static void print_float_dec(char* out, size_t n, const void* data, size_t idx)
+{
+  snprintf(out, n, "%f", ((const float*) data)[idx]);
+}
+
+static void print_float_sci(char* out, size_t n, const void* data, size_t idx)
+{
+  snprintf(out, n, "%e", ((const float*) data)[idx]);
+}
+
+static void print_i32_dec(char* out, size_t n, const void* data, size_t idx)
+{
+  snprintf(out, n, "%d", ((const int32_t*) data)[idx]);
+}
+
+static void print_u32_dec(char* out, size_t n, const void* data, size_t idx)
+{
+  snprintf(out, n, "%u", ((const uint32_t*) data)[idx]);
+}
+
+static void print_i16_dec(char* out, size_t n, const void* data, size_t idx)
+{
+  snprintf(out, n, "%d", ((const int16_t*) data)[idx]);
+}
+
+// Hex and binary show the raw bit pattern whatever the dtype
+static void print_hex16(char* out, size_t n, const void* data, size_t idx)
+{
+  uint16_t bits;
+  memcpy(&bits, (const uint16_t*) data + idx, sizeof(bits));
+  snprintf(out, n, "0x%04X", bits);
+}
+
+static void print_hex32(char* out, size_t n, const void* data, size_t idx)
+{
+  uint32_t bits;
+  memcpy(&bits, (const uint32_t*) data + idx, sizeof(bits));
+  snprintf(out, n, "0x%08X", bits);
+}
+
+static void print_bin32(char* out, size_t n, const void* data, size_t idx)
+{
+  uint32_t bits;
+  memcpy(&bits, (const uint32_t*) data + idx, sizeof(bits));
+  char text[32 + 3];
+  text[0] = '0';
+  text[1] = 'b';
+  for (int b = 31; b >= 0; b--) {
+    text[2 + 31 - b] = (char) ('0' + ((bits >> b) & 1));
+  }
+  text[34] = '\0';
+  snprintf(out, n, "%s", text);
+}
+
+static void print_bin16(char* out, size_t n, const void* data, size_t idx)
+{
+  uint16_t bits;
+  memcpy(&bits, (const uint16_t*) data + idx, sizeof(bits));
+  char text[16 + 3];
+  text[0] = '0';
+  text[1] = 'b';
+  for (int b = 15; b >= 0; b--) {
+    text[2 + 15 - b] = (char) ('0' + ((bits >> b) & 1));
+  }
+  text[18] = '\0';
+  snprintf(out, n, "%s", text);
+}
+
+// Printer per (dtype, format), looked up once when the worker starts
+static const DebugPrintFn debug_printers[DTYPE_MAX][DEBUG_FMT_BINARY + 1] = {
+    [DTYPE_FLOAT] = {[DEBUG_FMT_DECIMAL] = print_float_dec,
+                     [DEBUG_FMT_HEX] = print_hex32,
+                     [DEBUG_FMT_SCIENTIFIC] = print_float_sci,
+                     [DEBUG_FMT_BINARY] = print_bin32},
+    [DTYPE_I32] = {[DEBUG_FMT_DECIMAL] = print_i32_dec,
+                   [DEBUG_FMT_HEX] = print_hex32,
+                   [DEBUG_FMT_SCIENTIFIC] = print_i32_dec,
+                   [DEBUG_FMT_BINARY] = print_bin32},
+    [DTYPE_U32] = {[DEBUG_FMT_DECIMAL] = print_u32_dec,
+                   [DEBUG_FMT_HEX] = print_hex32,
+                   [DEBUG_FMT_SCIENTIFIC] = print_u32_dec,
+                   [DEBUG_FMT_BINARY] = print_bin32},
+    [DTYPE_I16] = {[DEBUG_FMT_DECIMAL] = print_i16_dec,
+                   [DEBUG_FMT_HEX] = print_hex16,
+                   [DEBUG_FMT_SCIENTIFIC] = print_i16_dec,
+                   [DEBUG_FMT_BINARY] = print_bin16},
+};
+
+/* Emit one formatted line. In async mode the line is formatted straight
+ * into the next log ring slot, or dropped if the writer has fallen behind;
+ * otherwise it goes to the file (the caller holds file_mutex). */
+static void debug_emitf(DebugOutputFilter_t* filter, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void debug_emitf(DebugOutputFilter_t* filter, const char* fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  if (!filter->config.async_output) {
+    vfprintf(filter->output_file, fmt, args);
+    va_end(args);
+    return;
+  }
+
+  size_t head = atomic_load_explicit(&filter->log_head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&filter->log_tail, memory_order_acquire);
+  if (head - tail > filter->log_mask) {
+    atomic_fetch_add_explicit(&filter->lines_dropped, 1,
+                              memory_order_relaxed);
+    va_end(args);
+    return;
+  }
+  char* slot = filter->log_ring + (head & filter->log_mask) * DEBUG_LINE_MAX;
+  int len = vsnprintf(slot, DEBUG_LINE_MAX, fmt, args);
+  va_end(args);
+  if (len >= DEBUG_LINE_MAX) {
+    slot[DEBUG_LINE_MAX - 2] = '\n';
+  }
+  atomic_store_explicit(&filter->log_head, head + 1, memory_order_release);
+}
+
+/* Background writer for async mode: the only thread touching the file.
+ * Lines queued before writer_stop is raised are always written. */
+static void* debug_writer(void* arg)
+{
+  DebugOutputFilter_t* filter = (DebugOutputFilter_t*) arg;
+  const struct timespec idle = {.tv_sec = 0, .tv_nsec = 1000000};
+
+  for (;;) {
+    bool stop = atomic_load(&filter->writer_stop);
+    size_t head = atomic_load_explicit(&filter->log_head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&filter->log_tail, memory_order_relaxed);
+    for (; tail != head; tail++) {
+      fputs(filter->log_ring + (tail & filter->log_mask) * DEBUG_LINE_MAX,
+            filter->output_file);
+      atomic_store_explicit(&filter->log_tail, tail + 1, memory_order_release);
+    }
+    if (filter->config.flush_after_print) {
+      fflush(filter->output_file);
+    }
+    if (stop) break;
+    nanosleep(&idle, NULL);
+  }
+  fflush(filter->output_file);
+  return NULL;
+}
+
+/* Sampling: every sample_every-th batch, spaced at least 1/K s apart.
+ * Control batches (completion, errors) are always shown. */
+static bool debug_batch_selected(DebugOutputFilter_t* filter,
+                                 const Batch_t* batch)
+{
+  if (batch->ec != Bp_EC_OK) return true;
+
+  uint64_t n = filter->batch_count++;
+  if (filter->config.sample_every > 1 &&
+      n % filter->config.sample_every != 0) {
+    return false;
+  }
+  if (filter->config.max_batches_per_s > 0) {
+    long long now = now_ns(CLOCK_MONOTONIC);
+    if (now < filter->next_emit_ns) return false;
+    filter->next_emit_ns =
+        now + 1000000000LL / filter->config.max_batches_per_s;
+  }
+  return true;
+}
+
+#define DEBUG_SUM_CASE(NAME, TYPE)                                        \
+  case DTYPE_##NAME:                                                      \
+    for (size_t c = 0; c < n_channels; c++) {                             \
+      const TYPE* v = (const TYPE*) bb_channel_ptr(buff, batch, c);       \
+      for (size_t i = 0; i < batch->head; i++) {                          \
+        double x = (double) v[i * stride];                                \
+        lo = x < lo ? x : lo;                                             \
+        hi = x > hi ? x : hi;                                             \
+        sum += x;                                                         \
+      }                                                                   \
+    }                                                                     \
+    break;
+
+/* One min/max/mean line over every value of a numeric batch */
+static void debug_summarise(DebugOutputFilter_t* filter,
+                            const Batch_buff_t* buff, const Batch_t* batch)
+{
+  size_t n_channels = bb_n_channels(buff);
+  size_t stride = buff->layout == BATCH_LAYOUT_PLANAR ? 1 : n_channels;
+  double lo = INFINITY, hi = -INFINITY, sum = 0.0;
+  switch (buff->dtype) {
+    BP_NUMERIC_DTYPES(DEBUG_SUM_CASE)
+    default:
+      return;
+  }
+  debug_emitf(filter, "%s  [summary n=%zu min=%g max=%g mean=%g]\n",
+              filter->formatted_prefix, batch->head, lo, hi,
+              sum / (double) (batch->head * n_channels));
+}
+#undef DEBUG_SUM_CASE
+
+static void debug_format_batch(DebugOutputFilter_t* filter,
+                               const Batch_buff_t* in, const Batch_t* in_batch,
+                               DebugPrintFn print_sample)
+{
+  // Print metadata if enabled
+  if (filter->config.show_metadata) {
+    char ec[16] = "";
+    if (in_batch->ec != Bp_EC_OK) {
+      snprintf(ec, sizeof(ec), ", ec=%d", in_batch->ec);
+    }
+    debug_emitf(filter,
+                "%s[Batch t=%lldns, period=%uns, samples=%zu, type=%s%s%s]\n",
+                filter->formatted_prefix, (long long) in_batch->t_ns,
+                in_batch->period_ns, in_batch->head,
+                in->dtype == DTYPE_FLOAT  ? "FLOAT"
+                : in->dtype == DTYPE_I32  ? "I32"
+                : in->dtype == DTYPE_U32  ? "U32"
+                : in->dtype == DTYPE_I16  ? "I16"
+                                          : "RECORD",
+                bb_batch_has_ts(in_batch) ? ", per-sample ts" : "", ec);
+  }
+
+  if (filter->config.show_summary && in_batch->head > 0) {
+    debug_summarise(filter, in, in_batch);
+  }
+
+  // Records are printed one line each instead of per byte
+  if (filter->config.show_samples && in_batch->head > 0 &&
+      in->dtype == DTYPE_RECORD) {
+    int max_records = filter->config.max_samples_per_batch;
+    int i = 0;
+    for (BbRecord_t* rec = bb_record_first(in_batch); rec;
+         rec = bb_record_next(in_batch, rec), i++) {
+      if (max_records >= 0 && i >= max_records) {
+        debug_emitf(filter, "%s  ... (more records)\n",
+                    filter->formatted_prefix);
+        break;
+      }
+      char hex[2 * 16 + 1] = "";
+      const uint8_t* bytes = bb_record_payload(rec);
+      for (uint32_t b = 0; b < rec->len && b < 16; b++) {
+        snprintf(hex + 2 * b, 3, "%02X", bytes[b]);
+      }
+      debug_emitf(filter, "%s  [%d] @%lldns len=%u %s%s\n",
+                  filter->formatted_prefix, i, rec->t_ns, rec->len, hex,
+                  rec->len > 16 ? "..." : "");
+    }
+  } else if (filter->config.show_samples && in_batch->head > 0) {
+    size_t num_samples = in_batch->head;
+    int samples_to_print = filter->config.max_samples_per_batch;
+    if (samples_to_print < 0 || samples_to_print > (int) num_samples) {
+      samples_to_print = (int) num_samples;
+    }
+
+    // One line per frame, its channels separated by spaces
+    size_t n_channels = bb_n_channels(in);
+    size_t stride = in->layout == BATCH_LAYOUT_PLANAR ? 1 : n_channels;
+    for (int i = 0; i < samples_to_print; i++) {
+      char ts[32] = "";
+      char values[DEBUG_LINE_MAX] = "";
+      if (bb_batch_has_ts(in_batch)) {
+        snprintf(ts, sizeof(ts), "@%lldns ", in_batch->ts[i]);
+      }
+      size_t len = 0;
+      for (size_t c = 0; print_sample && c < n_channels; c++) {
+        if (len + 1 >= sizeof(values)) break;
+        if (c > 0) values[len++] = ' ';
+        print_sample(values + len, sizeof(values) - len,
+                     bb_channel_ptr(in, in_batch, c), i * stride);
+        len += strlen(values + len);
+      }
+      debug_emitf(filter, "%s  [%d] %s%s\n", filter->formatted_prefix, i, ts,
+                  values);
+    }
+
+    if (samples_to_print < (int) num_samples) {
+      debug_emitf(filter, "%s  ... (%zu more samples)\n",
+                  filter->formatted_prefix, num_samples - samples_to_print);
+    }
+  }
+
+  // Handle completion
+  if (in_batch->ec == Bp_EC_COMPLETE && filter->config.show_metadata) {
+    debug_emitf(filter, "%s[Stream completed]\n", filter->formatted_prefix);
+  }
+}
+
 static void* debug_output_worker(void* arg)
 {
   DebugOutputFilter_t* filter = (DebugOutputFilter_t*) arg;
   Filter_t* base = &filter->base;
+  Batch_buff_t* in = base->input_buffers[0];
 
   // Note: Output sink is optional - filter can work as a pure inspector
 
+  // Resolve the sample printer once; NULL for record streams
+  SampleDtype_t dtype = in->dtype;
+  DebugOutputFormat fmt = filter->config.format <= DEBUG_FMT_BINARY
+                              ? filter->config.format
+                              : DEBUG_FMT_DECIMAL;
+  DebugPrintFn print_sample = dtype < DTYPE_MAX ? debug_printers[dtype][fmt]
+                                                : NULL;
+  bool printing = filter->config.show_metadata ||
+                  filter->config.show_samples || filter->config.show_summary;
+  bool async = filter->config.async_output;
+
+  if (async) {
+    atomic_store(&filter->writer_stop, false);
+    BP_WORKER_ASSERT(
+        base, pthread_create(&filter->writer, NULL, debug_writer, filter) == 0,
+        Bp_EC_THREAD_CREATE_FAIL);
+  }
+
   while (atomic_load(&base->running)) {
     // Get input batch
     Bp_EC err;
-    Batch_t* in_batch = bb_get_tail(base->input_buffers[0], 100, &err);
+    Batch_t* in_batch = bb_get_tail(in, base->timeout_us, &err);
     if (!in_batch) {
       if (err == Bp_EC_STOPPED) {
         break;  // Graceful shutdown
@@ -27,132 +339,21 @@ static void* debug_output_worker(void* arg)
       continue;  // Timeout is normal
     }
 
-    // Print batch if configured
-    if (filter->config.show_metadata || filter->config.show_samples) {
-      pthread_mutex_lock(&filter->file_mutex);
-
-      // Print metadata if enabled
-      if (filter->config.show_metadata) {
-        fprintf(filter->output_file,
-                "%s[Batch t=%lldns, period=%uns, samples=%zu, type=%s",
-                filter->formatted_prefix, (long long) in_batch->t_ns,
-                in_batch->period_ns, in_batch->head,
-                base->input_buffers[0]->dtype == DTYPE_FLOAT ? "FLOAT"
-                : base->input_buffers[0]->dtype == DTYPE_I32 ? "I32"
-                                                             : "U32");
-
-        if (in_batch->ec != Bp_EC_OK) {
-          fprintf(filter->output_file, ", ec=%d", in_batch->ec);
-        }
-        fprintf(filter->output_file, "]\n");
-      }
-
-      // Print samples if enabled
-      if (filter->config.show_samples && in_batch->head > 0) {
-        size_t num_samples = in_batch->head;
-        int samples_to_print = filter->config.max_samples_per_batch;
-        if (samples_to_print < 0 || samples_to_print > (int) num_samples) {
-          samples_to_print = (int) num_samples;
-        }
-
-        for (int i = 0; i < samples_to_print; i++) {
-          size_t idx = i;
-          fprintf(filter->output_file, "%s  [%d] ", filter->formatted_prefix,
-                  i);
-
-          switch (base->input_buffers[0]->dtype) {
-            case DTYPE_NDEF:
-            case DTYPE_MAX:
-              // Should not happen
-              break;
-            case DTYPE_FLOAT: {
-              float* data = (float*) in_batch->data;
-              switch (filter->config.format) {
-                case DEBUG_FMT_SCIENTIFIC:
-                  fprintf(filter->output_file, "%e\n", data[idx]);
-                  break;
-                case DEBUG_FMT_HEX: {
-                  uint32_t hex_val;
-                  memcpy(&hex_val, &data[idx], sizeof(uint32_t));
-                  fprintf(filter->output_file, "0x%08X\n", hex_val);
-                } break;
-                case DEBUG_FMT_BINARY: {
-                  uint32_t bits;
-                  memcpy(&bits, &data[idx], sizeof(uint32_t));
-                  fprintf(filter->output_file, "0b");
-                  for (int b = 31; b >= 0; b--) {
-                    fprintf(filter->output_file, "%u", (bits >> b) & 1);
-                  }
-                  fprintf(filter->output_file, "\n");
-                  break;
-                }
-                case DEBUG_FMT_DECIMAL:
-                default:
-                  fprintf(filter->output_file, "%f\n", data[idx]);
-                  break;
-              }
-              break;
-            }
-            case DTYPE_I32: {
-              int32_t* data = (int32_t*) in_batch->data;
-              switch (filter->config.format) {
-                case DEBUG_FMT_HEX:
-                  fprintf(filter->output_file, "0x%08X\n",
-                          (uint32_t) data[idx]);
-                  break;
-                case DEBUG_FMT_BINARY: {
-                  uint32_t bits = (uint32_t) data[idx];
-                  fprintf(filter->output_file, "0b");
-                  for (int b = 31; b >= 0; b--) {
-                    fprintf(filter->output_file, "%u", (bits >> b) & 1);
-                  }
-                  fprintf(filter->output_file, "\n");
-                  break;
-                }
-                case DEBUG_FMT_DECIMAL:
-                case DEBUG_FMT_SCIENTIFIC:
-                default:
-                  fprintf(filter->output_file, "%d\n", data[idx]);
-                  break;
-              }
-              break;
-            }
-            case DTYPE_U32: {
-              uint32_t* data = (uint32_t*) in_batch->data;
-              switch (filter->config.format) {
-                case DEBUG_FMT_HEX:
-                  fprintf(filter->output_file, "0x%08X\n", data[idx]);
-                  break;
-                case DEBUG_FMT_BINARY: {
-                  fprintf(filter->output_file, "0b");
-                  for (int b = 31; b >= 0; b--) {
-                    fprintf(filter->output_file, "%u", (data[idx] >> b) & 1);
-                  }
-                  fprintf(filter->output_file, "\n");
-                  break;
-                }
-                case DEBUG_FMT_DECIMAL:
-                case DEBUG_FMT_SCIENTIFIC:
-                default:
-                  fprintf(filter->output_file, "%u\n", data[idx]);
-                  break;
-              }
-              break;
-            }
-          }
-        }
-
-        if (samples_to_print < (int) num_samples) {
-          fprintf(filter->output_file, "%s  ... (%zu more samples)\n",
-                  filter->formatted_prefix, num_samples - samples_to_print);
+    // Print batch if configured and selected by the sampling policy
+    if (printing && debug_batch_selected(filter, in_batch)) {
+      if (!async) pthread_mutex_lock(&filter->file_mutex);
+      debug_format_batch(filter, in, in_batch, print_sample);
+      if (!async) {
+        if (filter->config.flush_after_print) {
+          fflush(filter->output_file);
         }
+        pthread_mutex_unlock(&filter->file_mutex);
       }
-
-      if (filter->config.flush_after_print) {
-        fflush(filter->output_file);
-      }
-
-      pthread_mutex_unlock(&filter->file_mutex);
+      atomic_fetch_add_explicit(&filter->batches_logged, 1,
+                                memory_order_relaxed);
+    } else if (printing) {
+      atomic_fetch_add_explicit(&filter->batches_skipped, 1,
+                                memory_order_relaxed);
     }
 
     // Pass through data if we have an output sink
@@ -166,31 +367,20 @@ static void* debug_output_worker(void* arg)
       out_batch->head = in_batch->head;
       out_batch->ec = in_batch->ec;
 
-      size_t data_size =
-          in_batch->head * bb_getdatawidth(base->input_buffers[0]->dtype);
-      if (data_size > 0) {
-        memcpy(out_batch->data, in_batch->data, data_size);
-      }
+      bb_copy_frames(base->sinks[0], out_batch, 0, in, in_batch, 0,
+                     in_batch->head);
 
       // Submit output
       bb_submit(base->sinks[0], base->timeout_us);
     }
 
     // Always delete input batch
-    bb_del_tail(base->input_buffers[0]);
-
-    // Handle completion
-    if (in_batch->ec == Bp_EC_COMPLETE) {
-      if (filter->config.show_metadata) {
-        pthread_mutex_lock(&filter->file_mutex);
-        fprintf(filter->output_file, "%s[Stream completed]\n",
-                filter->formatted_prefix);
-        if (filter->config.flush_after_print) {
-          fflush(filter->output_file);
-        }
-        pthread_mutex_unlock(&filter->file_mutex);
-      }
-    }
+    bb_del_tail(in);
+  }
+
+  if (async) {
+    atomic_store(&filter->writer_stop, true);
+    pthread_join(filter->writer, NULL);
   }
 
   return NULL;
@@ -239,11 +429,34 @@ Bp_EC debug_output_filter_init(DebugOutputFilter_t* filter,
     filter->output_file = stdout;
   }
 
+  // Log ring for async output
+  if (filter->config.async_output) {
+    size_t expo = filter->config.log_ring_expo ? filter->config.log_ring_expo
+                                               : 10;
+    if (expo > 20) {
+      if (filter->output_file != stdout) {
+        fclose(filter->output_file);
+      }
+      free(filter->formatted_prefix);
+      return Bp_EC_INVALID_CONFIG;
+    }
+    filter->log_mask = ((size_t) 1 << expo) - 1;
+    filter->log_ring = malloc((filter->log_mask + 1) * DEBUG_LINE_MAX);
+    if (!filter->log_ring) {
+      if (filter->output_file != stdout) {
+        fclose(filter->output_file);
+      }
+      free(filter->formatted_prefix);
+      return Bp_EC_MALLOC_FAIL;
+    }
+  }
+
   // Initialize mutex
   if (pthread_mutex_init(&filter->file_mutex, NULL) != 0) {
     if (filter->output_file != stdout) {
       fclose(filter->output_file);
     }
+    free(filter->log_ring);
     free(filter->formatted_prefix);
     return Bp_EC_MUTEX_INIT_FAIL;
   }
@@ -269,6 +482,7 @@ Bp_EC debug_output_filter_init(DebugOutputFilter_t* filter,
     if (filter->output_file != stdout) {
       fclose(filter->output_file);
     }
+    free(filter->log_ring);
     free(filter->formatted_prefix);
     return ec;
   }
@@ -303,6 +517,9 @@ static Bp_EC debug_output_deinit(Filter_t* base)
     filter->output_file = NULL;  // Prevent double close
   }
 
+  free(filter->log_ring);
+  filter->log_ring = NULL;
+
   pthread_mutex_destroy(&filter->file_mutex);
 
   // Don't call filt_deinit here - that would cause infinite recursion
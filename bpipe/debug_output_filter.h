@@ -11,6 +11,9 @@ typedef enum {
   DEBUG_FMT_BINARY
 } DebugOutputFormat;
 
+/* Longest line the filter emits; longer lines are truncated. */
+#define DEBUG_LINE_MAX 256
+
 typedef struct {
   const char* prefix;
   bool show_metadata;
@@ -20,6 +23,19 @@ typedef struct {
   bool flush_after_print;
   const char* filename;
   bool append_mode;
+
+  /* Tap mode, cheap enough to leave attached to a production stream.
+   * Batches are selected every sample_every-th (0 = all) and at most
+   * max_batches_per_s (0 = unlimited); control batches are always shown.
+   * show_summary prints one min/max/mean line per batch. With async_output
+   * lines are formatted into a lock-free ring of 2^log_ring_expo lines
+   * (0 = 1024) and written by a background thread; lines that find the
+   * ring full are dropped and counted rather than stalling the stream. */
+  unsigned sample_every;
+  unsigned max_batches_per_s;
+  bool show_summary;
+  bool async_output;
+  size_t log_ring_expo;
 } DebugOutputConfig_t;
 
 typedef struct {
@@ -28,6 +44,23 @@ typedef struct {
   char* formatted_prefix;
   FILE* output_file;
   pthread_mutex_t file_mutex;
+
+  /* Sampling state (worker) */
+  uint64_t batch_count;
+  long long next_emit_ns;
+
+  /* Async log ring: worker writes at head, writer thread reads at tail */
+  char* log_ring;
+  size_t log_mask;
+  _Atomic size_t log_head;
+  _Atomic size_t log_tail;
+  _Atomic bool writer_stop;
+  pthread_t writer;
+
+  /* Statistics */
+  _Atomic uint64_t batches_logged;
+  _Atomic uint64_t batches_skipped;
+  _Atomic uint64_t lines_dropped;
 } DebugOutputFilter_t;
 
 Bp_EC debug_output_filter_init(DebugOutputFilter_t* filter,
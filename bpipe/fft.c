@@ -0,0 +1,97 @@
+#include "fft.h"
+#include <math.h>
+#include <stdlib.h>
+
+Bp_EC fft_plan_init(FftPlan_t* plan, size_t expo)
+{
+  if (plan == NULL) return Bp_EC_NULL_POINTER;
+  if (expo < 1 || expo > FFT_MAX_EXPO) return Bp_EC_INVALID_CONFIG;
+
+  const size_t n = (size_t) 1 << expo;
+  plan->n = n;
+  plan->expo = expo;
+  plan->cos_tab = malloc((n / 2) * sizeof(float));
+  plan->sin_tab = malloc((n / 2) * sizeof(float));
+  plan->bitrev = malloc(n * sizeof(uint32_t));
+  if (!plan->cos_tab || !plan->sin_tab || !plan->bitrev) {
+    fft_plan_deinit(plan);
+    return Bp_EC_MALLOC_FAIL;
+  }
+
+  /* Twiddles in double so large sizes keep full float accuracy */
+  const double step = 2.0 * acos(-1.0) / (double) n;
+  for (size_t k = 0; k < n / 2; k++) {
+    plan->cos_tab[k] = (float) cos(step * (double) k);
+    plan->sin_tab[k] = (float) sin(step * (double) k);
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t r = 0;
+    for (size_t b = 0; b < expo; b++) r |= ((i >> b) & 1u) << (expo - 1 - b);
+    plan->bitrev[i] = r;
+  }
+  return Bp_EC_OK;
+}
+
+void fft_plan_deinit(FftPlan_t* plan)
+{
+  if (plan == NULL) return;
+  free(plan->cos_tab);
+  free(plan->sin_tab);
+  free(plan->bitrev);
+  plan->cos_tab = NULL;
+  plan->sin_tab = NULL;
+  plan->bitrev = NULL;
+}
+
+/* Iterative decimation in time. sign is -1 forward, +1 inverse. */
+static void fft_run(const FftPlan_t* plan, float* re, float* im, float sign)
+{
+  const size_t n = plan->n;
+  for (size_t i = 0; i < n; i++) {
+    size_t j = plan->bitrev[i];
+    if (j > i) {
+      float t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+
+  for (size_t len = 2; len <= n; len <<= 1) {
+    const size_t half = len / 2;
+    const size_t stride = n / len; /* Twiddle table step */
+    for (size_t base = 0; base < n; base += len) {
+      float* ar = re + base;
+      float* ai = im + base;
+      float* br = ar + half;
+      float* bi = ai + half;
+      for (size_t k = 0; k < half; k++) {
+        const float wr = plan->cos_tab[k * stride];
+        const float wi = sign * plan->sin_tab[k * stride];
+        const float tr = br[k] * wr - bi[k] * wi;
+        const float ti = br[k] * wi + bi[k] * wr;
+        br[k] = ar[k] - tr;
+        bi[k] = ai[k] - ti;
+        ar[k] += tr;
+        ai[k] += ti;
+      }
+    }
+  }
+}
+
+void fft_forward(const FftPlan_t* plan, float* re, float* im)
+{
+  fft_run(plan, re, im, -1.0f);
+}
+
+void fft_inverse(const FftPlan_t* plan, float* re, float* im)
+{
+  fft_run(plan, re, im, 1.0f);
+  const float scale = 1.0f / (float) plan->n;
+  for (size_t i = 0; i < plan->n; i++) {
+    re[i] *= scale;
+    im[i] *= scale;
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef BPIPE_FFT_H
+#define BPIPE_FFT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bperr.h"
+
+/* Radix-2 complex FFT on split real / imaginary float arrays.
+ *
+ * A plan holds the twiddle factors and bit-reversal permutation for one
+ * power-of-two size. Create it once when a filter is set up; transforms
+ * are then in place and allocation-free, and one plan may be shared by
+ * any number of threads.
+ *
+ * fft_forward computes X[k] = sum_n x[n] e^(-2 pi i k n / N);
+ * fft_inverse is its exact inverse, including the 1/N scaling.
+ */
+
+#define FFT_MAX_EXPO 20
+
+typedef struct _FftPlan_t {
+  size_t n;
+  size_t expo;
+  float* cos_tab;  /* cos(2 pi k / n), k < n / 2 */
+  float* sin_tab;  /* sin(2 pi k / n), k < n / 2 */
+  uint32_t* bitrev;
+} FftPlan_t;
+
+Bp_EC fft_plan_init(FftPlan_t* plan, size_t expo);
+void fft_plan_deinit(FftPlan_t* plan);
+
+void fft_forward(const FftPlan_t* plan, float* re, float* im);
+void fft_inverse(const FftPlan_t* plan, float* re, float* im);
+
+#endif /* BPIPE_FFT_H */
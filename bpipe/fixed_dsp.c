@@ -0,0 +1,408 @@
+#include "fixed_dsp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+/* Widen one channel of a batch to int32 */
+static void fixed_load(const void* src, SampleDtype_t dtype, size_t stride,
+                       size_t n, int32_t* dst)
+{
+  if (dtype == DTYPE_I16) {
+    const int16_t* s = (const int16_t*) src;
+    for (size_t k = 0; k < n; k++) dst[k] = s[k * stride];
+  } else {
+    const int32_t* s = (const int32_t*) src;
+    for (size_t k = 0; k < n; k++) dst[k] = s[k * stride];
+  }
+}
+
+static void fixed_store(void* dst, SampleDtype_t dtype, size_t stride,
+                        size_t n, const int32_t* src)
+{
+  if (dtype == DTYPE_I16) {
+    int16_t* d = (int16_t*) dst;
+    for (size_t k = 0; k < n; k++) d[k * stride] = (int16_t) src[k];
+  } else {
+    int32_t* d = (int32_t*) dst;
+    for (size_t k = 0; k < n; k++) d[k * stride] = src[k];
+  }
+}
+
+/* Narrow an accumulator, counting outputs that had to be clipped */
+static inline int32_t fixed_narrow(int64_t acc, unsigned frac_bits,
+                                   unsigned bits, uint64_t* saturated)
+{
+  int64_t r = fx_round_shift(acc, frac_bits);
+  int32_t y = fx_saturate(r, bits);
+  *saturated += y != r;
+  return y;
+}
+
+/* work holds n_taps - 1 samples of history followed by the n new ones;
+ * outputs are taken at input positions first, first + step, ... */
+static size_t fixed_fir(const FixedDsp_t* dsp, const int32_t* work, size_t n,
+                        size_t first, size_t step, int32_t* y,
+                        uint64_t* saturated)
+{
+  const int32_t* h = dsp->coeffs;
+  const size_t n_taps = dsp->n_coeffs;
+  size_t n_out = 0;
+  for (size_t k = first; k < n; k += step) {
+    const int32_t* w = work + k;
+    int64_t acc = 0;
+    for (size_t j = 0; j < n_taps; j++) acc += (int64_t) h[j] * w[j];
+    y[n_out++] = fixed_narrow(acc, dsp->frac_bits, dsp->sample_bits,
+                              saturated);
+  }
+  return n_out;
+}
+
+/* In place over x; st holds {x1, x2, y1, y2} per section */
+static void fixed_biquad(const FixedDsp_t* dsp, int32_t* st, int32_t* x,
+                         size_t n, uint64_t* saturated)
+{
+  const size_t n_sections = dsp->n_coeffs / 5;
+  for (size_t s = 0; s < n_sections; s++, st += 4) {
+    const int32_t* c = dsp->coeffs + 5 * s;
+    int32_t x1 = st[0], x2 = st[1], y1 = st[2], y2 = st[3];
+    for (size_t k = 0; k < n; k++) {
+      int64_t acc = (int64_t) c[0] * x[k] + (int64_t) c[1] * x1 +
+                    (int64_t) c[2] * x2 - (int64_t) c[3] * y1 -
+                    (int64_t) c[4] * y2;
+      x2 = x1;
+      x1 = x[k];
+      y2 = y1;
+      y1 = fixed_narrow(acc, dsp->frac_bits, dsp->sample_bits, saturated);
+      x[k] = y1;
+    }
+    st[0] = x1;
+    st[1] = x2;
+    st[2] = y1;
+    st[3] = y2;
+  }
+}
+
+static void fixed_mix(const FixedDsp_t* dsp, int32_t* x, size_t n,
+                      uint64_t* saturated)
+{
+  const int32_t* lo = dsp->coeffs;
+  size_t p = dsp->phase;
+  for (size_t k = 0; k < n; k++) {
+    x[k] = fixed_narrow((int64_t) lo[p] * x[k], dsp->frac_bits,
+                        dsp->sample_bits, saturated);
+    p = p + 1 < dsp->n_coeffs ? p + 1 : 0;
+  }
+}
+
+/* Frames of one input batch, one channel at a time. Returns output frames. */
+static size_t fixed_process(FixedDsp_t* dsp, const Batch_buff_t* in_buf,
+                            const Batch_t* input, const Batch_buff_t* out_buf,
+                            Batch_t* output)
+{
+  const SampleDtype_t dtype = in_buf->dtype;
+  const size_t n_channels = in_buf->n_channels;
+  const size_t stride =
+      in_buf->layout == BATCH_LAYOUT_PLANAR ? 1 : n_channels;
+  const size_t n = input->head;
+  const size_t hist = dsp->kind == FIXED_DSP_FIR ? dsp->n_coeffs - 1 : 0;
+  int32_t* x = dsp->work + hist;
+  int32_t* y = dsp->kind == FIXED_DSP_FIR ? x + n : x;
+  size_t n_out = n;
+
+  for (size_t ch = 0; ch < n_channels; ch++) {
+    fixed_load(bb_channel_ptr(in_buf, input, ch), dtype, stride, n, x);
+    switch (dsp->kind) {
+      case FIXED_DSP_FIR: {
+        int32_t* h = dsp->state + ch * hist;
+        memcpy(dsp->work, h, hist * sizeof(int32_t));
+        n_out = fixed_fir(dsp, dsp->work, n, dsp->phase, dsp->decimation, y,
+                          &dsp->samples_saturated);
+        memcpy(h, dsp->work + n, hist * sizeof(int32_t));
+        break;
+      }
+      case FIXED_DSP_BIQUAD:
+        fixed_biquad(dsp, dsp->state + ch * 4 * (dsp->n_coeffs / 5), x, n,
+                     &dsp->samples_saturated);
+        break;
+      case FIXED_DSP_MIX:
+        fixed_mix(dsp, x, n, &dsp->samples_saturated);
+        break;
+    }
+    fixed_store(bb_channel_ptr(out_buf, output, ch), dtype, stride, n_out, y);
+  }
+
+  /* Phases are per frame, shared by every channel */
+  if (dsp->kind == FIXED_DSP_FIR) {
+    /* First position past this batch that is due an output */
+    dsp->phase = dsp->phase + n_out * dsp->decimation - n;
+  } else if (dsp->kind == FIXED_DSP_MIX) {
+    dsp->phase = (dsp->phase + n) % dsp->n_coeffs;
+  }
+  return n_out;
+}
+
+static void* fixed_dsp_worker(void* arg)
+{
+  FixedDsp_t* dsp = (FixedDsp_t*) arg;
+  Filter_t* f = &dsp->base;
+  Batch_buff_t* in_buf = f->input_buffers[0];
+  Batch_buff_t* out_buf = f->sinks[0];
+  Bp_EC err = Bp_EC_OK;
+
+  BP_WORKER_ASSERT(f, out_buf != NULL, Bp_EC_NO_SINK);
+  BP_WORKER_ASSERT(f,
+                   out_buf->n_channels == in_buf->n_channels &&
+                       out_buf->layout == in_buf->layout &&
+                       out_buf->batch_capacity_expo >=
+                           in_buf->batch_capacity_expo,
+                   Bp_EC_INVALID_CONFIG);
+
+  const bool decimating = dsp->decimation > 1;
+
+  while (atomic_load(&f->running)) {
+    Batch_t* input = bb_get_tail(in_buf, f->timeout_us, &err);
+    if (!input) {
+      if (err == Bp_EC_TIMEOUT) continue;
+      break;
+    }
+
+    if (input->ec == Bp_EC_COMPLETE) {
+      filt_send_complete(f, out_buf);
+      bb_del_tail(in_buf);
+      break;
+    }
+    BP_WORKER_ASSERT(f, input->ec == Bp_EC_OK, input->ec);
+    Batch_t* output = bb_get_head(out_buf);
+    BP_WORKER_ASSERT(f, !bb_batch_has_ts(input) || output->ts != NULL,
+                     Bp_EC_INVALID_CONFIG);
+    BP_WORKER_ASSERT(f,
+                     !decimating ||
+                         (input->period_ns > 0 && !bb_batch_has_ts(input)),
+                     Bp_EC_INVALID_DATA);
+
+    size_t first = dsp->phase;
+    size_t n_out = fixed_process(dsp, in_buf, input, out_buf, output);
+    f->metrics.samples_processed += input->head;
+
+    if (n_out == 0) {
+      bb_del_tail(in_buf);
+      continue;
+    }
+
+    output->ec = Bp_EC_OK;
+    output->head = n_out;
+    output->batch_id = input->batch_id;
+    if (decimating) {
+      output->t_ns = input->t_ns + (long long) first * input->period_ns;
+      output->period_ns = input->period_ns * (unsigned) dsp->decimation;
+    } else {
+      output->t_ns = input->t_ns;
+      output->period_ns = input->period_ns;
+      if (bb_batch_has_ts(input)) {
+        memcpy(output->ts, input->ts, input->head * sizeof(long long));
+      }
+    }
+
+    err = bb_submit(out_buf, f->timeout_us);
+    if (err != Bp_EC_OK) break;
+    bb_del_tail(in_buf);
+    f->metrics.n_batches++;
+  }
+
+  BP_WORKER_ASSERT(f, BP_WORKER_CLEAN_EXIT(err), err);
+  return NULL;
+}
+
+static Bp_EC fixed_dsp_describe(Filter_t* self, char* buffer, size_t size)
+{
+  FixedDsp_t* dsp = (FixedDsp_t*) self;
+  if (buffer == NULL) return Bp_EC_NULL_POINTER;
+  static const char* kinds[] = {"FIR", "biquad", "mix"};
+
+  snprintf(buffer, size,
+           "FixedDsp: %s\n"
+           "  Kind: %s, %zu coefficients in Q%u, %u-bit samples\n"
+           "  Decimation: %zu\n"
+           "  Samples saturated: %llu",
+           self->name, kinds[dsp->kind], dsp->n_coeffs, dsp->frac_bits,
+           dsp->sample_bits, dsp->decimation,
+           (unsigned long long) dsp->samples_saturated);
+  return Bp_EC_OK;
+}
+
+/* int32 words of filter state over all channels */
+static size_t fixed_dsp_state_len(const FixedDsp_t* dsp, size_t n_channels)
+{
+  if (dsp->kind == FIXED_DSP_FIR) return n_channels * (dsp->n_coeffs - 1);
+  if (dsp->kind == FIXED_DSP_BIQUAD) {
+    return n_channels * 4 * (dsp->n_coeffs / 5); /* 5 coeffs per section */
+  }
+  return 0;
+}
+
+/* Checkpoint: filter histories, the decimation / LO phase and the
+ * saturation count */
+static Bp_EC fixed_dsp_checkpoint(Filter_t* self, Checkpoint_t* ck)
+{
+  FixedDsp_t* dsp = (FixedDsp_t*) self;
+  uint64_t phase = dsp->phase;
+  Bp_EC err = CKPT_PUT(ck, phase);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, dsp->samples_saturated);
+  if (err == Bp_EC_OK) {
+    size_t n = fixed_dsp_state_len(dsp, self->input_buffers[0]->n_channels);
+    err = ckpt_write(ck, dsp->state, n * sizeof(int32_t));
+  }
+  return err;
+}
+
+static Bp_EC fixed_dsp_restore(Filter_t* self, Checkpoint_t* ck)
+{
+  FixedDsp_t* dsp = (FixedDsp_t*) self;
+  uint64_t phase;
+  Bp_EC err = CKPT_GET(ck, phase);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, dsp->samples_saturated);
+  if (err == Bp_EC_OK) {
+    size_t n = fixed_dsp_state_len(dsp, self->input_buffers[0]->n_channels);
+    err = ckpt_read(ck, dsp->state, n * sizeof(int32_t));
+  }
+  if (err != Bp_EC_OK) return err;
+  if (phase >= MAX(dsp->decimation, dsp->n_coeffs)) return Bp_EC_INVALID_DATA;
+  dsp->phase = (size_t) phase;
+  return Bp_EC_OK;
+}
+
+static void fixed_dsp_free(FixedDsp_t* dsp)
+{
+  free(dsp->coeffs);
+  free(dsp->state);
+  free(dsp->work);
+  dsp->coeffs = NULL;
+  dsp->state = NULL;
+  dsp->work = NULL;
+}
+
+static Bp_EC fixed_dsp_deinit(Filter_t* self)
+{
+  fixed_dsp_free((FixedDsp_t*) self);
+
+  filt_release_inputs(self);
+  return Bp_EC_OK;
+}
+
+/* Worst case |accumulator| is sum|c| * 2^(bits-1) plus the rounding
+ * offset; keep it under 2^62 so neither can overflow int64 */
+static bool fixed_headroom_ok(const int32_t* c, size_t n, unsigned bits)
+{
+  uint64_t sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    sum += c[i] < 0 ? (uint64_t) -(int64_t) c[i] : (uint64_t) c[i];
+  }
+  return sum <= ((uint64_t) 1 << 62) >> (bits - 1);
+}
+
+static Bp_EC fixed_dsp_validate(const FixedDsp_config_t* config,
+                                unsigned bits)
+{
+  size_t n = config->n_coeffs;
+  if (config->coeffs == NULL) return Bp_EC_NULL_POINTER;
+  if (config->coeff_frac_bits > 31) return Bp_EC_INVALID_CONFIG;
+
+  switch (config->kind) {
+    case FIXED_DSP_FIR:
+      if (n < 1 || n > FIXED_DSP_MAX_TAPS) return Bp_EC_INVALID_CONFIG;
+      return fixed_headroom_ok(config->coeffs, n, bits)
+                 ? Bp_EC_OK
+                 : Bp_EC_INVALID_CONFIG;
+    case FIXED_DSP_BIQUAD:
+      if (n < 5 || n % 5 != 0 || n / 5 > FIXED_DSP_MAX_SECTIONS) {
+        return Bp_EC_INVALID_CONFIG;
+      }
+      for (size_t s = 0; s < n; s += 5) {
+        if (!fixed_headroom_ok(config->coeffs + s, 5, bits)) {
+          return Bp_EC_INVALID_CONFIG;
+        }
+      }
+      return Bp_EC_OK;
+    case FIXED_DSP_MIX:
+      if (n < 1 || n > FIXED_DSP_MAX_LO) return Bp_EC_INVALID_CONFIG;
+      return fixed_headroom_ok(config->coeffs, n, bits)
+                 ? Bp_EC_OK
+                 : Bp_EC_INVALID_CONFIG;
+  }
+  return Bp_EC_INVALID_CONFIG;
+}
+
+Bp_EC fixed_dsp_init(FixedDsp_t* dsp, FixedDsp_config_t config)
+{
+  if (dsp == NULL) return Bp_EC_NULL_FILTER;
+  SampleDtype_t dtype = config.buff_config.dtype;
+  if (dtype != DTYPE_I16 && dtype != DTYPE_I32) return Bp_EC_INVALID_CONFIG;
+  unsigned bits = dtype == DTYPE_I16 ? 16 : 32;
+
+  Bp_EC err = fixed_dsp_validate(&config, bits);
+  if (err != Bp_EC_OK) return err;
+  size_t decimation = config.decimation > 1 ? config.decimation : 1;
+  if (decimation > 1 && config.kind != FIXED_DSP_FIR) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+
+  Core_filt_config_t core_config = {
+      .name = config.name,
+      .filt_type = FILT_T_FIXED_DSP,
+      .size = sizeof(FixedDsp_t),
+      .n_inputs = 1,
+      .max_supported_sinks = 1,
+      .buff_config = config.buff_config,
+      .timeout_us = config.timeout_us > 0 ? config.timeout_us : 1000000,
+      .worker = fixed_dsp_worker};
+
+  err = filt_init(&dsp->base, core_config);
+  if (err != Bp_EC_OK) return err;
+
+  const size_t n = config.n_coeffs;
+  const size_t n_channels = MAX(config.buff_config.n_channels, 1);
+  const size_t capacity = (size_t) 1 << config.buff_config.batch_capacity_expo;
+  size_t n_work = capacity;
+  if (config.kind == FIXED_DSP_FIR) {
+    n_work = (n - 1) + 2 * capacity; /* history, input, output */
+  }
+
+  dsp->kind = config.kind;
+  dsp->frac_bits = config.coeff_frac_bits;
+  dsp->sample_bits = bits;
+  dsp->n_coeffs = n;
+  dsp->decimation = decimation;
+  dsp->phase = 0;
+  dsp->samples_saturated = 0;
+  dsp->coeffs = malloc(n * sizeof(int32_t));
+  dsp->state =
+      calloc(MAX(fixed_dsp_state_len(dsp, n_channels), 1), sizeof(int32_t));
+  dsp->work = malloc(n_work * sizeof(int32_t));
+  if (dsp->coeffs == NULL || dsp->state == NULL || dsp->work == NULL) {
+    fixed_dsp_free(dsp);
+    filt_deinit(&dsp->base);
+    return Bp_EC_MALLOC_FAIL;
+  }
+
+  /* FIR taps reversed so the inner loop walks taps and history forwards */
+  for (size_t i = 0; i < n; i++) {
+    dsp->coeffs[i] = config.kind == FIXED_DSP_FIR ? config.coeffs[n - 1 - i]
+                                                  : config.coeffs[i];
+  }
+
+  dsp->base.ops.describe = fixed_dsp_describe;
+  dsp->base.ops.deinit = fixed_dsp_deinit;
+  dsp->base.ops.checkpoint = fixed_dsp_checkpoint;
+  dsp->base.ops.restore = fixed_dsp_restore;
+
+  prop_constraints_from_buffer_append(&dsp->base, &config.buff_config, true);
+  if (decimation == 1) {
+    prop_append_behavior(&dsp->base, PROP_SAMPLE_PERIOD_NS,
+                         BEHAVIOR_OP_PRESERVE, NULL, OUTPUT_ALL);
+  }
+  dsp->base.output_properties[0] =
+      prop_propagate(NULL, 0, &dsp->base.contract, 0);
+
+  return Bp_EC_OK;
+}
@@ -0,0 +1,79 @@
+#ifndef BPIPE_FIXED_DSP_H
+#define BPIPE_FIXED_DSP_H
+
+#include "batch_buffer.h"
+#include "core.h"
+#include "fixed_point.h"
+
+/* FixedDsp: integer DSP kernels on Q15 / Q31 streams.
+ *
+ * Input and output are DTYPE_I16 (Q15 and other 16-bit formats) or
+ * DTYPE_I32 (Q31 and friends), same dtype, layout and channel count on both
+ * sides. Coefficients are int32_t in Q.coeff_frac_bits, so a Q15 stream can
+ * be filtered with Q14 taps for a gain range of +/-2, and so on; the output
+ * keeps the input's Q format.
+ *
+ * Kinds:
+ *   FIR       y[k] = sum_i c[i] * x[k - i]; with decimation M > 1 only
+ *             every M-th output is computed (decimating FIR), the phase
+ *             carrying over between batches.
+ *   BIQUAD    Cascade of Direct Form I sections, five coefficients per
+ *             section {b0, b1, b2, a1, a2}:
+ *             y = b0 x + b1 x1 + b2 x2 - a1 y1 - a2 y2.
+ *   MIX       y[k] = x[k] * lo[(phase + k) % n_coeffs]: multiply every
+ *             channel by a periodic local-oscillator table.
+ *
+ * Products accumulate in int64_t and are rounded and saturated once, on
+ * the way out (each biquad section saturates its own output). init rejects
+ * coefficient sets whose worst case could overflow the accumulator, so the
+ * inner loops carry no per-term saturation and results are bit-exact on
+ * every host. Filter state runs per channel across batches.
+ *
+ * Decimation needs regular input (period_ns > 0, no per-sample timestamps);
+ * output batches then carry period_ns * M and are shorter than the input.
+ */
+
+#define FIXED_DSP_MAX_TAPS 1024
+#define FIXED_DSP_MAX_SECTIONS 16
+#define FIXED_DSP_MAX_LO 65536
+
+typedef enum _FixedDspKind_e {
+  FIXED_DSP_FIR = 0,
+  FIXED_DSP_BIQUAD,
+  FIXED_DSP_MIX,
+} FixedDspKind_e;
+
+typedef struct _FixedDsp_config_t {
+  const char* name;
+  BatchBuffer_config buff_config; /* dtype I16 or I32 */
+  FixedDspKind_e kind;
+  const int32_t* coeffs; /* Taps, 5 per biquad section, or the LO table */
+  size_t n_coeffs;
+  unsigned coeff_frac_bits; /* Q format of coeffs, 0..31 */
+  size_t decimation;        /* FIR only; 0 or 1 for none */
+  long timeout_us;
+} FixedDsp_config_t;
+
+typedef struct _FixedDsp_t {
+  Filter_t base;
+
+  FixedDspKind_e kind;
+  unsigned frac_bits;
+  unsigned sample_bits; /* 16 or 32 */
+  size_t n_coeffs;
+  size_t decimation;
+  int32_t* coeffs; /* FIR taps reversed; biquad and LO as given */
+
+  /* Per-channel state: FIR history (n_coeffs - 1 samples) or biquad
+   * {x1, x2, y1, y2} per section */
+  int32_t* state;
+  int32_t* work; /* FIR history + one batch, widened to int32 */
+  size_t phase;  /* Decimation or LO phase, in frames */
+
+  /* Statistics */
+  uint64_t samples_saturated;
+} FixedDsp_t;
+
+Bp_EC fixed_dsp_init(FixedDsp_t* dsp, FixedDsp_config_t config);
+
+#endif /* BPIPE_FIXED_DSP_H */
@@ -0,0 +1,64 @@
+#ifndef BPIPE_FIXED_POINT_H
+#define BPIPE_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Fixed-point helpers shared by the integer DSP kernels.
+ *
+ * A Qm.n value is an integer v standing for v / 2^n. Products of a Q.a
+ * sample and a Q.b coefficient are accumulated in int64_t as Q.(a+b) and
+ * brought back to Q.a with fx_narrow(), which rounds half up and saturates
+ * to the sample width. Everything here is plain integer arithmetic with no
+ * implementation-defined shifts, so results are bit-exact on any host.
+ */
+
+/* floor(v / 2^shift), without relying on arithmetic right shift of
+ * negative values */
+static inline int64_t fx_floor_shift(int64_t v, unsigned shift)
+{
+  return v >= 0 ? v >> shift : ~(~v >> shift);
+}
+
+/* v / 2^shift rounded to nearest, halves towards +inf */
+static inline int64_t fx_round_shift(int64_t v, unsigned shift)
+{
+  if (shift == 0) return v;
+  return fx_floor_shift(v + ((int64_t) 1 << (shift - 1)), shift);
+}
+
+/* Clamp to the range of a signed `bits`-wide integer (bits <= 32) */
+static inline int32_t fx_saturate(int64_t v, unsigned bits)
+{
+  const int64_t hi = ((int64_t) 1 << (bits - 1)) - 1;
+  const int64_t lo = -hi - 1;
+  return (int32_t) (v > hi ? hi : (v < lo ? lo : v));
+}
+
+/* Accumulator in Q.(a + frac_bits) -> sample in Q.a, `bits` wide */
+static inline int32_t fx_narrow(int64_t acc, unsigned frac_bits,
+                                unsigned bits)
+{
+  return fx_saturate(fx_round_shift(acc, frac_bits), bits);
+}
+
+/* Real value -> Q.frac_bits, rounded and saturated to `bits` wide. For
+ * building coefficient tables; not meant for the sample path. */
+static inline int32_t fx_from_double(double v, unsigned frac_bits,
+                                     unsigned bits)
+{
+  double scaled = v * (double) ((int64_t) 1 << frac_bits);
+  const double hi = (double) (((int64_t) 1 << (bits - 1)) - 1);
+  const double lo = -hi - 1.0;
+  if (!(scaled < hi)) return (int32_t) hi; /* Also catches NaN */
+  if (scaled < lo) return (int32_t) lo;
+  scaled += 0.5;
+  int64_t r = (int64_t) scaled;
+  return (int32_t) (r > scaled ? r - 1 : r); /* floor */
+}
+
+static inline double fx_to_double(int32_t v, unsigned frac_bits)
+{
+  return (double) v / (double) ((int64_t) 1 << frac_bits);
+}
+
+#endif /* BPIPE_FIXED_POINT_H */
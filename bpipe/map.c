@@ -8,6 +8,14 @@
 
 // Map filter preserves most properties by default
 
+static inline Bp_EC map_apply(Map_filt_t* f, const void* in, void* out,
+                              size_t n_samples)
+{
+  if (!f->use_expr) return f->map_fcn(in, out, n_samples);
+  map_expr_eval(&f->expr, (const float*) in, (float*) out, n_samples);
+  return Bp_EC_OK;
+}
+
 void* map_worker(void* arg)
 {
   Map_filt_t* f = (Map_filt_t*) arg;
@@ -15,8 +23,11 @@ void* map_worker(void* arg)
   Bp_EC err = Bp_EC_OK;
 
   // Validate all configuration at once
-  if (!f->base.sinks[0] || !f->map_fcn ||
+  if (!f->base.sinks[0] || (!f->map_fcn && !f->use_expr) ||
+      (f->use_expr && f->base.input_buffers[0]->dtype != DTYPE_FLOAT) ||
       f->base.input_buffers[0]->dtype != f->base.sinks[0]->dtype ||
+      f->base.input_buffers[0]->n_channels != f->base.sinks[0]->n_channels ||
+      f->base.input_buffers[0]->layout != f->base.sinks[0]->layout ||
       f->base.input_buffers[0]->dtype == DTYPE_NDEF ||
       f->base.input_buffers[0]->dtype >= DTYPE_MAX) {
     f->base.worker_err_info.ec = Bp_EC_INVALID_CONFIG;
@@ -26,6 +37,13 @@ void* map_worker(void* arg)
   // Cache frequently used values
   const size_t data_width = bb_getdatawidth(f->base.input_buffers[0]->dtype);
   const size_t batch_size = bb_batch_size(f->base.sinks[0]);
+  // Interleaved frames are contiguous so every channel is mapped in a single
+  // call; planar batches need one call per channel plane.
+  const size_t n_channels = f->base.input_buffers[0]->n_channels;
+  const bool planar =
+      n_channels > 1 && f->base.input_buffers[0]->layout == BATCH_LAYOUT_PLANAR;
+  const size_t frame_width = data_width * (planar ? 1 : n_channels);
+  const size_t n_planes = planar ? n_channels : 1;
 
   // Main processing loop
   while (atomic_load(&f->base.running)) {
@@ -36,10 +54,18 @@ void* map_worker(void* arg)
         if (err != Bp_EC_OK) break;
       }
 
-      input = bb_get_tail(f->base.input_buffers[0], f->base.timeout_us, &err);
+      input = bb_get_tail(f->base.input_buffers[0], filt_wait_us(&f->base),
+                          &err);
       if (!input) {
         if (err == Bp_EC_TIMEOUT) {
-          continue;  // Normal timeout, keep waiting for data
+          // Normal timeout: ship a partial batch whose deadline has passed
+          if (output && filt_flush_due(&f->base, 0, output, false)) {
+            err = bb_submit(f->base.sinks[0], f->base.timeout_us);
+            if (err != Bp_EC_OK) break;
+            output = NULL;
+            f->base.metrics.n_batches++;
+          }
+          continue;  // Keep waiting for data
         }
         // STOPPED or other error - exit
         break;
@@ -63,8 +89,14 @@ void* map_worker(void* arg)
 
     size_t n = MIN(input->head - f->input_consumed, batch_size - output->head);
     if (n > 0) {
-      err = f->map_fcn((char*) input->data + f->input_consumed * data_width,
-                       (char*) output->data + output->head * data_width, n);
+      for (size_t p = 0; p < n_planes && err == Bp_EC_OK; p++) {
+        err = map_apply(
+            f, (char*) bb_channel_ptr(f->base.input_buffers[0], input, p) +
+                f->input_consumed * frame_width,
+            (char*) bb_channel_ptr(f->base.sinks[0], output, p) +
+                output->head * frame_width,
+            planar ? n : n * n_channels);
+      }
       if (err != Bp_EC_OK) break;
 
       f->input_consumed += n;
@@ -82,8 +114,10 @@ void* map_worker(void* arg)
       }
     }
 
-    // Submit output if batch is full
-    if (output->head >= batch_size) {
+    // Submit output if batch is full or the flush policy says so
+    if (output->head >= batch_size ||
+        filt_flush_due(&f->base, 0, output,
+                       f->input_consumed >= input->head)) {
       err = bb_submit(f->base.sinks[0], f->base.timeout_us);
       if (err != Bp_EC_OK) break;
       output = NULL;  // Force getting a new output batch
@@ -129,10 +163,11 @@ static Bp_EC map_describe(Filter_t* self, char* buffer, size_t buffer_size)
   snprintf(buffer, buffer_size,
            "Map Filter: %s\n"
            "  Input dtype: %d\n"
-           "  Map function: %p\n"
+           "  Map function: %p%s\n"
            "  Running: %s\n"
            "  Batches processed: %zu",
            self->name, self->input_buffers[0]->dtype, (void*) map->map_fcn,
+           map->use_expr ? " (compiled expression)" : "",
            self->running ? "true" : "false", self->metrics.n_batches);
 
   return Bp_EC_OK;
@@ -183,6 +218,10 @@ Bp_EC map_init(Map_filt_t* f, Map_config_t config)
   if (f == NULL) {
     return Bp_EC_INVALID_CONFIG;
   }
+  /* Maps work on numeric samples, not record streams */
+  if (config.buff_config.dtype == DTYPE_RECORD) {
+    return Bp_EC_INVALID_CONFIG;
+  }
 
   /* copy Batch Buffer config */
   core_config.buff_config = config.buff_config;
@@ -201,10 +240,24 @@ Bp_EC map_init(Map_filt_t* f, Map_config_t config)
   if (err != Bp_EC_OK) {
     return err;
   }
-  if (config.map_fcn == NULL) {
-    return Bp_EC_INVALID_CONFIG;
+  if ((config.map_fcn == NULL) == (config.expr == NULL)) {
+    filt_deinit(&f->base);
+    return Bp_EC_INVALID_CONFIG;  // Exactly one of map_fcn and expr
   }
   f->map_fcn = config.map_fcn;
+  f->use_expr = config.expr != NULL;
+  if (f->use_expr) {
+    if (config.buff_config.dtype != DTYPE_FLOAT) {
+      filt_deinit(&f->base);
+      return Bp_EC_INVALID_CONFIG;
+    }
+    err = map_expr_compile(&f->expr, config.expr, config.expr_params,
+                           MAP_EXPR_MAX_PARAMS, NULL);
+    if (err != Bp_EC_OK) {
+      filt_deinit(&f->base);
+      return err;
+    }
+  }
 
   // Initialize partial consumption tracking
   f->input_consumed = 0;
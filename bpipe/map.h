@@ -3,6 +3,7 @@
 
 #include "bperr.h"
 #include "core.h"
+#include "map_expr.h"
 #include "utils.h"
 
 typedef Bp_EC (*Map_fcn_t)(const void* in, void* out, size_t n_samples);
@@ -10,6 +11,8 @@ typedef Bp_EC (*Map_fcn_t)(const void* in, void* out, size_t n_samples);
 typedef struct _Map_filt_t {
   Filter_t base;
   Map_fcn_t map_fcn;
+  bool use_expr;   // Evaluate `expr` instead of calling map_fcn
+  MapExpr_t expr;  // Compiled program when the config gave an expression
 
   // Internal state for tracking partial batch consumption
   size_t input_consumed;  // Number of samples consumed from current input batch
@@ -21,6 +24,10 @@ typedef struct _Map_filt_config_t {
   const char* name;
   BatchBuffer_config buff_config;
   Map_fcn_t map_fcn;
+  // Alternative to map_fcn for float32 data, e.g. "clamp(a*x + b, -1, 1)".
+  // Compiled at map_init; see map_expr.h for the syntax.
+  const char* expr;
+  MapExprParam_t expr_params[MAP_EXPR_MAX_PARAMS];
   long timeout_us;
 } Map_config_t;
 
@@ -0,0 +1,591 @@
+#include "map_expr.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+#define MAX_NODES 64
+#define MAX_DEPTH 32
+#define REG_IN 0
+#define REG_OUT 1
+#define MX_PI 3.14159265358979323846
+
+typedef enum {
+  MX_MOV,
+  MX_NEG,
+  MX_ABS,
+  MX_SQRT,
+  MX_EXP,
+  MX_LOG,
+  MX_SIN,
+  MX_COS,
+  MX_TANH,
+  MX_FLOOR,
+  MX_ADD,
+  MX_SUB,
+  MX_MUL,
+  MX_DIV,
+  MX_POW,
+  MX_MIN,
+  MX_MAX,
+  MX_MULADD, /* a*b + c */
+  MX_MULSUB, /* a*b - c */
+  MX_CLAMP,  /* min(max(a, b), c) */
+} MxOp_e;
+
+static const struct {
+  const char* name;
+  MxOp_e op;
+  int arity;
+} functions[] = {
+    {"abs", MX_ABS, 1},     {"sqrt", MX_SQRT, 1},   {"exp", MX_EXP, 1},
+    {"log", MX_LOG, 1},     {"sin", MX_SIN, 1},     {"cos", MX_COS, 1},
+    {"tanh", MX_TANH, 1},   {"floor", MX_FLOOR, 1}, {"min", MX_MIN, 2},
+    {"max", MX_MAX, 2},     {"pow", MX_POW, 2},     {"clamp", MX_CLAMP, 3},
+};
+
+static inline float clampf(float v, float lo, float hi)
+{
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+/* Scalar semantics of every op, used for constant folding. Matches the
+ * loops in run_insn so folded and evaluated results agree bit for bit. */
+static float apply_scalar(MxOp_e op, float a, float b, float c)
+{
+  switch (op) {
+    case MX_MOV:
+      return a;
+    case MX_NEG:
+      return -a;
+    case MX_ABS:
+      return fabsf(a);
+    case MX_SQRT:
+      return sqrtf(a);
+    case MX_EXP:
+      return expf(a);
+    case MX_LOG:
+      return logf(a);
+    case MX_SIN:
+      return sinf(a);
+    case MX_COS:
+      return cosf(a);
+    case MX_TANH:
+      return tanhf(a);
+    case MX_FLOOR:
+      return floorf(a);
+    case MX_ADD:
+      return a + b;
+    case MX_SUB:
+      return a - b;
+    case MX_MUL:
+      return a * b;
+    case MX_DIV:
+      return a / b;
+    case MX_POW:
+      return powf(a, b);
+    case MX_MIN:
+      return fminf(a, b);
+    case MX_MAX:
+      return fmaxf(a, b);
+    case MX_MULADD:
+      return a * b + c;
+    case MX_MULSUB:
+      return a * b - c;
+    case MX_CLAMP:
+      return clampf(a, b, c);
+  }
+  return 0.0f;
+}
+
+/* -------------------------------------------------------------------------
+ * Parser: recursive descent into a node pool, folding as it goes
+ * ------------------------------------------------------------------------- */
+
+typedef enum { NODE_CONST, NODE_INPUT, NODE_OP } NodeKind_e;
+
+typedef struct {
+  NodeKind_e kind;
+  MxOp_e op;
+  int arity;
+  int child[3];
+  float value;
+} Node_t;
+
+typedef struct {
+  const char* text;
+  size_t pos;
+  const MapExprParam_t* params;
+  size_t n_params;
+  Node_t nodes[MAX_NODES];
+  int n_nodes;
+  int depth;
+  bool failed;
+} Parser_t;
+
+static int fail(Parser_t* p)
+{
+  p->failed = true;
+  return -1;
+}
+
+static void skip_space(Parser_t* p)
+{
+  while (isspace((unsigned char) p->text[p->pos])) p->pos++;
+}
+
+static bool accept(Parser_t* p, char c)
+{
+  skip_space(p);
+  if (p->text[p->pos] != c) return false;
+  p->pos++;
+  return true;
+}
+
+static int new_node(Parser_t* p, Node_t node)
+{
+  if (p->n_nodes >= MAX_NODES) return fail(p);
+  p->nodes[p->n_nodes] = node;
+  return p->n_nodes++;
+}
+
+static int new_const(Parser_t* p, float value)
+{
+  return new_node(p, (Node_t){.kind = NODE_CONST, .value = value});
+}
+
+static bool is_const(const Parser_t* p, int n, float value)
+{
+  return p->nodes[n].kind == NODE_CONST && p->nodes[n].value == value;
+}
+
+/* Builds an op node, folding constant subtrees and trivial identities */
+static int new_op(Parser_t* p, MxOp_e op, int arity, int a, int b, int c)
+{
+  if (p->failed) return -1;
+  int child[3] = {a, b, c};
+
+  bool all_const = true;
+  for (int i = 0; i < arity; i++) {
+    all_const &= p->nodes[child[i]].kind == NODE_CONST;
+  }
+  if (all_const) {
+    float v[3] = {0};
+    for (int i = 0; i < arity; i++) v[i] = p->nodes[child[i]].value;
+    return new_const(p, apply_scalar(op, v[0], v[1], v[2]));
+  }
+
+  switch (op) {
+    case MX_ADD:
+      if (is_const(p, a, 0.0f)) return b;
+      if (is_const(p, b, 0.0f)) return a;
+      break;
+    case MX_SUB:
+      if (is_const(p, b, 0.0f)) return a;
+      break;
+    case MX_MUL:
+      if (is_const(p, a, 1.0f)) return b;
+      if (is_const(p, b, 1.0f)) return a;
+      break;
+    case MX_DIV:
+      if (is_const(p, b, 1.0f)) return a;
+      break;
+    case MX_POW:
+      if (is_const(p, b, 1.0f)) return a;
+      if (is_const(p, b, 2.0f)) return new_op(p, MX_MUL, 2, a, a, -1);
+      break;
+    default:
+      break;
+  }
+
+  return new_node(p, (Node_t){.kind = NODE_OP,
+                              .op = op,
+                              .arity = arity,
+                              .child = {a, b, c}});
+}
+
+static int parse_expr(Parser_t* p);
+
+static int parse_call(Parser_t* p, const char* name, size_t len)
+{
+  for (size_t f = 0; f < sizeof(functions) / sizeof(functions[0]); f++) {
+    if (strlen(functions[f].name) != len ||
+        strncmp(functions[f].name, name, len) != 0) {
+      continue;
+    }
+    int args[3] = {-1, -1, -1};
+    for (int i = 0; i < functions[f].arity; i++) {
+      if (i > 0 && !accept(p, ',')) return fail(p);
+      args[i] = parse_expr(p);
+      if (p->failed) return -1;
+    }
+    if (!accept(p, ')')) return fail(p);
+    return new_op(p, functions[f].op, functions[f].arity, args[0], args[1],
+                  args[2]);
+  }
+  return fail(p);
+}
+
+static int parse_primary(Parser_t* p)
+{
+  skip_space(p);
+  const char* s = p->text + p->pos;
+
+  if (isdigit((unsigned char) *s) || *s == '.') {
+    char* end;
+    float value = strtof(s, &end);
+    if (end == s) return fail(p);
+    p->pos += (size_t) (end - s);
+    return new_const(p, value);
+  }
+
+  if (isalpha((unsigned char) *s) || *s == '_') {
+    size_t len = 0;
+    while (isalnum((unsigned char) s[len]) || s[len] == '_') len++;
+    p->pos += len;
+    if (accept(p, '(')) return parse_call(p, s, len);
+
+    if (len == 1 && s[0] == 'x') {
+      return new_node(p, (Node_t){.kind = NODE_INPUT});
+    }
+    if (len == 2 && strncmp(s, "pi", 2) == 0) {
+      return new_const(p, (float) MX_PI);
+    }
+    for (size_t i = 0; i < p->n_params && p->params[i].name; i++) {
+      if (strlen(p->params[i].name) == len &&
+          strncmp(p->params[i].name, s, len) == 0) {
+        return new_const(p, p->params[i].value);
+      }
+    }
+    p->pos -= len;
+    return fail(p);
+  }
+
+  if (accept(p, '(')) {
+    int n = parse_expr(p);
+    if (p->failed || !accept(p, ')')) return fail(p);
+    return n;
+  }
+  return fail(p);
+}
+
+static int parse_unary(Parser_t* p);
+
+/* Power binds tighter than unary minus and is right associative */
+static int parse_power(Parser_t* p)
+{
+  int base = parse_primary(p);
+  if (p->failed) return -1;
+  if (!accept(p, '^')) return base;
+  int expo = parse_unary(p);
+  return new_op(p, MX_POW, 2, base, expo, -1);
+}
+
+static int parse_unary(Parser_t* p)
+{
+  if (++p->depth > MAX_DEPTH) return fail(p);
+  int n;
+  if (accept(p, '-')) {
+    n = parse_unary(p);
+    n = new_op(p, MX_NEG, 1, n, -1, -1);
+  } else if (accept(p, '+')) {
+    n = parse_unary(p);
+  } else {
+    n = parse_power(p);
+  }
+  p->depth--;
+  return n;
+}
+
+static int parse_term(Parser_t* p)
+{
+  int n = parse_unary(p);
+  while (!p->failed) {
+    MxOp_e op;
+    if (accept(p, '*')) {
+      op = MX_MUL;
+    } else if (accept(p, '/')) {
+      op = MX_DIV;
+    } else {
+      break;
+    }
+    n = new_op(p, op, 2, n, parse_unary(p), -1);
+  }
+  return n;
+}
+
+static int parse_expr(Parser_t* p)
+{
+  if (++p->depth > MAX_DEPTH) return fail(p);
+  int n = parse_term(p);
+  while (!p->failed) {
+    MxOp_e op;
+    if (accept(p, '+')) {
+      op = MX_ADD;
+    } else if (accept(p, '-')) {
+      op = MX_SUB;
+    } else {
+      break;
+    }
+    n = new_op(p, op, 2, n, parse_term(p), -1);
+  }
+  p->depth--;
+  return n;
+}
+
+/* -------------------------------------------------------------------------
+ * Code generation
+ * ------------------------------------------------------------------------- */
+
+/* Scratch registers are allocated upwards from REG_OUT + 1 and constants
+ * downwards from the top, so a constant's broadcast (written once, here) can
+ * never land in a register an instruction also uses as scratch */
+typedef struct {
+  MapExpr_t* prog;
+  const Parser_t* p;
+  bool used[MAP_EXPR_MAX_REGS];
+  int scratch_top; /* One past the highest scratch register ever used */
+  int const_base;  /* Lowest constant register */
+  float const_value[MAP_EXPR_MAX_REGS];
+  bool failed;
+} Gen_t;
+
+static void update_n_regs(Gen_t* g)
+{
+  g->prog->n_regs =
+      (size_t) (g->scratch_top + (MAP_EXPR_MAX_REGS - g->const_base));
+}
+
+static int alloc_reg(Gen_t* g)
+{
+  for (int r = REG_OUT + 1; r < g->const_base; r++) {
+    if (!g->used[r]) {
+      g->used[r] = true;
+      g->scratch_top = MAX(g->scratch_top, r + 1);
+      update_n_regs(g);
+      return r;
+    }
+  }
+  g->failed = true;
+  return REG_OUT;
+}
+
+static void free_reg(Gen_t* g, int r)
+{
+  if (r > REG_OUT && r < g->const_base) g->used[r] = false;
+}
+
+/* Constants live in registers broadcast once here, shared by value */
+static int const_reg(Gen_t* g, float value)
+{
+  for (int r = g->const_base; r < MAP_EXPR_MAX_REGS; r++) {
+    if (memcmp(&g->const_value[r], &value, sizeof(float)) == 0) return r;
+  }
+  if (g->const_base - 1 < g->scratch_top) {
+    g->failed = true;
+    return REG_OUT;
+  }
+  int r = --g->const_base;
+  g->const_value[r] = value;
+  for (size_t i = 0; i < MAP_EXPR_CHUNK; i++) g->prog->regs[r][i] = value;
+  update_n_regs(g);
+  return r;
+}
+
+static void emit(Gen_t* g, MxOp_e op, int dst, int a, int b, int c)
+{
+  MapExpr_t* prog = g->prog;
+  if (prog->n_insns >= MAP_EXPR_MAX_INSNS) {
+    g->failed = true;
+    return;
+  }
+  prog->insns[prog->n_insns++] = (MapExprInsn_t){
+      .op = (unsigned char) op,
+      .dst = (unsigned char) dst,
+      .src = {(unsigned char) MAX(a, 0), (unsigned char) MAX(b, 0),
+              (unsigned char) MAX(c, 0)}};
+}
+
+static bool is_mul(const Parser_t* p, int n)
+{
+  return p->nodes[n].kind == NODE_OP && p->nodes[n].op == MX_MUL;
+}
+
+/* Evaluates node n, into `dst` if it is >= 0, and returns its register */
+static int gen(Gen_t* g, int n, int dst)
+{
+  const Node_t* node = &g->p->nodes[n];
+  if (node->kind != NODE_OP) {
+    int r = node->kind == NODE_INPUT ? REG_IN : const_reg(g, node->value);
+    if (dst < 0) return r;
+    emit(g, MX_MOV, dst, r, -1, -1);
+    return dst;
+  }
+
+  /* Fuse a*b + c, c + a*b and a*b - c */
+  MxOp_e op = node->op;
+  int args[3] = {node->child[0], node->child[1], node->child[2]};
+  int n_args = node->arity;
+  if (op == MX_ADD || op == MX_SUB) {
+    int mul = -1;
+    if (is_mul(g->p, args[0])) {
+      mul = 0;
+    } else if (op == MX_ADD && is_mul(g->p, args[1])) {
+      mul = 1;
+    }
+    if (mul >= 0) {
+      const Node_t* m = &g->p->nodes[args[mul]];
+      int addend = args[1 - mul];
+      op = op == MX_ADD ? MX_MULADD : MX_MULSUB;
+      args[0] = m->child[0];
+      args[1] = m->child[1];
+      args[2] = addend;
+      n_args = 3;
+    }
+  }
+
+  int regs[3] = {-1, -1, -1};
+  for (int i = 0; i < n_args; i++) {
+    /* Repeated subtrees (x^2 -> x*x) are evaluated once */
+    regs[i] = (i > 0 && args[i] == args[i - 1]) ? regs[i - 1]
+                                                  : gen(g, args[i], -1);
+  }
+  /* The destination never shares a register with a source, which lets the
+   * evaluation loops use restrict */
+  int d = dst >= 0 ? dst : alloc_reg(g);
+  for (int i = 0; i < n_args; i++) free_reg(g, regs[i]);
+  emit(g, op, d, regs[0], regs[1], regs[2]);
+  return d;
+}
+
+Bp_EC map_expr_compile(MapExpr_t* prog, const char* text,
+                       const MapExprParam_t* params, size_t n_params,
+                       size_t* err_pos)
+{
+  if (prog == NULL || text == NULL) return Bp_EC_NULL_POINTER;
+  if (n_params > 0 && params == NULL) return Bp_EC_NULL_POINTER;
+
+  Parser_t* p = calloc(1, sizeof(Parser_t));
+  if (p == NULL) return Bp_EC_MALLOC_FAIL;
+  p->text = text;
+  p->params = params;
+  p->n_params = n_params;
+
+  int root = parse_expr(p);
+  skip_space(p);
+  if (!p->failed && p->text[p->pos] != '\0') p->failed = true;
+  if (p->failed) {
+    if (err_pos) *err_pos = p->pos;
+    free(p);
+    return Bp_EC_INVALID_CONFIG;
+  }
+
+  memset(prog, 0, sizeof(*prog));
+  Gen_t g = {.prog = prog,
+             .p = p,
+             .scratch_top = REG_OUT + 1,
+             .const_base = MAP_EXPR_MAX_REGS};
+  update_n_regs(&g);
+  gen(&g, root, REG_OUT);
+  free(p);
+  if (g.failed) {
+    if (err_pos) *err_pos = 0;
+    return Bp_EC_INVALID_CONFIG;
+  }
+  return Bp_EC_OK;
+}
+
+/* -------------------------------------------------------------------------
+ * Evaluation
+ * ------------------------------------------------------------------------- */
+
+/* Always a whole chunk: the fixed trip count and restrict let the compiler
+ * vectorise each loop without runtime alias or remainder checks */
+#define LOOP(EXPR)                                          \
+  for (size_t i = 0; i < MAP_EXPR_CHUNK; i++) d[i] = EXPR; \
+  break
+
+static void run_insn(MxOp_e op, float* restrict d, const float* restrict a,
+                     const float* restrict b, const float* restrict c)
+{
+  switch (op) {
+    case MX_MOV:
+      memcpy(d, a, MAP_EXPR_CHUNK * sizeof(float));
+      break;
+    case MX_NEG:
+      LOOP(-a[i]);
+    case MX_ABS:
+      LOOP(fabsf(a[i]));
+    case MX_SQRT:
+      LOOP(sqrtf(a[i]));
+    case MX_EXP:
+      LOOP(expf(a[i]));
+    case MX_LOG:
+      LOOP(logf(a[i]));
+    case MX_SIN:
+      LOOP(sinf(a[i]));
+    case MX_COS:
+      LOOP(cosf(a[i]));
+    case MX_TANH:
+      LOOP(tanhf(a[i]));
+    case MX_FLOOR:
+      LOOP(floorf(a[i]));
+    case MX_ADD:
+      LOOP(a[i] + b[i]);
+    case MX_SUB:
+      LOOP(a[i] - b[i]);
+    case MX_MUL:
+      LOOP(a[i] * b[i]);
+    case MX_DIV:
+      LOOP(a[i] / b[i]);
+    case MX_POW:
+      LOOP(powf(a[i], b[i]));
+    case MX_MIN:
+      LOOP(fminf(a[i], b[i]));
+    case MX_MAX:
+      LOOP(fmaxf(a[i], b[i]));
+    case MX_MULADD:
+      LOOP(a[i] * b[i] + c[i]);
+    case MX_MULSUB:
+      LOOP(a[i] * b[i] - c[i]);
+    case MX_CLAMP:
+      LOOP(clampf(a[i], b[i], c[i]));
+  }
+}
+
+#undef LOOP
+
+void map_expr_eval(MapExpr_t* prog, const float* in, float* out, size_t n)
+{
+  float* r[MAP_EXPR_MAX_REGS];
+  for (size_t k = REG_OUT + 1; k < MAP_EXPR_MAX_REGS; k++) {
+    r[k] = prog->regs[k];
+  }
+
+  /* A partial last chunk, and the input when evaluating in place, go
+   * through the staging registers so every instruction sees a whole,
+   * non-overlapping chunk */
+  float* stage_in = prog->regs[REG_IN];
+  float* stage_out = prog->regs[REG_OUT];
+  for (size_t off = 0; off < n; off += MAP_EXPR_CHUNK) {
+    size_t m = MIN((size_t) MAP_EXPR_CHUNK, n - off);
+    bool partial = m < MAP_EXPR_CHUNK;
+    if (partial || in == out) {
+      memcpy(stage_in, in + off, m * sizeof(float));
+      memset(stage_in + m, 0, (MAP_EXPR_CHUNK - m) * sizeof(float));
+      r[REG_IN] = stage_in;
+    } else {
+      r[REG_IN] = (float*) in + off;
+    }
+    r[REG_OUT] = partial ? stage_out : out + off;
+
+    for (size_t k = 0; k < prog->n_insns; k++) {
+      const MapExprInsn_t* insn = &prog->insns[k];
+      run_insn((MxOp_e) insn->op, r[insn->dst], r[insn->src[0]],
+               r[insn->src[1]], r[insn->src[2]]);
+    }
+    if (partial) memcpy(out + off, stage_out, m * sizeof(float));
+  }
+}
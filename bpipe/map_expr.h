@@ -0,0 +1,58 @@
+#ifndef BPIPE_MAP_EXPR_H
+#define BPIPE_MAP_EXPR_H
+
+#include <stddef.h>
+#include "bperr.h"
+
+/* Arithmetic expressions for the map filter.
+ *
+ * An expression such as "clamp(a*x + b, -1, 1)" is parsed once, constant
+ * folded and compiled to a short register program. Evaluation runs the
+ * program over MAP_EXPR_CHUNK samples at a time, so each instruction is a
+ * tight loop over a chunk rather than a call per sample.
+ *
+ * Grammar: numbers, `x` (the input sample), named parameters, `pi`,
+ * + - * / ^ (power), unary minus, parentheses and the functions
+ * abs sqrt exp log sin cos tanh floor (1 arg), min max pow (2 args) and
+ * clamp(v, lo, hi). Parameters are fixed at compile time and fold into
+ * constants. Samples are float32.
+ */
+
+#define MAP_EXPR_CHUNK 128  /* Samples per register */
+#define MAP_EXPR_MAX_REGS 16  /* Including the input and output registers */
+#define MAP_EXPR_MAX_INSNS 32
+#define MAP_EXPR_MAX_PARAMS 8
+
+typedef struct _MapExprParam {
+  const char* name; /* NULL terminates the list */
+  float value;
+} MapExprParam_t;
+
+typedef struct _MapExprInsn {
+  unsigned char op;
+  unsigned char dst;
+  unsigned char src[3];
+} MapExprInsn_t;
+
+typedef struct _MapExpr {
+  MapExprInsn_t insns[MAP_EXPR_MAX_INSNS];
+  size_t n_insns;
+  size_t n_regs;
+  /* Scratch and constant registers; constants are broadcast at compile
+   * time. Registers 0 and 1 stage partial or in-place chunks. */
+  float regs[MAP_EXPR_MAX_REGS][MAP_EXPR_CHUNK];
+} MapExpr_t;
+
+/* Compile `text` with up to n_params parameters (a NULL name ends the list
+ * early). Returns Bp_EC_INVALID_CONFIG on a syntax error, an unknown name or
+ * a program that does not fit the limits above; if `err_pos` is given it
+ * receives the offset where parsing failed. */
+Bp_EC map_expr_compile(MapExpr_t* prog, const char* text,
+                       const MapExprParam_t* params, size_t n_params,
+                       size_t* err_pos);
+
+/* out[i] = f(in[i]) for n samples. in and out may be the same array but
+ * must not otherwise overlap. */
+void map_expr_eval(MapExpr_t* prog, const float* in, float* out, size_t n);
+
+#endif /* BPIPE_MAP_EXPR_H */
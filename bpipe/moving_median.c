@@ -0,0 +1,389 @@
+#include "moving_median.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+#define MEDIAN_CHUNK 64
+
+/* One channel's window. Heap path: slot s of the ring holds data[s] and
+ * sits at heap position pos[s]; heap[i] is the slot at position i. heap
+ * points at the middle of its storage: position 0 is the median, 1..half
+ * a min-heap of larger values (children of i at 2i, 2i + 1) and
+ * -1..-half a max-heap of smaller ones (children at 2i, 2i - 1).
+ * Network path: only hist, the last window - 1 samples, is used. */
+typedef struct _MedianChannel {
+  float* data;
+  int32_t* pos;
+  int32_t* heap;
+  size_t oldest; /* Ring slot to overwrite next */
+  float* hist;
+} MedianChannel_t;
+
+static inline bool mm_less(const MedianChannel_t* c, int i, int j)
+{
+  return c->data[c->heap[i]] < c->data[c->heap[j]];
+}
+
+/* Swap heap positions i and j if heap[i] < heap[j] */
+static inline bool mm_cmp_exch(MedianChannel_t* c, int i, int j)
+{
+  if (!mm_less(c, i, j)) return false;
+  int32_t t = c->heap[i];
+  c->heap[i] = c->heap[j];
+  c->heap[j] = t;
+  c->pos[c->heap[i]] = i;
+  c->pos[c->heap[j]] = j;
+  return true;
+}
+
+/* Sift down the min-heap starting with the child at position i */
+static void mm_min_down(MedianChannel_t* c, int i, int half)
+{
+  for (; i <= half; i *= 2) {
+    if (i > 1 && i < half && mm_less(c, i + 1, i)) i++;
+    if (!mm_cmp_exch(c, i, i / 2)) break;
+  }
+}
+
+static void mm_max_down(MedianChannel_t* c, int i, int half)
+{
+  for (; i >= -half; i *= 2) {
+    if (i < -1 && i > -half && mm_less(c, i, i - 1)) i--;
+    if (!mm_cmp_exch(c, i / 2, i)) break;
+  }
+}
+
+/* Sift up towards the median; true if it reached position 0 */
+static inline bool mm_min_up(MedianChannel_t* c, int i)
+{
+  while (i > 0 && mm_cmp_exch(c, i, i / 2)) i /= 2;
+  return i == 0;
+}
+
+static inline bool mm_max_up(MedianChannel_t* c, int i)
+{
+  while (i < 0 && mm_cmp_exch(c, i / 2, i)) i /= 2;
+  return i == 0;
+}
+
+/* Replace the oldest sample with v and return the new median */
+static inline float mm_push(MedianChannel_t* c, float v, size_t window)
+{
+  const int half = (int) (window / 2);
+  size_t s = c->oldest;
+  int p = c->pos[s];
+  float old = c->data[s];
+  c->data[s] = v;
+  c->oldest = s + 1 < window ? s + 1 : 0;
+
+  if (p > 0) {
+    if (old < v) {
+      mm_min_down(c, p * 2, half);
+    } else if (mm_min_up(c, p)) {
+      mm_max_down(c, -1, half);
+    }
+  } else if (p < 0) {
+    if (v < old) {
+      mm_max_down(c, p * 2, half);
+    } else if (mm_max_up(c, p)) {
+      mm_min_down(c, 1, half);
+    }
+  } else {
+    mm_max_down(c, -1, half);
+    mm_min_down(c, 1, half);
+  }
+  return c->data[c->heap[0]];
+}
+
+/* Fill the window with v; any arrangement of equal values is in order */
+static void mm_prime(MedianChannel_t* c, float v, size_t window)
+{
+  const int32_t half = (int32_t) (window / 2);
+  if (c->hist) {
+    for (size_t i = 0; i + 1 < window; i++) c->hist[i] = v;
+    return;
+  }
+  for (size_t s = 0; s < window; s++) {
+    c->data[s] = v;
+    c->pos[s] = (int32_t) s - half;
+    c->heap[(int32_t) s - half] = (int32_t) s;
+  }
+  c->oldest = 0;
+}
+
+/* Fixed trip count so the compiler vectorises it; lanes past the end of
+ * a partial chunk hold stale values and are ignored */
+static inline void net_ce(float* restrict a, float* restrict b)
+{
+  for (size_t i = 0; i < MEDIAN_CHUNK; i++) {
+    float lo = a[i] < b[i] ? a[i] : b[i];
+    float hi = a[i] < b[i] ? b[i] : a[i];
+    a[i] = lo;
+    b[i] = hi;
+  }
+}
+
+/* y[k] = median(x[k .. k + window - 1]) for k < n. Each window position
+ * becomes a row of a chunk; odd-even transposition sorts every column at
+ * once and the middle row is the median. */
+static void net_median(const float* x, float* y, size_t n, size_t window)
+{
+  float t[MOVING_MEDIAN_NET_MAX][MEDIAN_CHUNK] = {{0}};
+  for (size_t base = 0; base < n; base += MEDIAN_CHUNK) {
+    size_t m = MIN((size_t) MEDIAN_CHUNK, n - base);
+    for (size_t j = 0; j < window; j++) {
+      memcpy(t[j], x + base + j, m * sizeof(float));
+    }
+    for (size_t round = 0; round < window; round++) {
+      for (size_t j = round & 1; j + 1 < window; j += 2) {
+        net_ce(t[j], t[j + 1]);
+      }
+    }
+    memcpy(y + base, t[window / 2], m * sizeof(float));
+  }
+}
+
+static void moving_median_process(MovingMedian_t* mm,
+                                  const Batch_buff_t* in_buf,
+                                  const Batch_t* input,
+                                  const Batch_buff_t* out_buf,
+                                  Batch_t* output)
+{
+  const size_t n_channels = in_buf->n_channels;
+  const size_t stride =
+      in_buf->layout == BATCH_LAYOUT_PLANAR ? 1 : n_channels;
+  const size_t n = input->head;
+  const size_t w = mm->window;
+
+  for (size_t ch = 0; ch < n_channels; ch++) {
+    MedianChannel_t* c = &mm->channels[ch];
+    const float* x = (const float*) bb_channel_ptr(in_buf, input, ch);
+    float* y = (float*) bb_channel_ptr(out_buf, output, ch);
+    if (!mm->primed) mm_prime(c, x[0], w);
+
+    if (mm->use_network) {
+      /* Stage history + batch contiguously, median into the spare half */
+      float* lin = mm->work;
+      float* med = lin + (w - 1) + n;
+      memcpy(lin, c->hist, (w - 1) * sizeof(float));
+      for (size_t k = 0; k < n; k++) lin[w - 1 + k] = x[k * stride];
+      net_median(lin, med, n, w);
+      memcpy(c->hist, lin + n, (w - 1) * sizeof(float));
+      for (size_t k = 0; k < n; k++) y[k * stride] = med[k];
+    } else {
+      for (size_t k = 0; k < n; k++) {
+        y[k * stride] = mm_push(c, x[k * stride], w);
+      }
+    }
+  }
+  mm->primed = true;
+}
+
+static void* moving_median_worker(void* arg)
+{
+  MovingMedian_t* mm = (MovingMedian_t*) arg;
+  Filter_t* f = &mm->base;
+  Batch_buff_t* in_buf = f->input_buffers[0];
+  Batch_buff_t* out_buf = f->sinks[0];
+  Bp_EC err = Bp_EC_OK;
+
+  BP_WORKER_ASSERT(f, out_buf != NULL, Bp_EC_NO_SINK);
+  BP_WORKER_ASSERT(f,
+                   out_buf->n_channels == in_buf->n_channels &&
+                       out_buf->layout == in_buf->layout &&
+                       out_buf->batch_capacity_expo >=
+                           in_buf->batch_capacity_expo,
+                   Bp_EC_INVALID_CONFIG);
+
+  while (atomic_load(&f->running)) {
+    Batch_t* input = bb_get_tail(in_buf, f->timeout_us, &err);
+    if (!input) {
+      if (err == Bp_EC_TIMEOUT) continue;
+      break;
+    }
+
+    if (input->ec == Bp_EC_COMPLETE) {
+      filt_send_complete(f, out_buf);
+      bb_del_tail(in_buf);
+      break;
+    }
+    BP_WORKER_ASSERT(f, input->ec == Bp_EC_OK, input->ec);
+    Batch_t* output = bb_get_head(out_buf);
+    BP_WORKER_ASSERT(f, !bb_batch_has_ts(input) || output->ts != NULL,
+                     Bp_EC_INVALID_CONFIG);
+
+    output->batch_id = input->batch_id;
+    output->t_ns = input->t_ns;
+    output->period_ns = input->period_ns;
+    output->ec = Bp_EC_OK;
+    output->head = input->head;
+    if (bb_batch_has_ts(input)) {
+      memcpy(output->ts, input->ts, input->head * sizeof(long long));
+    }
+    if (input->head > 0) {
+      moving_median_process(mm, in_buf, input, out_buf, output);
+    }
+
+    err = bb_submit(out_buf, f->timeout_us);
+    if (err != Bp_EC_OK) break;
+    bb_del_tail(in_buf);
+
+    f->metrics.samples_processed += input->head;
+    f->metrics.n_batches++;
+  }
+
+  BP_WORKER_ASSERT(f, BP_WORKER_CLEAN_EXIT(err), err);
+  return NULL;
+}
+
+static Bp_EC moving_median_describe(Filter_t* self, char* buffer, size_t size)
+{
+  MovingMedian_t* mm = (MovingMedian_t*) self;
+  if (buffer == NULL) return Bp_EC_NULL_POINTER;
+
+  snprintf(buffer, size,
+           "MovingMedian: %s\n"
+           "  Window: %zu samples (%s)",
+           self->name, mm->window,
+           mm->use_network ? "sorting network" : "two heaps");
+  return Bp_EC_OK;
+}
+
+static void moving_median_free(MovingMedian_t* mm)
+{
+  free(mm->channels);
+  free(mm->work);
+  mm->channels = NULL;
+  mm->work = NULL;
+}
+
+static Bp_EC moving_median_deinit(Filter_t* self)
+{
+  moving_median_free((MovingMedian_t*) self);
+
+  filt_release_inputs(self);
+  return Bp_EC_OK;
+}
+
+/* Bytes of one channel's state: the network path needs only the history,
+ * the heap path the ring, positions and heap */
+static size_t moving_median_state_size(const MovingMedian_t* mm)
+{
+  const size_t w = mm->window;
+  return mm->use_network ? (w - 1) * sizeof(float)
+                         : w * (sizeof(float) + 2 * sizeof(int32_t));
+}
+
+/* Checkpoint: the channel states hold only values and relative indices, so
+ * the block after the channel headers is saved as is */
+static Bp_EC moving_median_checkpoint(Filter_t* self, Checkpoint_t* ck)
+{
+  MovingMedian_t* mm = (MovingMedian_t*) self;
+  const size_t n_channels = self->input_buffers[0]->n_channels;
+  Bp_EC err = CKPT_PUT(ck, mm->primed);
+  for (size_t ch = 0; ch < n_channels && err == Bp_EC_OK; ch++) {
+    uint64_t oldest = mm->channels[ch].oldest;
+    err = CKPT_PUT(ck, oldest);
+  }
+  if (err != Bp_EC_OK) return err;
+  return ckpt_write(ck, mm->channels + n_channels,
+                    n_channels * moving_median_state_size(mm));
+}
+
+static Bp_EC moving_median_restore(Filter_t* self, Checkpoint_t* ck)
+{
+  MovingMedian_t* mm = (MovingMedian_t*) self;
+  const size_t n_channels = self->input_buffers[0]->n_channels;
+  Bp_EC err = CKPT_GET(ck, mm->primed);
+  for (size_t ch = 0; ch < n_channels && err == Bp_EC_OK; ch++) {
+    uint64_t oldest;
+    err = CKPT_GET(ck, oldest);
+    if (err == Bp_EC_OK && oldest >= mm->window) err = Bp_EC_INVALID_DATA;
+    if (err == Bp_EC_OK) mm->channels[ch].oldest = (size_t) oldest;
+  }
+  if (err != Bp_EC_OK) return err;
+  return ckpt_read(ck, mm->channels + n_channels,
+                   n_channels * moving_median_state_size(mm));
+}
+
+/* Channel headers and every channel's state in one block */
+static Bp_EC moving_median_alloc(MovingMedian_t* mm, size_t n_channels,
+                                 size_t capacity)
+{
+  const size_t w = mm->window;
+  const size_t per_ch = moving_median_state_size(mm);
+  char* block = calloc(1, n_channels * (sizeof(MedianChannel_t) + per_ch));
+  if (block == NULL) return Bp_EC_MALLOC_FAIL;
+  mm->channels = (MedianChannel_t*) block;
+  if (mm->use_network) {
+    mm->work = malloc(((w - 1) + 2 * capacity) * sizeof(float));
+    if (mm->work == NULL) {
+      moving_median_free(mm);
+      return Bp_EC_MALLOC_FAIL;
+    }
+  }
+
+  char* state = block + n_channels * sizeof(MedianChannel_t);
+  for (size_t ch = 0; ch < n_channels; ch++) {
+    MedianChannel_t* c = &mm->channels[ch];
+    char* p = state + ch * per_ch;
+    if (mm->use_network) {
+      c->hist = (float*) p;
+    } else {
+      c->data = (float*) p;
+      c->pos = (int32_t*) (c->data + w);
+      c->heap = c->pos + w + w / 2;
+    }
+  }
+  return Bp_EC_OK;
+}
+
+Bp_EC moving_median_init(MovingMedian_t* mm, MovingMedian_config_t config)
+{
+  if (mm == NULL) return Bp_EC_NULL_FILTER;
+  if (config.buff_config.dtype != DTYPE_FLOAT) return Bp_EC_INVALID_CONFIG;
+  if (config.window < 3 || config.window > MOVING_MEDIAN_MAX_WINDOW ||
+      config.window % 2 == 0) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+
+  Core_filt_config_t core_config = {
+      .name = config.name,
+      .filt_type = FILT_T_MOVING_MEDIAN,
+      .size = sizeof(MovingMedian_t),
+      .n_inputs = 1,
+      .max_supported_sinks = 1,
+      .buff_config = config.buff_config,
+      .timeout_us = config.timeout_us > 0 ? config.timeout_us : 1000000,
+      .worker = moving_median_worker};
+
+  Bp_EC err = filt_init(&mm->base, core_config);
+  if (err != Bp_EC_OK) return err;
+
+  mm->window = config.window;
+  mm->use_network = config.window <= MOVING_MEDIAN_NET_MAX;
+  mm->primed = false;
+  mm->channels = NULL;
+  mm->work = NULL;
+  err = moving_median_alloc(
+      mm, MAX(config.buff_config.n_channels, 1),
+      (size_t) 1 << config.buff_config.batch_capacity_expo);
+  if (err != Bp_EC_OK) {
+    filt_deinit(&mm->base);
+    return err;
+  }
+
+  mm->base.ops.describe = moving_median_describe;
+  mm->base.ops.deinit = moving_median_deinit;
+  mm->base.ops.checkpoint = moving_median_checkpoint;
+  mm->base.ops.restore = moving_median_restore;
+
+  prop_constraints_from_buffer_append(&mm->base, &config.buff_config, true);
+  prop_append_behavior(&mm->base, PROP_SAMPLE_PERIOD_NS, BEHAVIOR_OP_PRESERVE,
+                       NULL, OUTPUT_ALL);
+  mm->base.output_properties[0] =
+      prop_propagate(NULL, 0, &mm->base.contract, 0);
+
+  return Bp_EC_OK;
+}
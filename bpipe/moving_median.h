@@ -0,0 +1,53 @@
+#ifndef BPIPE_MOVING_MEDIAN_H
+#define BPIPE_MOVING_MEDIAN_H
+
+#include "batch_buffer.h"
+#include "core.h"
+
+/* MovingMedian: running median over the last `window` samples, per
+ * channel, for despiking.
+ *
+ * DTYPE_FLOAT in and out, batch for batch with the input's timing. Output
+ * k is the median of inputs k - window + 1 .. k, so it lags the input by
+ * (window - 1) / 2 samples. The window starts out filled with each
+ * channel's first sample, and carries over between batches.
+ *
+ * Windows above MOVING_MEDIAN_NET_MAX use a two-heap structure (a max-heap
+ * below the median and a min-heap above it, sharing one array centred on
+ * the median) plus a ring of window slots that records where each sample
+ * sits in the heaps. Each new sample overwrites the oldest in place and is
+ * sifted back into order: O(log window) per sample.
+ *
+ * Smaller windows go through a branch-free sorting network applied to a
+ * chunk of outputs at a time, one compare-exchange across the whole chunk
+ * per step, which the compiler vectorises.
+ *
+ * NaN inputs do not order against other values; replace them upstream.
+ */
+
+#define MOVING_MEDIAN_NET_MAX 9
+#define MOVING_MEDIAN_MAX_WINDOW 65535
+
+typedef struct _MovingMedian_config_t {
+  const char* name;
+  BatchBuffer_config buff_config; /* dtype FLOAT */
+  size_t window;                  /* Odd, 3..MOVING_MEDIAN_MAX_WINDOW */
+  long timeout_us;
+} MovingMedian_config_t;
+
+/* Per-channel state, private to the filter */
+struct _MedianChannel;
+
+typedef struct _MovingMedian_t {
+  Filter_t base;
+
+  size_t window;
+  bool use_network; /* window <= MOVING_MEDIAN_NET_MAX */
+  bool primed;      /* Windows filled from the first samples */
+  struct _MedianChannel* channels;
+  float* work; /* Network path: window - 1 history + one batch */
+} MovingMedian_t;
+
+Bp_EC moving_median_init(MovingMedian_t* mm, MovingMedian_config_t config);
+
+#endif /* BPIPE_MOVING_MEDIAN_H */
@@ -50,12 +50,14 @@ static void* passthrough_worker(void* arg)
     output->ec = input->ec;
     output->head = input->head;
 
-    // Get data type and size
-    size_t data_width = bb_getdatawidth(pt->base.input_buffers[0]->dtype);
     size_t n_samples = input->head;
 
-    // Copy data
-    memcpy(output->data, input->data, n_samples * data_width);
+    // Move data (all channels): swap storage if the rings match, else copy
+    if (bb_swap_data(pt->base.input_buffers[0], input, pt->base.sinks[0],
+                     output) != Bp_EC_OK) {
+      bb_copy_frames(pt->base.sinks[0], output, 0, pt->base.input_buffers[0],
+                     input, 0, n_samples);
+    }
 
     // Submit output and delete input
     err = bb_submit(pt->base.sinks[0], pt->base.timeout_us);
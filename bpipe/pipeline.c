@@ -10,7 +10,10 @@ static Bp_EC pipeline_deinit(Filter_t* self);
 static Bp_EC pipeline_sink_connect(Filter_t* self, size_t output_port,
                                    Batch_buff_t* sink);
 static Bp_EC pipeline_describe(Filter_t* self, char* buffer, size_t size);
+static Bp_EC pipeline_checkpoint(Filter_t* self, Checkpoint_t* ck);
+static Bp_EC pipeline_restore(Filter_t* self, Checkpoint_t* ck);
 static bool pipeline_contains_filter(Pipeline_t* pipe, Filter_t* filter);
+static Bp_EC pipeline_build_arena(Pipeline_t* pipe, bool huge_pages);
 static void* pipeline_worker(void* arg);
 
 Bp_EC pipeline_init(Pipeline_t* pipe, Pipeline_config_t config)
@@ -125,13 +128,85 @@ Bp_EC pipeline_init(Pipeline_t* pipe, Pipeline_config_t config)
   pipe->base.ops.deinit = pipeline_deinit;
   pipe->base.ops.sink_connect = pipeline_sink_connect;
   pipe->base.ops.describe = pipeline_describe;
+  pipe->base.ops.checkpoint = pipeline_checkpoint;
+  pipe->base.ops.restore = pipeline_restore;
 
   /* Set worker to NULL - pipeline doesn't need its own worker thread */
   pipe->base.worker = NULL;
 
+  /* Filters are initialised (and their rings allocated) before the pipeline
+   * exists, so placement into the arena happens here by relocation. */
+  memset(&pipe->arena, 0, sizeof(pipe->arena));
+  if (config.use_arena) {
+    err = pipeline_build_arena(pipe, config.arena_huge_pages);
+    if (err != Bp_EC_OK) {
+      filt_deinit(&pipe->base); /* Runs pipeline_deinit */
+      return err;
+    }
+  }
+
   return Bp_EC_OK;
 }
 
+/* Ring buffers eligible for relocation: inputs of non-pipeline members that
+ * still own their heap storage. Nested pipelines keep their own arenas. */
+static bool pipeline_arena_candidate(const Filter_t* f, size_t i)
+{
+  Batch_buff_t* buf = f->input_buffers[i];
+  return f->filt_type != FILT_T_PIPELINE && buf && buf->batch_ring &&
+         buf->owns_storage;
+}
+
+/* Undo a partial pipeline_build_arena: move the rings that made it into the
+ * arena back onto the heap, then unmap it. A ring that cannot be moved back
+ * still points into the arena, which is then left mapped (and leaked) rather
+ * than pulled out from under the filter. */
+static void pipeline_unwind_arena(Pipeline_t* pipe)
+{
+  bool all_moved = true;
+  for (size_t i = 0; i < pipe->n_filters; i++) {
+    Filter_t* f = pipe->filters[i];
+    for (int j = 0; j < f->n_input_buffers; j++) {
+      Batch_buff_t* buf = f->input_buffers[j];
+      if (!buf || !arena_contains(&pipe->arena, buf->batch_ring)) continue;
+      all_moved &= bb_release_storage(buf) == Bp_EC_OK;
+    }
+  }
+  if (all_moved) arena_deinit(&pipe->arena);
+  memset(&pipe->arena, 0, sizeof(pipe->arena));
+}
+
+static Bp_EC pipeline_build_arena(Pipeline_t* pipe, bool huge_pages)
+{
+  /* Size everything first so a failure leaves every ring untouched */
+  size_t total = 0;
+  for (size_t i = 0; i < pipe->n_filters; i++) {
+    Filter_t* f = pipe->filters[i];
+    for (int j = 0; j < f->n_input_buffers; j++) {
+      if (!pipeline_arena_candidate(f, j)) continue;
+      if (!bb_isempy(f->input_buffers[j])) return Bp_EC_INVALID_CONFIG;
+      total += arena_align_up(bb_storage_size(f->input_buffers[j]), ARENA_ALIGN);
+    }
+  }
+  if (total == 0) return Bp_EC_OK;
+
+  Bp_EC err = arena_init(&pipe->arena, total, huge_pages);
+  if (err != Bp_EC_OK) return err;
+
+  for (size_t i = 0; i < pipe->n_filters && err == Bp_EC_OK; i++) {
+    Filter_t* f = pipe->filters[i];
+    for (int j = 0; j < f->n_input_buffers && err == Bp_EC_OK; j++) {
+      if (!pipeline_arena_candidate(f, j)) continue;
+      size_t need = bb_storage_size(f->input_buffers[j]);
+      void* mem = arena_alloc(&pipe->arena, need, ARENA_ALIGN);
+      err = mem ? bb_adopt_storage(f->input_buffers[j], mem, need)
+                : Bp_EC_NO_SPACE;
+    }
+  }
+  if (err != Bp_EC_OK) pipeline_unwind_arena(pipe);
+  return err;
+}
+
 /* Helper function to validate filter is in pipeline */
 static bool pipeline_contains_filter(Pipeline_t* pipe, Filter_t* filter)
 {
@@ -187,6 +262,48 @@ static Bp_EC pipeline_stop(Filter_t* self)
   return Bp_EC_OK;
 }
 
+/* The whole graph in one go: every member must be stopped, so all of them
+ * are captured at the same batch boundary */
+static Bp_EC pipeline_checkpoint(Filter_t* self, Checkpoint_t* ck)
+{
+  Pipeline_t* pipe = (Pipeline_t*) self;
+
+  for (size_t i = 0; i < pipe->n_filters; i++) {
+    if (atomic_load(&pipe->filters[i]->running)) return Bp_EC_ALREADY_RUNNING;
+  }
+
+  uint64_t n_filters = pipe->n_filters;
+  Bp_EC err = CKPT_PUT(ck, n_filters);
+  for (size_t i = 0; i < pipe->n_filters && err == Bp_EC_OK; i++) {
+    err = filt_checkpoint(pipe->filters[i], ck);
+  }
+  return err;
+}
+
+/* Every record is checked against its member before any state is touched,
+ * so a checkpoint of a different graph leaves the pipeline as it was */
+static Bp_EC pipeline_restore(Filter_t* self, Checkpoint_t* ck)
+{
+  Pipeline_t* pipe = (Pipeline_t*) self;
+
+  uint64_t n_filters;
+  Bp_EC err = CKPT_GET(ck, n_filters);
+  if (err != Bp_EC_OK) return err;
+  if (n_filters != pipe->n_filters) return Bp_EC_INVALID_DATA;
+
+  size_t start = ck->pos;
+  for (size_t i = 0; i < pipe->n_filters && err == Bp_EC_OK; i++) {
+    err = filt_skip_record(pipe->filters[i], ck);
+  }
+  if (err != Bp_EC_OK) return err;
+
+  ck->pos = start;
+  for (size_t i = 0; i < pipe->n_filters && err == Bp_EC_OK; i++) {
+    err = filt_restore(pipe->filters[i], ck);
+  }
+  return err;
+}
+
 static Bp_EC pipeline_sink_connect(Filter_t* self, size_t output_port,
                                    Batch_buff_t* sink)
 {
@@ -220,6 +337,10 @@ static Bp_EC pipeline_deinit(Filter_t* self)
    * The buffer is shared with input_filter and will be freed there */
   pipe->base.input_buffers[0] = NULL;
 
+  /* Member rings placed in the arena go with it; the filters' own deinit
+   * skips storage it does not own. Members must be stopped by now. */
+  arena_deinit(&pipe->arena);
+
   /* Base filter cleanup is handled by caller (filt_deinit) */
   return Bp_EC_OK;
 }
@@ -255,6 +376,51 @@ static Bp_EC pipeline_describe(Filter_t* self, char* buffer, size_t size)
   return Bp_EC_OK;
 }
 
+Bp_EC pipeline_memory_report(const Pipeline_t* pipe, char* buffer,
+                             size_t size)
+{
+  if (!pipe || !buffer || size == 0) return Bp_EC_NULL_POINTER;
+
+  size_t written = snprintf(buffer, size, "Pipeline '%s' ring memory:\n",
+                            pipe->base.name);
+  size_t total = 0;
+  size_t in_arena = 0;
+  size_t n_rings = 0;
+
+  for (size_t i = 0; i < pipe->n_filters; i++) {
+    Filter_t* f = pipe->filters[i];
+    if (f->filt_type == FILT_T_PIPELINE) continue;
+    for (int j = 0; j < f->n_input_buffers; j++) {
+      Batch_buff_t* buf = f->input_buffers[j];
+      if (!buf || !buf->batch_ring) continue;
+      size_t bytes = bb_storage_size(buf);
+      bool arena = arena_contains(&pipe->arena, buf->batch_ring);
+      total += bytes;
+      in_arena += arena ? bytes : 0;
+      n_rings++;
+      if (written < size) {
+        written += snprintf(buffer + written, size - written,
+                            "  %s.input[%d]: %lu x %lu B slots, %zu B (%s)\n",
+                            f->name, j, bb_n_batches(buf), bb_batch_bytes(buf),
+                            bytes, arena ? "arena" : "heap");
+      }
+    }
+  }
+
+  if (written < size) {
+    written += snprintf(buffer + written, size - written,
+                        "  total: %zu rings, %zu B (%zu B in arena)\n",
+                        n_rings, total, in_arena);
+  }
+  if (written < size && pipe->arena.base) {
+    snprintf(buffer + written, size - written,
+             "  arena: %zu / %zu B used, %s pages\n", pipe->arena.used,
+             pipe->arena.size, pipe->arena.huge_pages ? "huge" : "4k/THP");
+  }
+
+  return Bp_EC_OK;
+}
+
 /* Dummy worker function - pipeline uses component filter workers */
 static void* pipeline_worker(void* arg)
 {
@@ -606,7 +772,7 @@ Bp_EC pipeline_validate_properties(const Pipeline_t* pipeline,
           size_t first_port = 0;
 
           for (size_t port = 0; port < filter->n_input_buffers; port++) {
-            if (constraint->input_mask & (1 << port)) {
+            if (constraint->input_mask & prop_port_bit(port)) {
               Property_t* prop = &filter->input_properties[port]
                                       .properties[constraint->property];
 
@@ -1,6 +1,7 @@
 #ifndef BPIPE_PIPELINE_H
 #define BPIPE_PIPELINE_H
 
+#include "arena.h"
 #include "core.h"
 
 /* Connection specification (direct pointer references) */
@@ -28,6 +29,10 @@ typedef struct _Pipeline_config_t {
   size_t input_port;       /* Which port (default: 0) */
   Filter_t* output_filter; /* Which filter to expose as output */
   size_t output_port;      /* Which port (default: 0) */
+
+  /* Memory placement */
+  bool use_arena;        /* Relocate member input rings into one arena */
+  bool arena_huge_pages; /* Back the arena with huge pages if available */
 } Pipeline_config_t;
 
 /* External input mapping - maps external inputs to internal filter ports */
@@ -62,6 +67,8 @@ typedef struct _Pipeline_t {
   ExternalInputMapping_t external_input_mappings[MAX_INPUTS];
   size_t n_external_inputs;
 
+  /* Backing store for member filters' input rings (use_arena only) */
+  Arena_t arena;
 } Pipeline_t;
 
 /* Standard bpipe2 initialization pattern */
@@ -96,7 +103,21 @@ Bp_EC pipeline_validate_properties(const Pipeline_t* pipeline,
                                    size_t n_external_inputs, char* error_msg,
                                    size_t error_msg_size);
 
+/* Write a per-buffer breakdown of ring memory held by the pipeline's member
+ * filters, with totals and arena placement, into `buffer`.
+ * Intended to be logged once at startup.
+ */
+Bp_EC pipeline_memory_report(const Pipeline_t* pipeline, char* buffer,
+                             size_t size);
+
 /* Standard filter lifecycle (inherited from Filter_t) */
 /* filt_start(), filt_stop(), filt_deinit() work automatically */
 
+/* Warm restart of the whole graph: after filt_stop(&pipe->base),
+ * filt_checkpoint(&pipe->base, ck) records every member filter in order,
+ * with their queued batches if ck->with_rings. In the next run, build the
+ * same pipeline and call filt_restore(&pipe->base, ck) before starting it.
+ * All member records are checked before any is applied.
+ */
+
 #endif /* BPIPE_PIPELINE_H */
\ No newline at end of file
@@ -274,7 +274,7 @@ Bp_EC prop_validate_connection(const PropertyTable_t* upstream_props,
 
   /* Check each constraint using count */
   const InputConstraint_t* constraints = downstream_contract->input_constraints;
-  uint32_t port_mask = 1U << input_port; /* Convert port index to bitmask */
+  uint32_t port_mask = prop_port_bit(input_port);
 
   for (size_t i = 0; i < downstream_contract->n_input_constraints; i++) {
     const InputConstraint_t* constraint = &constraints[i];
@@ -337,7 +337,7 @@ Bp_EC prop_validate_multi_input_alignment(
 
   /* Check each multi-input alignment constraint */
   const InputConstraint_t* constraints = sink->input_constraints;
-  uint32_t new_port_mask = 1U << new_input_port;
+  uint32_t new_port_mask = prop_port_bit(new_input_port);
 
   for (size_t i = 0; i < sink->n_input_constraints; i++) {
     const InputConstraint_t* constraint = &constraints[i];
@@ -371,8 +371,9 @@ Bp_EC prop_validate_multi_input_alignment(
       return Bp_EC_PROPERTY_MISMATCH;
     }
 
-    /* Compare against all other inputs included in the constraint mask */
-    for (uint32_t port = 0; port < MAX_INPUTS; port++) {
+    /* Compare against the lower, already connected inputs included in the
+     * constraint mask (masks cover ports 0..31) */
+    for (uint32_t port = 0; port < new_input_port && port < 32; port++) {
       uint32_t port_mask = 1U << port;
 
       /* Skip ports not in the constraint mask */
@@ -380,18 +381,6 @@ Bp_EC prop_validate_multi_input_alignment(
         continue;
       }
 
-      /* Skip the port we're currently connecting */
-      if (port == new_input_port) {
-        continue;
-      }
-
-      /* Skip ports that haven't been connected yet.
-       * Only ports with lower indices than the current one should be connected.
-       */
-      if (port >= new_input_port) {
-        continue;
-      }
-
       /* Skip unconnected ports */
       if (port >= sink->n_input_buffers || sink->input_buffers[port] == NULL) {
         continue;
@@ -499,7 +488,7 @@ PropertyTable_t prop_propagate(const PropertyTable_t* input_properties,
 
   /* Apply filter's output behaviors using count */
   const OutputBehavior_t* behaviors = filter_contract->output_behaviors;
-  uint32_t output_mask = 1U << output_port;
+  uint32_t output_mask = prop_port_bit(output_port);
 
   if (behaviors) {
     for (size_t i = 0; i < filter_contract->n_output_behaviors; i++) {
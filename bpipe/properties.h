@@ -85,6 +85,13 @@ typedef struct {
 #define OUTPUT_ALL \
   0xFFFFFFFF /* All output ports (default for backward compatibility) */
 
+/* Mask bit of `port`. Masks cover ports 0..31; higher ports (filters may
+ * have up to MAX_PORTS) match no mask bit. */
+static inline uint32_t prop_port_bit(size_t port)
+{
+  return port < 32 ? 1U << port : 0;
+}
+
 /* Input constraint structure */
 typedef struct {
   SignalProperty_t property;
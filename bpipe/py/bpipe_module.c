@@ -0,0 +1,788 @@
+/* Python bindings: bpipe._bpipe
+ *
+ * Three object types:
+ *   Buffer - a Batch_buff_t, either owned (created from Python, usable as a
+ *            sink of a C filter) or borrowed (a filter's input buffer, used
+ *            to feed it from Python)
+ *   Batch  - view of one ring slot. Exports the sample data through the
+ *            buffer protocol, so numpy.asarray(batch) aliases ring memory
+ *            without copying. Views are only meaningful until the slot is
+ *            released with del_tail() / submit().
+ *   Filter - any C filter, built by the create_* factories and driven
+ *            through the generic filt_* API.
+ *
+ * The GIL is released while blocking in bb_get_tail, bb_submit and
+ * filt_stop; filter workers never call into Python.
+ */
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch_buffer.h"
+#include "core.h"
+#include "debug_output_filter.h"
+#include "passthrough.h"
+#include "signal_generator.h"
+
+static PyObject *BpipeError;
+
+/* Raise BpipeError(code, name) and return NULL */
+static PyObject *raise_ec(Bp_EC ec)
+{
+  const char *name = ec >= 0 && ec < Bp_EC_MAX && err_lut[ec][0]
+                         ? err_lut[ec]
+                         : "UNKNOWN";
+  PyObject *args = Py_BuildValue("(is)", (int) ec, name);
+  if (args) {
+    PyErr_SetObject(BpipeError, args);
+    Py_DECREF(args);
+  }
+  return NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Configuration helpers                                                   */
+
+static int parse_dtype(const char *name, SampleDtype_t *out)
+{
+  if (strcmp(name, "float32") == 0) {
+    *out = DTYPE_FLOAT;
+  } else if (strcmp(name, "int32") == 0) {
+    *out = DTYPE_I32;
+  } else if (strcmp(name, "uint32") == 0) {
+    *out = DTYPE_U32;
+  } else if (strcmp(name, "int16") == 0) {
+    *out = DTYPE_I16;
+  } else if (strcmp(name, "record") == 0) {
+    *out = DTYPE_RECORD;
+  } else {
+    PyErr_Format(PyExc_ValueError, "unknown dtype '%s'", name);
+    return -1;
+  }
+  return 0;
+}
+
+static int parse_overflow(const char *name, OverflowBehaviour_t *out)
+{
+  static const char *names[OVERFLOW_MAX] = {
+      [OVERFLOW_BLOCK] = "block",         [OVERFLOW_DROP_HEAD] = "drop_head",
+      [OVERFLOW_DROP_TAIL] = "drop_tail", [OVERFLOW_DROP_STALE] = "drop_stale",
+      [OVERFLOW_DECIMATE] = "decimate",   [OVERFLOW_SPILL] = "spill"};
+  for (int i = 0; i < OVERFLOW_MAX; i++) {
+    if (names[i] && strcmp(name, names[i]) == 0) {
+      *out = (OverflowBehaviour_t) i;
+      return 0;
+    }
+  }
+  PyErr_Format(PyExc_ValueError, "unknown overflow behaviour '%s'", name);
+  return -1;
+}
+
+static int make_buff_config(const char *dtype, size_t batch_expo,
+                            size_t ring_expo, size_t n_channels,
+                            const char *overflow, BatchBuffer_config *cfg)
+{
+  memset(cfg, 0, sizeof(*cfg));
+  cfg->batch_capacity_expo = batch_expo;
+  cfg->ring_capacity_expo = ring_expo;
+  cfg->n_channels = n_channels;
+  if (parse_dtype(dtype, &cfg->dtype) < 0) return -1;
+  return parse_overflow(overflow, &cfg->overflow_behaviour);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Buffer                                                                  */
+
+typedef struct {
+  PyObject_HEAD Batch_buff_t *buff;
+  PyObject *owner; /* Filter that owns `buff`, NULL if owned here */
+} BufferObject;
+
+static PyTypeObject BufferType;
+static PyTypeObject BatchType;
+
+static PyObject *buffer_wrap(Batch_buff_t *buff, PyObject *owner)
+{
+  BufferObject *self = PyObject_New(BufferObject, &BufferType);
+  if (!self) return NULL;
+  self->buff = buff;
+  self->owner = owner;
+  Py_XINCREF(owner);
+  return (PyObject *) self;
+}
+
+static int Buffer_init(BufferObject *self, PyObject *args, PyObject *kwds)
+{
+  static char *kwlist[] = {"dtype",      "batch_capacity_expo",
+                           "ring_capacity_expo", "n_channels",
+                           "overflow",   "name",
+                           NULL};
+  const char *dtype = "float32", *overflow = "block", *name = "py_buffer";
+  Py_ssize_t batch_expo = 6, ring_expo = 4, n_channels = 1;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|snnnss", kwlist, &dtype,
+                                   &batch_expo, &ring_expo, &n_channels,
+                                   &overflow, &name)) {
+    return -1;
+  }
+  if (batch_expo < 0 || ring_expo < 0 || n_channels < 0) {
+    PyErr_SetString(PyExc_ValueError, "sizes must be non-negative");
+    return -1;
+  }
+
+  BatchBuffer_config cfg;
+  if (make_buff_config(dtype, (size_t) batch_expo, (size_t) ring_expo,
+                       (size_t) n_channels, overflow, &cfg) < 0) {
+    return -1;
+  }
+  if (self->buff) {
+    PyErr_SetString(PyExc_RuntimeError, "Buffer already initialised");
+    return -1;
+  }
+  self->buff = calloc(1, sizeof(Batch_buff_t));
+  if (!self->buff) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  Bp_EC ec = bb_init(self->buff, name, cfg);
+  if (ec == Bp_EC_OK) ec = bb_start(self->buff);
+  if (ec != Bp_EC_OK) {
+    free(self->buff);
+    self->buff = NULL;
+    raise_ec(ec);
+    return -1;
+  }
+  return 0;
+}
+
+static void Buffer_dealloc(BufferObject *self)
+{
+  if (self->owner) {
+    Py_DECREF(self->owner);
+  } else if (self->buff) {
+    bb_stop(self->buff);
+    bb_deinit(self->buff);
+    free(self->buff);
+  }
+  Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject *batch_new(BufferObject *buffer, Batch_t *batch,
+                           bool writable);
+
+static PyObject *Buffer_get_tail(BufferObject *self, PyObject *args,
+                                 PyObject *kwds)
+{
+  static char *kwlist[] = {"timeout_us", NULL};
+  unsigned long timeout_us = 100000;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|k", kwlist, &timeout_us)) {
+    return NULL;
+  }
+  Bp_EC ec = Bp_EC_OK;
+  Batch_t *batch;
+  Py_BEGIN_ALLOW_THREADS batch = bb_get_tail(self->buff, timeout_us, &ec);
+  Py_END_ALLOW_THREADS
+
+  if (!batch) {
+    if (ec == Bp_EC_TIMEOUT) Py_RETURN_NONE;
+    return raise_ec(ec);
+  }
+  return batch_new(self, batch, false);
+}
+
+static PyObject *Buffer_del_tail(BufferObject *self, PyObject *unused)
+{
+  Bp_EC ec = bb_del_tail(self->buff);
+  if (ec != Bp_EC_OK) return raise_ec(ec);
+  Py_RETURN_NONE;
+}
+
+static PyObject *Buffer_get_head(BufferObject *self, PyObject *unused)
+{
+  return batch_new(self, bb_get_head(self->buff), true);
+}
+
+static PyObject *Buffer_submit(BufferObject *self, PyObject *args,
+                               PyObject *kwds)
+{
+  static char *kwlist[] = {"timeout_us", NULL};
+  unsigned long timeout_us = 100000;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|k", kwlist, &timeout_us)) {
+    return NULL;
+  }
+  Bp_EC ec;
+  Py_BEGIN_ALLOW_THREADS ec = bb_submit(self->buff, timeout_us);
+  Py_END_ALLOW_THREADS if (ec != Bp_EC_OK) return raise_ec(ec);
+  Py_RETURN_NONE;
+}
+
+static PyObject *Buffer_stop(BufferObject *self, PyObject *unused)
+{
+  bb_stop(self->buff);
+  Py_RETURN_NONE;
+}
+
+static PyObject *Buffer_stats(BufferObject *self, PyObject *unused)
+{
+  BbStats_t s;
+  Bp_EC ec = bb_get_stats(self->buff, &s);
+  if (ec != Bp_EC_OK) return raise_ec(ec);
+  return Py_BuildValue(
+      "{s:K,s:K,s:K,s:n,s:K,s:K}", "total_batches",
+      (unsigned long long) s.total_batches, "dropped_total",
+      (unsigned long long) s.dropped_total, "frames_decimated",
+      (unsigned long long) s.frames_decimated, "occupancy",
+      (Py_ssize_t) s.occupancy, "spilled_batches",
+      (unsigned long long) s.spilled_batches, "blocked_time_ns",
+      (unsigned long long) s.blocked_time_ns);
+}
+
+static PyObject *Buffer_get_capacity(BufferObject *self, void *closure)
+{
+  return PyLong_FromSize_t((size_t) 1 << self->buff->batch_capacity_expo);
+}
+
+static PyObject *Buffer_get_n_channels(BufferObject *self, void *closure)
+{
+  return PyLong_FromSize_t(bb_n_channels(self->buff));
+}
+
+static PyMethodDef Buffer_methods[] = {
+    {"get_tail", (PyCFunction) (void (*)(void)) Buffer_get_tail,
+     METH_VARARGS | METH_KEYWORDS,
+     "get_tail(timeout_us=100000) -> Batch or None on timeout.\n"
+     "Waits with the GIL released."},
+    {"del_tail", (PyCFunction) Buffer_del_tail, METH_NOARGS,
+     "Release the batch returned by get_tail()."},
+    {"get_head", (PyCFunction) Buffer_get_head, METH_NOARGS,
+     "Writable Batch for the next slot; fill it, set head, then submit()."},
+    {"submit", (PyCFunction) (void (*)(void)) Buffer_submit,
+     METH_VARARGS | METH_KEYWORDS,
+     "submit(timeout_us=100000). Waits with the GIL released."},
+    {"stop", (PyCFunction) Buffer_stop, METH_NOARGS,
+     "Stop the buffer, waking blocked readers and writers."},
+    {"stats", (PyCFunction) Buffer_stats, METH_NOARGS,
+     "Counters from bb_get_stats() as a dict."},
+    {NULL}};
+
+static PyGetSetDef Buffer_getset[] = {
+    {"capacity", (getter) Buffer_get_capacity, NULL, "Frames per batch"},
+    {"n_channels", (getter) Buffer_get_n_channels, NULL, "Channels per frame"},
+    {NULL}};
+
+static PyTypeObject BufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "bpipe._bpipe.Buffer",
+    .tp_basicsize = sizeof(BufferObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Batch ring buffer",
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) Buffer_init,
+    .tp_dealloc = (destructor) Buffer_dealloc,
+    .tp_methods = Buffer_methods,
+    .tp_getset = Buffer_getset,
+};
+
+/* ---------------------------------------------------------------------- */
+/* Batch                                                                   */
+
+typedef struct {
+  PyObject_HEAD BufferObject *buffer; /* Keeps the ring memory alive */
+  Batch_t *batch;
+  bool writable;
+  Py_ssize_t shape[2];
+  Py_ssize_t strides[2];
+} BatchObject;
+
+static PyObject *batch_new(BufferObject *buffer, Batch_t *batch,
+                           bool writable)
+{
+  BatchObject *self = PyObject_New(BatchObject, &BatchType);
+  if (!self) return NULL;
+  Py_INCREF(buffer);
+  self->buffer = buffer;
+  self->batch = batch;
+  self->writable = writable;
+  return (PyObject *) self;
+}
+
+static void Batch_dealloc(BatchObject *self)
+{
+  Py_DECREF(self->buffer);
+  Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/* Shape is (frames,) for one channel, (frames, channels) interleaved and
+ * (channels, frames) planar. Head batches expose their full capacity so
+ * Python can fill them before setting `head`. */
+static int Batch_getbuffer(BatchObject *self, Py_buffer *view, int flags)
+{
+  const Batch_buff_t *buff = self->buffer->buff;
+  if ((flags & PyBUF_WRITABLE) && !self->writable) {
+    PyErr_SetString(PyExc_BufferError, "tail batches are read-only");
+    return -1;
+  }
+
+  static char fmt_f[] = "f", fmt_i[] = "i", fmt_u[] = "I", fmt_h[] = "h",
+              fmt_b[] = "B";
+  char *format;
+  switch (buff->dtype) {
+    case DTYPE_FLOAT:
+      format = fmt_f;
+      break;
+    case DTYPE_I32:
+      format = fmt_i;
+      break;
+    case DTYPE_U32:
+      format = fmt_u;
+      break;
+    case DTYPE_I16:
+      format = fmt_h;
+      break;
+    default:
+      format = fmt_b;
+      break;
+  }
+
+  Py_ssize_t width = (Py_ssize_t) bb_getdatawidth(buff->dtype);
+  Py_ssize_t n_channels = (Py_ssize_t) bb_n_channels(buff);
+  Py_ssize_t capacity = (Py_ssize_t) 1 << buff->batch_capacity_expo;
+  Py_ssize_t frames =
+      self->writable ? capacity : (Py_ssize_t) self->batch->head;
+
+  view->ndim = n_channels > 1 ? 2 : 1;
+  if (n_channels == 1) {
+    self->shape[0] = frames;
+    self->strides[0] = width;
+  } else if (buff->layout == BATCH_LAYOUT_PLANAR) {
+    self->shape[0] = n_channels;
+    self->shape[1] = frames;
+    self->strides[0] = capacity * width;
+    self->strides[1] = width;
+  } else {
+    self->shape[0] = frames;
+    self->shape[1] = n_channels;
+    self->strides[0] = n_channels * width;
+    self->strides[1] = width;
+  }
+
+  view->buf = self->batch->data;
+  view->obj = (PyObject *) self;
+  Py_INCREF(self);
+  view->len = frames * n_channels * width;
+  view->readonly = !self->writable;
+  view->itemsize = width;
+  view->format = (flags & PyBUF_FORMAT) ? format : NULL;
+  view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+  view->strides = (flags & PyBUF_STRIDES) ? self->strides : NULL;
+  view->suboffsets = NULL;
+  view->internal = NULL;
+  if (!(flags & PyBUF_STRIDES) && view->ndim == 2 &&
+      buff->layout == BATCH_LAYOUT_PLANAR && frames != capacity) {
+    PyErr_SetString(PyExc_BufferError, "planar view needs strides");
+    view->obj = NULL;
+    Py_DECREF(self);
+    return -1;
+  }
+  return 0;
+}
+
+static PyBufferProcs Batch_as_buffer = {
+    .bf_getbuffer = (getbufferproc) Batch_getbuffer,
+};
+
+#define BATCH_FIELD(NAME, PYFROM, PYTO, CTYPE)                             \
+  static PyObject *Batch_get_##NAME(BatchObject *self, void *closure)      \
+  {                                                                        \
+    return PYFROM(self->batch->NAME);                                      \
+  }                                                                        \
+  static int Batch_set_##NAME(BatchObject *self, PyObject *v, void *c)     \
+  {                                                                        \
+    if (!self->writable) {                                                 \
+      PyErr_SetString(PyExc_AttributeError, "tail batches are read-only"); \
+      return -1;                                                           \
+    }                                                                      \
+    CTYPE x = (CTYPE) PYTO(v);                                             \
+    if (PyErr_Occurred()) return -1;                                       \
+    self->batch->NAME = x;                                                 \
+    return 0;                                                              \
+  }
+
+BATCH_FIELD(head, PyLong_FromSize_t, PyLong_AsSize_t, size_t)
+BATCH_FIELD(t_ns, PyLong_FromLongLong, PyLong_AsLongLong, long long)
+BATCH_FIELD(period_ns, PyLong_FromUnsignedLong, PyLong_AsUnsignedLong,
+            unsigned)
+BATCH_FIELD(batch_id, PyLong_FromSize_t, PyLong_AsSize_t, size_t)
+BATCH_FIELD(ec, PyLong_FromLong, PyLong_AsLong, Bp_EC)
+#undef BATCH_FIELD
+
+static int Batch_set_head_checked(BatchObject *self, PyObject *v, void *c)
+{
+  size_t head = PyLong_AsSize_t(v);
+  if (PyErr_Occurred()) return -1;
+  if (head > ((size_t) 1 << self->buffer->buff->batch_capacity_expo)) {
+    PyErr_SetString(PyExc_ValueError, "head exceeds batch capacity");
+    return -1;
+  }
+  return Batch_set_head(self, v, c);
+}
+
+/* Per-sample timestamps as an int64 memoryview, None if the buffer has no
+ * timestamp column */
+static PyObject *Batch_get_ts(BatchObject *self, void *closure)
+{
+  if (!self->batch->ts) Py_RETURN_NONE;
+  size_t n = self->writable
+                 ? (size_t) 1 << self->buffer->buff->batch_capacity_expo
+                 : self->batch->head;
+  PyObject *raw = PyMemoryView_FromMemory(
+      (char *) self->batch->ts, (Py_ssize_t) (n * sizeof(long long)),
+      self->writable ? PyBUF_WRITE : PyBUF_READ);
+  if (!raw) return NULL;
+  PyObject *typed = PyObject_CallMethod(raw, "cast", "s", "q");
+  Py_DECREF(raw);
+  return typed;
+}
+
+static PyGetSetDef Batch_getset[] = {
+    {"head", (getter) Batch_get_head, (setter) Batch_set_head_checked,
+     "Frames in the batch"},
+    {"t_ns", (getter) Batch_get_t_ns, (setter) Batch_set_t_ns,
+     "Timestamp of the first frame"},
+    {"period_ns", (getter) Batch_get_period_ns, (setter) Batch_set_period_ns,
+     "Sample period, 0 for per-sample timestamps"},
+    {"batch_id", (getter) Batch_get_batch_id, (setter) Batch_set_batch_id,
+     NULL},
+    {"ec", (getter) Batch_get_ec, (setter) Batch_set_ec,
+     "Bp_EC code; COMPLETE marks end of stream"},
+    {"ts", (getter) Batch_get_ts, NULL, "Per-sample timestamps or None"},
+    {NULL}};
+
+static PyTypeObject BatchType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "bpipe._bpipe.Batch",
+    .tp_basicsize = sizeof(BatchObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "View of one ring slot; supports the buffer protocol",
+    .tp_dealloc = (destructor) Batch_dealloc,
+    .tp_as_buffer = &Batch_as_buffer,
+    .tp_getset = Batch_getset,
+};
+
+/* ---------------------------------------------------------------------- */
+/* Filter                                                                  */
+
+typedef struct {
+  PyObject_HEAD Filter_t *filt; /* Concrete filter struct, base first */
+  PyObject *sinks[MAX_SINKS];      /* Python Buffers the filter writes into */
+  PyObject *downstream[MAX_SINKS]; /* Filters owning our output rings */
+} FilterObject;
+
+static PyTypeObject FilterType;
+
+static PyObject *filter_new(Filter_t *filt)
+{
+  FilterObject *self = PyObject_New(FilterObject, &FilterType);
+  if (!self) {
+    filt_deinit(filt);
+    free(filt);
+    return NULL;
+  }
+  self->filt = filt;
+  memset(self->sinks, 0, sizeof(self->sinks));
+  memset(self->downstream, 0, sizeof(self->downstream));
+  return (PyObject *) self;
+}
+
+static void Filter_dealloc(FilterObject *self)
+{
+  if (self->filt) {
+    if (atomic_load(&self->filt->running)) {
+      Py_BEGIN_ALLOW_THREADS filt_stop(self->filt);
+      Py_END_ALLOW_THREADS
+    }
+    filt_deinit(self->filt);
+    free(self->filt);
+  }
+  for (int i = 0; i < MAX_SINKS; i++) Py_XDECREF(self->sinks[i]);
+  for (int i = 0; i < MAX_SINKS; i++) Py_XDECREF(self->downstream[i]);
+  Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject *Filter_start(FilterObject *self, PyObject *unused)
+{
+  Bp_EC ec = filt_start(self->filt);
+  if (ec != Bp_EC_OK) return raise_ec(ec);
+  Py_RETURN_NONE;
+}
+
+static PyObject *Filter_stop(FilterObject *self, PyObject *unused)
+{
+  Bp_EC ec;
+  Py_BEGIN_ALLOW_THREADS ec = filt_stop(self->filt);
+  Py_END_ALLOW_THREADS if (ec != Bp_EC_OK) return raise_ec(ec);
+  Py_RETURN_NONE;
+}
+
+/* connect(port, Buffer): write output `port` into a Python-owned buffer */
+static PyObject *Filter_connect(FilterObject *self, PyObject *args)
+{
+  Py_ssize_t port;
+  BufferObject *sink;
+  if (!PyArg_ParseTuple(args, "nO!", &port, &BufferType, &sink)) return NULL;
+  if (port < 0 || port >= MAX_SINKS) {
+    return raise_ec(Bp_EC_INVALID_SINK_IDX);
+  }
+  Bp_EC ec = filt_sink_connect(self->filt, (size_t) port, sink->buff);
+  if (ec != Bp_EC_OK) return raise_ec(ec);
+  Py_INCREF(sink);
+  Py_XSETREF(self->sinks[port], (PyObject *) sink);
+  Py_RETURN_NONE;
+}
+
+/* connect_filter(port, Filter, input=0): filt_connect with validation */
+static PyObject *Filter_connect_filter(FilterObject *self, PyObject *args)
+{
+  Py_ssize_t port, input = 0;
+  FilterObject *dst;
+  if (!PyArg_ParseTuple(args, "nO!|n", &port, &FilterType, &dst, &input)) {
+    return NULL;
+  }
+  if (port < 0 || port >= MAX_SINKS) {
+    return raise_ec(Bp_EC_INVALID_SINK_IDX);
+  }
+  if (input < 0 || input >= MAX_INPUTS) {
+    return raise_ec(Bp_EC_INVALID_CONFIG);
+  }
+  Bp_EC ec =
+      filt_connect(self->filt, (size_t) port, dst->filt, (size_t) input);
+  if (ec != Bp_EC_OK) return raise_ec(ec);
+  /* We write into dst's input ring: keep dst alive as long as we are */
+  Py_INCREF(dst);
+  Py_XSETREF(self->downstream[port], (PyObject *) dst);
+  Py_RETURN_NONE;
+}
+
+/* input(i): borrowed Buffer for feeding input `i` from Python */
+static PyObject *Filter_input(FilterObject *self, PyObject *args)
+{
+  Py_ssize_t i;
+  if (!PyArg_ParseTuple(args, "n", &i)) return NULL;
+  if (i < 0 || i >= self->filt->n_input_buffers ||
+      !self->filt->input_buffers[i]) {
+    return raise_ec(Bp_EC_NOINPUT);
+  }
+  return buffer_wrap(self->filt->input_buffers[i], (PyObject *) self);
+}
+
+static PyObject *Filter_describe(FilterObject *self, PyObject *unused)
+{
+  char text[1024];
+  Bp_EC ec = filt_describe(self->filt, text, sizeof(text));
+  if (ec != Bp_EC_OK) return raise_ec(ec);
+  return PyUnicode_FromString(text);
+}
+
+static PyObject *Filter_get_error(FilterObject *self, void *closure)
+{
+  Bp_EC ec = self->filt->worker_err_info.ec;
+  return Py_BuildValue("(is)", (int) ec,
+                       ec >= 0 && ec < Bp_EC_MAX ? err_lut[ec] : "UNKNOWN");
+}
+
+static PyObject *Filter_get_name(FilterObject *self, void *closure)
+{
+  return PyUnicode_FromString(self->filt->name);
+}
+
+static PyMethodDef Filter_methods[] = {
+    {"start", (PyCFunction) Filter_start, METH_NOARGS, NULL},
+    {"stop", (PyCFunction) Filter_stop, METH_NOARGS,
+     "Stop and join the worker, with the GIL released."},
+    {"connect", (PyCFunction) Filter_connect, METH_VARARGS,
+     "connect(port, buffer): send output `port` to a Python Buffer."},
+    {"connect_filter", (PyCFunction) Filter_connect_filter, METH_VARARGS,
+     "connect_filter(port, filter, input=0)"},
+    {"input", (PyCFunction) Filter_input, METH_VARARGS,
+     "input(i) -> Buffer feeding input `i`."},
+    {"describe", (PyCFunction) Filter_describe, METH_NOARGS, NULL},
+    {NULL}};
+
+static PyGetSetDef Filter_getset[] = {
+    {"error", (getter) Filter_get_error, NULL,
+     "(code, name) reported by the worker"},
+    {"name", (getter) Filter_get_name, NULL, NULL},
+    {NULL}};
+
+static PyTypeObject FilterType = {
+    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "bpipe._bpipe.Filter",
+    .tp_basicsize = sizeof(FilterObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "A C filter; build with the create_* functions",
+    .tp_dealloc = (destructor) Filter_dealloc,
+    .tp_methods = Filter_methods,
+    .tp_getset = Filter_getset,
+};
+
+/* ---------------------------------------------------------------------- */
+/* Factories                                                               */
+
+static PyObject *create_passthrough(PyObject *mod, PyObject *args,
+                                    PyObject *kwds)
+{
+  static char *kwlist[] = {"dtype",      "batch_capacity_expo",
+                           "ring_capacity_expo", "n_channels",
+                           "timeout_us", NULL};
+  const char *dtype = "float32";
+  Py_ssize_t batch_expo = 6, ring_expo = 4, n_channels = 1;
+  long timeout_us = 100000;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|snnnl", kwlist, &dtype,
+                                   &batch_expo, &ring_expo, &n_channels,
+                                   &timeout_us)) {
+    return NULL;
+  }
+  Passthrough_config_t cfg = {.name = "py_passthrough",
+                              .timeout_us = timeout_us};
+  if (make_buff_config(dtype, (size_t) batch_expo, (size_t) ring_expo,
+                       (size_t) n_channels, "block", &cfg.buff_config) < 0) {
+    return NULL;
+  }
+  Passthrough_t *pt = calloc(1, sizeof(Passthrough_t));
+  if (!pt) return PyErr_NoMemory();
+  Bp_EC ec = passthrough_init(pt, &cfg);
+  if (ec != Bp_EC_OK) {
+    free(pt);
+    return raise_ec(ec);
+  }
+  return filter_new(&pt->base);
+}
+
+static PyObject *create_signal_generator(PyObject *mod, PyObject *args,
+                                         PyObject *kwds)
+{
+  static char *kwlist[] = {"waveform",   "frequency_hz",
+                           "sample_period_ns", "amplitude",
+                           "offset",     "phase_rad",
+                           "max_samples", "dtype",
+                           "batch_capacity_expo", "ring_capacity_expo",
+                           "timeout_us", NULL};
+  const char *waveform = "sine", *dtype = "float32";
+  double frequency_hz = 1.0, amplitude = 1.0, offset = 0.0, phase = 0.0;
+  unsigned long long period_ns = 1000000, max_samples = 0;
+  Py_ssize_t batch_expo = 6, ring_expo = 4;
+  long timeout_us = 100000;
+  if (!PyArg_ParseTupleAndKeywords(
+          args, kwds, "|sdKdddKsnnl", kwlist, &waveform, &frequency_hz,
+          &period_ns, &amplitude, &offset, &phase, &max_samples, &dtype,
+          &batch_expo, &ring_expo, &timeout_us)) {
+    return NULL;
+  }
+
+  static const char *waveforms[] = {"sine", "square", "sawtooth",
+                                    "triangle"};
+  int wf = -1;
+  for (int i = 0; i < 4; i++) {
+    if (strcmp(waveform, waveforms[i]) == 0) wf = i;
+  }
+  if (wf < 0) {
+    PyErr_Format(PyExc_ValueError, "unknown waveform '%s'", waveform);
+    return NULL;
+  }
+
+  SignalGenerator_config_t cfg = {.name = "py_signal_generator",
+                                  .timeout_us = timeout_us,
+                                  .waveform_type = (WaveformType_e) wf,
+                                  .frequency_hz = frequency_hz,
+                                  .phase_rad = phase,
+                                  .sample_period_ns = period_ns,
+                                  .amplitude = amplitude,
+                                  .offset = offset,
+                                  .max_samples = max_samples};
+  if (make_buff_config(dtype, (size_t) batch_expo, (size_t) ring_expo, 1,
+                       "block", &cfg.buff_config) < 0) {
+    return NULL;
+  }
+  SignalGenerator_t *sg = calloc(1, sizeof(SignalGenerator_t));
+  if (!sg) return PyErr_NoMemory();
+  Bp_EC ec = signal_generator_init(sg, cfg);
+  if (ec != Bp_EC_OK) {
+    free(sg);
+    return raise_ec(ec);
+  }
+  return filter_new(&sg->base);
+}
+
+static PyObject *create_debug_output(PyObject *mod, PyObject *args,
+                                     PyObject *kwds)
+{
+  static char *kwlist[] = {"prefix",       "filename",
+                           "show_metadata", "show_samples",
+                           "show_summary", "sample_every",
+                           "max_batches_per_s", "async_output",
+                           NULL};
+  DebugOutputConfig_t cfg = {.show_metadata = true,
+                             .max_samples_per_batch = -1};
+  int show_metadata = 1, show_samples = 0, show_summary = 0, async = 0;
+  unsigned int sample_every = 0, max_per_s = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|zzpppIIp", kwlist,
+                                   &cfg.prefix, &cfg.filename, &show_metadata,
+                                   &show_samples, &show_summary, &sample_every,
+                                   &max_per_s, &async)) {
+    return NULL;
+  }
+  cfg.show_metadata = show_metadata;
+  cfg.show_samples = show_samples;
+  cfg.show_summary = show_summary;
+  cfg.sample_every = sample_every;
+  cfg.max_batches_per_s = max_per_s;
+  cfg.async_output = async;
+
+  DebugOutputFilter_t *dbg = calloc(1, sizeof(DebugOutputFilter_t));
+  if (!dbg) return PyErr_NoMemory();
+  Bp_EC ec = debug_output_filter_init(dbg, &cfg);
+  if (ec != Bp_EC_OK) {
+    free(dbg);
+    return raise_ec(ec);
+  }
+  return filter_new(&dbg->base);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Module                                                                  */
+
+static PyMethodDef module_methods[] = {
+    {"create_passthrough", (PyCFunction) (void (*)(void)) create_passthrough,
+     METH_VARARGS | METH_KEYWORDS, "Passthrough filter"},
+    {"create_signal_generator",
+     (PyCFunction) (void (*)(void)) create_signal_generator,
+     METH_VARARGS | METH_KEYWORDS, "Signal generator source"},
+    {"create_debug_output", (PyCFunction) (void (*)(void)) create_debug_output,
+     METH_VARARGS | METH_KEYWORDS, "Debug output (tap) filter"},
+    {NULL}};
+
+static struct PyModuleDef bpipe_module = {
+    PyModuleDef_HEAD_INIT, .m_name = "bpipe._bpipe",
+    .m_doc = "bpipe C extension", .m_size = -1, .m_methods = module_methods};
+
+PyMODINIT_FUNC PyInit__bpipe(void)
+{
+  if (PyType_Ready(&BufferType) < 0 || PyType_Ready(&BatchType) < 0 ||
+      PyType_Ready(&FilterType) < 0) {
+    return NULL;
+  }
+  PyObject *m = PyModule_Create(&bpipe_module);
+  if (!m) return NULL;
+
+  BpipeError = PyErr_NewException("bpipe.BpipeError", PyExc_RuntimeError,
+                                  NULL);
+  Py_INCREF(&BufferType);
+  Py_INCREF(&BatchType);
+  Py_INCREF(&FilterType);
+  if (PyModule_AddObject(m, "BpipeError", BpipeError) < 0 ||
+      PyModule_AddObject(m, "Buffer", (PyObject *) &BufferType) < 0 ||
+      PyModule_AddObject(m, "Batch", (PyObject *) &BatchType) < 0 ||
+      PyModule_AddObject(m, "Filter", (PyObject *) &FilterType) < 0 ||
+      PyModule_AddIntConstant(m, "EC_OK", Bp_EC_OK) < 0 ||
+      PyModule_AddIntConstant(m, "EC_COMPLETE", Bp_EC_COMPLETE) < 0) {
+    Py_DECREF(m);
+    return NULL;
+  }
+  return m;
+}
@@ -0,0 +1,377 @@
+#include "reorder.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+static inline long long ro_key(const Reorder_t* ro, size_t slot)
+{
+  return bb_sample_t_ns(&ro->slots[slot], ro->pos[slot]);
+}
+
+static inline bool ro_less(const Reorder_t* ro, size_t a, size_t b)
+{
+  long long ka = ro_key(ro, a), kb = ro_key(ro, b);
+  return ka < kb || (ka == kb && ro->seq[a] < ro->seq[b]);
+}
+
+static void ro_sift_up(Reorder_t* ro, size_t i)
+{
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (!ro_less(ro, ro->heap[i], ro->heap[parent])) break;
+    size_t t = ro->heap[i];
+    ro->heap[i] = ro->heap[parent];
+    ro->heap[parent] = t;
+    i = parent;
+  }
+}
+
+static void ro_sift_down(Reorder_t* ro, size_t i)
+{
+  for (;;) {
+    size_t l = 2 * i + 1, r = l + 1, m = i;
+    if (l < ro->n_held && ro_less(ro, ro->heap[l], ro->heap[m])) m = l;
+    if (r < ro->n_held && ro_less(ro, ro->heap[r], ro->heap[m])) m = r;
+    if (m == i) break;
+    size_t t = ro->heap[i];
+    ro->heap[i] = ro->heap[m];
+    ro->heap[m] = t;
+    i = m;
+  }
+}
+
+static size_t ro_pop(Reorder_t* ro)
+{
+  size_t top = ro->heap[0];
+  ro->heap[0] = ro->heap[--ro->n_held];
+  ro_sift_down(ro, 0);
+  return top;
+}
+
+static void ro_push(Reorder_t* ro, size_t slot)
+{
+  ro->heap[ro->n_held] = slot;
+  ro_sift_up(ro, ro->n_held++);
+}
+
+/* Frames from `pos` with a time <= limit */
+static size_t ro_run_length(const Batch_t* b, size_t pos, long long limit)
+{
+  size_t n = 0;
+  if (!bb_batch_has_ts(b) && b->period_ns > 0) {
+    long long t0 = bb_sample_t_ns(b, pos);
+    if (limit >= t0) {
+      unsigned long long steps =
+          (unsigned long long) (limit - t0) / b->period_ns + 1;
+      n = steps < b->head - pos ? (size_t) steps : b->head - pos;
+    }
+    return n;
+  }
+  while (pos + n < b->head && bb_sample_t_ns(b, pos + n) <= limit) n++;
+  return n;
+}
+
+static Bp_EC ro_submit(Reorder_t* ro)
+{
+  Filter_t* f = &ro->base;
+  Batch_t* out = ro->out;
+  ro->out = NULL;
+  if (out == NULL || out->head == 0) return Bp_EC_OK;
+  out->ec = Bp_EC_OK;
+  out->batch_id = f->metrics.n_batches++;
+  return bb_submit(f->sinks[0], f->timeout_us);
+}
+
+/* Append n frames of held batch `src` from `pos` to the output */
+static Bp_EC ro_emit(Reorder_t* ro, const Batch_t* src, size_t pos, size_t n)
+{
+  const Batch_buff_t* in_buf = ro->base.input_buffers[0];
+  Batch_buff_t* out_buf = ro->base.sinks[0];
+  const size_t capacity = bb_batch_size(out_buf);
+  const bool src_ts = bb_batch_has_ts(src);
+
+  while (n > 0) {
+    if (ro->out == NULL) {
+      ro->out = bb_get_head(out_buf);
+      ro->out->head = 0;
+    }
+    Batch_t* out = ro->out;
+    const long long t0 = bb_sample_t_ns(src, pos);
+
+    if (out->head == 0) {
+      out->t_ns = t0;
+      out->period_ns = src_ts ? 0 : src->period_ns;
+    } else if (out->period_ns != 0 &&
+               (src_ts || src->period_ns != out->period_ns ||
+                t0 != out->t_ns + (long long) (out->head * out->period_ns))) {
+      /* Run is off the grid */
+      if (out->ts == NULL) {
+        Bp_EC err = ro_submit(ro);
+        if (err != Bp_EC_OK) return err;
+        continue;
+      }
+      for (size_t i = 0; i < out->head; i++) {
+        out->ts[i] = out->t_ns + (long long) (i * out->period_ns);
+      }
+      out->period_ns = 0;
+    }
+
+    size_t m = MIN(n, capacity - out->head);
+    bb_copy_frames(out_buf, out, out->head, in_buf, src, pos, m);
+    if (out->period_ns == 0 && out->ts != NULL && !src_ts) {
+      for (size_t i = 0; i < m; i++) {
+        out->ts[out->head + i] = bb_sample_t_ns(src, pos + i);
+      }
+    }
+    out->head += m;
+    ro->emitted_t_ns = bb_sample_t_ns(src, pos + m - 1);
+    ro->any_emitted = true;
+    pos += m;
+    n -= m;
+    if (out->head == capacity) {
+      Bp_EC err = ro_submit(ro);
+      if (err != Bp_EC_OK) return err;
+    }
+  }
+  return Bp_EC_OK;
+}
+
+/* Emit what the time bound allows; with `make_room` also the oldest
+ * samples until a slot is free, with `drain` everything */
+static Bp_EC ro_release(Reorder_t* ro, bool make_room, bool drain)
+{
+  const long long watermark = ro->max_delay_ns > 0
+                                  ? ro->newest_t_ns - ro->max_delay_ns
+                                  : LLONG_MIN;
+  Bp_EC err = Bp_EC_OK;
+
+  while (ro->n_held > 0 && err == Bp_EC_OK) {
+    const bool must = drain || (make_room && ro->n_free == 0);
+    const size_t top = ro->heap[0];
+    if (!must && ro_key(ro, top) > watermark) break;
+
+    ro_pop(ro);
+    long long limit = ro->n_held > 0 ? ro_key(ro, ro->heap[0]) : LLONG_MAX;
+    /* Equal times go to the earlier arrival, which is `top` */
+    if (!must) limit = MIN(limit, watermark);
+    Batch_t* b = &ro->slots[top];
+    size_t n = ro_run_length(b, ro->pos[top], limit);
+    err = ro_emit(ro, b, ro->pos[top], n);
+    ro->pos[top] += n;
+
+    if (ro->pos[top] < b->head) {
+      ro_push(ro, top);
+    } else {
+      ro->free_ids[ro->n_free++] = top;
+    }
+  }
+  if (err != Bp_EC_OK) return err;
+  return ro_submit(ro);
+}
+
+/* Copy an input batch into a free slot, minus any late prefix */
+static void ro_hold(Reorder_t* ro, const Batch_buff_t* in_buf,
+                    const Batch_t* input)
+{
+  size_t skip = 0;
+  if (ro->any_emitted) {
+    while (skip < input->head &&
+           bb_sample_t_ns(input, skip) < ro->emitted_t_ns) {
+      skip++;
+    }
+  }
+  ro->late_samples += skip;
+  if (skip == input->head) {
+    ro->late_batches++;
+    return;
+  }
+
+  const long long first = bb_sample_t_ns(input, 0);
+  const long long last = bb_sample_t_ns(input, input->head - 1);
+  if (ro->any_seen && first < ro->newest_t_ns) ro->batches_reordered++;
+  if (!ro->any_seen || last > ro->newest_t_ns) ro->newest_t_ns = last;
+  ro->any_seen = true;
+
+  size_t slot = ro->free_ids[--ro->n_free];
+  Batch_t* b = &ro->slots[slot];
+  b->head = 0;
+  b->t_ns = input->t_ns;
+  b->period_ns = input->period_ns;
+  b->batch_id = input->batch_id;
+  bb_copy_frames(in_buf, b, 0, in_buf, input, 0, input->head);
+  b->head = input->head;
+  ro->pos[slot] = skip;
+  ro->seq[slot] = ro->next_seq++;
+  ro_push(ro, slot);
+}
+
+static void* reorder_worker(void* arg)
+{
+  Reorder_t* ro = (Reorder_t*) arg;
+  Filter_t* f = &ro->base;
+  Batch_buff_t* in_buf = f->input_buffers[0];
+  Batch_buff_t* out_buf = f->sinks[0];
+  Bp_EC err = Bp_EC_OK;
+
+  BP_WORKER_ASSERT(f, out_buf != NULL, Bp_EC_NO_SINK);
+
+  while (atomic_load(&f->running)) {
+    Batch_t* input = bb_get_tail(in_buf, f->timeout_us, &err);
+    if (!input) {
+      if (err == Bp_EC_TIMEOUT) continue;
+      break;
+    }
+    if (input->ec == Bp_EC_COMPLETE) {
+      bb_del_tail(in_buf);
+      err = ro_release(ro, false, true);
+      if (err != Bp_EC_OK) break;
+      filt_send_complete(f, out_buf);
+      break;
+    }
+    BP_WORKER_ASSERT(f, input->ec == Bp_EC_OK, input->ec);
+    BP_WORKER_ASSERT(f, !bb_batch_has_ts(input) || out_buf->ts_ring != NULL,
+                     Bp_EC_INVALID_CONFIG);
+
+    if (input->head > 0) {
+      /* Count bound: a full pool gives up its oldest samples */
+      if (ro->n_free == 0) {
+        err = ro_release(ro, true, false);
+        if (err != Bp_EC_OK) break;
+      }
+      ro_hold(ro, in_buf, input);
+    }
+    f->metrics.samples_processed += input->head;
+    bb_del_tail(in_buf);
+
+    err = ro_release(ro, false, false);
+    if (err != Bp_EC_OK) break;
+  }
+
+  BP_WORKER_ASSERT(f, BP_WORKER_CLEAN_EXIT(err), err);
+  return NULL;
+}
+
+static Bp_EC reorder_describe(Filter_t* self, char* buffer, size_t size)
+{
+  Reorder_t* ro = (Reorder_t*) self;
+  if (buffer == NULL) return Bp_EC_NULL_POINTER;
+
+  snprintf(buffer, size,
+           "Reorder: %s\n"
+           "  Holds up to %zu batches, delay %lld ns\n"
+           "  Reordered: %llu, late samples: %llu, late batches: %llu",
+           self->name, ro->max_held, ro->max_delay_ns,
+           (unsigned long long) ro->batches_reordered,
+           (unsigned long long) ro->late_samples,
+           (unsigned long long) ro->late_batches);
+  return Bp_EC_OK;
+}
+
+static void reorder_free(Reorder_t* ro)
+{
+  free(ro->slots); /* Also holds the index arrays */
+  free(ro->pool);
+  ro->slots = NULL;
+  ro->pool = NULL;
+}
+
+static Bp_EC reorder_deinit(Filter_t* self)
+{
+  reorder_free((Reorder_t*) self);
+
+  filt_release_inputs(self);
+  return Bp_EC_OK;
+}
+
+/* Slot headers, then the per-slot index arrays; data and timestamps in a
+ * separate pool */
+static Bp_EC reorder_alloc(Reorder_t* ro, const Batch_buff_t* in_buf,
+                           bool timestamps)
+{
+  const size_t n = ro->max_held;
+  const size_t data_bytes = bb_batch_bytes(in_buf);
+  const size_t ts_bytes =
+      timestamps ? bb_batch_size((Batch_buff_t*) in_buf) * sizeof(long long)
+                 : 0;
+
+  ro->slots = calloc(1, n * (sizeof(Batch_t) + 3 * sizeof(size_t) +
+                             sizeof(uint64_t)));
+  ro->pool = malloc(n * (data_bytes + ts_bytes));
+  if (ro->slots == NULL || ro->pool == NULL) {
+    reorder_free(ro);
+    return Bp_EC_MALLOC_FAIL;
+  }
+  ro->pos = (size_t*) (ro->slots + n);
+  ro->free_ids = ro->pos + n;
+  ro->heap = ro->free_ids + n;
+  ro->seq = (uint64_t*) (ro->heap + n);
+
+  char* p = ro->pool;
+  for (size_t i = 0; i < n; i++) {
+    ro->slots[i].data = p + i * data_bytes;
+    ro->slots[i].n_channels = in_buf->n_channels;
+    ro->slots[i].layout = in_buf->layout;
+    ro->slots[i].ts =
+        timestamps ? (long long*) (p + n * data_bytes + i * ts_bytes) : NULL;
+    ro->free_ids[i] = n - 1 - i;
+  }
+  ro->n_free = n;
+  ro->n_held = 0;
+  return Bp_EC_OK;
+}
+
+Bp_EC reorder_init(Reorder_t* ro, Reorder_config_t config)
+{
+  if (ro == NULL) return Bp_EC_NULL_FILTER;
+  if (config.buff_config.dtype >= DTYPE_RECORD || config.max_held == 0 ||
+      config.max_held > REORDER_MAX_HELD || config.max_delay_ns < 0) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+
+  Core_filt_config_t core_config = {
+      .name = config.name,
+      .filt_type = FILT_T_REORDER,
+      .size = sizeof(Reorder_t),
+      .n_inputs = 1,
+      .max_supported_sinks = 1,
+      .buff_config = config.buff_config,
+      .timeout_us = config.timeout_us > 0 ? config.timeout_us : 1000000,
+      .worker = reorder_worker};
+
+  Bp_EC err = filt_init(&ro->base, core_config);
+  if (err != Bp_EC_OK) return err;
+
+  ro->max_held = config.max_held;
+  ro->max_delay_ns = config.max_delay_ns;
+  ro->slots = NULL;
+  ro->pos = NULL;
+  ro->pool = NULL;
+  ro->out = NULL;
+  ro->next_seq = 0;
+  ro->newest_t_ns = 0;
+  ro->emitted_t_ns = 0;
+  ro->any_seen = false;
+  ro->any_emitted = false;
+  ro->batches_reordered = 0;
+  ro->late_samples = 0;
+  ro->late_batches = 0;
+  err = reorder_alloc(ro, ro->base.input_buffers[0],
+                      config.buff_config.sample_timestamps);
+  if (err != Bp_EC_OK) {
+    filt_deinit(&ro->base);
+    return err;
+  }
+
+  ro->base.ops.describe = reorder_describe;
+  ro->base.ops.deinit = reorder_deinit;
+
+  prop_constraints_from_buffer_append(&ro->base, &config.buff_config, true);
+  prop_append_behavior(&ro->base, PROP_SAMPLE_PERIOD_NS, BEHAVIOR_OP_PRESERVE,
+                       NULL, OUTPUT_ALL);
+  ro->base.output_properties[0] =
+      prop_propagate(NULL, 0, &ro->base.contract, 0);
+
+  return Bp_EC_OK;
+}
@@ -0,0 +1,75 @@
+#ifndef BPIPE_REORDER_H
+#define BPIPE_REORDER_H
+
+#include "batch_buffer.h"
+#include "core.h"
+
+/* Reorder: restores timestamp order to a stream whose batches arrive
+ * slightly out of order, e.g. merged network or multi-file sources.
+ *
+ * Input batches are copied into a pool of `max_held` slots and kept in a
+ * min-heap on the time of their next unsent sample. Samples are released
+ * in time order once
+ *   - they are at least `max_delay_ns` older than the newest sample seen
+ *     (time bound, if max_delay_ns > 0), or
+ *   - the pool is full and a slot is needed (count bound).
+ * Samples short of both bounds wait for more input or end of stream.
+ * Batches that overlap in time are merged sample by sample, so the output
+ * is ordered even when two sources interleave. Samples within a batch are
+ * assumed to be in order already.
+ *
+ * A sample older than the last one emitted is late: it is dropped and
+ * counted in `late_samples`. A batch dropped entirely also counts in
+ * `late_batches`. Samples with equal times are emitted in arrival order.
+ *
+ * Output batches keep the regular t_ns/period_ns timing while consecutive
+ * runs continue the same grid. If a run breaks the grid and the sink has a
+ * timestamp column, the batch switches to per-sample timestamps; otherwise
+ * it is submitted and a new one started. Irregular input (per-sample
+ * timestamps) needs a sink with sample_timestamps. Everything held is
+ * flushed in order at end of stream.
+ */
+
+#define REORDER_MAX_HELD 256
+
+typedef struct _Reorder_config_t {
+  const char* name;
+  BatchBuffer_config buff_config; /* Any numeric dtype */
+  size_t max_held;                /* Pool size in batches, 1..MAX_HELD */
+  long long max_delay_ns;         /* Time bound, 0 = count bound only */
+  long timeout_us;
+} Reorder_config_t;
+
+typedef struct _Reorder_t {
+  Filter_t base;
+
+  size_t max_held;
+  long long max_delay_ns;
+
+  /* Held batches: slot i owns slots[i].data (and .ts for irregular input),
+   * laid out like a batch of the input buffer */
+  Batch_t* slots;
+  size_t* pos;      /* Next unsent frame of each slot */
+  uint64_t* seq;    /* Arrival order, breaks ties between equal times */
+  size_t* free_ids; /* Stack of free slots */
+  size_t n_free;
+  size_t* heap; /* Held slots, min-heap on next sample time */
+  size_t n_held;
+  void* pool;
+
+  Batch_t* out; /* Output batch being filled, NULL if none */
+  uint64_t next_seq;
+  long long newest_t_ns;  /* Newest sample seen */
+  long long emitted_t_ns; /* Last sample emitted */
+  bool any_seen;
+  bool any_emitted;
+
+  /* Statistics */
+  uint64_t batches_reordered; /* Arrived earlier than an earlier batch */
+  uint64_t late_samples;
+  uint64_t late_batches;
+} Reorder_t;
+
+Bp_EC reorder_init(Reorder_t* ro, Reorder_config_t config);
+
+#endif /* BPIPE_REORDER_H */
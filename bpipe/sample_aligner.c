@@ -195,8 +195,13 @@ static void* sample_aligner_worker(void* arg)
     size_t output_capacity = (1 << f->sinks[0]->batch_capacity_expo);
     size_t to_copy = MIN(samples, output_capacity);
 
-    memcpy(output->data, input->data,
-           to_copy * bb_getdatawidth(f->input_buffers[0]->dtype));
+    // Only the timing changes: take over the input's storage when possible
+    if (to_copy < samples ||
+        bb_swap_data(f->input_buffers[0], input, f->sinks[0], output) !=
+            Bp_EC_OK) {
+      bb_copy_frames(f->sinks[0], output, 0, f->input_buffers[0], input, 0,
+                     to_copy);
+    }
     output->head = to_copy;
 
     // Update state
@@ -276,10 +281,38 @@ static Bp_EC sample_aligner_get_stats(Filter_t* self, void* stats_out)
   return Bp_EC_OK;
 }
 
+// Checkpoint: output grid and phase statistics. The history buffer is not
+// used by the passthrough path yet, so it is not saved.
+static Bp_EC sample_aligner_checkpoint(Filter_t* self, Checkpoint_t* ck)
+{
+  SampleAligner_t* sa = (SampleAligner_t*) self;
+  Bp_EC err = CKPT_PUT(ck, sa->initialized);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, sa->period_ns);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, sa->next_output_ns);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, sa->samples_interpolated);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, sa->max_phase_correction_ns);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, sa->total_phase_correction_ns);
+  return err;
+}
+
+static Bp_EC sample_aligner_restore(Filter_t* self, Checkpoint_t* ck)
+{
+  SampleAligner_t* sa = (SampleAligner_t*) self;
+  Bp_EC err = CKPT_GET(ck, sa->initialized);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, sa->period_ns);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, sa->next_output_ns);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, sa->samples_interpolated);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, sa->max_phase_correction_ns);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, sa->total_phase_correction_ns);
+  return err;
+}
+
 // Initialize function
 Bp_EC sample_aligner_init(SampleAligner_t* f, SampleAligner_config_t config)
 {
   if (f == NULL) return Bp_EC_INVALID_CONFIG;
+  // Alignment needs a sample grid; record streams have none
+  if (config.buff_config.dtype == DTYPE_RECORD) return Bp_EC_INVALID_CONFIG;
 
   // Build core config
   Core_filt_config_t core_config = {
@@ -317,6 +350,8 @@ Bp_EC sample_aligner_init(SampleAligner_t* f, SampleAligner_config_t config)
   f->base.ops.deinit = sample_aligner_deinit;
   f->base.ops.describe = sample_aligner_describe;
   f->base.ops.get_stats = sample_aligner_get_stats;
+  f->base.ops.checkpoint = sample_aligner_checkpoint;
+  f->base.ops.restore = sample_aligner_restore;
 
   // Set input constraints
   prop_constraints_from_buffer_append(&f->base, &config.buff_config, true);
@@ -110,6 +110,23 @@ static void send_completion_to_sinks(Filter_t* filter)
   }
 }
 
+// Checkpoint: the generator resumes on its sample grid and waveform phase
+static Bp_EC signal_generator_checkpoint(Filter_t* self, Checkpoint_t* ck)
+{
+  SignalGenerator_t* sg = (SignalGenerator_t*) self;
+  Bp_EC err = CKPT_PUT(ck, sg->next_t_ns);
+  if (err == Bp_EC_OK) err = CKPT_PUT(ck, sg->samples_generated);
+  return err;
+}
+
+static Bp_EC signal_generator_restore(Filter_t* self, Checkpoint_t* ck)
+{
+  SignalGenerator_t* sg = (SignalGenerator_t*) self;
+  Bp_EC err = CKPT_GET(ck, sg->next_t_ns);
+  if (err == Bp_EC_OK) err = CKPT_GET(ck, sg->samples_generated);
+  return err;
+}
+
 // Worker thread function
 void* signal_generator_worker(void* arg)
 {
@@ -127,8 +144,8 @@ void* signal_generator_worker(void* arg)
                      Bp_EC_INVALID_CONFIG);
   }
 
-  // Initialize timing
-  sg->next_t_ns = sg->start_time_ns;
+  // Initialize timing, unless resuming from a checkpoint
+  if (sg->samples_generated == 0) sg->next_t_ns = sg->start_time_ns;
 
   while (atomic_load(&sg->base.running)) {
     // Get output batch
@@ -235,6 +252,9 @@ Bp_EC signal_generator_init(SignalGenerator_t* sg,
   sg->next_t_ns = 0;
   sg->samples_generated = 0;
 
+  sg->base.ops.checkpoint = signal_generator_checkpoint;
+  sg->base.ops.restore = signal_generator_restore;
+
   // Signal generator has no input constraints (source filter)
   // Configure output behaviors using the new pattern
 
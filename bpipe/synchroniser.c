@@ -0,0 +1,312 @@
+#include "synchroniser.h"
+#include <string.h>
+#include "utils.h"
+
+/* Time of the next unconsumed frame on an input */
+static inline long long cursor_t_ns(const Synchroniser_t* s, size_t i)
+{
+  const SyncCursor_t* c = &s->cursors[i];
+  return c->batch->t_ns + (long long) (c->offset * s->period_ns);
+}
+
+static inline size_t cursor_remaining(const SyncCursor_t* c)
+{
+  return c->batch->head - c->offset;
+}
+
+static inline bool cursor_exhausted(const SyncCursor_t* c)
+{
+  return !c->batch || c->offset >= c->batch->head;
+}
+
+/* Make sure input i holds a batch with unconsumed frames. Returns
+ * Bp_EC_COMPLETE at end of stream, Bp_EC_STOPPED when shut down. A batch that
+ * does not continue where the previous one ended clears `aligned`. */
+static Bp_EC sync_fetch(Synchroniser_t* s, size_t i)
+{
+  Filter_t* f = &s->base;
+  SyncCursor_t* c = &s->cursors[i];
+
+  while (cursor_exhausted(c)) {
+    if (c->batch) {
+      bb_del_tail(f->input_buffers[i]);
+      c->batch = NULL;
+    }
+
+    Bp_EC err;
+    Batch_t* batch = bb_get_tail(f->input_buffers[i], f->timeout_us, &err);
+    if (!batch) {
+      if (err == Bp_EC_TIMEOUT && atomic_load(&f->running)) continue;
+      return err == Bp_EC_TIMEOUT ? Bp_EC_STOPPED : err;
+    }
+    /* All inputs must share one regular grid. A rejected batch is released
+     * like an end-of-stream one, so the ring is not left with its tail out */
+    err = batch->ec;
+    if (err == Bp_EC_OK && batch->period_ns == 0) err = Bp_EC_INVALID_DATA;
+    if (err == Bp_EC_OK && s->period_ns == 0) {
+      s->period_ns = batch->period_ns;
+      s->phase_ns = batch->t_ns % (long long) s->period_ns;
+    }
+    if (err == Bp_EC_OK && batch->period_ns != s->period_ns) {
+      err = Bp_EC_PROPERTY_MISMATCH;
+    }
+    if (err == Bp_EC_OK &&
+        batch->t_ns % (long long) s->period_ns != s->phase_ns) {
+      err = Bp_EC_PHASE_ERROR;
+    }
+    if (err != Bp_EC_OK) {
+      bb_del_tail(f->input_buffers[i]);
+      return err;
+    }
+
+    if (batch->t_ns != c->next_t_ns) {
+      if (c->next_t_ns >= 0) s->realignments++;
+      s->aligned = false;
+    }
+    c->next_t_ns = batch->t_ns + (long long) (batch->head * s->period_ns);
+    c->batch = batch;
+    c->offset = 0;
+  }
+  return Bp_EC_OK;
+}
+
+static void sync_submit_outputs(Synchroniser_t* s)
+{
+  Filter_t* f = &s->base;
+  if (!s->outputs[0]) return;
+  for (size_t i = 0; i < s->n_inputs; i++) {
+    s->outputs[i]->head = s->accumulated;
+    s->outputs[i]->batch_id = s->batches_emitted;
+    bb_submit(f->sinks[i], f->timeout_us);
+    s->outputs[i] = NULL;
+  }
+  s->batches_emitted++;
+  s->accumulated = 0;
+  f->metrics.n_batches++;
+}
+
+/* Fetch on every input; on success all cursors hold data. The worker sleeps
+ * on all missing inputs at once and takes them in the order their data
+ * arrives, rather than blocking on each in turn. */
+static Bp_EC sync_fetch_all(Synchroniser_t* s)
+{
+  Filter_t* f = &s->base;
+  for (;;) {
+    uint32_t want = 0, ready;
+    for (size_t i = 0; i < s->n_inputs; i++) {
+      SyncCursor_t* c = &s->cursors[i];
+      if (!cursor_exhausted(c)) continue;
+      if (c->batch) { /* A held tail would keep the input ready */
+        bb_del_tail(f->input_buffers[i]);
+        c->batch = NULL;
+      }
+      want |= 1u << i;
+    }
+    if (want == 0) return Bp_EC_OK;
+
+    Bp_EC err = filt_await_inputs(f, &s->ws, want, &ready);
+    if (err == Bp_EC_TIMEOUT) continue;
+    if (err != Bp_EC_OK) return err;
+    for (size_t i = 0; i < s->n_inputs; i++) {
+      if (!(ready & (1u << i))) continue;
+      err = sync_fetch(s, i);
+      if (err != Bp_EC_OK) return err;
+    }
+  }
+}
+
+/* Trim every input forward to the latest cursor time. Whole spans are
+ * skipped at once; fetching a new batch may reveal another gap, in which
+ * case the caller simply runs this again. */
+static Bp_EC sync_align(Synchroniser_t* s)
+{
+  /* Output batches must not straddle a discontinuity */
+  if (s->accumulated > 0) sync_submit_outputs(s);
+
+  s->aligned = true;
+  long long target = cursor_t_ns(s, 0);
+  for (size_t i = 1; i < s->n_inputs; i++) {
+    target = MAX(target, cursor_t_ns(s, i));
+  }
+
+  for (size_t i = 0; i < s->n_inputs; i++) {
+    long long t = cursor_t_ns(s, i);
+    while (t < target) {
+      size_t skip = (size_t) ((target - t) / (long long) s->period_ns);
+      size_t n = MIN(skip, cursor_remaining(&s->cursors[i]));
+      s->cursors[i].offset += n;
+      s->samples_trimmed += n;
+      Bp_EC err = sync_fetch(s, i);
+      if (err != Bp_EC_OK) return err;
+      if (!s->aligned) return Bp_EC_OK; /* New gap: start over */
+      t = cursor_t_ns(s, i);
+    }
+    if (t != target) s->aligned = false; /* Overshot after a gap */
+  }
+  return Bp_EC_OK;
+}
+
+static void* synchroniser_worker(void* arg)
+{
+  Synchroniser_t* s = (Synchroniser_t*) arg;
+  Filter_t* f = &s->base;
+
+  /* Every input needs its partner output, all with the same geometry */
+  size_t out_samples = SIZE_MAX;
+  for (size_t i = 0; i < s->n_inputs; i++) {
+    BP_WORKER_ASSERT(f, f->sinks[i] != NULL, Bp_EC_NO_SINK);
+    BP_WORKER_ASSERT(f, f->sinks[i]->dtype == f->input_buffers[i]->dtype,
+                     Bp_EC_DTYPE_MISMATCH);
+    BP_WORKER_ASSERT(
+        f, f->sinks[i]->n_channels == f->input_buffers[i]->n_channels,
+        Bp_EC_WIDTH_MISMATCH);
+    out_samples = MIN(out_samples, (size_t) bb_batch_size(f->sinks[i]));
+  }
+  if (s->output_batch_samples == 0 || s->output_batch_samples > out_samples) {
+    s->output_batch_samples = out_samples;
+  }
+
+  s->period_ns = 0;
+  s->phase_ns = 0;
+  s->accumulated = 0;
+  s->aligned = false;
+  for (size_t i = 0; i < s->n_inputs; i++) {
+    s->cursors[i] = (SyncCursor_t){.batch = NULL, .offset = 0, .next_t_ns = -1};
+    s->outputs[i] = NULL;
+  }
+
+  Bp_EC err = filt_waitset_inputs(f, &s->ws);
+  BP_WORKER_ASSERT(f, err == Bp_EC_OK, err);
+  while (atomic_load(&f->running)) {
+    err = sync_fetch_all(s);
+    if (err != Bp_EC_OK) break;
+
+    if (!s->aligned) {
+      err = sync_align(s);
+      if (err != Bp_EC_OK) break;
+      continue;
+    }
+
+    /* Largest span available on every input and fitting the output */
+    size_t n = s->output_batch_samples - s->accumulated;
+    for (size_t i = 0; i < s->n_inputs; i++) {
+      n = MIN(n, cursor_remaining(&s->cursors[i]));
+    }
+
+    if (!s->outputs[0]) {
+      long long t0 = cursor_t_ns(s, 0);
+      for (size_t i = 0; i < s->n_inputs; i++) {
+        Batch_t* out = bb_get_head(f->sinks[i]);
+        out->t_ns = t0;
+        out->period_ns = (unsigned) s->period_ns;
+        out->head = 0;
+        out->ec = Bp_EC_OK;
+        s->outputs[i] = out;
+      }
+    }
+
+    for (size_t i = 0; i < s->n_inputs; i++) {
+      SyncCursor_t* c = &s->cursors[i];
+      bb_copy_frames(f->sinks[i], s->outputs[i], s->accumulated,
+                     f->input_buffers[i], c->batch, c->offset, n);
+      c->offset += n;
+    }
+    s->accumulated += n;
+    f->metrics.samples_processed += n;
+
+    if (s->accumulated == s->output_batch_samples) sync_submit_outputs(s);
+  }
+
+  /* Flush what is aligned, then terminate every output */
+  if (err == Bp_EC_COMPLETE || err == Bp_EC_STOPPED) {
+    if (s->accumulated > 0) sync_submit_outputs(s);
+    for (size_t i = 0; i < s->n_inputs; i++) {
+      if (s->outputs[i]) continue;
+      Batch_t* done = bb_get_head(f->sinks[i]);
+      done->head = 0;
+      done->ec = Bp_EC_COMPLETE;
+      bb_submit(f->sinks[i], f->timeout_us);
+    }
+  }
+  for (size_t i = 0; i < s->n_inputs; i++) {
+    if (s->cursors[i].batch) {
+      bb_del_tail(f->input_buffers[i]);
+      s->cursors[i].batch = NULL;
+    }
+  }
+  bb_waitset_deinit(&s->ws);
+  BP_WORKER_ASSERT(f, err == Bp_EC_OK || err == Bp_EC_COMPLETE ||
+                          err == Bp_EC_STOPPED ||
+                          err == Bp_EC_FILTER_STOPPING,
+                   err);
+  return NULL;
+}
+
+static Bp_EC synchroniser_describe(Filter_t* self, char* buffer, size_t size)
+{
+  Synchroniser_t* s = (Synchroniser_t*) self;
+  snprintf(buffer, size,
+           "Synchroniser: %s\n"
+           "  Ports: %zu\n"
+           "  Output batch size: %zu samples\n"
+           "  Period: %lu ns\n"
+           "  Batches emitted: %lu\n"
+           "  Samples trimmed: %lu\n"
+           "  Realignments: %lu\n",
+           self->name, s->n_inputs, s->output_batch_samples, s->period_ns,
+           s->batches_emitted, s->samples_trimmed, s->realignments);
+  return Bp_EC_OK;
+}
+
+Bp_EC synchroniser_init(Synchroniser_t* sync, Synchroniser_config_t config)
+{
+  if (sync == NULL) return Bp_EC_NULL_FILTER;
+  if (config.n_inputs < 2 || config.n_inputs > MAX_INPUTS ||
+      config.n_inputs > MAX_SINKS) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+  /* Alignment trims and rechunks samples; record streams have none */
+  if (config.buff_config.dtype == DTYPE_RECORD) return Bp_EC_INVALID_CONFIG;
+
+  Core_filt_config_t core_config = {
+      .name = config.name,
+      .filt_type = FILT_T_MIMO_SYNCRONISER,
+      .size = sizeof(Synchroniser_t),
+      .n_inputs = config.n_inputs,
+      .max_supported_sinks = config.n_inputs,
+      .buff_config = config.buff_config,
+      .timeout_us = config.timeout_us > 0 ? config.timeout_us : 1000000,
+      .worker = synchroniser_worker};
+
+  Bp_EC err = filt_init(&sync->base, core_config);
+  if (err != Bp_EC_OK) return err;
+
+  sync->n_inputs = config.n_inputs;
+  sync->output_batch_samples = config.output_batch_samples;
+  memset(sync->cursors, 0, sizeof(sync->cursors));
+  memset(sync->outputs, 0, sizeof(sync->outputs));
+  sync->accumulated = 0;
+  sync->period_ns = 0;
+  sync->phase_ns = 0;
+  sync->aligned = false;
+  sync->samples_trimmed = 0;
+  sync->realignments = 0;
+  sync->batches_emitted = 0;
+
+  sync->base.ops.describe = synchroniser_describe;
+
+  /* Regular inputs with one shared period and dtype */
+  prop_constraints_from_buffer_append(&sync->base, &config.buff_config, true);
+  prop_append_constraint(&sync->base, PROP_SAMPLE_PERIOD_NS,
+                         CONSTRAINT_OP_EXISTS, NULL, INPUT_ALL);
+  prop_append_constraint(&sync->base, PROP_SAMPLE_PERIOD_NS,
+                         CONSTRAINT_OP_MULTI_INPUT_ALIGNED, NULL, INPUT_ALL);
+  prop_append_constraint(&sync->base, PROP_DATA_TYPE,
+                         CONSTRAINT_OP_MULTI_INPUT_ALIGNED, NULL, INPUT_ALL);
+
+  /* Re-chunked, possibly partial at gaps and end of stream */
+  prop_set_output_behavior_for_buffer_filter(&sync->base, &config.buff_config,
+                                             true, false);
+
+  return Bp_EC_OK;
+}
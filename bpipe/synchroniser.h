@@ -0,0 +1,54 @@
+#ifndef BPIPE_SYNCHRONISER_H
+#define BPIPE_SYNCHRONISER_H
+
+#include "batch_buffer.h"
+#include "core.h"
+
+/* Synchroniser: N regular inputs -> N outputs on a common time grid.
+ *
+ * Inputs must share period_ns and sample phase (t_ns % period_ns); use a
+ * SampleAligner upstream otherwise. Leading samples are trimmed so every
+ * stream starts at the same grid point, and output i carries input i
+ * re-chunked so that batch k on every port has the same t_ns and head.
+ * After a gap on any input the other inputs are trimmed forward again,
+ * so outputs only ever cover time ranges present on all inputs.
+ */
+
+typedef struct _Synchroniser_config_t {
+  const char* name;
+  BatchBuffer_config buff_config; /* Applied to every input */
+  size_t n_inputs;                /* 2..MAX_INPUTS, one output per input */
+  size_t output_batch_samples;    /* 0 = smallest connected sink capacity */
+  long timeout_us;
+} Synchroniser_config_t;
+
+typedef struct _SyncCursor_t {
+  Batch_t* batch;      /* Input batch currently held, NULL if none */
+  size_t offset;       /* Frames of `batch` already consumed */
+  long long next_t_ns; /* Expected t_ns of the next input batch */
+} SyncCursor_t;
+
+typedef struct _Synchroniser_t {
+  Filter_t base;
+
+  size_t n_inputs;
+  size_t output_batch_samples; /* Resolved at worker start */
+
+  /* Runtime state */
+  BbWaitSet_t ws; /* All inputs, registered while the worker runs */
+  SyncCursor_t cursors[MAX_INPUTS];
+  Batch_t* outputs[MAX_INPUTS]; /* Open output batches, all or none */
+  size_t accumulated;           /* Frames in each open output batch */
+  uint64_t period_ns;           /* Common period, from first batch */
+  long long phase_ns;           /* t_ns % period_ns shared by all inputs */
+  bool aligned;                 /* Cursors sit on the same grid point */
+
+  /* Statistics */
+  uint64_t samples_trimmed; /* Dropped while (re)aligning, all inputs */
+  uint64_t realignments;    /* Gaps that forced a re-trim */
+  uint64_t batches_emitted; /* Per port */
+} Synchroniser_t;
+
+Bp_EC synchroniser_init(Synchroniser_t* sync, Synchroniser_config_t config);
+
+#endif /* BPIPE_SYNCHRONISER_H */
@@ -32,10 +32,10 @@ static void* tee_worker(void* arg)
       // Copy metadata
       output->head = input->head;  // Number of samples
 
-      // Deep copy data
-      size_t data_width = bb_getdatawidth(f->input_buffers[0]->dtype);
-      size_t data_size = input->head * data_width;
-      memcpy(output->data, input->data, data_size);
+      // Deep copy data, all channels at once (transposed if the output
+      // layout differs from the input layout)
+      bb_copy_frames(f->sinks[i], output, 0, f->input_buffers[0], input, 0,
+                     input->head);
       output->t_ns = input->t_ns;
       output->period_ns = input->period_ns;
       output->batch_id = input->batch_id;
@@ -80,6 +80,18 @@ Bp_EC tee_init(Tee_filt_t* tee, Tee_config_t config)
     }
   }
 
+  // Outputs carry the same channel count; layouts may differ
+  size_t n_channels =
+      config.buff_config.n_channels ? config.buff_config.n_channels : 1;
+  for (size_t i = 0; i < config.n_outputs; i++) {
+    size_t out_channels = config.output_configs[i].n_channels
+                              ? config.output_configs[i].n_channels
+                              : 1;
+    if (out_channels != n_channels) {
+      return Bp_EC_WIDTH_MISMATCH;
+    }
+  }
+
   // Option B: Validate all outputs have same batch size as input
   size_t input_batch_size = 1 << config.buff_config.batch_capacity_expo;
   for (size_t i = 0; i < config.n_outputs; i++) {
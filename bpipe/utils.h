@@ -29,6 +29,14 @@
     }                                               \
   } while (false)
 
+/* True for the normal ways a worker loop ends (stop, timeout, end of
+ * stream). Workers finish with
+ *   BP_WORKER_ASSERT(f, BP_WORKER_CLEAN_EXIT(err), err);
+ * so any other error is recorded with its location. */
+#define BP_WORKER_CLEAN_EXIT(err)                 \
+  ((err) == Bp_EC_OK || (err) == Bp_EC_STOPPED || \
+   (err) == Bp_EC_TIMEOUT || (err) == Bp_EC_COMPLETE)
+
 #endif /* BPIPE_UTILS_H */
 
 #define PI 3.1415  // TODO
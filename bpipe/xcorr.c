@@ -0,0 +1,318 @@
+#include "xcorr.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+/* Below this magnitude a PHAT bin carries no usable phase */
+#define XCORR_PHAT_EPS 1e-12f
+
+/* Copy what input i can contribute to its block; the worker calls this once
+ * the input is ready. Returns Bp_EC_COMPLETE at end of stream. */
+static Bp_EC xcorr_take(XCorr_t* xc, size_t i)
+{
+  Filter_t* f = &xc->base;
+  Batch_buff_t* in_buf = f->input_buffers[i];
+  const size_t n_block = xc->block_samples;
+
+  if (xc->held[i] == NULL) {
+    Bp_EC err;
+    Batch_t* batch = bb_get_tail(in_buf, f->timeout_us, &err);
+    if (!batch) return err;
+    if (batch->ec != Bp_EC_OK) {
+      bb_del_tail(in_buf);
+      return batch->ec;
+    }
+    if (batch->period_ns == 0 || bb_batch_has_ts(batch)) {
+      bb_del_tail(in_buf);
+      return Bp_EC_INVALID_DATA;
+    }
+    if (xc->period_ns == 0) xc->period_ns = batch->period_ns;
+    if (batch->period_ns != xc->period_ns) {
+      bb_del_tail(in_buf);
+      return Bp_EC_PROPERTY_MISMATCH;
+    }
+    xc->held[i] = batch;
+    xc->offset[i] = 0;
+  }
+
+  Batch_t* batch = xc->held[i];
+  if (xc->filled[i] == 0) {
+    xc->block_t_ns[i] =
+        batch->t_ns + (long long) (xc->offset[i] * xc->period_ns);
+  }
+  size_t n = MIN(batch->head - xc->offset[i], n_block - xc->filled[i]);
+  memcpy(xc->block[i] + xc->filled[i],
+         (const float*) batch->data + xc->offset[i], n * sizeof(float));
+  xc->filled[i] += n;
+  xc->offset[i] += n;
+  if (xc->offset[i] >= batch->head) {
+    bb_del_tail(in_buf);
+    xc->held[i] = NULL;
+  }
+  return Bp_EC_OK;
+}
+
+static float xcorr_energy(const float* x, size_t n)
+{
+  double e = 0.0;
+  for (size_t k = 0; k < n; k++) e += (double) x[k] * x[k];
+  return (float) e;
+}
+
+/* r[l] scaled by n / (n - |l|). Only n - |l| products overlap at lag l;
+ * without this the triangular taper drags the interpolated peak towards
+ * zero lag by about 1 / (n * curvature). |l| <= n / 2 + 1 here, so the
+ * scale stays near 2 at most. */
+static inline float xcorr_unbiased(const float* corr, long l, size_t n)
+{
+  size_t m = 2 * n;
+  size_t overlap = n - (size_t) (l < 0 ? -l : l);
+  return corr[(size_t) l & (m - 1)] * ((float) n / (float) overlap);
+}
+
+/* Correlate the two full blocks; lag and peak height out */
+static void xcorr_block(XCorr_t* xc, float* lag_out, float* peak_out)
+{
+  const size_t n = xc->block_samples;
+  const size_t m = xc->plan.n; /* 2n */
+  float* re = xc->re;
+  float* im = xc->im;
+
+  /* z = x0 + i x1, zero padded */
+  memcpy(re, xc->block[0], n * sizeof(float));
+  memcpy(im, xc->block[1], n * sizeof(float));
+  memset(re + n, 0, n * sizeof(float));
+  memset(im + n, 0, n * sizeof(float));
+  fft_forward(&xc->plan, re, im);
+
+  /* X0 = (Z[k] + conj Z[-k]) / 2, X1 = (Z[k] - conj Z[-k]) / 2i, and the
+   * cross-spectrum conj(X0) X1 */
+  for (size_t k = 0; k < m; k++) {
+    size_t km = (m - k) & (m - 1);
+    float a = re[k], b = im[k], c = re[km], d = im[km];
+    float p = 0.5f * (a + c), q = 0.5f * (b - d);
+    float r = 0.5f * (b + d), s = 0.5f * (c - a);
+    float sr = p * r + q * s;
+    float si = p * s - q * r;
+    if (xc->phat) {
+      float mag = sqrtf(sr * sr + si * si);
+      float w = mag > XCORR_PHAT_EPS ? 1.0f / mag : 0.0f;
+      sr *= w;
+      si *= w;
+    }
+    xc->spec_re[k] = sr;
+    xc->spec_im[k] = si;
+  }
+  fft_inverse(&xc->plan, xc->spec_re, xc->spec_im);
+  const float* corr = xc->spec_re; /* r[l] at l mod 2n */
+
+  long best = 0;
+  float best_v = -INFINITY;
+  const long max_lag = (long) xc->max_lag;
+  for (long l = -max_lag; l <= max_lag; l++) {
+    float v = xcorr_unbiased(corr, l, n);
+    if (v > best_v) {
+      best_v = v;
+      best = l;
+    }
+  }
+
+  /* Parabola through the peak and its neighbours */
+  float ym = xcorr_unbiased(corr, best - 1, n);
+  float yp = xcorr_unbiased(corr, best + 1, n);
+  float denom = ym - 2.0f * best_v + yp;
+  float delta = 0.0f, peak = best_v;
+  if (denom < 0.0f) {
+    delta = 0.5f * (ym - yp) / denom;
+    delta = delta < -0.5f ? -0.5f : (delta > 0.5f ? 0.5f : delta);
+    peak = best_v - 0.25f * (ym - yp) * delta;
+  }
+
+  if (!xc->phat) {
+    float norm = sqrtf(xcorr_energy(xc->block[0], n) *
+                       xcorr_energy(xc->block[1], n));
+    peak = norm > 0.0f ? peak / norm : 0.0f;
+  }
+  *lag_out = (float) best + delta;
+  *peak_out = peak;
+}
+
+static void* xcorr_worker(void* arg)
+{
+  XCorr_t* xc = (XCorr_t*) arg;
+  Filter_t* f = &xc->base;
+  Batch_buff_t* out_buf = f->sinks[0];
+  Bp_EC err = Bp_EC_OK;
+
+  BP_WORKER_ASSERT(f, out_buf != NULL, Bp_EC_NO_SINK);
+
+  for (size_t i = 0; i < 2; i++) {
+    xc->held[i] = NULL;
+    xc->filled[i] = 0;
+  }
+  xc->period_ns = 0;
+
+  err = filt_waitset_inputs(f, &xc->ws);
+  BP_WORKER_ASSERT(f, err == Bp_EC_OK, err);
+
+  while (atomic_load(&f->running)) {
+    /* Take from whichever input has data, so an idle one cannot hold up
+     * the other's producer */
+    uint32_t want = 0, ready;
+    for (size_t i = 0; i < 2; i++) {
+      if (xc->filled[i] < xc->block_samples) want |= 1u << i;
+    }
+    err = filt_await_inputs(f, &xc->ws, want, &ready);
+    if (err == Bp_EC_TIMEOUT) {
+      err = Bp_EC_OK;
+      continue;
+    }
+    for (size_t i = 0; i < 2 && err == Bp_EC_OK; i++) {
+      if (ready & (1u << i)) err = xcorr_take(xc, i);
+    }
+    if (err != Bp_EC_OK) break;
+    if (xc->filled[0] < xc->block_samples ||
+        xc->filled[1] < xc->block_samples) {
+      continue;
+    }
+
+    BP_WORKER_ASSERT(f, xc->block_t_ns[0] == xc->block_t_ns[1],
+                     Bp_EC_PHASE_ERROR);
+
+    float lag, peak;
+    xcorr_block(xc, &lag, &peak);
+    xc->filled[0] = xc->filled[1] = 0;
+
+    Batch_t* out = bb_get_head(out_buf);
+    float* frame = (float*) out->data;
+    frame[0] = lag;
+    frame[1] = peak;
+    out->head = 1;
+    out->t_ns = xc->block_t_ns[0];
+    out->period_ns = (unsigned) (xc->period_ns * xc->block_samples);
+    out->batch_id = xc->blocks_emitted;
+    out->ec = Bp_EC_OK;
+    xc->last_lag = lag;
+    xc->last_peak = peak;
+    xc->blocks_emitted++;
+    f->metrics.samples_processed += xc->block_samples;
+    f->metrics.n_batches++;
+    err = bb_submit(out_buf, f->timeout_us);
+    if (err != Bp_EC_OK) break;
+  }
+
+  for (size_t i = 0; i < 2; i++) {
+    if (xc->held[i]) {
+      bb_del_tail(f->input_buffers[i]);
+      xc->held[i] = NULL;
+    }
+  }
+
+  bb_waitset_deinit(&xc->ws);
+
+  if (err == Bp_EC_COMPLETE) filt_send_complete(f, out_buf);
+  BP_WORKER_ASSERT(f, BP_WORKER_CLEAN_EXIT(err), err);
+  return NULL;
+}
+
+/* Output frames are [lag, peak], not the input's single channel */
+static Bp_EC xcorr_sink_connect(Filter_t* self, size_t output_port,
+                                Batch_buff_t* sink)
+{
+  return filt_attach_sink(self, output_port, sink, DTYPE_FLOAT, 2);
+}
+
+static Bp_EC xcorr_describe(Filter_t* self, char* buffer, size_t size)
+{
+  XCorr_t* xc = (XCorr_t*) self;
+  if (buffer == NULL) return Bp_EC_NULL_POINTER;
+
+  snprintf(buffer, size,
+           "XCorr: %s\n"
+           "  Block: %zu samples, FFT %zu, max lag %zu%s\n"
+           "  Blocks: %llu, last lag %.3f, peak %.3f",
+           self->name, xc->block_samples, xc->plan.n, xc->max_lag,
+           xc->phat ? ", GCC-PHAT" : "",
+           (unsigned long long) xc->blocks_emitted, (double) xc->last_lag,
+           (double) xc->last_peak);
+  return Bp_EC_OK;
+}
+
+static void xcorr_free(XCorr_t* xc)
+{
+  fft_plan_deinit(&xc->plan);
+  free(xc->block[0]); /* One allocation for every work array */
+  xc->block[0] = xc->block[1] = NULL;
+  xc->re = xc->im = xc->spec_re = xc->spec_im = NULL;
+}
+
+static Bp_EC xcorr_deinit(Filter_t* self)
+{
+  xcorr_free((XCorr_t*) self);
+
+  filt_release_inputs(self);
+  return Bp_EC_OK;
+}
+
+Bp_EC xcorr_init(XCorr_t* xc, XCorr_config_t config)
+{
+  if (xc == NULL) return Bp_EC_NULL_FILTER;
+  if (config.buff_config.dtype != DTYPE_FLOAT ||
+      config.buff_config.n_channels > 1) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+  if (config.block_expo < XCORR_MIN_BLOCK_EXPO ||
+      config.block_expo > XCORR_MAX_BLOCK_EXPO) {
+    return Bp_EC_INVALID_CONFIG;
+  }
+  const size_t n = (size_t) 1 << config.block_expo;
+  if (config.max_lag > n / 2) return Bp_EC_INVALID_CONFIG;
+
+  Core_filt_config_t core_config = {
+      .name = config.name,
+      .filt_type = FILT_T_XCORR,
+      .size = sizeof(XCorr_t),
+      .n_inputs = 2,
+      .max_supported_sinks = 1,
+      .buff_config = config.buff_config,
+      .timeout_us = config.timeout_us > 0 ? config.timeout_us : 1000000,
+      .worker = xcorr_worker};
+
+  Bp_EC err = filt_init(&xc->base, core_config);
+  if (err != Bp_EC_OK) return err;
+
+  xc->block_samples = n;
+  xc->max_lag = config.max_lag ? config.max_lag : n / 2;
+  xc->phat = config.phat;
+  xc->blocks_emitted = 0;
+  xc->last_lag = 0.0f;
+  xc->last_peak = 0.0f;
+
+  /* Two blocks of n, four work arrays of 2n */
+  float* mem = malloc(10 * n * sizeof(float));
+  err = mem ? fft_plan_init(&xc->plan, config.block_expo + 1)
+            : Bp_EC_MALLOC_FAIL;
+  if (err != Bp_EC_OK) {
+    free(mem);
+    filt_deinit(&xc->base);
+    return err;
+  }
+  xc->block[0] = mem;
+  xc->block[1] = mem + n;
+  xc->re = mem + 2 * n;
+  xc->im = xc->re + 2 * n;
+  xc->spec_re = xc->im + 2 * n;
+  xc->spec_im = xc->spec_re + 2 * n;
+
+  xc->base.ops.describe = xcorr_describe;
+  xc->base.ops.sink_connect = xcorr_sink_connect;
+  xc->base.ops.deinit = xcorr_deinit;
+
+  prop_constraints_from_buffer_append(&xc->base, &config.buff_config, true);
+  xc->base.output_properties[0] =
+      prop_propagate(NULL, 0, &xc->base.contract, 0);
+
+  return Bp_EC_OK;
+}
@@ -0,0 +1,80 @@
+#ifndef BPIPE_XCORR_H
+#define BPIPE_XCORR_H
+
+#include "batch_buffer.h"
+#include "core.h"
+#include "fft.h"
+
+/* XCorr: block cross-correlation and time-delay estimation between two
+ * aligned streams.
+ *
+ * Inputs 0 and 1 are single-channel DTYPE_FLOAT with the same regular
+ * period and sample grid (a Synchroniser upstream provides this). Every
+ * block of N = 2^block_expo samples is correlated through the FFT:
+ *
+ *   r[l] = sum_n x0[n] x1[n + l],   |l| <= max_lag <= N / 2
+ *
+ * zero padded to 2N so the correlation is linear, not circular. Each lag
+ * is scaled by N / (N - |l|), the unbiased estimate, so the block edges do
+ * not pull the interpolated peak towards zero. With `phat` the
+ * cross-spectrum is whitened first (GCC-PHAT), which sharpens the peak for
+ * broadband signals and in reverberant conditions.
+ *
+ * The output is DTYPE_FLOAT with 2 channels, one frame per block:
+ *   [0] lag of the peak in samples, refined by parabolic interpolation.
+ *       A positive lag means input 1 is delayed relative to input 0.
+ *   [1] peak height: r normalised by sqrt(E0 * E1), close to 1 for a
+ *       clean match, or the raw GCC-PHAT value with `phat`.
+ * Each frame is stamped with its block's start time; period_ns is N times
+ * the input period.
+ *
+ * Both inputs go into one complex FFT, as its real and imaginary parts,
+ * and are separated by symmetry; the inverse transform gives r. The FFT
+ * plan and all work arrays are allocated in init, so the steady state is
+ * allocation-free. A partial block at end of stream is dropped.
+ */
+
+#define XCORR_MIN_BLOCK_EXPO 2
+#define XCORR_MAX_BLOCK_EXPO 16
+
+typedef struct _XCorr_config_t {
+  const char* name;
+  BatchBuffer_config buff_config; /* Both inputs: FLOAT, one channel */
+  size_t block_expo;              /* N = 2^block_expo samples per block */
+  size_t max_lag;                 /* Search range, <= N / 2; 0 = N / 2 */
+  bool phat;                      /* GCC-PHAT weighting */
+  long timeout_us;
+} XCorr_config_t;
+
+typedef struct _XCorr_t {
+  Filter_t base;
+
+  size_t block_samples;
+  size_t max_lag;
+  bool phat;
+
+  /* Planned once in init */
+  FftPlan_t plan; /* Size 2N */
+  float* block[2];  /* Samples collected for the current block */
+  float* re;        /* 2N work arrays */
+  float* im;
+  float* spec_re;
+  float* spec_im;
+
+  /* Runtime state */
+  BbWaitSet_t ws;   /* Both inputs, registered while the worker runs */
+  Batch_t* held[2]; /* Input batch being consumed, NULL if none */
+  size_t offset[2]; /* Frames of held[i] already consumed */
+  size_t filled[2];
+  long long block_t_ns[2];
+  uint64_t period_ns; /* Common input period, from the first batch */
+
+  /* Statistics */
+  uint64_t blocks_emitted;
+  float last_lag;
+  float last_peak;
+} XCorr_t;
+
+Bp_EC xcorr_init(XCorr_t* xc, XCorr_config_t config);
+
+#endif /* BPIPE_XCORR_H */
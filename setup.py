@@ -0,0 +1,23 @@
+"""Build the bpipe C extension: python setup.py build_ext --inplace"""
+
+from glob import glob
+
+from setuptools import Extension, setup
+
+sources = ["bpipe/py/bpipe_module.c"] + sorted(glob("bpipe/*.c"))
+
+setup(
+    name="bpipe",
+    version="0.1.0",
+    packages=["bpipe"],
+    ext_modules=[
+        Extension(
+            "bpipe._bpipe",
+            sources=sources,
+            include_dirs=["bpipe"],
+            extra_compile_args=["-std=c99", "-pthread"],
+            extra_link_args=["-pthread"],
+            libraries=["m"],
+        )
+    ],
+)
@@ -270,7 +270,7 @@ void test_partial_batch_handling(void)
     size_t n_batches = sizeof(batch_sizes) / sizeof(batch_sizes[0]);
     
     // Create variable batch producer that generates specified batch sizes
-    VariableBatchProducer_t producer;
+    VariableBatchProducer_t producer = {0};
     VariableBatchProducerConfig_t prod_config = {
         .name = "partial_batch_producer",
         .timeout_us = 1000000,
@@ -284,7 +284,7 @@ void test_partial_batch_handling(void)
     CHECK_ERR(variable_batch_producer_init(&producer, prod_config));
     
     // Create test consumer to validate output
-    ControllableConsumer_t consumer;
+    ControllableConsumer_t consumer = {0};
     ControllableConsumerConfig_t consumer_config = {
         .name = "partial_batch_consumer",
         .buff_config = {
@@ -416,7 +416,7 @@ void test_data_type_compatibility(void)
         }
         
         // Create appropriate signal generator
-        SignalGenerator_t generator;
+        SignalGenerator_t generator = {0};
         SignalGenerator_config_t gen_config = {
             .name = "dtype_test_gen",
             .buff_config = {
@@ -438,7 +438,7 @@ void test_data_type_compatibility(void)
         CHECK_ERR(signal_generator_init(&generator, gen_config));
         
         // Create test consumer
-        ControllableConsumer_t consumer;
+        ControllableConsumer_t consumer = {0};
         ControllableConsumerConfig_t consumer_config = {
             .name = "dtype_test_consumer",
             .buff_config = {
@@ -519,7 +519,7 @@ void test_sample_rate_preservation(void)
     size_t total_samples = 1000;
     
     // Create signal generator
-    SignalGenerator_t generator;
+    SignalGenerator_t generator = {0};
     SignalGenerator_config_t gen_config = {
         .name = "rate_test_gen",
         .buff_config = {
@@ -541,7 +541,7 @@ void test_sample_rate_preservation(void)
     CHECK_ERR(signal_generator_init(&generator, gen_config));
     
     // Create test consumer with property validation
-    ControllableConsumer_t consumer;
+    ControllableConsumer_t consumer = {0};
     ControllableConsumerConfig_t consumer_config = {
         .name = "rate_test_consumer",
         .buff_config = {
@@ -639,7 +639,7 @@ void test_data_integrity(void)
         CHECK_ERR(g_fut_init(g_fut, g_fut_config));
         
         // Create appropriate signal generator based on pattern
-        SignalGenerator_t generator;
+        SignalGenerator_t generator = {0};
         WaveformType_e waveform = (pattern == TEST_PATTERN_SINE) ? WAVEFORM_SINE : WAVEFORM_SAWTOOTH;
         
         SignalGenerator_config_t gen_config = {
@@ -663,7 +663,7 @@ void test_data_integrity(void)
         CHECK_ERR(signal_generator_init(&generator, gen_config));
         
         // Create validating consumer
-        ControllableConsumer_t consumer;
+        ControllableConsumer_t consumer = {0};
         ControllableConsumerConfig_t consumer_config = {
             .name = "integrity_test_consumer",
             .buff_config = {
@@ -799,7 +799,7 @@ void test_multi_input_synchronization(void)
     }
     
     // Create test consumer for output validation
-    ControllableConsumer_t consumer;
+    ControllableConsumer_t consumer = {0};
     ControllableConsumerConfig_t consumer_config = {
         .name = "multi_input_consumer",
         .buff_config = {
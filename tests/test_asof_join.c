@@ -0,0 +1,235 @@
+#include <string.h>
+#include "../bpipe/asof_join.h"
+#include "core.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define FILL -1.0f
+
+static AsofJoin_t join;
+static Batch_buff_t outputs[3];
+
+static const BatchBuffer_config buff_config = {.dtype = DTYPE_FLOAT,
+                                               .batch_capacity_expo = 2,
+                                               .ring_capacity_expo = 4,
+                                               .overflow_behaviour =
+                                                   OVERFLOW_BLOCK,
+                                               .sample_timestamps = true};
+
+static const BatchBuffer_config out_config = {.dtype = DTYPE_FLOAT,
+                                              .batch_capacity_expo = 3,
+                                              .ring_capacity_expo = 4,
+                                              .overflow_behaviour =
+                                                  OVERFLOW_BLOCK,
+                                              .sample_timestamps = true};
+
+/* Irregular batch: value of each sample is its timestamp */
+static void push_events(Batch_buff_t* buff, const long long* t, size_t n)
+{
+  Batch_t* batch = bb_get_head(buff);
+  float* data = (float*) batch->data;
+  for (size_t i = 0; i < n; i++) {
+    batch->ts[i] = t[i];
+    data[i] = (float) t[i];
+  }
+  batch->t_ns = t[0];
+  batch->period_ns = 0;
+  batch->head = n;
+  batch->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(buff, 100000));
+}
+
+/* Regular batch: value of each sample is base + its grid index */
+static void push_regular(Batch_buff_t* buff, long long t0, unsigned period,
+                         float base, size_t first_idx, size_t n)
+{
+  Batch_t* batch = bb_get_head(buff);
+  float* data = (float*) batch->data;
+  for (size_t i = 0; i < n; i++) data[i] = base + (float) (first_idx + i);
+  batch->t_ns = t0 + (long long) (first_idx * period);
+  batch->period_ns = period;
+  batch->head = n;
+  batch->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(buff, 100000));
+}
+
+static void push_complete(Batch_buff_t* buff)
+{
+  Batch_t* batch = bb_get_head(buff);
+  batch->head = 0;
+  batch->ec = Bp_EC_COMPLETE;
+  CHECK_ERR(bb_submit(buff, 100000));
+}
+
+void setUp(void) { memset(&join, 0, sizeof(join)); }
+
+void tearDown(void)
+{
+  if (join.base.worker != NULL) {
+    CHECK_ERR(filt_stop(&join.base));
+    CHECK_ERR(filt_deinit(&join.base));
+    for (size_t i = 0; i <= join.n_secondaries; i++) {
+      bb_stop(&outputs[i]);
+      bb_deinit(&outputs[i]);
+    }
+  }
+}
+
+void test_joins_latest_value_with_staleness(void)
+{
+  AsofJoin_config_t config = {.name = "asof",
+                              .buff_config = buff_config,
+                              .n_secondaries = 2,
+                              .max_staleness_ns = 100,
+                              .fill_value = FILL,
+                              .timeout_us = 100000};
+  CHECK_ERR(asof_join_init(&join, config));
+  for (int i = 0; i < 3; i++) {
+    CHECK_ERR(bb_init(&outputs[i], "asof_out", out_config));
+    CHECK_ERR(filt_sink_connect(&join.base, i, &outputs[i]));
+    CHECK_ERR(bb_start(&outputs[i]));
+    CHECK_ERR(bb_start(join.base.input_buffers[i]));
+  }
+  CHECK_ERR(filt_start(&join.base));
+
+  Batch_buff_t** in = join.base.input_buffers;
+
+  /* Primary events */
+  const long long t_a[] = {5, 17, 40, 41};
+  const long long t_b[] = {100, 250};
+  push_events(in[0], t_a, 4);
+  push_events(in[0], t_b, 2);
+  push_complete(in[0]);
+
+  /* Secondary 1: 0, 10, ..., 90 in batches of 4, values 0..9 */
+  push_regular(in[1], 0, 10, 0.0f, 0, 4);
+  push_regular(in[1], 0, 10, 0.0f, 4, 4);
+  push_regular(in[1], 0, 10, 0.0f, 8, 2);
+  push_complete(in[1]);
+
+  /* Secondary 2: starts late at 20, period 20, values 100..102 */
+  push_regular(in[2], 20, 20, 100.0f, 0, 3);
+  push_complete(in[2]);
+
+  const float want[3][6] = {{5, 17, 40, 41, 100, 250},
+                            {0, 1, 4, 4, 9, FILL},
+                            {FILL, FILL, 101, 101, 102, FILL}};
+  const long long want_t[6] = {5, 17, 40, 41, 100, 250};
+
+  for (int p = 0; p < 3; p++) {
+    size_t n = 0;
+    for (;;) {
+      Bp_EC err;
+      Batch_t* b = bb_get_tail(&outputs[p], 1000000, &err);
+      CHECK_ERR(err);
+      if (b->ec == Bp_EC_COMPLETE) {
+        bb_del_tail(&outputs[p]);
+        break;
+      }
+      const float* d = (const float*) b->data;
+      for (size_t i = 0; i < b->head; i++, n++) {
+        TEST_ASSERT_TRUE(n < 6);
+        TEST_ASSERT_EQUAL_INT64(want_t[n], b->ts[i]);
+        TEST_ASSERT_EQUAL_FLOAT(want[p][n], d[i]);
+      }
+      bb_del_tail(&outputs[p]);
+    }
+    TEST_ASSERT_EQUAL(6, n);
+  }
+
+  TEST_ASSERT_EQUAL(6, join.samples_joined);
+  TEST_ASSERT_EQUAL(4, join.fills);
+}
+
+void test_rejects_invalid_config(void)
+{
+  AsofJoin_config_t config = {
+      .name = "asof", .buff_config = buff_config, .n_secondaries = 0};
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, asof_join_init(&join, config));
+  config.n_secondaries = MAX_INPUTS;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, asof_join_init(&join, config));
+  config.n_secondaries = 1;
+  config.max_staleness_ns = -1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, asof_join_init(&join, config));
+  config.max_staleness_ns = 0;
+  config.buff_config.dtype = DTYPE_RECORD;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, asof_join_init(&join, config));
+}
+
+void test_rejects_output_without_timestamps(void)
+{
+  AsofJoin_config_t config = {
+      .name = "asof", .buff_config = buff_config, .n_secondaries = 1};
+  CHECK_ERR(asof_join_init(&join, config));
+
+  BatchBuffer_config plain = out_config;
+  plain.sample_timestamps = false;
+  CHECK_ERR(bb_init(&outputs[0], "plain", plain));
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    filt_sink_connect(&join.base, 0, &outputs[0]));
+  TEST_ASSERT_NULL(join.base.sinks[0]);
+
+  bb_deinit(&outputs[0]);
+  CHECK_ERR(filt_deinit(&join.base));
+  memset(&join, 0, sizeof(join)); /* Never started: nothing for tearDown */
+}
+
+/* Read the next data batch of output 1, checking its values */
+static void expect_joined(const float* want, size_t n)
+{
+  Bp_EC err;
+  Batch_t* b = bb_get_tail(&outputs[1], 1000000, &err);
+  CHECK_ERR(err);
+  TEST_ASSERT_EQUAL(n, b->head);
+  const float* d = (const float*) b->data;
+  for (size_t i = 0; i < n; i++) TEST_ASSERT_EQUAL_FLOAT(want[i], d[i]);
+  bb_del_tail(&outputs[1]);
+}
+
+void test_idle_secondary_emits_last_value(void)
+{
+  AsofJoin_config_t config = {.name = "asof",
+                              .buff_config = buff_config,
+                              .n_secondaries = 1,
+                              .fill_value = FILL,
+                              .timeout_us = 20000};
+  CHECK_ERR(asof_join_init(&join, config));
+  for (int i = 0; i < 2; i++) {
+    CHECK_ERR(bb_init(&outputs[i], "asof_out", out_config));
+    CHECK_ERR(filt_sink_connect(&join.base, i, &outputs[i]));
+    CHECK_ERR(bb_start(&outputs[i]));
+    CHECK_ERR(bb_start(join.base.input_buffers[i]));
+  }
+  CHECK_ERR(filt_start(&join.base));
+
+  Batch_buff_t** in = join.base.input_buffers;
+
+  /* The secondary sends samples at 0 and 10, then goes quiet without
+   * completing: later primary samples get its last value */
+  push_regular(in[1], 0, 10, 0.0f, 0, 2);
+  const long long t_a[] = {5, 15, 30, 1000};
+  push_events(in[0], t_a, 4);
+  const float want_a[] = {0, 1, 1, 1};
+  expect_joined(want_a, 4);
+
+  /* Once it produces again its new values are joined */
+  push_regular(in[1], 2000, 10, 7.0f, 0, 1);
+  const long long t_b[] = {2500};
+  push_events(in[0], t_b, 1);
+  const float want_b[] = {7};
+  expect_joined(want_b, 1);
+
+  push_complete(in[1]);
+  push_complete(in[0]);
+  TEST_ASSERT_EQUAL(0, join.fills);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_joins_latest_value_with_staleness);
+  RUN_TEST(test_rejects_invalid_config);
+  RUN_TEST(test_rejects_output_without_timestamps);
+  RUN_TEST(test_idle_secondary_emits_last_value);
+  return UNITY_END();
+}
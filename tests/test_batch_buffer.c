@@ -1,8 +1,10 @@
 #define _DEFAULT_SOURCE
 #include <pthread.h>
 #include <stdint.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "../bpipe/arena.h"
 #include "../bpipe/batch_buffer.h"
 #include "unity.h"
 #include "unity_internals.h"
@@ -388,6 +390,280 @@ void test_overflow_drop_tail(void)
   bb_deinit(&buff_drop_tail);
 }
 
+static void submit_with_ec(Batch_buff_t* b, int id, Bp_EC ec)
+{
+  Batch_t* batch = bb_get_head(b);
+  batch->batch_id = id;
+  batch->head = ec == Bp_EC_OK ? 1 : 0;
+  batch->ec = ec;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(b, 1000));
+}
+
+void test_overflow_drop_stale(void)
+{
+  Batch_buff_t stale;
+  BatchBuffer_config config = {.dtype = DTYPE_U32,
+                               .overflow_behaviour = OVERFLOW_DROP_STALE,
+                               .ring_capacity_expo = 3,
+                               .batch_capacity_expo = 2};
+  TEST_ASSERT_EQUAL_INT(Bp_EC_INVALID_CONFIG,
+                        bb_init(&stale, "DROP_STALE", config));
+  config.max_age_us = 20000;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&stale, "DROP_STALE", config));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_start(&stale));
+
+  // Two batches age out, the third is fresh when the consumer arrives
+  submit_with_ec(&stale, 0, Bp_EC_OK);
+  submit_with_ec(&stale, 1, Bp_EC_OK);
+  usleep(30000);
+  submit_with_ec(&stale, 2, Bp_EC_OK);
+
+  Bp_EC err;
+  Batch_t* batch = bb_get_tail(&stale, 1000, &err);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, err);
+  TEST_ASSERT_EQUAL_INT(2, batch->batch_id);
+
+  // A batch already handed to the consumer is never dropped under it
+  usleep(30000);
+  batch = bb_get_tail(&stale, 1000, &err);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, err);
+  TEST_ASSERT_EQUAL_INT(2, batch->batch_id);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&stale));
+
+  // Completion is delivered however old it is
+  submit_with_ec(&stale, 3, Bp_EC_OK);
+  submit_with_ec(&stale, 4, Bp_EC_COMPLETE);
+  usleep(30000);
+  batch = bb_get_tail(&stale, 1000, &err);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, err);
+  TEST_ASSERT_EQUAL_INT(4, batch->batch_id);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_COMPLETE, batch->ec);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&stale));
+
+  BbStats_t stats;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_get_stats(&stale, &stats));
+  TEST_ASSERT_EQUAL_INT(5, stats.total_batches);
+  TEST_ASSERT_EQUAL_INT(3, stats.dropped_stale);
+  TEST_ASSERT_EQUAL_INT(3, stats.dropped_total);
+  TEST_ASSERT_EQUAL_INT(0, stats.occupancy);
+
+  bb_stop(&stale);
+  bb_deinit(&stale);
+}
+
+/* Trickle batches stamped at the epoch: stale on arrival with t_ns ages */
+static void* stale_trickle(void* arg)
+{
+  Batch_buff_t* b = (Batch_buff_t*) arg;
+  for (int i = 0; i < 30; i++) {
+    usleep(10000);
+    Batch_t* batch = bb_get_head(b);
+    batch->t_ns = 0;
+    batch->head = 1;
+    batch->ec = Bp_EC_OK;
+    bb_submit(b, 100000);
+  }
+  return NULL;
+}
+
+void test_drop_stale_wait_keeps_deadline(void)
+{
+  Batch_buff_t stale;
+  BatchBuffer_config config = {.dtype = DTYPE_U32,
+                               .overflow_behaviour = OVERFLOW_DROP_STALE,
+                               .ring_capacity_expo = 3,
+                               .batch_capacity_expo = 2,
+                               .max_age_us = 1000,
+                               .age_from_t_ns = true};
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&stale, "DROP_STALE", config));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_start(&stale));
+
+  pthread_t producer;
+  pthread_create(&producer, NULL, stale_trickle, &stale);
+
+  // Every arrival is skipped; the wait still ends after its own timeout
+  long long start = now_ns(CLOCK_MONOTONIC);
+  Bp_EC err;
+  Batch_t* batch = bb_get_tail(&stale, 50000, &err);
+  long long waited_ms = (now_ns(CLOCK_MONOTONIC) - start) / 1000000;
+  TEST_ASSERT_NULL(batch);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_TIMEOUT, err);
+  TEST_ASSERT_TRUE(waited_ms < 150);
+
+  pthread_join(producer, NULL);
+  bb_stop(&stale);
+  bb_deinit(&stale);
+}
+
+/* Regular 4-frame batch whose values are the global frame index */
+static void submit_ramp(Batch_buff_t* b, uint32_t first)
+{
+  Batch_t* batch = bb_get_head(b);
+  for (uint32_t j = 0; j < 4; j++) *BATCH_GET_SAMPLE_U32(batch, j) = first + j;
+  batch->t_ns = first * 1000LL;
+  batch->period_ns = 1000;
+  batch->head = 4;
+  batch->ec = Bp_EC_OK;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(b, 1000));
+}
+
+static void expect_batch(Batch_buff_t* b, const uint32_t* values, size_t n,
+                         unsigned period_ns)
+{
+  Bp_EC err;
+  Batch_t* batch = bb_get_tail(b, 1000, &err);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, err);
+  TEST_ASSERT_EQUAL_INT(n, batch->head);
+  TEST_ASSERT_EQUAL_INT(period_ns, batch->period_ns);
+  TEST_ASSERT_EQUAL_INT64(values[0] * 1000LL, batch->t_ns);
+  for (size_t j = 0; j < n; j++) {
+    TEST_ASSERT_EQUAL_UINT32(values[j], *BATCH_GET_SAMPLE_U32(batch, j));
+  }
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(b));
+}
+
+void test_overflow_decimate(void)
+{
+  Batch_buff_t dec;
+  BatchBuffer_config config = {.dtype = DTYPE_U32,
+                               .overflow_behaviour = OVERFLOW_DECIMATE,
+                               .ring_capacity_expo = 3,  // 7 usable slots
+                               .batch_capacity_expo = 2,
+                               .high_water = 4,
+                               .low_water = 1,
+                               .max_decimation_expo = 3};
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&dec, "DECIMATE", config));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_start(&dec));
+
+  // Frames 0..15 at full rate, then 2x, 4x, 8x as the backlog grows. The
+  // 8x batch covering 24..27 keeps nothing and is not published.
+  for (uint32_t first = 0; first < 32; first += 4) submit_ramp(&dec, first);
+  TEST_ASSERT_EQUAL_INT(7, bb_occupancy(&dec));
+
+  for (uint32_t i = 0; i < 4; i++) {
+    const uint32_t full[4] = {i * 4, i * 4 + 1, i * 4 + 2, i * 4 + 3};
+    expect_batch(&dec, full, 4, 1000);
+  }
+  expect_batch(&dec, (const uint32_t[]){17, 19}, 2, 2000);
+  expect_batch(&dec, (const uint32_t[]){23}, 1, 4000);
+  expect_batch(&dec, (const uint32_t[]){31}, 1, 8000);
+
+  // Drained: the factor steps back down and the grid stays continuous
+  submit_ramp(&dec, 32);
+  expect_batch(&dec, (const uint32_t[]){35}, 1, 4000);
+
+  BbStats_t stats;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_get_stats(&dec, &stats));
+  TEST_ASSERT_EQUAL_INT(4, stats.decimation_factor);
+  TEST_ASSERT_EQUAL_INT(4, stats.decimation_changes);
+  TEST_ASSERT_EQUAL_INT(15, stats.frames_decimated);
+  TEST_ASSERT_EQUAL_INT(0, stats.dropped_total);
+
+  bb_stop(&dec);
+  bb_deinit(&dec);
+
+  config.low_water = 4;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_INVALID_CONFIG, bb_init(&dec, "BAD", config));
+}
+
+void test_overflow_spill(void)
+{
+  Batch_buff_t spill;
+  BatchBuffer_config config = {.dtype = DTYPE_U32,
+                               .overflow_behaviour = OVERFLOW_SPILL,
+                               .ring_capacity_expo = 2,  // 3 usable slots
+                               .batch_capacity_expo = 2,
+                               .sample_timestamps = true,
+                               .spill_capacity_expo = 3};
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&spill, "SPILL", config));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_start(&spill));
+
+  // Burst of 7: three fill the ring, four spill
+  for (uint32_t i = 0; i < 7; i++) {
+    Batch_t* batch = bb_get_head(&spill);
+    for (uint32_t j = 0; j < 4; j++) {
+      *BATCH_GET_SAMPLE_U32(batch, j) = i * 4 + j;
+      batch->ts[j] = (i * 4 + j) * 10LL;
+    }
+    batch->batch_id = i;
+    batch->head = 4;
+    batch->period_ns = 0;
+    batch->ec = Bp_EC_OK;
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(&spill, 1000));
+  }
+  BbStats_t stats;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_get_stats(&spill, &stats));
+  TEST_ASSERT_EQUAL_INT(4, stats.spilled_batches);
+  TEST_ASSERT_EQUAL_INT(4, stats.spill_occupancy);
+
+  // Ring space opens up, but ordering keeps new batches behind the spill
+  Bp_EC err;
+  Batch_t* batch = bb_get_tail(&spill, 1000, &err);
+  TEST_ASSERT_EQUAL_INT(0, batch->batch_id);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&spill));
+  submit_with_ec(&spill, 7, Bp_EC_OK);
+
+  for (uint32_t i = 1; i < 8; i++) {
+    batch = bb_get_tail(&spill, 1000, &err);
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, err);
+    TEST_ASSERT_EQUAL_INT(i, batch->batch_id);
+    if (i < 7) {
+      TEST_ASSERT_EQUAL_INT(4, batch->head);
+      TEST_ASSERT_EQUAL_UINT32(i * 4 + 3, *BATCH_GET_SAMPLE_U32(batch, 3));
+      TEST_ASSERT_EQUAL_INT64((i * 4 + 3) * 10LL, bb_sample_t_ns(batch, 3));
+    }
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&spill));
+  }
+  TEST_ASSERT_TRUE(bb_get_tail(&spill, 1000, &err) == NULL);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_TIMEOUT, err);
+
+  // Drained: back to the RAM ring
+  submit_with_ec(&spill, 8, Bp_EC_OK);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_get_stats(&spill, &stats));
+  TEST_ASSERT_EQUAL_INT(5, stats.spilled_batches);
+  TEST_ASSERT_EQUAL_INT(5, stats.spill_peak);
+  TEST_ASSERT_EQUAL_INT(0, stats.spill_occupancy);
+  TEST_ASSERT_EQUAL_INT(1, stats.occupancy);
+  TEST_ASSERT_EQUAL_INT(9, stats.total_batches);
+  TEST_ASSERT_EQUAL_INT(0, stats.dropped_total);
+
+  bb_stop(&spill);
+  bb_deinit(&spill);
+}
+
+void test_overflow_spill_full_nonblocking(void)
+{
+  Batch_buff_t spill;
+  BatchBuffer_config config = {.dtype = DTYPE_U32,
+                               .overflow_behaviour = OVERFLOW_SPILL,
+                               .ring_capacity_expo = 1,  // 1 usable slot
+                               .batch_capacity_expo = 2,
+                               .spill_capacity_expo = 1};
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&spill, "SPILL_FULL", config));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_start(&spill));
+  for (int i = 0; i < 3; i++) {
+    submit_with_ec(&spill, i, Bp_EC_OK);
+  }
+
+  // Ring and spill full: a zero timeout polls instead of waiting forever
+  long long t0 = now_ns(CLOCK_MONOTONIC);
+  bb_get_head(&spill)->batch_id = 3;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_TIMEOUT, bb_submit(&spill, 0));
+  TEST_ASSERT_TRUE(now_ns(CLOCK_MONOTONIC) - t0 < 100000000LL);
+
+  Bp_EC err;
+  for (int i = 0; i < 3; i++) {
+    Batch_t* batch = bb_get_tail(&spill, 1000, &err);
+    TEST_ASSERT_NOT_NULL(batch);
+    TEST_ASSERT_EQUAL_INT(i, batch->batch_id);
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&spill));
+  }
+  TEST_ASSERT_NULL(bb_get_tail(&spill, 1000, &err));
+
+  bb_stop(&spill);
+  bb_deinit(&spill);
+}
+
 /* Test concurrent producer/consumer with DROP_TAIL */
 typedef struct {
   Batch_buff_t* buff;
@@ -478,6 +754,548 @@ void test_drop_tail_concurrent(void)
   bb_deinit(&buff);
 }
 
+void test_multichannel_geometry(void)
+{
+  TEST_MESSAGE("Testing multichannel slot sizing and channel pointers");
+
+  Batch_buff_t buff;
+  BatchBuffer_config config = {.dtype = DTYPE_U32,
+                               .overflow_behaviour = OVERFLOW_BLOCK,
+                               .ring_capacity_expo = 2,
+                               .batch_capacity_expo = 3,
+                               .n_channels = 3,
+                               .layout = BATCH_LAYOUT_PLANAR};
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&buff, "PLANAR", config));
+
+  TEST_ASSERT_EQUAL_INT(3, bb_n_channels(&buff));
+  TEST_ASSERT_EQUAL_INT(3 * sizeof(uint32_t), bb_frame_size(&buff));
+  TEST_ASSERT_EQUAL_INT(8 * 3 * sizeof(uint32_t), bb_batch_bytes(&buff));
+
+  Batch_t* b0 = &buff.batch_ring[0];
+  Batch_t* b1 = &buff.batch_ring[1];
+  TEST_ASSERT_EQUAL_INT(3, b0->n_channels);
+  TEST_ASSERT_EQUAL_INT(BATCH_LAYOUT_PLANAR, b0->layout);
+  TEST_ASSERT_EQUAL_PTR((char*) b0->data + bb_batch_bytes(&buff), b1->data);
+  TEST_ASSERT_EQUAL_PTR((uint32_t*) b0->data + 2 * 8,
+                        bb_channel_ptr(&buff, b0, 2));
+  bb_deinit(&buff);
+
+  // Default config is a single interleaved channel
+  config.n_channels = 0;
+  config.layout = BATCH_LAYOUT_INTERLEAVED;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&buff, "MONO", config));
+  TEST_ASSERT_EQUAL_INT(1, bb_n_channels(&buff));
+  TEST_ASSERT_EQUAL_INT(8 * sizeof(uint32_t), bb_batch_bytes(&buff));
+  bb_deinit(&buff);
+
+  config.n_channels = BB_MAX_CHANNELS + 1;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_INVALID_CONFIG,
+                        bb_init(&buff, "TOO_MANY", config));
+}
+
+void test_sample_timestamp_column(void)
+{
+  TEST_MESSAGE("Testing optional per-sample timestamp column");
+
+  Batch_buff_t buff;
+  BatchBuffer_config config = {.dtype = DTYPE_U32,
+                               .overflow_behaviour = OVERFLOW_BLOCK,
+                               .ring_capacity_expo = 2,
+                               .batch_capacity_expo = 3};
+
+  // Disabled by default: no column, timing is t_ns + i * period_ns
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&buff, "NO_TS", config));
+  TEST_ASSERT_NULL(buff.ts_ring);
+  Batch_t* batch = bb_get_head(&buff);
+  TEST_ASSERT_NULL(batch->ts);
+  batch->t_ns = 100;
+  batch->period_ns = 10;
+  TEST_ASSERT_FALSE(bb_batch_has_ts(batch));
+  TEST_ASSERT_EQUAL_INT(130, bb_sample_t_ns(batch, 3));
+  bb_deinit(&buff);
+
+  config.sample_timestamps = true;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&buff, "TS", config));
+  TEST_ASSERT_NOT_NULL(buff.ts_ring);
+  TEST_ASSERT_EQUAL_PTR(buff.ts_ring + 8, buff.batch_ring[1].ts);
+
+  batch = bb_get_head(&buff);
+  batch->t_ns = 5;
+  batch->period_ns = 0;
+  for (int i = 0; i < 8; i++) {
+    batch->ts[i] = 5 + i * i;
+  }
+  TEST_ASSERT_TRUE(bb_batch_has_ts(batch));
+  TEST_ASSERT_EQUAL_INT(5 + 49, bb_sample_t_ns(batch, 7));
+
+  // A regular batch ignores the column even when it is allocated
+  batch->period_ns = 2;
+  TEST_ASSERT_EQUAL_INT(5 + 14, bb_sample_t_ns(batch, 7));
+  bb_deinit(&buff);
+}
+
+void test_record_stream(void)
+{
+  TEST_MESSAGE("Testing variable-length record batches");
+
+  Batch_buff_t buff;
+  BatchBuffer_config config = {.dtype = DTYPE_RECORD,
+                               .overflow_behaviour = OVERFLOW_BLOCK,
+                               .ring_capacity_expo = 2,
+                               .batch_capacity_expo = 7};  // 128 bytes
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&buff, "RECORDS", config));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_start(&buff));
+
+  // Records of 5, 13 and 0 bytes take 24, 32 and 16 bytes of the batch
+  Batch_t* batch = bb_get_head(&buff);
+  batch->head = 0;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK,
+                        bb_record_append(&buff, batch, "hello", 5, 1000));
+  char* p = bb_record_reserve(&buff, batch, 64);
+  TEST_ASSERT_NOT_NULL(p);
+  memcpy(p, "variable-len!", 13);
+  bb_record_commit(batch, 13, 2500);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK,
+                        bb_record_append(&buff, batch, "", 0, 2600));
+  TEST_ASSERT_EQUAL_INT(72, batch->head);
+  TEST_ASSERT_EQUAL_INT(1000, batch->t_ns);
+
+  // 64 bytes of payload no longer fit: caller must move to the next batch
+  TEST_ASSERT_NULL(bb_record_reserve(&buff, batch, 64));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_INVALID_DATA,
+                        bb_record_append(&buff, batch, p, 200, 0));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(&buff, 1000));
+
+  // Bulk reserve three 20-byte slots and commit shorter records in one go
+  batch = bb_get_head(&buff);
+  batch->head = 0;
+  void* slots[8];
+  size_t n = bb_record_reserve_n(&buff, batch, 8, 20, slots);
+  TEST_ASSERT_EQUAL_INT(3, n);  // 128 / (16 + 24)
+  const size_t lens[3] = {1, 20, 7};
+  const long long times[3] = {10, 20, 30};
+  for (size_t i = 0; i < n; i++) {
+    memset(slots[i], (int) ('a' + i), lens[i]);
+  }
+  bb_record_commit_n(batch, n, 20, lens, times);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(&buff, 1000));
+
+  // Consumer side: walk the records of both batches
+  Bp_EC err;
+  batch = bb_get_tail(&buff, 1000, &err);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, err);
+  TEST_ASSERT_EQUAL_INT(3, bb_record_count(batch));
+  BbRecord_t* rec = bb_record_first(batch);
+  TEST_ASSERT_EQUAL_INT(5, rec->len);
+  TEST_ASSERT_EQUAL_INT(0, memcmp(bb_record_payload(rec), "hello", 5));
+  rec = bb_record_next(batch, rec);
+  TEST_ASSERT_EQUAL_INT(13, rec->len);
+  TEST_ASSERT_EQUAL_INT(2500, rec->t_ns);
+  rec = bb_record_next(batch, rec);
+  TEST_ASSERT_EQUAL_INT(0, rec->len);
+  TEST_ASSERT_NULL(bb_record_next(batch, rec));
+  bb_del_tail(&buff);
+
+  batch = bb_get_tail(&buff, 1000, &err);
+  TEST_ASSERT_EQUAL_INT(3, bb_record_count(batch));
+  size_t i = 0;
+  for (rec = bb_record_first(batch); rec; rec = bb_record_next(batch, rec)) {
+    TEST_ASSERT_EQUAL_INT(lens[i], rec->len);
+    TEST_ASSERT_EQUAL_INT(times[i], rec->t_ns);
+    TEST_ASSERT_EQUAL_INT('a' + i, ((char*) bb_record_payload(rec))[0]);
+    i++;
+  }
+  bb_del_tail(&buff);
+
+  bb_stop(&buff);
+  bb_deinit(&buff);
+
+  // Records are single-channel and need room for at least a header
+  config.batch_capacity_expo = 3;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_INVALID_CONFIG, bb_init(&buff, "SMALL", config));
+}
+
+void test_interleave_roundtrip(void)
+{
+  TEST_MESSAGE("Testing interleave/deinterleave against naive transpose");
+
+  const size_t channel_counts[] = {1, 2, 3, 4, 8, 12};
+  const size_t n_frames = 19;  // Exercises vector body and scalar tail
+  const size_t stride = 32;
+
+  for (size_t k = 0; k < sizeof(channel_counts) / sizeof(channel_counts[0]);
+       k++) {
+    size_t n_ch = channel_counts[k];
+    uint32_t planar[12 * 32] = {0};
+    uint32_t inter[12 * 32] = {0};
+    uint32_t back[12 * 32] = {0};
+
+    for (size_t c = 0; c < n_ch; c++) {
+      for (size_t f = 0; f < n_frames; f++) {
+        planar[c * stride + f] = (uint32_t) (c * 1000 + f);
+      }
+    }
+
+    bb_interleave(inter, planar, n_frames, n_ch, stride, sizeof(uint32_t));
+    for (size_t f = 0; f < n_frames; f++) {
+      for (size_t c = 0; c < n_ch; c++) {
+        TEST_ASSERT_EQUAL_UINT32(c * 1000 + f, inter[f * n_ch + c]);
+      }
+    }
+
+    bb_deinterleave(back, inter, n_frames, n_ch, stride, sizeof(uint32_t));
+    for (size_t c = 0; c < n_ch; c++) {
+      for (size_t f = 0; f < n_frames; f++) {
+        TEST_ASSERT_EQUAL_UINT32(planar[c * stride + f], back[c * stride + f]);
+      }
+    }
+  }
+}
+
+void test_copy_frames_across_layouts(void)
+{
+  TEST_MESSAGE("Testing bb_copy_frames between planar and interleaved");
+
+  Batch_buff_t planar, inter;
+  BatchBuffer_config config = {.dtype = DTYPE_FLOAT,
+                               .overflow_behaviour = OVERFLOW_BLOCK,
+                               .ring_capacity_expo = 2,
+                               .batch_capacity_expo = 4,
+                               .n_channels = 4,
+                               .layout = BATCH_LAYOUT_PLANAR};
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&planar, "PLANAR", config));
+  config.layout = BATCH_LAYOUT_INTERLEAVED;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&inter, "INTER", config));
+
+  Batch_t* src = bb_get_head(&planar);
+  for (size_t c = 0; c < 4; c++) {
+    float* plane = bb_channel_ptr(&planar, src, c);
+    for (size_t f = 0; f < 16; f++) {
+      plane[f] = (float) (c * 100 + f);
+    }
+  }
+
+  // Copy frames 3..12 of the planar batch to offset 2 of the interleaved one
+  Batch_t* dst = bb_get_head(&inter);
+  bb_copy_frames(&inter, dst, 2, &planar, src, 3, 10);
+  float* out = dst->data;
+  for (size_t f = 0; f < 10; f++) {
+    for (size_t c = 0; c < 4; c++) {
+      TEST_ASSERT_EQUAL_FLOAT((float) (c * 100 + f + 3), out[(f + 2) * 4 + c]);
+    }
+  }
+
+  bb_deinit(&planar);
+  bb_deinit(&inter);
+}
+
+void test_adopt_arena_storage(void)
+{
+  TEST_MESSAGE("Testing relocation of ring storage into an arena");
+
+  Batch_buff_t buf;
+  BatchBuffer_config config = {.dtype = DTYPE_FLOAT,
+                               .overflow_behaviour = OVERFLOW_BLOCK,
+                               .ring_capacity_expo = 2,
+                               .batch_capacity_expo = 3,
+                               .n_channels = 2,
+                               .sample_timestamps = true};
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&buf, "ADOPT", config));
+  TEST_ASSERT_TRUE(buf.owns_storage);
+
+  size_t need = bb_storage_size(&buf);
+  TEST_ASSERT_EQUAL(arena_align_up(4 * sizeof(Batch_t), 64) +
+                        4 * 8 * 2 * sizeof(float) + 4 * 8 * sizeof(long long),
+                    need);
+
+  Arena_t arena;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, arena_init(&arena, need, false));
+  void* mem = arena_alloc(&arena, need, 0);
+  TEST_ASSERT_NOT_NULL(mem);
+  TEST_ASSERT_NULL(arena_alloc(&arena, 1, 0));
+
+  // Too small, and refusing a non-empty ring, both leave the buffer alone
+  TEST_ASSERT_EQUAL_INT(Bp_EC_NO_SPACE, bb_adopt_storage(&buf, mem, need - 1));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_start(&buf));
+  bb_get_head(&buf)->head = 1;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(&buf, 0));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_INVALID_CONFIG,
+                        bb_adopt_storage(&buf, mem, need));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&buf));
+  TEST_ASSERT_TRUE(buf.owns_storage);
+
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_adopt_storage(&buf, mem, need));
+  TEST_ASSERT_FALSE(buf.owns_storage);
+  TEST_ASSERT_EQUAL_PTR(mem, buf.batch_ring);
+
+  // Every slot is re-pointed into the arena and usable
+  for (int i = 0; i < 3; i++) {
+    Batch_t* b = bb_get_head(&buf);
+    TEST_ASSERT_TRUE(arena_contains(&arena, b->data));
+    TEST_ASSERT_TRUE(arena_contains(&arena, b->ts));
+    float* data = b->data;
+    data[15] = (float) i;
+    b->ts[7] = i;
+    b->head = 8;
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(&buf, 0));
+  }
+  Bp_EC err;
+  for (int i = 0; i < 3; i++) {
+    Batch_t* b = bb_get_tail(&buf, 0, &err);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL_FLOAT((float) i, ((float*) b->data)[15]);
+    TEST_ASSERT_EQUAL(i, b->ts[7]);
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&buf));
+  }
+
+  // bb_deinit must leave arena memory alone
+  bb_stop(&buf);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_deinit(&buf));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, arena_deinit(&arena));
+}
+
+void test_swap_data_between_rings(void)
+{
+  TEST_MESSAGE("Testing zero-copy storage swaps along a chain of rings");
+
+  Batch_buff_t a, b, c, other;
+  BatchBuffer_config config = {.dtype = DTYPE_FLOAT,
+                               .overflow_behaviour = OVERFLOW_BLOCK,
+                               .ring_capacity_expo = 2,
+                               .batch_capacity_expo = 3,
+                               .sample_timestamps = true};
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&a, "SWAP_A", config));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&b, "SWAP_B", config));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&c, "SWAP_C", config));
+  config.batch_capacity_expo = 4;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&other, "SWAP_OTHER", config));
+  bb_start(&a);
+  bb_start(&b);
+  bb_start(&c);
+
+  // Run several batches a -> b -> c, moving storage instead of samples
+  Bp_EC err;
+  for (int i = 0; i < 6; i++) {
+    Batch_t* in = bb_get_head(&a);
+    ((float*) in->data)[7] = (float) i;
+    in->ts[7] = i;
+    in->head = 8;
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(&a, 0));
+
+    Batch_buff_t* hops[][2] = {{&a, &b}, {&b, &c}};
+    for (int h = 0; h < 2; h++) {
+      Batch_t* src = bb_get_tail(hops[h][0], 0, &err);
+      Batch_t* dst = bb_get_head(hops[h][1]);
+      void* src_data = src->data;
+      void* dst_data = dst->data;
+      TEST_ASSERT_EQUAL_INT(Bp_EC_OK,
+                            bb_swap_data(hops[h][0], src, hops[h][1], dst));
+      TEST_ASSERT_EQUAL_PTR(src_data, dst->data);
+      TEST_ASSERT_EQUAL_PTR(dst_data, src->data);
+      dst->head = src->head;
+      TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(hops[h][1], 0));
+      TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(hops[h][0]));
+    }
+
+    Batch_t* out = bb_get_tail(&c, 0, &err);
+    TEST_ASSERT_EQUAL_FLOAT((float) i, ((float*) out->data)[7]);
+    TEST_ASSERT_EQUAL(i, out->ts[7]);
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&c));
+  }
+
+  // Mismatched geometry is refused and leaves both batches alone
+  Batch_t* in = bb_get_head(&c);
+  Batch_t* out = bb_get_head(&other);
+  void* in_data = in->data;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_CAPACITY_MISMATCH,
+                        bb_swap_data(&c, in, &other, out));
+  TEST_ASSERT_EQUAL_PTR(in_data, in->data);
+
+  // Shared rings cannot move into external storage
+  char mem[4096] __attribute__((aligned(64)));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_INVALID_CONFIG,
+                        bb_adopt_storage(&b, mem, sizeof(mem)));
+
+  // Storage stays valid for the rest of the chain when a member leaves
+  bb_stop(&a);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_deinit(&a));
+  for (int i = 0; i < 4; i++) {
+    Batch_t* slot = bb_get_head(&c);
+    memset(slot->data, 0, 8 * sizeof(float));
+    slot->ts[0] = i;
+    slot->head = 8;
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(&c, 0));
+    TEST_ASSERT_NOT_NULL(bb_get_tail(&c, 0, &err));
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&c));
+  }
+  bb_stop(&b);
+  bb_stop(&c);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_deinit(&c));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_deinit(&b));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_deinit(&other));
+}
+
+void test_swap_groups_merge_after_members_leave(void)
+{
+  TEST_MESSAGE("Testing share group merges once members have left");
+
+  Batch_buff_t r[5];
+  BatchBuffer_config config = {.dtype = DTYPE_FLOAT,
+                               .overflow_behaviour = OVERFLOW_BLOCK,
+                               .ring_capacity_expo = 2,
+                               .batch_capacity_expo = 3,
+                               .sample_timestamps = true};
+  for (int i = 0; i < 5; i++) {
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&r[i], "SWAP_MERGE", config));
+  }
+  const int pairs[][2] = {{0, 1}, {1, 2}, {3, 4}, {3, 2}};
+  for (int p = 0; p < 4; p++) {
+    // Departed members leave their blocks behind in the group of 2
+    if (p == 2) {
+      TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_deinit(&r[0]));
+      TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_deinit(&r[1]));
+    }
+    Batch_buff_t* a = &r[pairs[p][0]];
+    Batch_buff_t* b = &r[pairs[p][1]];
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK,
+                          bb_swap_data(a, bb_get_head(a), b, bb_get_head(b)));
+  }
+  for (int i = 2; i < 5; i++) {
+    float* data = bb_get_head(&r[i])->data;
+    data[7] = (float) i;
+  }
+  for (int i = 2; i < 5; i++) {
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_deinit(&r[i]));
+  }
+
+  // A DROP_TAIL producer may reclaim the input slot: never swapped
+  config.overflow_behaviour = OVERFLOW_DROP_TAIL;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&r[0], "SWAP_DROP", config));
+  config.overflow_behaviour = OVERFLOW_BLOCK;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&r[1], "SWAP_OUT", config));
+  TEST_ASSERT_EQUAL_INT(
+      Bp_EC_INVALID_CONFIG,
+      bb_swap_data(&r[0], bb_get_head(&r[0]), &r[1], bb_get_head(&r[1])));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_deinit(&r[0]));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_deinit(&r[1]));
+}
+
+static void* delayed_submit(void* arg)
+{
+  Batch_buff_t* b = arg;
+  usleep(20000);
+  bb_get_head(b)->head = 1;
+  bb_submit(b, 0);
+  return NULL;
+}
+
+void test_await_any_inputs(void)
+{
+  TEST_MESSAGE("Testing bb_await_any wake-up across several inputs");
+
+  Batch_buff_t in[3];
+  BatchBuffer_config config = {.dtype = DTYPE_U32,
+                               .overflow_behaviour = OVERFLOW_BLOCK,
+                               .ring_capacity_expo = 2,
+                               .batch_capacity_expo = 2};
+  BbWaitSet_t ws;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_waitset_init(&ws));
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&in[i], "IN", config));
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_start(&in[i]));
+    TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_waitset_add_input(&ws, &in[i]));
+  }
+
+  // A buffer has one consumer, so it can only join one input set
+  BbWaitSet_t other;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_waitset_init(&other));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_ALREADY_REGISTERED,
+                        bb_waitset_add_input(&other, &in[0]));
+  bb_waitset_deinit(&other);
+
+  uint32_t ready_in = 0xFF, ready_out = 0xFF;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_TIMEOUT,
+                        bb_await_any(&ws, BB_AWAIT_POLL, &ready_in,
+                                     &ready_out));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_TIMEOUT,
+                        bb_await_any(&ws, 5000, &ready_in, &ready_out));
+
+  // Sleeping waiter is woken by a submit on the last input, well before the
+  // (long) timeout
+  pthread_t producer;
+  pthread_create(&producer, NULL, delayed_submit, &in[2]);
+  long long t0 = now_ns(CLOCK_MONOTONIC);
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK,
+                        bb_await_any(&ws, 5000000, &ready_in, &ready_out));
+  long long waited_us = (now_ns(CLOCK_MONOTONIC) - t0) / 1000;
+  pthread_join(producer, NULL);
+  TEST_ASSERT_EQUAL_HEX32(1u << 2, ready_in);
+  TEST_ASSERT_EQUAL_HEX32(0, ready_out);
+  TEST_ASSERT_TRUE(waited_us < 1000000);
+
+  // Stopping an input also wakes the set so the filter can see STOPPED
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&in[2]));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_stop(&in[1]));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK,
+                        bb_await_any(&ws, 0, &ready_in, &ready_out));
+  TEST_ASSERT_EQUAL_HEX32(1u << 1, ready_in);
+
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_waitset_deinit(&ws));
+  for (int i = 0; i < 3; i++) {
+    TEST_ASSERT_NULL(in[i].consumer_ws);
+    bb_deinit(&in[i]);
+  }
+}
+
+void test_await_any_outputs_and_fd(void)
+{
+  TEST_MESSAGE("Testing output readiness and poll() integration");
+
+  Batch_buff_t in, out;
+  BatchBuffer_config config = {.dtype = DTYPE_U32,
+                               .overflow_behaviour = OVERFLOW_BLOCK,
+                               .ring_capacity_expo = 1,
+                               .batch_capacity_expo = 2};
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&in, "IN", config));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_init(&out, "OUT", config));
+  bb_start(&in);
+  bb_start(&out);
+
+  BbWaitSet_t ws;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_waitset_init(&ws));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_waitset_add_input(&ws, &in));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_waitset_add_output(&ws, &out));
+
+  // Empty output is writable straight away
+  uint32_t ready_in, ready_out;
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_await_any(&ws, BB_AWAIT_POLL, &ready_in,
+                                               &ready_out));
+  TEST_ASSERT_EQUAL_HEX32(0, ready_in);
+  TEST_ASSERT_EQUAL_HEX32(1, ready_out);
+
+  // Fill the output (ring of 2 keeps one slot free)
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_submit(&out, 0));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_TIMEOUT,
+                        bb_await_any(&ws, BB_AWAIT_POLL, &ready_in,
+                                     &ready_out));
+
+  // External poller: the fd becomes readable once the consumer frees a slot
+  int fd = bb_waitset_fd(&ws);
+  TEST_ASSERT_TRUE(fd >= 0);
+  struct pollfd pfd = {.fd = fd, .events = POLLIN};
+  TEST_ASSERT_EQUAL_INT(0, poll(&pfd, 1, 0));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_del_tail(&out));
+  TEST_ASSERT_EQUAL_INT(1, poll(&pfd, 1, 0));
+  TEST_ASSERT_EQUAL_INT(Bp_EC_OK, bb_await_any(&ws, BB_AWAIT_POLL, &ready_in,
+                                               &ready_out));
+  TEST_ASSERT_EQUAL_HEX32(1, ready_out);
+  TEST_ASSERT_EQUAL_INT(0, poll(&pfd, 1, 0));  // Drained by bb_await_any
+
+  bb_waitset_deinit(&ws);
+  bb_deinit(&in);
+  bb_deinit(&out);
+}
+
 int main(int argc, char* argv[])
 {
   UNITY_BEGIN();
@@ -488,5 +1306,20 @@ int main(int argc, char* argv[])
   RUN_TEST(test_empty_blocking_consume);
   RUN_TEST(test_overflow_drop_tail);
   RUN_TEST(test_drop_tail_concurrent);
+  RUN_TEST(test_overflow_drop_stale);
+  RUN_TEST(test_drop_stale_wait_keeps_deadline);
+  RUN_TEST(test_overflow_decimate);
+  RUN_TEST(test_overflow_spill);
+  RUN_TEST(test_overflow_spill_full_nonblocking);
+  RUN_TEST(test_multichannel_geometry);
+  RUN_TEST(test_sample_timestamp_column);
+  RUN_TEST(test_record_stream);
+  RUN_TEST(test_interleave_roundtrip);
+  RUN_TEST(test_copy_frames_across_layouts);
+  RUN_TEST(test_adopt_arena_storage);
+  RUN_TEST(test_swap_data_between_rings);
+  RUN_TEST(test_swap_groups_merge_after_members_leave);
+  RUN_TEST(test_await_any_inputs);
+  RUN_TEST(test_await_any_outputs_and_fd);
   return UNITY_END();
 }
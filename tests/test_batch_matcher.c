@@ -335,6 +335,124 @@ void test_input_already_matched(void)
   TEST_ASSERT_EQUAL(64, fixture.matcher.output_batch_samples);
 }
 
+// Push `n` sequential samples starting at sample index `first`
+static void push_samples(Batch_buff_t* buff, size_t first, size_t n)
+{
+  Batch_t* batch = bb_get_head(buff);
+  float* data = (float*) batch->data;
+  for (size_t i = 0; i < n; i++) data[i] = (float) (first + i);
+  batch->t_ns = (long long) first * 1000000;
+  batch->period_ns = 1000000;
+  batch->head = n;
+  batch->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(buff, 1000000));
+}
+
+void test_non_power_of_two_frames(void)
+{
+  // 1000-sample frames (1 s at 1 kHz) in 1024-sample sink batches
+  BatchMatcher_config_t matcher_config = {
+      .name = "frame_matcher",
+      .buff_config = {.dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = 6,
+                      .ring_capacity_expo = 5,
+                      .overflow_behaviour = OVERFLOW_BLOCK},
+      .output_batch_samples = 1000};
+  CHECK_ERR(batch_matcher_init(&fixture.matcher, matcher_config));
+
+  BatchBuffer_config out_config = {.dtype = DTYPE_FLOAT,
+                                   .batch_capacity_expo = 10,
+                                   .ring_capacity_expo = 2,
+                                   .overflow_behaviour = OVERFLOW_BLOCK};
+  Batch_buff_t small, out;
+  BatchBuffer_config small_config = out_config;
+  small_config.batch_capacity_expo = 9;
+  CHECK_ERR(bb_init(&small, "small", small_config));
+  TEST_ASSERT_EQUAL(Bp_EC_CAPACITY_MISMATCH,
+                    filt_sink_connect(&fixture.matcher.base, 0, &small));
+  CHECK_ERR(bb_deinit(&small));
+
+  CHECK_ERR(bb_init(&out, "frames", out_config));
+  CHECK_ERR(filt_sink_connect(&fixture.matcher.base, 0, &out));
+  TEST_ASSERT_EQUAL(1000, fixture.matcher.output_batch_samples);
+  CHECK_ERR(bb_start(&out));
+  CHECK_ERR(bb_start(fixture.matcher.base.input_buffers[0]));
+  CHECK_ERR(filt_start(&fixture.matcher.base));
+
+  // Start mid-frame at sample 10 so the leading partial frame is skipped
+  Batch_buff_t* in = fixture.matcher.base.input_buffers[0];
+  for (size_t first = 10; first < 2300; first += 64) push_samples(in, first, 64);
+  Batch_t* done = bb_get_head(in);
+  done->head = 0;
+  done->ec = Bp_EC_COMPLETE;
+  CHECK_ERR(bb_submit(in, 1000000));
+
+  Bp_EC err;
+  Batch_t* frame = bb_get_tail(&out, 1000000, &err);
+  CHECK_ERR(err);
+  TEST_ASSERT_EQUAL(1000, frame->head);
+  TEST_ASSERT_EQUAL_INT64(1000LL * 1000000, frame->t_ns);
+  float* data = (float*) frame->data;
+  for (size_t i = 0; i < 1000; i++) {
+    TEST_ASSERT_EQUAL_FLOAT((float) (1000 + i), data[i]);
+  }
+  bb_del_tail(&out);
+
+  // Trailing partial frame is flushed on completion
+  frame = bb_get_tail(&out, 1000000, &err);
+  CHECK_ERR(err);
+  TEST_ASSERT_EQUAL(314, frame->head);
+  TEST_ASSERT_EQUAL_INT64(2000LL * 1000000, frame->t_ns);
+  bb_del_tail(&out);
+
+  TEST_ASSERT_EQUAL(990, fixture.matcher.samples_skipped);
+
+  CHECK_ERR(filt_stop(&fixture.matcher.base));
+  CHECK_ERR(filt_deinit(&fixture.matcher.base));
+  fixture.matcher.base.worker = NULL;
+  bb_stop(&out);
+  CHECK_ERR(bb_deinit(&out));
+}
+
+void test_aligned_batches_pass_whole(void)
+{
+  BatchMatcher_config_t matcher_config = {
+      .name = "whole_matcher",
+      .buff_config = {.dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = 6,
+                      .ring_capacity_expo = 4,
+                      .overflow_behaviour = OVERFLOW_BLOCK}};
+  CHECK_ERR(batch_matcher_init(&fixture.matcher, matcher_config));
+
+  Batch_buff_t out;
+  CHECK_ERR(bb_init(&out, "whole", matcher_config.buff_config));
+  CHECK_ERR(filt_sink_connect(&fixture.matcher.base, 0, &out));
+  CHECK_ERR(bb_start(&out));
+  CHECK_ERR(bb_start(fixture.matcher.base.input_buffers[0]));
+  CHECK_ERR(filt_start(&fixture.matcher.base));
+
+  Batch_buff_t* in = fixture.matcher.base.input_buffers[0];
+  for (size_t b = 0; b < 3; b++) push_samples(in, b * 64, 64);
+
+  for (size_t b = 0; b < 3; b++) {
+    Bp_EC err;
+    Batch_t* batch = bb_get_tail(&out, 1000000, &err);
+    CHECK_ERR(err);
+    TEST_ASSERT_EQUAL(64, batch->head);
+    TEST_ASSERT_EQUAL_INT64((long long) b * 64 * 1000000, batch->t_ns);
+    TEST_ASSERT_EQUAL_FLOAT((float) (b * 64 + 63),
+                            ((float*) batch->data)[63]);
+    bb_del_tail(&out);
+  }
+  TEST_ASSERT_EQUAL(3, fixture.matcher.batches_passed_whole);
+
+  CHECK_ERR(filt_stop(&fixture.matcher.base));
+  CHECK_ERR(filt_deinit(&fixture.matcher.base));
+  fixture.matcher.base.worker = NULL;
+  bb_stop(&out);
+  CHECK_ERR(bb_deinit(&out));
+}
+
 int main(void)
 {
   UNITY_BEGIN();
@@ -344,6 +462,8 @@ int main(void)
   RUN_TEST(test_no_sink_error);
   RUN_TEST(test_phase_validation);
   RUN_TEST(test_input_already_matched);
+  RUN_TEST(test_non_power_of_two_frames);
+  RUN_TEST(test_aligned_batches_pass_whole);
 
   return UNITY_END();
 }
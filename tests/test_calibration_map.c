@@ -0,0 +1,252 @@
+#include <math.h>
+#include <string.h>
+#include "../bpipe/calibration_map.h"
+#include "core.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define BATCH_CAPACITY_EXPO 6
+#define RING_CAPACITY_EXPO 4
+#define BATCH_CAPACITY (1 << BATCH_CAPACITY_EXPO)
+
+typedef struct {
+  CalibrationMap_t cal;
+  Batch_buff_t output;
+} TestFixture;
+
+static TestFixture fixture;
+
+/* Reference: binary search for the segment, then interpolate */
+static float reference(const CalibrationTable_t* t, float v)
+{
+  size_t n = t->n_points;
+  if (!t->extrapolate) {
+    v = v < t->x[0] ? t->x[0] : (v > t->x[n - 1] ? t->x[n - 1] : v);
+  }
+  size_t lo = 0, hi = n - 2;
+  while (lo < hi) {
+    size_t mid = (lo + hi + 1) / 2;
+    if (t->x[mid] <= v) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  float slope = (t->y[lo + 1] - t->y[lo]) / (t->x[lo + 1] - t->x[lo]);
+  return t->y[lo] + (v - t->x[lo]) * slope;
+}
+
+static void start(CalibrationTable_t table, SampleDtype_t dtype)
+{
+  CalibrationMap_config_t config = {
+      .name = "cal",
+      .buff_config = {.dtype = dtype,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO},
+      .table = table,
+      .timeout_us = 100000};
+  CHECK_ERR(calibration_map_init(&fixture.cal, config));
+  test_filt_start(&fixture.cal.base, &fixture.output,
+                  (BatchBuffer_config){
+                      .dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO,
+                      .overflow_behaviour = OVERFLOW_BLOCK});
+}
+
+/* Push n samples through the filter and return the calibrated batch */
+static const float* run_batch(const void* samples, size_t n)
+{
+  test_push(fixture.cal.base.input_buffers[0], samples, n, 1000, 10);
+  Batch_t* out = test_pull(&fixture.output);
+  TEST_ASSERT_EQUAL(n, out->head);
+  TEST_ASSERT_EQUAL(1000, out->t_ns);
+  TEST_ASSERT_EQUAL(10, out->period_ns);
+  return (const float*) out->data;
+}
+
+void setUp(void) { memset(&fixture, 0, sizeof(fixture)); }
+
+void tearDown(void)
+{
+  if (fixture.cal.base.worker != NULL) {
+    test_filt_stop(&fixture.cal.base, &fixture.output);
+  }
+}
+
+void test_uniform_table_from_adc_counts(void)
+{
+  /* 12-bit ADC, 17 evenly spaced breakpoints on a quadratic */
+  float x[17], y[17];
+  for (int i = 0; i < 17; i++) {
+    x[i] = 256.0f * (float) i;
+    y[i] = 0.001f * x[i] * x[i] / 4096.0f - 1.5f;
+  }
+  CalibrationTable_t table = {.x = x, .y = y, .n_points = 17};
+  start(table, DTYPE_I32);
+
+  int32_t raw[BATCH_CAPACITY];
+  for (int i = 0; i < BATCH_CAPACITY; i++) {
+    raw[i] = -100 + i * 71;  // -100..4373
+  }
+  const float* out = run_batch(raw, BATCH_CAPACITY);
+  for (int i = 0; i < BATCH_CAPACITY; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, reference(&table, (float) raw[i]),
+                             out[i]);
+  }
+  CHECK_ERR(bb_del_tail(&fixture.output));
+
+  /* -100, -29 and the four samples above 4096 lie outside the table */
+  TEST_ASSERT_EQUAL(6, atomic_load(&fixture.cal.samples_clamped));
+}
+
+void test_non_uniform_table_with_extrapolation(void)
+{
+  /* Breakpoints bunched towards zero */
+  float x[200], y[200];
+  for (int i = 0; i < 200; i++) {
+    x[i] = powf((float) i, 1.5f);
+    y[i] = sinf(0.05f * (float) i) * 10.0f;
+  }
+  CalibrationTable_t table = {
+      .x = x, .y = y, .n_points = 200, .extrapolate = true};
+  start(table, DTYPE_FLOAT);
+
+  float v[BATCH_CAPACITY];
+  for (int i = 0; i < BATCH_CAPACITY; i++) {
+    v[i] = -20.0f + 47.3f * (float) i;
+  }
+  v[1] = x[57];  // Exactly on breakpoints
+  v[2] = x[198];
+  v[3] = NAN;
+
+  const float* out = run_batch(v, BATCH_CAPACITY);
+  TEST_ASSERT_TRUE(isnan(out[3]));
+  for (int i = 0; i < BATCH_CAPACITY; i++) {
+    if (i == 3) continue;
+    TEST_ASSERT_FLOAT_WITHIN(1e-3f, reference(&table, v[i]), out[i]);
+  }
+  CHECK_ERR(bb_del_tail(&fixture.output));
+}
+
+/* Infinite inputs must stop at the end segments, not walk off the tables */
+void test_extrapolate_infinities(void)
+{
+  float x_uneven[4] = {0.0f, 1.0f, 3.0f, 7.0f};
+  float x_even[4] = {0.0f, 1.0f, 2.0f, 3.0f};
+  float y[4] = {0.0f, 2.0f, 3.0f, -10.0f}; /* Falls off to the right */
+  float* xs[2] = {x_uneven, x_even};
+  float v[4] = {-INFINITY, INFINITY, NAN, 8.0f};
+
+  for (int t = 0; t < 2; t++) {
+    CalibrationTable_t table = {
+        .x = xs[t], .y = y, .n_points = 4, .extrapolate = true};
+    start(table, DTYPE_FLOAT);
+
+    const float* out = run_batch(v, 4);
+    TEST_ASSERT_TRUE(isinf(out[0]) && out[0] < 0.0f);
+    TEST_ASSERT_TRUE(isinf(out[1]) && out[1] < 0.0f);
+    TEST_ASSERT_TRUE(isnan(out[2]));
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, reference(&table, v[3]), out[3]);
+    CHECK_ERR(bb_del_tail(&fixture.output));
+
+    test_filt_stop(&fixture.cal.base, &fixture.output);
+    memset(&fixture, 0, sizeof(fixture));
+  }
+}
+
+void test_partial_batch_clamped_non_uniform(void)
+{
+  /* A partial batch: NaN and clamping on every sample up to head */
+  float x[40], y[40];
+  for (int i = 0; i < 40; i++) {
+    x[i] = (float) (i * i);
+    y[i] = cosf(0.2f * (float) i);
+  }
+  CalibrationTable_t table = {.x = x, .y = y, .n_points = 40};
+  start(table, DTYPE_FLOAT);
+
+  float v[BATCH_CAPACITY - 3];
+  for (int i = 0; i < BATCH_CAPACITY - 3; i++) {
+    v[i] = -50.0f + 27.1f * (float) i;
+  }
+  v[9] = NAN;
+  v[BATCH_CAPACITY - 4] = NAN;
+
+  const float* out = run_batch(v, BATCH_CAPACITY - 3);
+  for (int i = 0; i < BATCH_CAPACITY - 3; i++) {
+    if (isnan(v[i])) {
+      TEST_ASSERT_TRUE(isnan(out[i]));
+    } else {
+      TEST_ASSERT_FLOAT_WITHIN(1e-5f, reference(&table, v[i]), out[i]);
+    }
+  }
+  CHECK_ERR(bb_del_tail(&fixture.output));
+  /* -50, -22.9 and the two samples above 1521 (the last one is NaN) */
+  TEST_ASSERT_EQUAL(4, atomic_load(&fixture.cal.samples_clamped));
+}
+
+void test_table_swap_through_reconfigure(void)
+{
+  float x[2] = {0.0f, 10.0f};
+  float gain1[2] = {0.0f, 10.0f}, gain2[2] = {0.0f, 20.0f};
+  CalibrationTable_t table = {.x = x, .y = gain1, .n_points = 2};
+  start(table, DTYPE_FLOAT);
+
+  float v[4] = {1.0f, 2.0f, 3.0f, 4.0f};
+  const float* out = run_batch(v, 4);
+  TEST_ASSERT_EQUAL_FLOAT(3.0f, out[2]);
+  CHECK_ERR(bb_del_tail(&fixture.output));
+
+  table.y = gain2;
+  CHECK_ERR(filt_reconfigure(&fixture.cal.base, &table));
+  out = run_batch(v, 4);
+  TEST_ASSERT_EQUAL_FLOAT(6.0f, out[2]);
+  CHECK_ERR(bb_del_tail(&fixture.output));
+  TEST_ASSERT_EQUAL(1, atomic_load(&fixture.cal.tables_swapped));
+
+  /* A bad table is rejected and the current one stays in place */
+  float bad_x[2] = {5.0f, 5.0f};
+  table.x = bad_x;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    filt_reconfigure(&fixture.cal.base, &table));
+  out = run_batch(v, 4);
+  TEST_ASSERT_EQUAL_FLOAT(8.0f, out[3]);
+  CHECK_ERR(bb_del_tail(&fixture.output));
+}
+
+void test_rejects_invalid_config(void)
+{
+  float x[3] = {0.0f, 1.0f, 0.5f}, y[3] = {0};
+  CalibrationMap_config_t config = {
+      .name = "cal",
+      .buff_config = {.dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO},
+      .table = {.x = x, .y = y, .n_points = 3}};
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    calibration_map_init(&fixture.cal, config));
+  config.table.n_points = 1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    calibration_map_init(&fixture.cal, config));
+  config.table.n_points = 2;
+  config.buff_config.dtype = DTYPE_U32;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    calibration_map_init(&fixture.cal, config));
+  config.buff_config.dtype = DTYPE_FLOAT;
+  config.table.y = NULL;
+  TEST_ASSERT_EQUAL(Bp_EC_NULL_POINTER,
+                    calibration_map_init(&fixture.cal, config));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_uniform_table_from_adc_counts);
+  RUN_TEST(test_non_uniform_table_with_extrapolation);
+  RUN_TEST(test_extrapolate_infinities);
+  RUN_TEST(test_partial_batch_clamped_non_uniform);
+  RUN_TEST(test_table_swap_through_reconfigure);
+  RUN_TEST(test_rejects_invalid_config);
+  return UNITY_END();
+}
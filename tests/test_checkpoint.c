@@ -0,0 +1,345 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../bpipe/moving_median.h"
+#include "../bpipe/pipeline.h"
+#include "core.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define BATCH_EXPO 6
+#define BATCH_N (1 << BATCH_EXPO)
+#define N_SAMPLES (4 * BATCH_N)
+#define PERIOD_NS 100
+#define BLOB_SIZE (64 * 1024)
+
+static MovingMedian_t mm;
+static Batch_buff_t output;
+static float signal[N_SAMPLES];
+static uint8_t blob[BLOB_SIZE];
+
+static void init_median(MovingMedian_t* f, const char* name, size_t window)
+{
+  MovingMedian_config_t config = {
+      .name = name,
+      .buff_config = {.dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = BATCH_EXPO,
+                      .ring_capacity_expo = 3},
+      .window = window,
+      .timeout_us = 100000};
+  memset(f, 0, sizeof(*f));
+  CHECK_ERR(moving_median_init(f, config));
+}
+
+static void connect_output(void)
+{
+  BatchBuffer_config out_config = {.dtype = DTYPE_FLOAT,
+                                   .batch_capacity_expo = BATCH_EXPO,
+                                   .ring_capacity_expo = 4,
+                                   .overflow_behaviour = OVERFLOW_BLOCK};
+  CHECK_ERR(bb_init(&output, "median_out", out_config));
+  CHECK_ERR(filt_sink_connect(&mm.base, 0, &output));
+  CHECK_ERR(bb_start(&output));
+}
+
+/* Queue signal batch `b` in the filter's input */
+static void push(size_t b)
+{
+  Batch_t* in = bb_get_head(mm.base.input_buffers[0]);
+  memcpy(in->data, &signal[b * BATCH_N], BATCH_N * sizeof(float));
+  in->head = BATCH_N;
+  in->t_ns = (long long) (b * BATCH_N) * PERIOD_NS;
+  in->period_ns = PERIOD_NS;
+  in->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(mm.base.input_buffers[0], 100000));
+}
+
+static int cmp_float(const void* a, const void* b)
+{
+  float x = *(const float*) a, y = *(const float*) b;
+  return (x > y) - (x < y);
+}
+
+/* Read output batch `b` and check it against one uninterrupted run */
+static void expect_batch(size_t b, size_t window)
+{
+  Bp_EC err;
+  Batch_t* out = bb_get_tail(&output, 1000000, &err);
+  CHECK_ERR(err);
+  TEST_ASSERT_EQUAL(BATCH_N, out->head);
+  TEST_ASSERT_EQUAL((long long) (b * BATCH_N) * PERIOD_NS, out->t_ns);
+  for (size_t k = 0; k < BATCH_N; k++) {
+    float win[64];
+    size_t n = b * BATCH_N + k;
+    for (size_t j = 0; j < window; j++) {
+      win[j] = signal[n >= j ? n - j : 0];
+    }
+    qsort(win, window, sizeof(float), cmp_float);
+    TEST_ASSERT_EQUAL_FLOAT(win[window / 2], ((float*) out->data)[k]);
+  }
+  CHECK_ERR(bb_del_tail(&output));
+}
+
+/* Stop and checkpoint mm, tear it down, build it again and restore */
+static size_t restart_median(size_t window, bool with_rings)
+{
+  CHECK_ERR(filt_stop(&mm.base));
+  Checkpoint_t ck;
+  ckpt_writer(&ck, blob, sizeof(blob), with_rings);
+  CHECK_ERR(filt_checkpoint(&mm.base, &ck));
+  size_t size = ck.pos;
+  CHECK_ERR(filt_deinit(&mm.base));
+  bb_stop(&output);
+  bb_deinit(&output);
+
+  init_median(&mm, "median", window);
+  connect_output();
+  ckpt_reader(&ck, blob, size);
+  CHECK_ERR(filt_restore(&mm.base, &ck));
+  TEST_ASSERT_EQUAL(size, ck.pos);
+  return size;
+}
+
+void setUp(void)
+{
+  memset(&mm, 0, sizeof(mm));
+  srand(99);
+  for (size_t k = 0; k < N_SAMPLES; k++) {
+    signal[k] = (float) (rand() % 1000);
+  }
+}
+
+void tearDown(void)
+{
+  if (mm.base.filt_type != FILT_T_NDEF) {
+    if (mm.base.running) CHECK_ERR(filt_stop(&mm.base));
+    CHECK_ERR(filt_deinit(&mm.base));
+    bb_stop(&output);
+    bb_deinit(&output);
+  }
+}
+
+void test_sizing_pass_matches_written_size(void)
+{
+  init_median(&mm, "median", 31);
+  connect_output();
+
+  Checkpoint_t ck;
+  ckpt_writer(&ck, NULL, 0, false);
+  CHECK_ERR(filt_checkpoint(&mm.base, &ck));
+  size_t needed = ck.pos;
+  TEST_ASSERT_EQUAL(0, ck.n_cold);
+
+  ckpt_writer(&ck, blob, needed - 1, false);
+  TEST_ASSERT_EQUAL(Bp_EC_NO_SPACE, filt_checkpoint(&mm.base, &ck));
+  ckpt_writer(&ck, blob, needed, false);
+  CHECK_ERR(filt_checkpoint(&mm.base, &ck));
+  TEST_ASSERT_EQUAL(needed, ck.pos);
+
+  /* A truncated blob is rejected, not read past */
+  ckpt_reader(&ck, blob, needed - 1);
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_DATA, filt_restore(&mm.base, &ck));
+}
+
+void test_state_restored_across_restart(void)
+{
+  const size_t windows[] = {31, 9}; /* Heap path, network path */
+  for (size_t i = 0; i < 2; i++) {
+    init_median(&mm, "median", windows[i]);
+    connect_output();
+    CHECK_ERR(filt_start(&mm.base));
+    push(0);
+    expect_batch(0, windows[i]);
+    push(1);
+    expect_batch(1, windows[i]);
+
+    restart_median(windows[i], false);
+    CHECK_ERR(filt_start(&mm.base));
+    push(2);
+    expect_batch(2, windows[i]);
+    push(3);
+    expect_batch(3, windows[i]);
+    tearDown();
+    memset(&mm, 0, sizeof(mm));
+  }
+}
+
+void test_queued_batches_restored_with_rings(void)
+{
+  init_median(&mm, "median", 31);
+  connect_output();
+  CHECK_ERR(filt_start(&mm.base));
+  push(0);
+  expect_batch(0, 31);
+
+  /* Queued after the worker stopped: carried over in the record */
+  CHECK_ERR(filt_stop(&mm.base));
+  push(1);
+  push(2);
+  restart_median(31, true);
+  TEST_ASSERT_EQUAL(2, bb_occupancy(mm.base.input_buffers[0]));
+  CHECK_ERR(filt_start(&mm.base));
+  expect_batch(1, 31);
+  expect_batch(2, 31);
+}
+
+void test_record_for_other_filter_rejected(void)
+{
+  init_median(&mm, "median", 31);
+  connect_output();
+  Checkpoint_t ck;
+  ckpt_writer(&ck, blob, sizeof(blob), false);
+  CHECK_ERR(filt_checkpoint(&mm.base, &ck));
+  size_t size = ck.pos;
+
+  MovingMedian_t other;
+  init_median(&other, "median2", 31);
+  ckpt_reader(&ck, blob, size);
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_DATA, filt_restore(&other.base, &ck));
+  CHECK_ERR(filt_deinit(&other.base));
+
+  /* Same name, different window: state size does not match */
+  init_median(&other, "median", 9);
+  ckpt_reader(&ck, blob, size);
+  TEST_ASSERT_NOT_EQUAL(Bp_EC_OK, filt_restore(&other.base, &ck));
+  CHECK_ERR(filt_deinit(&other.base));
+
+  CHECK_ERR(filt_start(&mm.base));
+  ckpt_writer(&ck, blob, sizeof(blob), false);
+  TEST_ASSERT_EQUAL(Bp_EC_ALREADY_RUNNING, filt_checkpoint(&mm.base, &ck));
+  ckpt_reader(&ck, blob, size);
+  TEST_ASSERT_EQUAL(Bp_EC_ALREADY_RUNNING, filt_restore(&mm.base, &ck));
+}
+
+void test_ring_restore_checks_geometry(void)
+{
+  BatchBuffer_config config = {.dtype = DTYPE_FLOAT,
+                               .batch_capacity_expo = BATCH_EXPO,
+                               .ring_capacity_expo = 3,
+                               .n_channels = 2,
+                               .layout = BATCH_LAYOUT_PLANAR};
+  Batch_buff_t ring;
+  CHECK_ERR(bb_init(&ring, "ring", config));
+  Batch_t* batch = bb_get_head(&ring);
+  batch->head = 4;
+  batch->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(&ring, 100000));
+
+  Checkpoint_t ck;
+  ckpt_writer(&ck, blob, sizeof(blob), true);
+  CHECK_ERR(bb_checkpoint(&ring, &ck));
+  size_t size = ck.pos;
+  bb_deinit(&ring);
+
+  /* Same frame size each time, only one field differs */
+  BatchBuffer_config other[3] = {config, config, config};
+  other[0].dtype = DTYPE_I32;
+  other[1].layout = BATCH_LAYOUT_INTERLEAVED;
+  other[2].dtype = DTYPE_I16;
+  other[2].n_channels = 4;
+  for (size_t i = 0; i < 3; i++) {
+    CHECK_ERR(bb_init(&ring, "ring", other[i]));
+    ckpt_reader(&ck, blob, size);
+    TEST_ASSERT_EQUAL(Bp_EC_INVALID_DATA, bb_restore_check(&ring, &ck));
+    ckpt_reader(&ck, blob, size);
+    TEST_ASSERT_EQUAL(Bp_EC_INVALID_DATA, bb_restore(&ring, &ck));
+    TEST_ASSERT_EQUAL(0, bb_occupancy(&ring));
+    bb_deinit(&ring);
+  }
+
+  CHECK_ERR(bb_init(&ring, "ring", config));
+  ckpt_reader(&ck, blob, size);
+  CHECK_ERR(bb_restore_check(&ring, &ck));
+  TEST_ASSERT_EQUAL(size, ck.pos);
+  TEST_ASSERT_EQUAL(0, bb_occupancy(&ring));
+  ckpt_reader(&ck, blob, size);
+  CHECK_ERR(bb_restore(&ring, &ck));
+  TEST_ASSERT_EQUAL(1, bb_occupancy(&ring));
+  bb_deinit(&ring);
+}
+
+/* Build first -> second in `pipe` */
+static void init_pipeline(Pipeline_t* pipe, MovingMedian_t* first,
+                          MovingMedian_t* second, const char* second_name)
+{
+  init_median(first, "first", 9);
+  init_median(second, second_name, 9);
+  Filter_t* filters[] = {&first->base, &second->base};
+  Connection_t connections[] = {{&first->base, 0, &second->base, 0}};
+  Pipeline_config_t config = {.name = "chain",
+                              .buff_config = {.dtype = DTYPE_FLOAT,
+                                              .batch_capacity_expo = BATCH_EXPO,
+                                              .ring_capacity_expo = 3},
+                              .timeout_us = 100000,
+                              .filters = filters,
+                              .n_filters = 2,
+                              .connections = connections,
+                              .n_connections = 1,
+                              .input_filter = &first->base,
+                              .output_filter = &second->base};
+  CHECK_ERR(pipeline_init(pipe, config));
+}
+
+static void deinit_pipeline(Pipeline_t* pipe, MovingMedian_t* first,
+                            MovingMedian_t* second)
+{
+  CHECK_ERR(filt_deinit(&pipe->base));
+  CHECK_ERR(filt_deinit(&first->base));
+  CHECK_ERR(filt_deinit(&second->base));
+}
+
+void test_pipeline_checks_every_record_first(void)
+{
+  Pipeline_t pipe;
+  MovingMedian_t first, second;
+  init_pipeline(&pipe, &first, &second, "second");
+  first.primed = true;
+  second.primed = true;
+  Checkpoint_t ck;
+  ckpt_writer(&ck, blob, sizeof(blob), false);
+  CHECK_ERR(filt_checkpoint(&pipe.base, &ck));
+  size_t size = ck.pos;
+  deinit_pipeline(&pipe, &first, &second);
+
+  /* Second member differs: nothing is restored, not even the first */
+  init_pipeline(&pipe, &first, &second, "other");
+  ckpt_reader(&ck, blob, size);
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_DATA, filt_restore(&pipe.base, &ck));
+  TEST_ASSERT_FALSE(first.primed);
+  deinit_pipeline(&pipe, &first, &second);
+
+  /* Second member's ring cannot take the record: checked up front too */
+  init_pipeline(&pipe, &first, &second, "second");
+  uint8_t* ring_blob = blob + size;
+  ckpt_writer(&ck, ring_blob, sizeof(blob) - size, true);
+  CHECK_ERR(filt_checkpoint(&pipe.base, &ck));
+  size_t ring_size = ck.pos;
+  Batch_t* queued = bb_get_head(second.base.input_buffers[0]);
+  queued->head = 1;
+  queued->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(second.base.input_buffers[0], 100000));
+  first.primed = false;
+  ckpt_reader(&ck, ring_blob, ring_size);
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, filt_restore(&pipe.base, &ck));
+  TEST_ASSERT_FALSE(first.primed);
+  deinit_pipeline(&pipe, &first, &second);
+
+  init_pipeline(&pipe, &first, &second, "second");
+  ckpt_reader(&ck, blob, size);
+  CHECK_ERR(filt_restore(&pipe.base, &ck));
+  TEST_ASSERT_EQUAL(size, ck.pos);
+  TEST_ASSERT_TRUE(first.primed);
+  TEST_ASSERT_TRUE(second.primed);
+  deinit_pipeline(&pipe, &first, &second);
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_sizing_pass_matches_written_size);
+  RUN_TEST(test_state_restored_across_restart);
+  RUN_TEST(test_queued_batches_restored_with_rings);
+  RUN_TEST(test_record_for_other_filter_rejected);
+  RUN_TEST(test_ring_restore_checks_geometry);
+  RUN_TEST(test_pipeline_checks_every_record_first);
+  return UNITY_END();
+}
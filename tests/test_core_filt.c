@@ -4,6 +4,7 @@
 #include <bits/types/timer_t.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <time.h>
 #include "unity_internals.h"
@@ -218,6 +219,57 @@ void test_cascading_complete(void)
 
 void test_shutdown_with_data(void) {}
 
+#define WIDE_PORTS 64
+Batch_buff_t wide_sinks[WIDE_PORTS];
+
+void test_ports_sized_at_init(void)
+{
+  /* Per-batch fields stay within two cache lines */
+  TEST_ASSERT_TRUE(offsetof(Filter_t, name) <= 128);
+
+  Filter_t wide;
+  Core_filt_config_t wide_config = filter_config;
+  wide_config.name = "WIDE";
+  wide_config.max_supported_sinks = WIDE_PORTS;
+  wide_config.n_inputs = WIDE_PORTS;
+  CHECK_ERR(filt_init(&wide, wide_config));
+  TEST_ASSERT_EQUAL(WIDE_PORTS, wide.n_input_buffers);
+  TEST_ASSERT_NOT_NULL(wide.input_buffers[WIDE_PORTS - 1]);
+
+  for (size_t i = 0; i < WIDE_PORTS; i++) {
+    CHECK_ERR(bb_init(&wide_sinks[i], "WIDE_SINK", config));
+    CHECK_ERR(filt_sink_connect(&wide, i, &wide_sinks[i]));
+  }
+  TEST_ASSERT_EQUAL(WIDE_PORTS, wide.n_sinks);
+  TEST_ASSERT_EQUAL_PTR(&wide_sinks[WIDE_PORTS - 1],
+                        wide.sinks[WIDE_PORTS - 1]);
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_SINK_IDX,
+                    filt_sink_connect(&wide, WIDE_PORTS, &output));
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_SINK_IDX,
+                    filt_connect(&wide, WIDE_PORTS, &wide, 0));
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_SINK_IDX,
+                    filt_connect(&wide, 0, &wide, WIDE_PORTS));
+  FlushPolicy_t policy = {.max_latency_us = 100};
+  CHECK_ERR(filt_set_flush_policy(&wide, WIDE_PORTS - 1, policy));
+  TEST_ASSERT_EQUAL(100, wide.flush_policy[WIDE_PORTS - 1].max_latency_us);
+
+  for (size_t i = 0; i < WIDE_PORTS; i++) {
+    CHECK_ERR(filt_sink_disconnect(&wide, i));
+    CHECK_ERR(bb_deinit(&wide_sinks[i]));
+  }
+  CHECK_ERR(filt_deinit(&wide));
+  TEST_ASSERT_NULL(wide.input_buffers);
+  TEST_ASSERT_NULL(wide.output_properties);
+
+  wide_config.max_supported_sinks = MAX_PORTS + 1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG_MAX_SINKS,
+                    filt_init(&wide, wide_config));
+  wide_config.max_supported_sinks = 1;
+  wide_config.n_inputs = MAX_PORTS + 1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG_MAX_INPUTS,
+                    filt_init(&wide, wide_config));
+}
+
 int main(int argc, char* argv[])
 {
   TEST_MESSAGE("Test core filter.");
@@ -226,5 +278,6 @@ int main(int argc, char* argv[])
   RUN_TEST(test_data_passthrough_single_thread);
   RUN_TEST(test_filter_cascade);
   RUN_TEST(test_cascading_complete);
+  RUN_TEST(test_ports_sized_at_init);
   return UNITY_END();
 }
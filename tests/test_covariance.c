@@ -0,0 +1,258 @@
+#define _DEFAULT_SOURCE
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../bpipe/covariance.h"
+#include "core.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define BATCH_CAPACITY_EXPO 5
+#define RING_CAPACITY_EXPO 4
+#define BATCH_CAPACITY (1 << BATCH_CAPACITY_EXPO)
+#define PERIOD_NS 1000
+#define MAX_NC 40
+
+typedef struct {
+  Covariance_t cov;
+  Batch_buff_t output;
+  bool has_output;
+} TestFixture;
+
+static TestFixture fixture;
+
+static void start(size_t nc, size_t hop, size_t window_hops,
+                  CovarianceOutput_e kind, BatchLayout_t layout,
+                  bool with_sink)
+{
+  Covariance_config_t config = {
+      .name = "cov",
+      .buff_config = {.dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO,
+                      .n_channels = nc,
+                      .layout = layout},
+      .hop_samples = hop,
+      .window_hops = window_hops,
+      .output = kind,
+      .timeout_us = 10000};
+  CHECK_ERR(covariance_init(&fixture.cov, config));
+  if (!with_sink) {
+    CHECK_ERR(filt_start(&fixture.cov.base));
+    return;
+  }
+  test_filt_start(&fixture.cov.base, &fixture.output,
+                  (BatchBuffer_config){.dtype = DTYPE_FLOAT,
+                                       .batch_capacity_expo = 6,
+                                       .ring_capacity_expo = RING_CAPACITY_EXPO,
+                                       .n_channels = nc});
+  fixture.has_output = true;
+}
+
+/* Deterministic test signal: correlated channels around a large mean */
+static float signal(size_t c, size_t n)
+{
+  double common = sin(0.37 * (double) n) + 0.5 * cos(0.013 * (double) n);
+  double own = sin(0.91 * (double) n * (double) (c + 1) + (double) c);
+  return (float) (1000.0 + 10.0 * (double) c +
+                  ((double) (c % 3) - 1.0) * common + 0.3 * own);
+}
+
+/* Frames [n0, n0 + BATCH_CAPACITY) of every channel, in either layout */
+static void push_batch(size_t nc, size_t n0)
+{
+  Batch_buff_t* in_buf = fixture.cov.base.input_buffers[0];
+  Batch_t* in = bb_get_head(in_buf);
+  size_t stride = in_buf->layout == BATCH_LAYOUT_PLANAR ? 1 : nc;
+  for (size_t c = 0; c < nc; c++) {
+    float* d = (float*) bb_channel_ptr(in_buf, in, c);
+    for (size_t k = 0; k < BATCH_CAPACITY; k++) {
+      d[k * stride] = signal(c, n0 + k);
+    }
+  }
+  in->head = BATCH_CAPACITY;
+  in->t_ns = (long long) n0 * PERIOD_NS;
+  in->period_ns = PERIOD_NS;
+  in->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(in_buf, 100000));
+}
+
+/* Two-pass reference over frames [n0, n0 + n) */
+static void reference(size_t nc, size_t n0, size_t n, bool correlation,
+                      double* m)
+{
+  double mean[MAX_NC] = {0};
+  for (size_t c = 0; c < nc; c++) {
+    for (size_t k = 0; k < n; k++) mean[c] += signal(c, n0 + k);
+    mean[c] /= (double) n;
+  }
+  for (size_t i = 0; i < nc; i++) {
+    for (size_t j = 0; j < nc; j++) {
+      double s = 0.0;
+      for (size_t k = 0; k < n; k++) {
+        s += (signal(i, n0 + k) - mean[i]) * (signal(j, n0 + k) - mean[j]);
+      }
+      m[i * nc + j] = s / (double) (n - 1);
+    }
+  }
+  if (correlation) {
+    double diag[MAX_NC];
+    for (size_t i = 0; i < nc; i++) diag[i] = m[i * nc + i];
+    for (size_t i = 0; i < nc; i++) {
+      for (size_t j = 0; j < nc; j++) {
+        m[i * nc + j] /= sqrt(diag[i] * diag[j]);
+      }
+    }
+  }
+}
+
+/* Read one matrix batch and compare it with the reference */
+static void expect_matrix(size_t nc, size_t n0, size_t n, bool correlation,
+                          float tol)
+{
+  static double ref[MAX_NC * MAX_NC];
+  reference(nc, n0, n, correlation, ref);
+
+  Batch_t* out = test_pull(&fixture.output);
+  TEST_ASSERT_EQUAL(nc, out->head);
+  TEST_ASSERT_EQUAL((long long) n0 * PERIOD_NS, out->t_ns);
+  const float* m = (const float*) out->data;
+  for (size_t i = 0; i < nc * nc; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(tol, (float) ref[i], m[i]);
+  }
+  CHECK_ERR(bb_del_tail(&fixture.output));
+}
+
+void setUp(void) { memset(&fixture, 0, sizeof(fixture)); }
+
+void tearDown(void)
+{
+  if (fixture.cov.base.worker == NULL) return;
+  if (fixture.has_output) {
+    test_filt_stop(&fixture.cov.base, &fixture.output);
+  } else {
+    CHECK_ERR(filt_stop(&fixture.cov.base));
+    CHECK_ERR(filt_deinit(&fixture.cov.base));
+  }
+}
+
+void test_tumbling_covariance(void)
+{
+  const size_t nc = 5;
+  start(nc, 2 * BATCH_CAPACITY, 1, COVARIANCE_OUT_COVARIANCE,
+        BATCH_LAYOUT_INTERLEAVED, true);
+  for (size_t b = 0; b < 6; b++) push_batch(nc, b * BATCH_CAPACITY);
+  for (size_t w = 0; w < 3; w++) {
+    expect_matrix(nc, w * 2 * BATCH_CAPACITY, 2 * BATCH_CAPACITY, false, 2e-4f);
+  }
+}
+
+void test_sliding_window_across_batches(void)
+{
+  /* Hops of 24 frames split batches of 32; window of 3 hops */
+  const size_t nc = 3;
+  const size_t hop = 24;
+  start(nc, hop, 3, COVARIANCE_OUT_COVARIANCE, BATCH_LAYOUT_INTERLEAVED,
+        true);
+  for (size_t b = 0; b < 6; b++) push_batch(nc, b * BATCH_CAPACITY);
+  /* 192 frames: hops end at 72, 96, ..., 192 */
+  for (size_t end = 3 * hop; end <= 6 * BATCH_CAPACITY; end += hop) {
+    expect_matrix(nc, end - 3 * hop, 3 * hop, false, 2e-4f);
+  }
+  TEST_ASSERT_EQUAL(6, fixture.cov.windows_emitted);
+}
+
+void test_correlation_many_channels_planar(void)
+{
+  /* More than one 32-channel tile */
+  const size_t nc = MAX_NC;
+  start(nc, 2 * BATCH_CAPACITY, 2, COVARIANCE_OUT_CORRELATION,
+        BATCH_LAYOUT_PLANAR, true);
+  for (size_t b = 0; b < 6; b++) push_batch(nc, b * BATCH_CAPACITY);
+  expect_matrix(nc, 0, 4 * BATCH_CAPACITY, true, 1e-4f);
+  expect_matrix(nc, 2 * BATCH_CAPACITY, 4 * BATCH_CAPACITY, true, 1e-4f);
+}
+
+void test_snapshot_through_get_stats(void)
+{
+  /* No sink: the matrix is only available as a snapshot */
+  const size_t nc = 4;
+  start(nc, BATCH_CAPACITY, 2, COVARIANCE_OUT_COVARIANCE,
+        BATCH_LAYOUT_INTERLEAVED, false);
+  for (size_t b = 0; b < 3; b++) push_batch(nc, b * BATCH_CAPACITY);
+
+  float m[4 * 4];
+  Covariance_stats_t stats = {.matrix = m};
+  for (int i = 0; i < 1000; i++) {
+    CHECK_ERR(filt_get_stats(&fixture.cov.base, &stats));
+    if (stats.windows_emitted == 2 &&
+        stats.metrics.samples_processed == 3 * BATCH_CAPACITY) {
+      break;
+    }
+    usleep(1000);
+  }
+  TEST_ASSERT_EQUAL(2, stats.windows_emitted);
+  TEST_ASSERT_EQUAL(nc, stats.n_channels);
+  TEST_ASSERT_EQUAL((long long) BATCH_CAPACITY * PERIOD_NS, stats.window_t_ns);
+  TEST_ASSERT_EQUAL(3 * BATCH_CAPACITY, stats.metrics.samples_processed);
+
+  double ref[4 * 4];
+  reference(nc, BATCH_CAPACITY, 2 * BATCH_CAPACITY, false, ref);
+  for (size_t i = 0; i < nc * nc; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(2e-4f, (float) ref[i], m[i]);
+  }
+}
+
+void test_rejects_invalid_config(void)
+{
+  Covariance_config_t config = {
+      .name = "cov",
+      .buff_config = {.dtype = DTYPE_I32,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO,
+                      .n_channels = 4},
+      .hop_samples = 16};
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    covariance_init(&fixture.cov, config));
+  config.buff_config.dtype = DTYPE_FLOAT;
+  config.buff_config.n_channels = 1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    covariance_init(&fixture.cov, config));
+  config.buff_config.n_channels = 4;
+  config.window_hops = COVARIANCE_MAX_HOPS + 1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    covariance_init(&fixture.cov, config));
+
+  /* The sink takes one 4 x 4 matrix per batch */
+  config.window_hops = 2;
+  CHECK_ERR(covariance_init(&fixture.cov, config));
+  Batch_buff_t sink;
+  BatchBuffer_config sink_config = {.dtype = DTYPE_FLOAT,
+                                    .batch_capacity_expo = 1,
+                                    .ring_capacity_expo = 2,
+                                    .n_channels = 4};
+  CHECK_ERR(bb_init(&sink, "short", sink_config));
+  TEST_ASSERT_EQUAL(Bp_EC_CAPACITY_MISMATCH,
+                    filt_sink_connect(&fixture.cov.base, 0, &sink));
+  bb_deinit(&sink);
+  sink_config.batch_capacity_expo = 2;
+  sink_config.n_channels = 3;
+  CHECK_ERR(bb_init(&sink, "narrow", sink_config));
+  TEST_ASSERT_EQUAL(Bp_EC_WIDTH_MISMATCH,
+                    filt_sink_connect(&fixture.cov.base, 0, &sink));
+  bb_deinit(&sink);
+  CHECK_ERR(filt_deinit(&fixture.cov.base));
+  memset(&fixture, 0, sizeof(fixture));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_tumbling_covariance);
+  RUN_TEST(test_sliding_window_across_batches);
+  RUN_TEST(test_correlation_many_channels_planar);
+  RUN_TEST(test_snapshot_through_get_stats);
+  RUN_TEST(test_rejects_invalid_config);
+  return UNITY_END();
+}
@@ -122,16 +122,174 @@ void test_basic_csv_write(void)
   CHECK_ERR(sink.base.worker_err_info.ec);
 
   // Cleanup
+  filt_deinit(&sink.base);
+  filt_deinit(&source.base);
   unlink(output_file);
 }
 
 // Test multi-column output
+// Push one batch of interleaved frames, then the completion batch, and wait
+// for the sink worker to finish
+static void push_frames_and_complete(CSVSink_t* sink, size_t n_frames,
+                                     float fill)
+{
+  Batch_buff_t* in = sink->base.input_buffers[0];
+  Batch_t* batch = bb_get_head(in);
+  float* data = batch->data;
+  for (size_t i = 0; i < n_frames * in->n_channels; i++) {
+    data[i] = fill + (float) i;
+  }
+  batch->head = n_frames;
+  batch->t_ns = 1000;
+  batch->period_ns = 10;
+  batch->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(in, 100000));
+
+  batch = bb_get_head(in);
+  if (batch) {
+    batch->head = 0;
+    batch->ec = Bp_EC_COMPLETE;
+    bb_submit(in, 100000);
+  }
+
+  while (atomic_load(&sink->base.running)) {
+    usleep(1000);
+  }
+}
+
+static size_t count_char(const char* path, char c)
+{
+  FILE* f = fopen(path, "r");
+  if (!f) return 0;
+  size_t n = 0;
+  int ch;
+  while ((ch = fgetc(f)) != EOF) n += ch == c;
+  fclose(f);
+  return n;
+}
+
+// Test multi-column output from an interleaved multichannel input
 void test_multi_column_output(void)
 {
-  // Skip this test for now - needs proper multi-channel source
-  // The signal generator produces single values, not vector data
-  TEST_IGNORE_MESSAGE(
-      "Multi-column test needs multi-channel source implementation");
+  const char* output_file = "test_multi_col.csv";
+  unlink(output_file);
+
+  CSVSink_t sink;
+  CSVSink_config_t sink_cfg = {.name = "multi_sink",
+                               .output_path = output_file,
+                               .format = CSV_FORMAT_MULTI_COL,
+                               .write_header = true,
+                               .precision = 1,
+                               .buff_config = {.dtype = DTYPE_FLOAT,
+                                               .n_channels = 3,
+                                               .batch_capacity_expo = 4,
+                                               .ring_capacity_expo = 2}};
+  CHECK_ERR(csv_sink_init(&sink, sink_cfg));
+  CHECK_ERR(filt_start(&sink.base));
+
+  push_frames_and_complete(&sink, 2, 0.0f);
+  CHECK_ERR(filt_stop(&sink.base));
+  CHECK_ERR(sink.base.worker_err_info.ec);
+
+  TEST_ASSERT_EQUAL(3, count_lines(output_file));
+  TEST_ASSERT_TRUE(file_contains(
+      output_file, "timestamp_ns,channel_0,channel_1,channel_2\n"));
+  TEST_ASSERT_TRUE(file_contains(output_file, "1000,0.0,1.0,2.0\n"));
+  TEST_ASSERT_TRUE(file_contains(output_file, "1010,3.0,4.0,5.0\n"));
+
+  filt_deinit(&sink.base);
+  unlink(output_file);
+}
+
+// Rows wider than the line buffer are refused whole, never truncated or
+// written past the end of the buffer
+void test_wide_row_output(void)
+{
+  const char* output_file = "test_wide_row.csv";
+
+  /* 256 channels at one decimal place fit */
+  unlink(output_file);
+  CSVSink_t sink;
+  CSVSink_config_t sink_cfg = {.name = "wide_sink",
+                               .output_path = output_file,
+                               .format = CSV_FORMAT_MULTI_COL,
+                               .write_header = false,
+                               .precision = 1,
+                               .buff_config = {.dtype = DTYPE_FLOAT,
+                                               .n_channels = 256,
+                                               .batch_capacity_expo = 2,
+                                               .ring_capacity_expo = 2}};
+  CHECK_ERR(csv_sink_init(&sink, sink_cfg));
+  CHECK_ERR(filt_start(&sink.base));
+  push_frames_and_complete(&sink, 1, 0.0f);
+  CHECK_ERR(filt_stop(&sink.base));
+  CHECK_ERR(sink.base.worker_err_info.ec);
+  TEST_ASSERT_EQUAL(1, count_char(output_file, '\n'));
+  TEST_ASSERT_EQUAL(256, count_char(output_file, ','));
+  filt_deinit(&sink.base);
+
+  /* BB_MAX_CHANNELS at six decimal places do not */
+  unlink(output_file);
+  sink_cfg.precision = 6;
+  sink_cfg.buff_config.n_channels = BB_MAX_CHANNELS;
+  CHECK_ERR(csv_sink_init(&sink, sink_cfg));
+  CHECK_ERR(filt_start(&sink.base));
+  push_frames_and_complete(&sink, 1, 1000.0f);
+  CHECK_ERR(filt_stop(&sink.base));
+  TEST_ASSERT_EQUAL(Bp_EC_NO_SPACE, sink.base.worker_err_info.ec);
+  TEST_ASSERT_EQUAL(0, count_char(output_file, '\n'));
+  filt_deinit(&sink.base);
+  unlink(output_file);
+}
+
+// Test integer dtypes go through their own formatters (no float formatting)
+void test_integer_dtype_output(void)
+{
+  const char* output_file = "test_int.csv";
+  unlink(output_file);
+
+  CSVSink_t sink;
+  CSVSink_config_t sink_cfg = {.name = "int_sink",
+                               .output_path = output_file,
+                               .format = CSV_FORMAT_SIMPLE,
+                               .write_header = false,
+                               .precision = 3,
+                               .buff_config = {.dtype = DTYPE_I32,
+                                               .batch_capacity_expo = 4,
+                                               .ring_capacity_expo = 2}};
+  CHECK_ERR(csv_sink_init(&sink, sink_cfg));
+  CHECK_ERR(filt_start(&sink.base));
+
+  Batch_buff_t* in = sink.base.input_buffers[0];
+  Batch_t* batch = bb_get_head(in);
+  int32_t* data = batch->data;
+  data[0] = -3;
+  data[1] = 0;
+  data[2] = 2147483647;
+  batch->head = 3;
+  batch->t_ns = 1000;
+  batch->period_ns = 10;
+  batch->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(in, 100000));
+
+  batch = bb_get_head(in);
+  batch->head = 0;
+  batch->ec = Bp_EC_COMPLETE;
+  CHECK_ERR(bb_submit(in, 100000));
+
+  while (atomic_load(&sink.base.running)) {
+    usleep(1000);
+  }
+  CHECK_ERR(filt_stop(&sink.base));
+  CHECK_ERR(sink.base.worker_err_info.ec);
+
+  TEST_ASSERT_EQUAL(3, count_lines(output_file));
+  TEST_ASSERT_TRUE(file_contains(output_file, "1000,-3\n"));
+  TEST_ASSERT_TRUE(file_contains(output_file, "1010,0\n"));
+  TEST_ASSERT_TRUE(file_contains(output_file, "1020,2147483647\n"));
+
+  filt_deinit(&sink.base);
+  unlink(output_file);
 }
 
 // Test file size limit
@@ -207,6 +365,8 @@ void test_file_size_limit(void)
 
   TEST_ASSERT_TRUE_MESSAGE(size <= 1100, "File size exceeded limit too much");
 
+  filt_deinit(&sink.base);
+  filt_deinit(&source.base);
   unlink(output_file);
 }
 
@@ -291,6 +451,8 @@ void test_completion_handling(void)
   CHECK_ERR(source.base.worker_err_info.ec);
   CHECK_ERR(sink.base.worker_err_info.ec);
 
+  filt_deinit(&sink.base);
+  filt_deinit(&source.base);
   unlink(output_file);
 }
 
@@ -304,6 +466,8 @@ int main(void)
 
   RUN_TEST(test_basic_csv_write);
   RUN_TEST(test_multi_column_output);
+  RUN_TEST(test_wide_row_output);
+  RUN_TEST(test_integer_dtype_output);
   RUN_TEST(test_file_size_limit);
   RUN_TEST(test_error_handling);
   RUN_TEST(test_completion_handling);
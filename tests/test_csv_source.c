@@ -271,6 +271,67 @@ void test_csv_source_irregular_data(void)
   unlink(config.file_path);
 }
 
+void test_csv_source_irregular_timestamp_column(void)
+{
+  CsvSource_t source;
+
+  const char* csv_content =
+      "ts_ns,event_value\n"
+      "1000000,10.5\n"
+      "1500000,20.5\n"
+      "3000000,30.5\n"
+      "3100000,40.5\n";
+
+  CsvSource_config_t config = {
+      .name = "test_csv",
+      .file_path = TEST_DATA_DIR "irregular_ts.csv",
+      .delimiter = ',',
+      .has_header = true,
+      .ts_column_name = "ts_ns",
+      .data_column_names = {"event_value", NULL},
+      .detect_regular_timing = true,
+      .regular_threshold_ns = 100,
+      .timeout_us = 1000000};
+
+  create_test_csv(config.file_path, csv_content);
+  CHECK_ERR(csvsource_init(&source, config));
+
+  // Sink with a timestamp column: irregular samples share one batch
+  Batch_buff_t sink;
+  BatchBuffer_config buff_config = {.dtype = DTYPE_FLOAT,
+                                    .batch_capacity_expo = 6,
+                                    .ring_capacity_expo = 4,
+                                    .overflow_behaviour = OVERFLOW_BLOCK,
+                                    .sample_timestamps = true};
+  CHECK_ERR(bb_init(&sink, "ts_sink", buff_config));
+  CHECK_ERR(bb_start(&sink));
+  CHECK_ERR(filt_sink_connect(&source.base, 0, &sink));
+
+  CHECK_ERR(filt_start(&source.base));
+
+  Bp_EC read_err;
+  Batch_t* batch = bb_get_tail(&sink, 1000000, &read_err);
+  TEST_ASSERT_EQUAL(Bp_EC_OK, read_err);
+  TEST_ASSERT_EQUAL(4, batch->head);
+  TEST_ASSERT_EQUAL(0, batch->period_ns);
+  TEST_ASSERT_TRUE(bb_batch_has_ts(batch));
+  TEST_ASSERT_EQUAL(1000000, batch->t_ns);
+
+  const long long expected_ts[] = {1000000, 1500000, 3000000, 3100000};
+  float* data = (float*) batch->data;
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT_EQUAL(expected_ts[i], bb_sample_t_ns(batch, i));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 10.5f + 10.0f * i, data[i]);
+  }
+  bb_del_tail(&sink);
+
+  filt_stop(&source.base);
+  bb_stop(&sink);
+  bb_deinit(&sink);
+  csvsource_destroy(&source);
+  unlink(config.file_path);
+}
+
 void test_csv_source_timing_gap(void)
 {
   CsvSource_t source;
@@ -526,6 +587,62 @@ void test_csv_source_multi_channel(void)
   unlink(config.file_path);
 }
 
+void test_csv_source_interleaved_output(void)
+{
+  CsvSource_t source;
+
+  const char* csv_content =
+      "ts_ns,x,y,z\n"
+      "1000,1.0,2.0,3.0\n"
+      "2000,4.0,5.0,6.0\n";
+
+  CsvSource_config_t config = {
+      .name = "test_csv",
+      .file_path = TEST_DATA_DIR "interleaved.csv",
+      .delimiter = ',',
+      .has_header = true,
+      .ts_column_name = "ts_ns",
+      .data_column_names = {"x", "y", "z", NULL},
+      .detect_regular_timing = true,
+      .regular_threshold_ns = 100,
+      .timeout_us = 1000000};
+
+  create_test_csv(config.file_path, csv_content);
+  CHECK_ERR(csvsource_init(&source, config));
+
+  // A single 3-channel sink receives all columns in one batch
+  Batch_buff_t sink;
+  BatchBuffer_config buff_config = {.dtype = DTYPE_FLOAT,
+                                    .batch_capacity_expo = 1,
+                                    .ring_capacity_expo = 4,
+                                    .overflow_behaviour = OVERFLOW_BLOCK,
+                                    .n_channels = 3,
+                                    .layout = BATCH_LAYOUT_INTERLEAVED};
+  CHECK_ERR(bb_init(&sink, "interleaved_sink", buff_config));
+  CHECK_ERR(bb_start(&sink));
+  CHECK_ERR(filt_sink_connect(&source.base, 0, &sink));
+
+  CHECK_ERR(filt_start(&source.base));
+
+  Bp_EC read_err;
+  Batch_t* batch = bb_get_tail(&sink, 1000000, &read_err);
+  TEST_ASSERT_EQUAL(Bp_EC_OK, read_err);
+  TEST_ASSERT_EQUAL(2, batch->head);
+  TEST_ASSERT_EQUAL(1000, batch->period_ns);
+
+  float* data = (float*) batch->data;
+  for (int i = 0; i < 6; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(0.001, (float) (i + 1), data[i]);
+  }
+  bb_del_tail(&sink);
+
+  filt_stop(&source.base);
+  bb_stop(&sink);
+  bb_deinit(&sink);
+  csvsource_destroy(&source);
+  unlink(config.file_path);
+}
+
 void test_csv_source_line_too_long(void)
 {
   CsvSource_t source;
@@ -638,27 +755,34 @@ void test_csv_source_get_stats_operation(void)
   // Start filter
   CHECK_ERR(filt_start(&source.base));
 
-  // Read batches
-  Bp_EC read_err;
-  Batch_t* batch1 = bb_get_tail(sink, 1000000, &read_err);
-  TEST_ASSERT_EQUAL(Bp_EC_OK, read_err);
-  TEST_ASSERT_NOT_NULL(batch1);
-  bb_del_tail(sink);
+  // Read batches: irregular rows arrive one sample per batch, and metrics
+  // count a batch before it is submitted
+  Bp_EC read_err[2];
+  Batch_t* batch[2];
+  for (int i = 0; i < 2; i++) {
+    batch[i] = bb_get_tail(sink, 1000000, &read_err[i]);
+    if (batch[i]) bb_del_tail(sink);
+  }
 
   // Get stats
-  CHECK_ERR(source.base.ops.get_stats(&source.base, &stats));
-
-  // Verify stats
-  TEST_ASSERT_TRUE(stats.samples_processed >= 2);
-  TEST_ASSERT_TRUE(stats.n_batches >= 1);
+  Bp_EC stats_err = source.base.ops.get_stats(&source.base, &stats);
 
-  // Stop and cleanup
+  // Stop and cleanup before asserting, so a failure leaves no worker behind
   filt_stop(&source.base);
   bb_stop(sink);
   bb_deinit(sink);
   free(sink);
   csvsource_destroy(&source);
   unlink(config.file_path);
+
+  // Verify stats
+  for (int i = 0; i < 2; i++) {
+    TEST_ASSERT_EQUAL(Bp_EC_OK, read_err[i]);
+    TEST_ASSERT_NOT_NULL(batch[i]);
+  }
+  CHECK_ERR(stats_err);
+  TEST_ASSERT_TRUE(stats.samples_processed >= 2);
+  TEST_ASSERT_TRUE(stats.n_batches >= 2);
 }
 
 void test_csv_source_different_sink_batch_sizes(void)
@@ -868,10 +992,12 @@ int main(void)
   RUN_TEST(test_csv_source_missing_column);
   RUN_TEST(test_csv_source_regular_data);
   RUN_TEST(test_csv_source_irregular_data);
+  RUN_TEST(test_csv_source_irregular_timestamp_column);
   RUN_TEST(test_csv_source_timing_gap);
   RUN_TEST(test_csv_source_loop_mode);
   RUN_TEST(test_csv_source_skip_invalid_rows);
   RUN_TEST(test_csv_source_multi_channel);
+  RUN_TEST(test_csv_source_interleaved_output);
 
   // New error path tests
   RUN_TEST(test_csv_source_line_too_long);
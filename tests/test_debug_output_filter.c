@@ -541,6 +541,153 @@ void test_debug_output_sample_limiting(void)
   free(collector);
 }
 
+void test_debug_output_sampled_async_summary(void)
+{
+  // Description: Verify tap mode logs a summary for every 2nd batch (plus
+  // the completing batch) through the background writer, while all data
+  // still passes through
+
+  const char* test_file = "/tmp/bpipe_debug_tap.log";
+  unlink(test_file);
+
+  float test_data[16];
+  for (int i = 0; i < 16; i++) {
+    test_data[i] = (float) i;
+  }
+  TestSourceFilter_t* source = create_test_source(test_data, 16, 4);
+
+  DebugOutputConfig_t debug_config = {.prefix = "TAP:",
+                                      .filename = test_file,
+                                      .sample_every = 2,
+                                      .show_summary = true,
+                                      .async_output = true,
+                                      .log_ring_expo = 4};
+  DebugOutputFilter_t debug;
+  CHECK_ERR(debug_output_filter_init(&debug, &debug_config));
+
+  TestCollectorFilter_t* collector = create_test_collector(30);
+
+  CHECK_ERR(filt_sink_connect(&source->base, 0, debug.base.input_buffers[0]));
+  CHECK_ERR(
+      filt_sink_connect(&debug.base, 0, collector->base.input_buffers[0]));
+
+  CHECK_ERR(filt_start(&source->base));
+  CHECK_ERR(filt_start(&debug.base));
+  CHECK_ERR(filt_start(&collector->base));
+
+  usleep(50000);
+
+  CHECK_ERR(filt_stop(&source->base));
+  CHECK_ERR(filt_stop(&debug.base));
+  CHECK_ERR(filt_stop(&collector->base));
+
+  CHECK_ERR(debug.base.worker_err_info.ec);
+  TEST_ASSERT_EQUAL_size_t(16, collector->collected_count);
+  TEST_ASSERT_EQUAL(3, debug.batches_logged);
+  TEST_ASSERT_EQUAL(1, debug.batches_skipped);
+  TEST_ASSERT_EQUAL(0, debug.lines_dropped);
+
+  // The writer has been joined, so the file is complete
+  FILE* f = fopen(test_file, "r");
+  TEST_ASSERT_NOT_NULL(f);
+  const char* expected[] = {"TAP:  [summary n=4 min=0 max=3 mean=1.5]\n",
+                            "TAP:  [summary n=4 min=8 max=11 mean=9.5]\n",
+                            "TAP:  [summary n=4 min=12 max=15 mean=13.5]\n"};
+  char line[DEBUG_LINE_MAX];
+  int n_lines = 0;
+  while (fgets(line, sizeof(line), f)) {
+    TEST_ASSERT_TRUE(n_lines < 3);
+    TEST_ASSERT_EQUAL_STRING(expected[n_lines], line);
+    n_lines++;
+  }
+  fclose(f);
+  TEST_ASSERT_EQUAL(3, n_lines);
+
+  unlink(test_file);
+  filt_deinit(&source->base);
+  filt_deinit(&debug.base);
+  filt_deinit(&collector->base);
+  free(source);
+  free(collector->collected_data);
+  free(collector);
+}
+
+// Print the frames of one 2-channel batch in `layout` and return the file
+static void debug_print_two_channels(const char* test_file,
+                                     BatchLayout_t layout)
+{
+  unlink(test_file);
+  DebugOutputConfig_t debug_config = {.prefix = "MC:",
+                                      .show_samples = true,
+                                      .max_samples_per_batch = -1,
+                                      .format = DEBUG_FMT_DECIMAL,
+                                      .flush_after_print = true,
+                                      .filename = test_file};
+  DebugOutputFilter_t debug;
+  CHECK_ERR(debug_output_filter_init(&debug, &debug_config));
+
+  // The filter's input is single channel; rebuild it as 2 channels
+  Batch_buff_t* in = debug.base.input_buffers[0];
+  BatchBuffer_config cfg = {.dtype = DTYPE_FLOAT,
+                            .n_channels = 2,
+                            .layout = layout,
+                            .batch_capacity_expo = 2,
+                            .ring_capacity_expo = 2,
+                            .overflow_behaviour = OVERFLOW_BLOCK};
+  CHECK_ERR(bb_deinit(in));
+  CHECK_ERR(bb_init(in, "debug_in", cfg));
+  CHECK_ERR(filt_start(&debug.base));
+
+  // Frame i holds i on channel 0 and 10 + i on channel 1
+  Batch_t* batch = bb_get_head(in);
+  for (size_t ch = 0; ch < 2; ch++) {
+    float* v = bb_channel_ptr(in, batch, ch);
+    size_t stride = layout == BATCH_LAYOUT_PLANAR ? 1 : 2;
+    for (size_t i = 0; i < 3; i++) v[i * stride] = (float) (10 * ch + i);
+  }
+  batch->head = 3;
+  batch->t_ns = 0;
+  batch->period_ns = 1000;
+  batch->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(in, 100000));
+
+  // The worker keeps running after the stream ends; wait for it to drain
+  for (int i = 0; i < 1000 && bb_occupancy(in) > 0; i++) usleep(1000);
+  TEST_ASSERT_EQUAL(0, bb_occupancy(in));
+  CHECK_ERR(filt_stop(&debug.base));
+  CHECK_ERR(debug.base.worker_err_info.ec);
+  filt_deinit(&debug.base);
+}
+
+void test_debug_output_multichannel(void)
+{
+  // Description: Verify each printed line is one frame with every channel,
+  // for both interleaved and planar input
+
+  const char* test_file = "/tmp/bpipe_debug_multichannel.log";
+  const char* expected[] = {"MC:  [0] 0.000000 10.000000\n",
+                            "MC:  [1] 1.000000 11.000000\n",
+                            "MC:  [2] 2.000000 12.000000\n"};
+  BatchLayout_t layouts[] = {BATCH_LAYOUT_INTERLEAVED, BATCH_LAYOUT_PLANAR};
+
+  for (size_t l = 0; l < 2; l++) {
+    debug_print_two_channels(test_file, layouts[l]);
+
+    FILE* f = fopen(test_file, "r");
+    TEST_ASSERT_NOT_NULL(f);
+    char line[DEBUG_LINE_MAX];
+    int n_lines = 0;
+    while (fgets(line, sizeof(line), f)) {
+      TEST_ASSERT_TRUE(n_lines < 3);
+      TEST_ASSERT_EQUAL_STRING(expected[n_lines], line);
+      n_lines++;
+    }
+    fclose(f);
+    TEST_ASSERT_EQUAL(3, n_lines);
+  }
+  unlink(test_file);
+}
+
 int main(void)
 {
   UNITY_BEGIN();
@@ -549,5 +696,7 @@ int main(void)
   RUN_TEST(test_debug_output_to_file);
   RUN_TEST(test_debug_output_formats);
   RUN_TEST(test_debug_output_sample_limiting);
+  RUN_TEST(test_debug_output_sampled_async_summary);
+  RUN_TEST(test_debug_output_multichannel);
   return UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fft.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define EXPO 6
+#define N (1 << EXPO)
+
+static FftPlan_t plan;
+
+void setUp(void) { CHECK_ERR(fft_plan_init(&plan, EXPO)); }
+
+void tearDown(void) { fft_plan_deinit(&plan); }
+
+void test_forward_matches_direct_dft(void)
+{
+  float re[N], im[N];
+  double x_re[N], x_im[N];
+  srand(42);
+  for (int i = 0; i < N; i++) {
+    re[i] = (float) (x_re[i] = rand() / (double) RAND_MAX - 0.5);
+    im[i] = (float) (x_im[i] = rand() / (double) RAND_MAX - 0.5);
+  }
+  fft_forward(&plan, re, im);
+
+  const double two_pi = 2.0 * acos(-1.0);
+  for (int k = 0; k < N; k++) {
+    double want_re = 0.0, want_im = 0.0;
+    for (int n = 0; n < N; n++) {
+      double a = -two_pi * k * n / N;
+      want_re += x_re[n] * cos(a) - x_im[n] * sin(a);
+      want_im += x_re[n] * sin(a) + x_im[n] * cos(a);
+    }
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float) want_re, re[k]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float) want_im, im[k]);
+  }
+}
+
+void test_inverse_round_trip(void)
+{
+  float re[N], im[N], orig[N];
+  for (int i = 0; i < N; i++) {
+    orig[i] = re[i] = sinf(0.37f * (float) i) + (i == 5 ? 3.0f : 0.0f);
+    im[i] = 0.0f;
+  }
+  fft_forward(&plan, re, im);
+  /* Real input: conjugate symmetric spectrum */
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, re[3], re[N - 3]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4f, -im[3], im[N - 3]);
+
+  fft_inverse(&plan, re, im);
+  for (int i = 0; i < N; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, orig[i], re[i]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, 0.0f, im[i]);
+  }
+}
+
+void test_rejects_bad_sizes(void)
+{
+  FftPlan_t p;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, fft_plan_init(&p, 0));
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    fft_plan_init(&p, FFT_MAX_EXPO + 1));
+  TEST_ASSERT_EQUAL(Bp_EC_NULL_POINTER, fft_plan_init(NULL, 4));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_forward_matches_direct_dft);
+  RUN_TEST(test_inverse_round_trip);
+  RUN_TEST(test_rejects_bad_sizes);
+  return UNITY_END();
+}
@@ -0,0 +1,258 @@
+#include <math.h>
+#include <string.h>
+#include "../bpipe/fixed_dsp.h"
+#include "core.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define BATCH_CAPACITY_EXPO 6
+#define RING_CAPACITY_EXPO 4
+#define BATCH_CAPACITY (1 << BATCH_CAPACITY_EXPO)
+
+typedef struct {
+  FixedDsp_t dsp;
+  Batch_buff_t output;
+} TestFixture;
+
+static TestFixture fixture;
+
+static void start(FixedDsp_config_t config)
+{
+  config.buff_config.batch_capacity_expo = BATCH_CAPACITY_EXPO;
+  config.buff_config.ring_capacity_expo = RING_CAPACITY_EXPO;
+  config.timeout_us = 100000;
+  CHECK_ERR(fixed_dsp_init(&fixture.dsp, config));
+
+  BatchBuffer_config out_config = config.buff_config;
+  out_config.overflow_behaviour = OVERFLOW_BLOCK;
+  test_filt_start(&fixture.dsp.base, &fixture.output, out_config);
+}
+
+void setUp(void) { memset(&fixture, 0, sizeof(fixture)); }
+
+void tearDown(void)
+{
+  if (fixture.dsp.base.worker != NULL) {
+    test_filt_stop(&fixture.dsp.base, &fixture.output);
+  }
+}
+
+void test_fir_q15_rounding_is_exact(void)
+{
+  /* Two-tap average in Q15: halves round up, also for negative values */
+  const int32_t taps[2] = {16384, 16384};
+  start((FixedDsp_config_t){.name = "avg",
+                            .buff_config = {.dtype = DTYPE_I16},
+                            .kind = FIXED_DSP_FIR,
+                            .coeffs = taps,
+                            .n_coeffs = 2,
+                            .coeff_frac_bits = 15});
+
+  const int16_t x[6] = {1, 2, 3, -3, -2, -1};
+  const int16_t want[6] = {1, 2, 3, 0, -2, -1};
+  test_push(fixture.dsp.base.input_buffers[0], x, 6, 0, 10);
+  Batch_t* out = test_pull(&fixture.output);
+  TEST_ASSERT_EQUAL(6, out->head);
+  for (int i = 0; i < 6; i++) {
+    TEST_ASSERT_EQUAL_INT(want[i], ((int16_t*) out->data)[i]);
+  }
+  CHECK_ERR(bb_del_tail(&fixture.output));
+}
+
+void test_fir_interleaved_matches_reference_across_batches(void)
+{
+  enum { N_TAPS = 7, N_CH = 2, N_FRAMES = 3 * BATCH_CAPACITY / 2 };
+  const int32_t taps[N_TAPS] = {-1200, 2500, 9000, 16000,
+                                9000,  2500, -1200};
+  start((FixedDsp_config_t){
+      .name = "fir",
+      .buff_config = {.dtype = DTYPE_I16, .n_channels = N_CH},
+      .kind = FIXED_DSP_FIR,
+      .coeffs = taps,
+      .n_coeffs = N_TAPS,
+      .coeff_frac_bits = 15});
+
+  static int16_t x[N_FRAMES][N_CH];
+  for (int k = 0; k < N_FRAMES; k++) {
+    x[k][0] = (int16_t) (30000.0 * sin(0.3 * k));
+    x[k][1] = (int16_t) ((k * 7919) % 65536 - 32768);
+  }
+
+  /* Split into two batches of 48 frames; history must carry over */
+  size_t half = N_FRAMES / 2;
+  test_push(fixture.dsp.base.input_buffers[0], x, half, 0, 10);
+  test_push(fixture.dsp.base.input_buffers[0], x[half], half,
+            (long long) half * 10, 10);
+
+  for (size_t b = 0; b < 2; b++) {
+    Batch_t* out = test_pull(&fixture.output);
+    TEST_ASSERT_EQUAL(half, out->head);
+    TEST_ASSERT_EQUAL(b * half * 10, out->t_ns);
+    const int16_t* y = (const int16_t*) out->data;
+    for (size_t i = 0; i < half; i++) {
+      size_t k = b * half + i;
+      for (int c = 0; c < N_CH; c++) {
+        int64_t acc = 0;
+        for (int j = 0; j < N_TAPS && j <= (int) k; j++) {
+          acc += (int64_t) taps[j] * x[k - j][c];
+        }
+        TEST_ASSERT_EQUAL_INT(fx_narrow(acc, 15, 16), y[i * N_CH + c]);
+      }
+    }
+    CHECK_ERR(bb_del_tail(&fixture.output));
+  }
+  /* Channel 1 is full scale */
+  TEST_ASSERT_TRUE(fixture.dsp.samples_saturated > 0);
+}
+
+void test_decimating_fir_keeps_phase(void)
+{
+  const int32_t taps[3] = {1 << 14, 1 << 13, 1 << 13};  // Q15
+  start((FixedDsp_config_t){.name = "decim",
+                            .buff_config = {.dtype = DTYPE_I32},
+                            .kind = FIXED_DSP_FIR,
+                            .coeffs = taps,
+                            .n_coeffs = 3,
+                            .coeff_frac_bits = 15,
+                            .decimation = 3});
+
+  int32_t x[40];
+  for (int k = 0; k < 40; k++) x[k] = 1000 * k - 7;
+
+  /* Batches of 10, 2 (no output due) and 28 frames */
+  const size_t sizes[3] = {10, 2, 28};
+  size_t pos = 0;
+  for (int b = 0; b < 3; b++) {
+    test_push(fixture.dsp.base.input_buffers[0], x + pos, sizes[b],
+              (long long) pos * 10, 10);
+    pos += sizes[b];
+  }
+
+  /* Outputs at inputs 0, 3, ..., 39: four from the first batch, ten from
+   * the last (first one at input 12) */
+  size_t k = 0;
+  const size_t n_expected[2] = {4, 10};
+  for (int b = 0; b < 2; b++) {
+    Batch_t* out = test_pull(&fixture.output);
+    TEST_ASSERT_EQUAL(n_expected[b], out->head);
+    TEST_ASSERT_EQUAL(30, out->period_ns);
+    TEST_ASSERT_EQUAL(k * 10, out->t_ns);
+    for (size_t i = 0; i < out->head; i++, k += 3) {
+      int64_t acc = 0;
+      for (size_t j = 0; j < 3 && j <= k; j++) {
+        acc += (int64_t) taps[j] * x[k - j];
+      }
+      TEST_ASSERT_EQUAL_INT(fx_narrow(acc, 15, 32),
+                              ((int32_t*) out->data)[i]);
+    }
+    CHECK_ERR(bb_del_tail(&fixture.output));
+  }
+  TEST_ASSERT_EQUAL(42, k);
+}
+
+void test_biquad_q31_and_mixer(void)
+{
+  /* Second-order lowpass, coefficients in Q2.30 */
+  const double b[3] = {0.0675, 0.1349, 0.0675}, a[2] = {-1.1430, 0.4128};
+  int32_t c[5];
+  for (int i = 0; i < 3; i++) c[i] = fx_from_double(b[i], 30, 32);
+  for (int i = 0; i < 2; i++) c[3 + i] = fx_from_double(a[i], 30, 32);
+  start((FixedDsp_config_t){.name = "lp",
+                            .buff_config = {.dtype = DTYPE_I32},
+                            .kind = FIXED_DSP_BIQUAD,
+                            .coeffs = c,
+                            .n_coeffs = 5,
+                            .coeff_frac_bits = 30});
+
+  int32_t x[BATCH_CAPACITY];
+  for (int k = 0; k < BATCH_CAPACITY; k++) {
+    x[k] = k < 4 ? 0 : (1 << 30);  // Step
+  }
+  test_push(fixture.dsp.base.input_buffers[0], x, BATCH_CAPACITY, 0, 10);
+  const int32_t* y = (const int32_t*) test_pull(&fixture.output)->data;
+
+  int64_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+  for (int k = 0; k < BATCH_CAPACITY; k++) {
+    int64_t acc =
+        c[0] * (int64_t) x[k] + c[1] * x1 + c[2] * x2 - c[3] * y1 - c[4] * y2;
+    x2 = x1;
+    x1 = x[k];
+    y2 = y1;
+    y1 = fx_narrow(acc, 30, 32);
+    TEST_ASSERT_EQUAL_INT((int32_t) y1, y[k]);
+  }
+  /* Unity DC gain: settles close to the step */
+  TEST_ASSERT_INT_WITHIN(1 << 22, 1 << 30, y[BATCH_CAPACITY - 1]);
+  CHECK_ERR(bb_del_tail(&fixture.output));
+  test_filt_stop(&fixture.dsp.base, &fixture.output);
+
+  /* Mixer: a four-entry Q15 LO, phase continuing across batches */
+  memset(&fixture, 0, sizeof(fixture));
+  const int32_t lo[4] = {32767, -32768, 0, 0};
+  start((FixedDsp_config_t){.name = "mix",
+                            .buff_config = {.dtype = DTYPE_I16},
+                            .kind = FIXED_DSP_MIX,
+                            .coeffs = lo,
+                            .n_coeffs = 4,
+                            .coeff_frac_bits = 15});
+  const int16_t in1[3] = {1000, 1000, 1000}, in2[3] = {500, 500, -32768};
+  test_push(fixture.dsp.base.input_buffers[0], in1, 3, 0, 10);
+  test_push(fixture.dsp.base.input_buffers[0], in2, 3, 30, 10);
+  const int16_t want[6] = {1000, -1000, 0, 0, 500, 32767};
+  for (int bidx = 0; bidx < 2; bidx++) {
+    const int16_t* m = (const int16_t*) test_pull(&fixture.output)->data;
+    for (int i = 0; i < 3; i++) {
+      TEST_ASSERT_EQUAL_INT(want[bidx * 3 + i], m[i]);
+    }
+    CHECK_ERR(bb_del_tail(&fixture.output));
+  }
+  /* -32768 * -1.0 does not fit in Q15 */
+  TEST_ASSERT_EQUAL(1, fixture.dsp.samples_saturated);
+}
+
+void test_rejects_invalid_config(void)
+{
+  const int32_t taps[5] = {1 << 30, 1 << 30, 1 << 30, 1 << 30, 1 << 30};
+  FixedDsp_config_t config = {
+      .name = "bad",
+      .buff_config = {.dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO},
+      .kind = FIXED_DSP_FIR,
+      .coeffs = taps,
+      .n_coeffs = 5,
+      .coeff_frac_bits = 30};
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, fixed_dsp_init(&fixture.dsp, config));
+
+  /* Q31 samples against a 5 * 2^30 tap sum could overflow int64 */
+  config.buff_config.dtype = DTYPE_I32;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, fixed_dsp_init(&fixture.dsp, config));
+  config.buff_config.dtype = DTYPE_I16;
+  CHECK_ERR(fixed_dsp_init(&fixture.dsp, config));
+  CHECK_ERR(filt_deinit(&fixture.dsp.base));
+  memset(&fixture, 0, sizeof(fixture));
+
+  config.kind = FIXED_DSP_BIQUAD;
+  config.n_coeffs = 4;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, fixed_dsp_init(&fixture.dsp, config));
+  config.n_coeffs = 5;
+  config.decimation = 2;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, fixed_dsp_init(&fixture.dsp, config));
+  config.decimation = 0;
+  config.coeff_frac_bits = 32;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, fixed_dsp_init(&fixture.dsp, config));
+  config.coeff_frac_bits = 15;
+  config.coeffs = NULL;
+  TEST_ASSERT_EQUAL(Bp_EC_NULL_POINTER, fixed_dsp_init(&fixture.dsp, config));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_fir_q15_rounding_is_exact);
+  RUN_TEST(test_fir_interleaved_matches_reference_across_batches);
+  RUN_TEST(test_decimating_fir_keeps_phase);
+  RUN_TEST(test_biquad_q31_and_mixer);
+  RUN_TEST(test_rejects_invalid_config);
+  return UNITY_END();
+}
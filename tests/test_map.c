@@ -578,6 +578,58 @@ void test_scale_transform(void)
   CHECK_ERR(bb_deinit(&output_buffer));
 }
 
+/* Test: Expression instead of a map function */
+void test_expression_transform(void)
+{
+  Map_filt_t filter;
+  Map_config_t config = {.name = "test_expr",
+                         .buff_config = test_config,
+                         .expr = "clamp(a*x + b, -100, 100)",
+                         .expr_params = {{"a", 2.0f}, {"b", -50.0f}},
+                         .timeout_us = 10000};
+
+  CHECK_ERR(map_init(&filter, config));
+
+  Batch_buff_t output_buffer;
+  CHECK_ERR(bb_init(&output_buffer, "test_output", config.buff_config));
+  CHECK_ERR(filt_sink_connect(&filter.base, 0, &output_buffer));
+  CHECK_ERR(bb_start(&output_buffer));
+  CHECK_ERR(filt_start(&filter.base));
+
+  Batch_t* input_batch = bb_get_head(filter.base.input_buffers[0]);
+  for (int i = 0; i < BATCH_CAPACITY; i++) {
+    *((float*) input_batch->data + i) = (float) i;
+  }
+  input_batch->head = BATCH_CAPACITY;
+  CHECK_ERR(bb_submit(filter.base.input_buffers[0], 10000));
+
+  Bp_EC err;
+  Batch_t* output_batch = bb_get_tail(&output_buffer, 100000, &err);
+  CHECK_ERR(err);
+  for (int i = 0; i < BATCH_CAPACITY; i++) {
+    float expected = MIN(MAX(2.0f * (float) i - 50.0f, -100.0f), 100.0f);
+    TEST_ASSERT_EQUAL_FLOAT(expected, *((float*) output_batch->data + i));
+  }
+
+  CHECK_ERR(bb_del_tail(&output_buffer));
+  CHECK_ERR(filt_stop(&filter.base));
+  CHECK_ERR(bb_stop(&output_buffer));
+  CHECK_ERR(filt_deinit(&filter.base));
+  CHECK_ERR(bb_deinit(&output_buffer));
+
+  // Unknown names, non-float data and giving both a function and an
+  // expression are rejected at init
+  Map_filt_t bad;
+  config.expr = "a*x + c";
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, map_init(&bad, config));
+  config.expr = "x";
+  config.map_fcn = test_scale_map;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, map_init(&bad, config));
+  config.map_fcn = NULL;
+  config.buff_config.dtype = DTYPE_I32;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, map_init(&bad, config));
+}
+
 /* Test: Chained transforms (scale then offset) */
 void test_chained_transforms(void)
 {
@@ -995,6 +1047,83 @@ void test_mismatched_ring_capacity(void)
   CHECK_ERR(bb_deinit(&output));
 }
 
+/* Push a short batch of sequential values into the map's input */
+static void push_short_batch(Map_filt_t* filter, float first, size_t n)
+{
+  Batch_t* batch = bb_get_head(filter->base.input_buffers[0]);
+  for (size_t i = 0; i < n; i++) {
+    ((float*) batch->data)[i] = first + (float) i;
+  }
+  batch->head = n;
+  batch->t_ns = 0;
+  batch->period_ns = 1000;
+  CHECK_ERR(bb_submit(filter->base.input_buffers[0], 10000));
+}
+
+/* Test: Flush policy bounds the latency of partial batches */
+void test_flush_policy(void)
+{
+  Map_filt_t filter;
+  Map_config_t config = {.name = "test_flush",
+                         .buff_config = test_config,
+                         .map_fcn = test_identity_map,
+                         .timeout_us = 1000000};  // Far beyond the deadline
+  CHECK_ERR(map_init(&filter, config));
+
+  Batch_buff_t output_buffer;
+  CHECK_ERR(bb_init(&output_buffer, "test_output", config.buff_config));
+  CHECK_ERR(filt_sink_connect(&filter.base, 0, &output_buffer));
+
+  // Coalesce input batches, but never hold samples for more than 20ms
+  FlushPolicy_t policy = {.max_latency_us = 20000, .coalesce = true};
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_SINK_IDX,
+                    filt_set_flush_policy(&filter.base, 1, policy));
+  CHECK_ERR(filt_set_flush_policy(&filter.base, 0, policy));
+
+  CHECK_ERR(bb_start(&output_buffer));
+  CHECK_ERR(filt_start(&filter.base));
+
+  push_short_batch(&filter, 0.0f, 10);
+  push_short_batch(&filter, 10.0f, 10);
+
+  // Both short batches arrive merged, well before timeout_us
+  long long start = now_ns(CLOCK_MONOTONIC);
+  Bp_EC err;
+  Batch_t* out = bb_get_tail(&output_buffer, 500000, &err);
+  CHECK_ERR(err);
+  TEST_ASSERT_TRUE(now_ns(CLOCK_MONOTONIC) - start < 500000000LL);
+  TEST_ASSERT_EQUAL(20, out->head);
+  TEST_ASSERT_EQUAL_FLOAT(19.0f, ((float*) out->data)[19]);
+  CHECK_ERR(bb_del_tail(&output_buffer));
+  TEST_ASSERT_EQUAL(1, filter.base.metrics.deadline_flushes);
+
+  CHECK_ERR(filt_stop(&filter.base));
+  CHECK_ERR(bb_stop(&output_buffer));
+
+  // Without coalescing every input batch is forwarded as it ends
+  policy.coalesce = false;
+  CHECK_ERR(filt_set_flush_policy(&filter.base, 0, policy));
+  CHECK_ERR(filt_start(&filter.base));
+  CHECK_ERR(bb_start(&output_buffer));
+
+  push_short_batch(&filter, 100.0f, 5);
+  push_short_batch(&filter, 105.0f, 7);
+  out = bb_get_tail(&output_buffer, 500000, &err);
+  CHECK_ERR(err);
+  TEST_ASSERT_EQUAL(5, out->head);
+  CHECK_ERR(bb_del_tail(&output_buffer));
+  out = bb_get_tail(&output_buffer, 500000, &err);
+  CHECK_ERR(err);
+  TEST_ASSERT_EQUAL(7, out->head);
+  TEST_ASSERT_EQUAL_FLOAT(105.0f, ((float*) out->data)[0]);
+  CHECK_ERR(bb_del_tail(&output_buffer));
+
+  CHECK_ERR(filt_stop(&filter.base));
+  CHECK_ERR(bb_stop(&output_buffer));
+  CHECK_ERR(filt_deinit(&filter.base));
+  CHECK_ERR(bb_deinit(&output_buffer));
+}
+
 /* Main test runner */
 int main(void)
 {
@@ -1008,8 +1137,10 @@ int main(void)
   // Functional tests
   RUN_TEST(test_single_threaded_linear_ramp);
   RUN_TEST(test_scale_transform);
+  RUN_TEST(test_expression_transform);
   RUN_TEST(test_chained_transforms);
   RUN_TEST(test_buffer_wraparound);
+  RUN_TEST(test_flush_policy);
 
   // Multi-threaded tests
   RUN_TEST(test_multi_stage_single_threaded);
@@ -0,0 +1,108 @@
+#include <math.h>
+#include <string.h>
+#include "map_expr.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define N 300  // Not a multiple of MAP_EXPR_CHUNK
+
+static MapExpr_t prog;
+static float in[N], out[N];
+
+void setUp(void)
+{
+  memset(&prog, 0, sizeof(prog));
+  for (size_t i = 0; i < N; i++) in[i] = -3.0f + 0.02f * (float) i;
+}
+
+void tearDown(void) {}
+
+static void compile(const char* text, const MapExprParam_t* params,
+                    size_t n_params)
+{
+  size_t pos = 0;
+  Bp_EC err = map_expr_compile(&prog, text, params, n_params, &pos);
+  TEST_ASSERT_EQUAL_MESSAGE(Bp_EC_OK, err, text);
+}
+
+void test_affine_clamp_matches_reference(void)
+{
+  const MapExprParam_t params[] = {{"a", 0.75f}, {"b", 0.25f}};
+  compile("clamp(a*x + b, -1, 1)", params, 2);
+
+  /* a*x + b fuses into one instruction, then the clamp */
+  TEST_ASSERT_EQUAL(2, prog.n_insns);
+
+  map_expr_eval(&prog, in, out, N);
+  for (size_t i = 0; i < N; i++) {
+    float v = 0.75f * in[i] + 0.25f;
+    v = v < -1.0f ? -1.0f : (v > 1.0f ? 1.0f : v);
+    TEST_ASSERT_EQUAL_FLOAT(v, out[i]);
+  }
+}
+
+void test_functions_and_precedence(void)
+{
+  compile("sqrt(x*x + 1) - 2^-x / 4 + max(abs(x), 0.5)", NULL, 0);
+  map_expr_eval(&prog, in, out, N);
+  for (size_t i = 0; i < N; i++) {
+    float x = in[i];
+    float want = sqrtf(x * x + 1.0f) - powf(2.0f, -x) / 4.0f +
+                 fmaxf(fabsf(x), 0.5f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, want, out[i]);
+  }
+}
+
+void test_constant_folding(void)
+{
+  const MapExprParam_t params[] = {{"gain", 3.0f}, {NULL, 0.0f}};
+  compile("x * (gain * 2 - 5) + sin(0) + 0", params, 4);
+  /* Folds to x * 1 -> x: a single copy */
+  TEST_ASSERT_EQUAL(1, prog.n_insns);
+  map_expr_eval(&prog, in, out, N);
+  for (size_t i = 0; i < N; i++) TEST_ASSERT_EQUAL_FLOAT(in[i], out[i]);
+
+  compile("cos(pi) * 4", NULL, 0);
+  map_expr_eval(&prog, in, out, N);
+  TEST_ASSERT_EQUAL_FLOAT(-4.0f, out[N - 1]);
+}
+
+void test_in_place_evaluation(void)
+{
+  compile("x^2 - x", NULL, 0);
+  float data[N];
+  memcpy(data, in, sizeof(data));
+  map_expr_eval(&prog, data, data, N);
+  for (size_t i = 0; i < N; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(in[i] * in[i] - in[i], data[i]);
+  }
+}
+
+void test_rejects_bad_expressions(void)
+{
+  const char* bad[] = {"",          "x +",        "foo(x)",    "y * 2",
+                       "clamp(x,1)", "(x",        "x x",       "min(x,,1)",
+                       "3 $ x"};
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    TEST_ASSERT_EQUAL_MESSAGE(Bp_EC_INVALID_CONFIG,
+                              map_expr_compile(&prog, bad[i], NULL, 0, NULL),
+                              bad[i]);
+  }
+
+  size_t pos = 0;
+  map_expr_compile(&prog, "x + 2 * q", NULL, 0, &pos);
+  TEST_ASSERT_EQUAL(8, pos);
+  TEST_ASSERT_EQUAL(Bp_EC_NULL_POINTER,
+                    map_expr_compile(&prog, NULL, NULL, 0, NULL));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_affine_clamp_matches_reference);
+  RUN_TEST(test_functions_and_precedence);
+  RUN_TEST(test_constant_folding);
+  RUN_TEST(test_in_place_evaluation);
+  RUN_TEST(test_rejects_bad_expressions);
+  return UNITY_END();
+}
@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../bpipe/moving_median.h"
+#include "core.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define BATCH_CAPACITY_EXPO 7
+#define RING_CAPACITY_EXPO 4
+#define BATCH_CAPACITY (1 << BATCH_CAPACITY_EXPO)
+#define N_SAMPLES 700
+
+typedef struct {
+  MovingMedian_t mm;
+  Batch_buff_t output;
+} TestFixture;
+
+static TestFixture fixture;
+static float signal[N_SAMPLES][2];
+
+static void start(size_t window, size_t n_channels)
+{
+  MovingMedian_config_t config = {
+      .name = "median",
+      .buff_config = {.dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO,
+                      .n_channels = n_channels},
+      .window = window,
+      .timeout_us = 100000};
+  CHECK_ERR(moving_median_init(&fixture.mm, config));
+
+  BatchBuffer_config out_config = config.buff_config;
+  out_config.overflow_behaviour = OVERFLOW_BLOCK;
+  test_filt_start(&fixture.mm.base, &fixture.output, out_config);
+}
+
+static int cmp_float(const void* a, const void* b)
+{
+  float x = *(const float*) a, y = *(const float*) b;
+  return (x > y) - (x < y);
+}
+
+/* Median of inputs k - w + 1 .. k, with the first sample repeated before
+ * the start */
+static float reference(size_t k, size_t ch, size_t w)
+{
+  float win[1001];
+  for (size_t j = 0; j < w; j++) {
+    long i = (long) k - (long) j;
+    win[j] = signal[i < 0 ? 0 : i][ch];
+  }
+  qsort(win, w, sizeof(float), cmp_float);
+  return win[w / 2];
+}
+
+/* Push the signal in uneven batches and check every output */
+static void run_and_check(size_t window, size_t n_channels)
+{
+  start(window, n_channels);
+  const size_t sizes[] = {1, 17, BATCH_CAPACITY, 63, 2, BATCH_CAPACITY, 99};
+  size_t pos = 0, out_pos = 0;
+  for (size_t b = 0; pos < N_SAMPLES; b++) {
+    size_t n = MIN(sizes[b % 7], (size_t) (N_SAMPLES - pos));
+    float frames[BATCH_CAPACITY * 2];
+    for (size_t k = 0; k < n; k++) {
+      for (size_t c = 0; c < n_channels; c++) {
+        frames[k * n_channels + c] = signal[pos + k][c];
+      }
+    }
+    test_push(fixture.mm.base.input_buffers[0], frames, n,
+              (long long) pos * 100, 100);
+    pos += n;
+
+    Batch_t* out = test_pull(&fixture.output);
+    const float* y = (const float*) out->data;
+    for (size_t k = 0; k < n; k++, out_pos++) {
+      for (size_t c = 0; c < n_channels; c++) {
+        TEST_ASSERT_EQUAL_FLOAT(reference(out_pos, c, window),
+                                y[k * n_channels + c]);
+      }
+    }
+    CHECK_ERR(bb_del_tail(&fixture.output));
+  }
+}
+
+void setUp(void)
+{
+  memset(&fixture, 0, sizeof(fixture));
+  srand(1234);
+  for (size_t k = 0; k < N_SAMPLES; k++) {
+    signal[k][0] = (float) (rand() % 2000) / 10.0f;
+    /* Slow ramp with repeated values and occasional spikes */
+    signal[k][1] = (float) (k / 8) + (k % 37 == 0 ? 1000.0f : 0.0f);
+  }
+}
+
+void tearDown(void)
+{
+  if (fixture.mm.base.worker != NULL) {
+    test_filt_stop(&fixture.mm.base, &fixture.output);
+  }
+}
+
+void test_heap_window_31(void) { run_and_check(31, 2); }
+
+void test_heap_window_1001_exceeds_batch(void) { run_and_check(1001, 1); }
+
+void test_network_window_3(void) { run_and_check(3, 2); }
+
+void test_network_window_9(void) { run_and_check(9, 2); }
+
+void test_removes_spikes(void)
+{
+  start(11, 1);
+  float x[64];
+  for (int k = 0; k < 64; k++) x[k] = k % 10 == 5 ? 1e6f : 2.5f;
+  test_push(fixture.mm.base.input_buffers[0], x, 64, 0, 1);
+
+  Batch_t* out = test_pull(&fixture.output);
+  for (int k = 0; k < 64; k++) {
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, ((float*) out->data)[k]);
+  }
+  CHECK_ERR(bb_del_tail(&fixture.output));
+
+  char text[256];
+  CHECK_ERR(filt_describe(&fixture.mm.base, text, sizeof(text)));
+  TEST_ASSERT_NOT_NULL(strstr(text, "two heaps"));
+}
+
+void test_rejects_invalid_config(void)
+{
+  MovingMedian_config_t config = {
+      .name = "median",
+      .buff_config = {.dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO},
+      .window = 4};
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    moving_median_init(&fixture.mm, config));
+  config.window = 1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    moving_median_init(&fixture.mm, config));
+  config.window = MOVING_MEDIAN_MAX_WINDOW + 2;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    moving_median_init(&fixture.mm, config));
+  config.window = 5;
+  config.buff_config.dtype = DTYPE_I32;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    moving_median_init(&fixture.mm, config));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_heap_window_31);
+  RUN_TEST(test_heap_window_1001_exceeds_batch);
+  RUN_TEST(test_network_window_3);
+  RUN_TEST(test_network_window_9);
+  RUN_TEST(test_removes_spikes);
+  RUN_TEST(test_rejects_invalid_config);
+  return UNITY_END();
+}
@@ -686,6 +686,185 @@ void test_pipeline_external_output_connection(void)
   filt_deinit(&offset.base);
 }
 
+/**
+ * Test data flow with member rings relocated into the pipeline arena
+ *
+ * This test verifies:
+ * - pipeline_init moves every member input ring into one arena mapping
+ * - Data still flows and is transformed correctly out of arena storage
+ * - The memory report accounts for every ring as arena-backed
+ *
+ * Pipeline: SignalGenerator -> Pipeline[Map1 -> Map2] -> TestSink
+ */
+void test_pipeline_arena_data_flow(void)
+{
+  SignalGenerator_t sig_gen;
+  SignalGenerator_config_t sig_config = {
+      .name = "test_signal",
+      .buff_config = default_buffer_config(),
+      .frequency_hz = 10.0,
+      .amplitude = 1.0,
+      .sample_period_ns = 10000000,
+      .timeout_us = 1000000,
+      .max_samples = 100,
+      .waveform_type = WAVEFORM_SINE};
+  CHECK_ERR(signal_generator_init(&sig_gen, sig_config));
+
+  Map_filt_t scaler, offset;
+  Map_config_t scaler_config = {.name = "scaler",
+                                .buff_config = default_buffer_config(),
+                                .map_fcn = scale_by_2,
+                                .timeout_us = 1000000};
+  Map_config_t offset_config = {.name = "offset",
+                                .buff_config = default_buffer_config(),
+                                .map_fcn = offset_by_10,
+                                .timeout_us = 1000000};
+  CHECK_ERR(map_init(&scaler, scaler_config));
+  CHECK_ERR(map_init(&offset, offset_config));
+
+  TestSink_t sink;
+  CHECK_ERR(test_sink_init(&sink, "test_sink", 200));
+  CHECK_ERR(filt_sink_connect(&offset.base, 0, sink.base.input_buffers[0]));
+
+  Filter_t* filters[] = {&scaler.base, &offset.base};
+  Connection_t connections[] = {{&scaler.base, 0, &offset.base, 0}};
+
+  Pipeline_config_t pipeline_config = {.name = "arena_pipeline",
+                                       .buff_config = default_buffer_config(),
+                                       .timeout_us = 1000000,
+                                       .filters = filters,
+                                       .n_filters = 2,
+                                       .connections = connections,
+                                       .n_connections = 1,
+                                       .input_filter = &scaler.base,
+                                       .output_filter = &offset.base,
+                                       .use_arena = true,
+                                       .arena_huge_pages = true};
+
+  Pipeline_t pipeline;
+  CHECK_ERR(pipeline_init(&pipeline, pipeline_config));
+
+  /* Both member rings now live in the arena, the external sink does not */
+  TEST_ASSERT_NOT_NULL(pipeline.arena.base);
+  TEST_ASSERT_TRUE(arena_contains(&pipeline.arena,
+                                  scaler.base.input_buffers[0]->batch_ring));
+  TEST_ASSERT_TRUE(arena_contains(&pipeline.arena,
+                                  offset.base.input_buffers[0]->data_ring));
+  TEST_ASSERT_FALSE(scaler.base.input_buffers[0]->owns_storage);
+  TEST_ASSERT_TRUE(sink.base.input_buffers[0]->owns_storage);
+  TEST_ASSERT_EQUAL_PTR(scaler.base.input_buffers[0],
+                        pipeline.base.input_buffers[0]);
+
+  char report[1024];
+  CHECK_ERR(pipeline_memory_report(&pipeline, report, sizeof(report)));
+  TEST_ASSERT_NOT_NULL(strstr(report, "scaler.input[0]"));
+  TEST_ASSERT_NOT_NULL(strstr(report, "total: 2 rings"));
+  TEST_ASSERT_NULL(strstr(report, "(heap)"));
+
+  CHECK_ERR(
+      filt_sink_connect(&sig_gen.base, 0, pipeline.base.input_buffers[0]));
+
+  CHECK_ERR(filt_start(&pipeline.base));
+  CHECK_ERR(filt_start(&sink.base));
+  CHECK_ERR(filt_start(&sig_gen.base));
+
+  while (atomic_load(&sig_gen.base.running)) {
+    usleep(10000);
+  }
+  usleep(50000);
+
+  filt_stop(&sig_gen.base);
+  filt_stop(&pipeline.base);
+  filt_stop(&sink.base);
+
+  pthread_mutex_lock(&sink.mutex);
+  TEST_ASSERT_GREATER_THAN(50, sink.count);
+  for (int i = 0; i < 50; i++) {
+    float t = i * 0.01f;
+    float expected = sinf(2 * M_PI * 10.0f * t) * 2.0f + 10.0f;
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, expected, sink.buffer[i]);
+  }
+  pthread_mutex_unlock(&sink.mutex);
+
+  /* Pipeline teardown releases the arena; members skip storage they lost */
+  test_sink_deinit(&sink);
+  filt_deinit(&sig_gen.base);
+  filt_deinit(&pipeline.base);
+  TEST_ASSERT_NULL(pipeline.arena.base);
+  filt_deinit(&scaler.base);
+  filt_deinit(&offset.base);
+}
+
+/*
+ * Test that a failed arena build leaves every member ring on the heap
+ *
+ * The offset filter's input ring has joined a share group (bb_swap_data), so
+ * it cannot move into the arena after the scaler's ring already has.
+ * pipeline_init must move the scaler's ring back before unmapping the arena.
+ */
+void test_pipeline_arena_failure_restores_rings(void)
+{
+  Map_filt_t scaler, offset;
+  Map_config_t scaler_config = {.name = "scaler",
+                                .buff_config = default_buffer_config(),
+                                .map_fcn = scale_by_2,
+                                .timeout_us = 1000000};
+  Map_config_t offset_config = {.name = "offset",
+                                .buff_config = default_buffer_config(),
+                                .map_fcn = offset_by_10,
+                                .timeout_us = 1000000};
+  CHECK_ERR(map_init(&scaler, scaler_config));
+  CHECK_ERR(map_init(&offset, offset_config));
+
+  Batch_buff_t side;
+  CHECK_ERR(bb_init(&side, "side", default_buffer_config()));
+  CHECK_ERR(bb_start(&side));
+  Batch_t* batch = bb_get_head(&side);
+  batch->head = 1;
+  CHECK_ERR(bb_submit(&side, 0));
+  Bp_EC err;
+  batch = bb_get_tail(&side, 0, &err);
+  CHECK_ERR(err);
+  Batch_buff_t* shared = offset.base.input_buffers[0];
+  CHECK_ERR(bb_swap_data(&side, batch, shared, bb_get_head(shared)));
+  CHECK_ERR(bb_del_tail(&side));
+
+  Filter_t* filters[] = {&scaler.base, &offset.base};
+  Connection_t connections[] = {{&scaler.base, 0, &offset.base, 0}};
+  Pipeline_config_t pipeline_config = {.name = "arena_pipeline",
+                                       .buff_config = default_buffer_config(),
+                                       .timeout_us = 1000000,
+                                       .filters = filters,
+                                       .n_filters = 2,
+                                       .connections = connections,
+                                       .n_connections = 1,
+                                       .input_filter = &scaler.base,
+                                       .output_filter = &offset.base,
+                                       .use_arena = true};
+  Pipeline_t pipeline;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    pipeline_init(&pipeline, pipeline_config));
+  TEST_ASSERT_NULL(pipeline.arena.base);
+
+  /* The scaler's ring is back on the heap and still carries data */
+  Batch_buff_t* in = scaler.base.input_buffers[0];
+  TEST_ASSERT_TRUE(in->owns_storage);
+  CHECK_ERR(bb_start(in));
+  batch = bb_get_head(in);
+  ((float*) batch->data)[0] = 42.0f;
+  batch->head = 1;
+  CHECK_ERR(bb_submit(in, 0));
+  batch = bb_get_tail(in, 0, &err);
+  CHECK_ERR(err);
+  TEST_ASSERT_EQUAL_FLOAT(42.0f, ((float*) batch->data)[0]);
+  CHECK_ERR(bb_del_tail(in));
+
+  bb_stop(&side);
+  filt_deinit(&scaler.base);
+  filt_deinit(&offset.base);
+  bb_deinit(&side);
+}
+
 /* Unity test runner */
 int main(void)
 {
@@ -694,5 +873,7 @@ int main(void)
   RUN_TEST(test_pipeline_dag_data_flow);
   RUN_TEST(test_pipeline_nested);
   RUN_TEST(test_pipeline_external_output_connection);
+  RUN_TEST(test_pipeline_arena_data_flow);
+  RUN_TEST(test_pipeline_arena_failure_restores_rings);
   return UNITY_END();
 }
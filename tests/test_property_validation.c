@@ -867,7 +867,7 @@ void test_multi_output_tee_properties(void)
   TEST_ASSERT_EQUAL(2, tee.base.max_supported_sinks);
 
   // Verify the multi-output infrastructure exists
-  // The tee filter has MAX_OUTPUTS output property tables
+  // The tee filter has one output property table per sink
   TEST_ASSERT_TRUE(tee.base.n_outputs >= 1);
 
   // Each output should have its own property table
@@ -0,0 +1,205 @@
+#include <stdlib.h>
+#include <string.h>
+#include "../bpipe/reorder.h"
+#include "core.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define BATCH_CAPACITY_EXPO 3
+#define RING_CAPACITY_EXPO 4
+#define BATCH_CAPACITY (1 << BATCH_CAPACITY_EXPO)
+#define PERIOD_NS 1000
+#define MAX_OUT 256
+
+typedef struct {
+  Reorder_t ro;
+  Batch_buff_t output;
+  /* Everything read from the output up to end of stream */
+  int32_t values[MAX_OUT];
+  long long times[MAX_OUT];
+  size_t n_out;
+  size_t n_regular; /* Output batches with regular timing */
+} TestFixture;
+
+static TestFixture fixture;
+
+static void start(size_t max_held, long long max_delay_ns, bool timestamps)
+{
+  Reorder_config_t config = {
+      .name = "reorder",
+      .buff_config = {.dtype = DTYPE_I32,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO,
+                      .sample_timestamps = timestamps},
+      .max_held = max_held,
+      .max_delay_ns = max_delay_ns,
+      .timeout_us = 10000};
+  CHECK_ERR(reorder_init(&fixture.ro, config));
+  test_filt_start(&fixture.ro.base, &fixture.output,
+                  (BatchBuffer_config){
+                      .dtype = DTYPE_I32,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO + 1,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO + 1,
+                      .sample_timestamps = timestamps});
+}
+
+/* A regular batch of n samples from sample index `first`, spaced `step`
+ * periods apart; each value is its sample index */
+static void push(size_t first, size_t n, size_t step)
+{
+  int32_t d[BATCH_CAPACITY];
+  for (size_t k = 0; k < n; k++) d[k] = (int32_t) (first + k * step);
+  test_push(fixture.ro.base.input_buffers[0], d, n,
+            (long long) first * PERIOD_NS, (unsigned) (step * PERIOD_NS));
+}
+
+static void push_complete(void)
+{
+  Batch_t* in = bb_get_head(fixture.ro.base.input_buffers[0]);
+  in->head = 0;
+  in->ec = Bp_EC_COMPLETE;
+  CHECK_ERR(bb_submit(fixture.ro.base.input_buffers[0], 100000));
+}
+
+/* Read one output batch into the fixture; false at end of stream */
+static bool read_batch(void)
+{
+  Batch_t* out = test_pull(&fixture.output);
+  if (out->ec == Bp_EC_COMPLETE) {
+    CHECK_ERR(bb_del_tail(&fixture.output));
+    return false;
+  }
+  TEST_ASSERT_EQUAL(Bp_EC_OK, out->ec);
+  TEST_ASSERT_TRUE(fixture.n_out + out->head <= MAX_OUT);
+  if (!bb_batch_has_ts(out)) fixture.n_regular++;
+  for (size_t k = 0; k < out->head; k++) {
+    fixture.values[fixture.n_out] = ((int32_t*) out->data)[k];
+    fixture.times[fixture.n_out++] = bb_sample_t_ns(out, k);
+  }
+  CHECK_ERR(bb_del_tail(&fixture.output));
+  return true;
+}
+
+static void read_all(void)
+{
+  while (read_batch()) {
+  }
+}
+
+/* Output is samples 0..n-1, in order, each at its own time */
+static void expect_sequence(size_t n)
+{
+  TEST_ASSERT_EQUAL(n, fixture.n_out);
+  for (size_t i = 0; i < n; i++) {
+    TEST_ASSERT_EQUAL((int) i, fixture.values[i]);
+    TEST_ASSERT_EQUAL((long long) i * PERIOD_NS, fixture.times[i]);
+  }
+}
+
+void setUp(void) { memset(&fixture, 0, sizeof(fixture)); }
+
+void tearDown(void)
+{
+  if (fixture.ro.base.worker != NULL) {
+    test_filt_stop(&fixture.ro.base, &fixture.output);
+  }
+}
+
+void test_count_bound_reorders_batches(void)
+{
+  start(3, 0, false);
+  const size_t order[] = {0, 2, 1, 3, 5, 4, 7, 6};
+  for (size_t i = 0; i < 8; i++) {
+    push(order[i] * BATCH_CAPACITY, BATCH_CAPACITY, 1);
+  }
+  push_complete();
+  read_all();
+
+  expect_sequence(8 * BATCH_CAPACITY);
+  TEST_ASSERT_EQUAL(3, fixture.ro.batches_reordered);
+  TEST_ASSERT_EQUAL(0, fixture.ro.late_samples);
+}
+
+void test_time_bound_releases_before_end(void)
+{
+  /* Hold two batches' worth of time */
+  start(16, 2 * BATCH_CAPACITY * PERIOD_NS, false);
+  push(1 * BATCH_CAPACITY, BATCH_CAPACITY, 1);
+  push(0 * BATCH_CAPACITY, BATCH_CAPACITY, 1);
+  push(3 * BATCH_CAPACITY, BATCH_CAPACITY, 1);
+  push(2 * BATCH_CAPACITY, BATCH_CAPACITY, 1);
+
+  /* Newest is sample 31, so samples up to 15 are out already */
+  while (fixture.n_out < 2 * BATCH_CAPACITY) TEST_ASSERT_TRUE(read_batch());
+  expect_sequence(2 * BATCH_CAPACITY);
+
+  push_complete();
+  read_all();
+  expect_sequence(4 * BATCH_CAPACITY);
+}
+
+void test_late_data_dropped(void)
+{
+  start(2, 0, false);
+  push(1 * BATCH_CAPACITY, BATCH_CAPACITY, 1);
+  push(3 * BATCH_CAPACITY, BATCH_CAPACITY, 1);
+  /* Pushes batch 1 out, then is late */
+  push(0 * BATCH_CAPACITY, BATCH_CAPACITY, 1);
+  /* First 3 samples are late */
+  push(2 * BATCH_CAPACITY - 4, BATCH_CAPACITY, 1);
+  push_complete();
+  read_all();
+
+  /* Batches 1 and 3, and the batch at 2 minus its late samples */
+  TEST_ASSERT_EQUAL(3 * BATCH_CAPACITY - 3, fixture.n_out);
+  for (size_t i = 1; i < fixture.n_out; i++) {
+    TEST_ASSERT_TRUE(fixture.times[i] >= fixture.times[i - 1]);
+    TEST_ASSERT_EQUAL(fixture.times[i] / PERIOD_NS, fixture.values[i]);
+  }
+  TEST_ASSERT_EQUAL(BATCH_CAPACITY, fixture.values[0]);
+  TEST_ASSERT_EQUAL(1, fixture.ro.late_batches);
+  TEST_ASSERT_EQUAL(BATCH_CAPACITY + 3, fixture.ro.late_samples);
+}
+
+void test_overlapping_batches_merged(void)
+{
+  /* Two sources on interleaved grids: even and odd samples */
+  start(4, 0, true);
+  push(0, BATCH_CAPACITY, 2);
+  push(1, BATCH_CAPACITY, 2);
+  push(2 * BATCH_CAPACITY, BATCH_CAPACITY, 2);
+  push(2 * BATCH_CAPACITY + 1, BATCH_CAPACITY, 2);
+  push_complete();
+  read_all();
+
+  expect_sequence(4 * BATCH_CAPACITY);
+  TEST_ASSERT_EQUAL(0, fixture.n_regular);
+  TEST_ASSERT_EQUAL(0, fixture.ro.late_samples);
+}
+
+void test_rejects_invalid_config(void)
+{
+  Reorder_config_t config = {
+      .name = "reorder",
+      .buff_config = {.dtype = DTYPE_I32,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO},
+      .max_held = 0};
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, reorder_init(&fixture.ro, config));
+  config.max_held = REORDER_MAX_HELD + 1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, reorder_init(&fixture.ro, config));
+  config.max_held = 4;
+  config.max_delay_ns = -1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, reorder_init(&fixture.ro, config));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_count_bound_reorders_batches);
+  RUN_TEST(test_time_bound_releases_before_end);
+  RUN_TEST(test_late_data_dropped);
+  RUN_TEST(test_overlapping_batches_merged);
+  RUN_TEST(test_rejects_invalid_config);
+  return UNITY_END();
+}
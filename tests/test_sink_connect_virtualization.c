@@ -69,6 +69,42 @@ void test_default_sink_connect_unchanged(void)
   filt_deinit(&filter);
 }
 
+// Timestamped input frames only go to sinks that can hold the timestamps
+void test_default_sink_connect_requires_timestamps(void)
+{
+  Filter_t filter;
+  BatchBuffer_config ts_config = {.dtype = DTYPE_FLOAT,
+                                  .batch_capacity_expo = 6,
+                                  .ring_capacity_expo = 4,
+                                  .overflow_behaviour = OVERFLOW_BLOCK,
+                                  .sample_timestamps = true};
+  Core_filt_config_t config = {.name = "ts_filter",
+                               .filt_type = FILT_T_MAP,
+                               .size = sizeof(Filter_t),
+                               .n_inputs = 1,
+                               .max_supported_sinks = 1,
+                               .buff_config = ts_config,
+                               .timeout_us = 1000,
+                               .worker = test_worker};
+  CHECK_ERR(filt_init(&filter, config));
+
+  Batch_buff_t plain_sink, ts_sink;
+  BatchBuffer_config plain_config = ts_config;
+  plain_config.sample_timestamps = false;
+  CHECK_ERR(bb_init(&plain_sink, "plain", plain_config));
+  CHECK_ERR(bb_init(&ts_sink, "ts", ts_config));
+
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    filt_sink_connect(&filter, 0, &plain_sink));
+  TEST_ASSERT_EQUAL(0, filter.n_sinks);
+  CHECK_ERR(filt_sink_connect(&filter, 0, &ts_sink));
+  TEST_ASSERT_EQUAL_PTR(&ts_sink, filter.sinks[0]);
+
+  bb_deinit(&plain_sink);
+  bb_deinit(&ts_sink);
+  filt_deinit(&filter);
+}
+
 // Test custom sink_connect implementation
 typedef struct {
   Filter_t base;
@@ -268,6 +304,7 @@ int main(void)
 {
   UNITY_BEGIN();
   RUN_TEST(test_default_sink_connect_unchanged);
+  RUN_TEST(test_default_sink_connect_requires_timestamps);
   RUN_TEST(test_custom_sink_connect_override);
   RUN_TEST(test_sink_connect_error_handling);
   RUN_TEST(test_pipeline_connection_forwarding);
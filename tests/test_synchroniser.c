@@ -0,0 +1,286 @@
+#include <string.h>
+#include <time.h>
+#include "../bpipe/synchroniser.h"
+#include "core.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define PERIOD_NS 1000
+#define IN_EXPO 4  /* 16-sample input batches */
+#define OUT_EXPO 5 /* 32-sample output batches */
+
+static Synchroniser_t sync_filt;
+static Batch_buff_t outputs[2];
+
+static const BatchBuffer_config in_config = {.dtype = DTYPE_FLOAT,
+                                             .batch_capacity_expo = IN_EXPO,
+                                             .ring_capacity_expo = 4,
+                                             .overflow_behaviour =
+                                                 OVERFLOW_BLOCK};
+
+static const BatchBuffer_config out_config = {.dtype = DTYPE_FLOAT,
+                                              .batch_capacity_expo = OUT_EXPO,
+                                              .ring_capacity_expo = 4,
+                                              .overflow_behaviour =
+                                                  OVERFLOW_BLOCK};
+
+/* Sample values equal their grid index so alignment is checkable */
+static void push_span(Batch_buff_t* buff, long long first_idx, size_t n)
+{
+  Batch_t* batch = bb_get_head(buff);
+  float* data = (float*) batch->data;
+  for (size_t i = 0; i < n; i++) data[i] = (float) (first_idx + (long long) i);
+  batch->t_ns = first_idx * PERIOD_NS;
+  batch->period_ns = PERIOD_NS;
+  batch->head = n;
+  batch->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(buff, 100000));
+}
+
+static void push_complete(Batch_buff_t* buff)
+{
+  Batch_t* batch = bb_get_head(buff);
+  batch->head = 0;
+  batch->ec = Bp_EC_COMPLETE;
+  CHECK_ERR(bb_submit(buff, 100000));
+}
+
+static long long elapsed_ms(const struct timespec* t0)
+{
+  struct timespec t1;
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  return (t1.tv_sec - t0->tv_sec) * 1000LL +
+         (t1.tv_nsec - t0->tv_nsec) / 1000000LL;
+}
+
+static void start_sync_timeout(long long timeout_us)
+{
+  Synchroniser_config_t config = {.name = "sync",
+                                  .buff_config = in_config,
+                                  .n_inputs = 2,
+                                  .timeout_us = timeout_us};
+  CHECK_ERR(synchroniser_init(&sync_filt, config));
+  for (int i = 0; i < 2; i++) {
+    CHECK_ERR(bb_init(&outputs[i], "sync_out", out_config));
+    CHECK_ERR(filt_sink_connect(&sync_filt.base, i, &outputs[i]));
+    CHECK_ERR(bb_start(&outputs[i]));
+    CHECK_ERR(bb_start(sync_filt.base.input_buffers[i]));
+  }
+  CHECK_ERR(filt_start(&sync_filt.base));
+}
+
+static void start_sync(void) { start_sync_timeout(100000); }
+
+/* Drain both outputs in lock-step, checking that every batch pair shares
+ * t_ns and length and that values follow the grid. Returns total samples
+ * per port; *first_idx receives the first grid index seen. */
+static size_t drain_outputs(long long* first_idx, size_t* n_batches)
+{
+  size_t total = 0;
+  *n_batches = 0;
+  for (;;) {
+    Bp_EC err;
+    Batch_t* a = bb_get_tail(&outputs[0], 1000000, &err);
+    CHECK_ERR(err);
+    Batch_t* b = bb_get_tail(&outputs[1], 1000000, &err);
+    CHECK_ERR(err);
+
+    TEST_ASSERT_EQUAL(a->ec, b->ec);
+    if (a->ec == Bp_EC_COMPLETE) {
+      bb_del_tail(&outputs[0]);
+      bb_del_tail(&outputs[1]);
+      return total;
+    }
+
+    TEST_ASSERT_EQUAL_INT64(a->t_ns, b->t_ns);
+    TEST_ASSERT_EQUAL(a->head, b->head);
+    TEST_ASSERT_EQUAL(PERIOD_NS, a->period_ns);
+    TEST_ASSERT_EQUAL(0, a->t_ns % PERIOD_NS);
+    if (total == 0) *first_idx = a->t_ns / PERIOD_NS;
+
+    const float* da = (const float*) a->data;
+    const float* db = (const float*) b->data;
+    long long idx = a->t_ns / PERIOD_NS;
+    for (size_t i = 0; i < a->head; i++) {
+      TEST_ASSERT_EQUAL_FLOAT((float) (idx + (long long) i), da[i]);
+      TEST_ASSERT_EQUAL_FLOAT((float) (idx + (long long) i), db[i]);
+    }
+    total += a->head;
+    (*n_batches)++;
+    bb_del_tail(&outputs[0]);
+    bb_del_tail(&outputs[1]);
+  }
+}
+
+void setUp(void) { memset(&sync_filt, 0, sizeof(sync_filt)); }
+
+void tearDown(void)
+{
+  if (sync_filt.base.worker != NULL) {
+    CHECK_ERR(filt_stop(&sync_filt.base));
+    CHECK_ERR(filt_deinit(&sync_filt.base));
+    for (int i = 0; i < 2; i++) {
+      bb_stop(&outputs[i]);
+      bb_deinit(&outputs[i]);
+    }
+  }
+}
+
+void test_trims_leading_samples_and_rechunks(void)
+{
+  start_sync();
+
+  /* Input 0 covers [0, 64), input 1 covers [5, 69) */
+  for (int b = 0; b < 4; b++) {
+    push_span(sync_filt.base.input_buffers[0], b * 16, 16);
+    push_span(sync_filt.base.input_buffers[1], 5 + b * 16, 16);
+  }
+  push_complete(sync_filt.base.input_buffers[0]);
+  push_complete(sync_filt.base.input_buffers[1]);
+
+  long long first_idx = -1;
+  size_t n_batches;
+  size_t total = drain_outputs(&first_idx, &n_batches);
+
+  TEST_ASSERT_EQUAL(5, first_idx);
+  TEST_ASSERT_EQUAL(59, total); /* Overlap is [5, 64) */
+  TEST_ASSERT_EQUAL(2, n_batches);
+  TEST_ASSERT_EQUAL(5, sync_filt.samples_trimmed);
+}
+
+void test_gap_realigns_all_ports(void)
+{
+  start_sync();
+
+  /* Input 0 drops [32, 40); input 1 is continuous over [0, 80) */
+  push_span(sync_filt.base.input_buffers[0], 0, 16);
+  push_span(sync_filt.base.input_buffers[0], 16, 16);
+  push_span(sync_filt.base.input_buffers[0], 40, 16);
+  push_span(sync_filt.base.input_buffers[0], 56, 16);
+  for (int b = 0; b < 5; b++) {
+    push_span(sync_filt.base.input_buffers[1], b * 16, 16);
+  }
+  push_complete(sync_filt.base.input_buffers[0]);
+  push_complete(sync_filt.base.input_buffers[1]);
+
+  long long first_idx = -1;
+  size_t n_batches;
+  size_t total = drain_outputs(&first_idx, &n_batches);
+
+  /* [0, 32) then [40, 72): no output batch straddles the gap */
+  TEST_ASSERT_EQUAL(0, first_idx);
+  TEST_ASSERT_EQUAL(64, total);
+  TEST_ASSERT_EQUAL(2, n_batches);
+  TEST_ASSERT_EQUAL(8, sync_filt.samples_trimmed);
+  TEST_ASSERT_EQUAL(1, sync_filt.realignments);
+}
+
+void test_metrics_count_partial_batches(void)
+{
+  start_sync();
+
+  /* Input 0 drops [16, 24): the batch cut short by the gap and the one
+   * flushed at completion both count */
+  push_span(sync_filt.base.input_buffers[0], 0, 16);
+  push_span(sync_filt.base.input_buffers[0], 24, 16);
+  push_span(sync_filt.base.input_buffers[1], 0, 16);
+  push_span(sync_filt.base.input_buffers[1], 16, 16);
+  push_span(sync_filt.base.input_buffers[1], 32, 8);
+  push_complete(sync_filt.base.input_buffers[0]);
+  push_complete(sync_filt.base.input_buffers[1]);
+
+  long long first_idx = -1;
+  size_t n_batches;
+  size_t total = drain_outputs(&first_idx, &n_batches);
+
+  TEST_ASSERT_EQUAL(32, total);
+  TEST_ASSERT_EQUAL(2, n_batches);
+  TEST_ASSERT_EQUAL(n_batches, sync_filt.base.metrics.n_batches);
+  TEST_ASSERT_EQUAL(total, sync_filt.base.metrics.samples_processed);
+}
+
+void test_mismatched_period_releases_batch(void)
+{
+  start_sync();
+
+  push_span(sync_filt.base.input_buffers[0], 0, 16);
+  Batch_t* batch = bb_get_head(sync_filt.base.input_buffers[1]);
+  batch->t_ns = 0;
+  batch->period_ns = 2 * PERIOD_NS;
+  batch->head = 16;
+  batch->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(sync_filt.base.input_buffers[1], 100000));
+
+  struct timespec ts_1ms = {.tv_nsec = 1000000};
+  for (int i = 0; i < 1000 && atomic_load(&sync_filt.base.running); i++) {
+    nanosleep(&ts_1ms, NULL);
+  }
+  TEST_ASSERT_FALSE(atomic_load(&sync_filt.base.running));
+  TEST_ASSERT_EQUAL(Bp_EC_PROPERTY_MISMATCH,
+                    sync_filt.base.worker_err_info.ec);
+  /* The rejected batch was handed back, not left checked out */
+  TEST_ASSERT_EQUAL(0, bb_occupancy(sync_filt.base.input_buffers[1]));
+}
+
+/* One input active, one idle, with a timeout far longer than the test:
+ * the worker sleeps on the wait set rather than on a single ring, so data
+ * on the idle input and a stop request are both picked up promptly. */
+void test_idle_input_does_not_stall_active_input(void)
+{
+  start_sync_timeout(10000000);
+
+  push_span(sync_filt.base.input_buffers[0], 0, 16);
+  push_span(sync_filt.base.input_buffers[0], 16, 16);
+  struct timespec ts_20ms = {.tv_nsec = 20000000};
+  nanosleep(&ts_20ms, NULL);
+  TEST_ASSERT_TRUE(atomic_load(&sync_filt.base.running));
+
+  struct timespec t0;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  push_span(sync_filt.base.input_buffers[1], 0, 16);
+  push_span(sync_filt.base.input_buffers[1], 16, 16);
+
+  Bp_EC err;
+  Batch_t* a = bb_get_tail(&outputs[0], 1000000, &err);
+  CHECK_ERR(err);
+  Batch_t* b = bb_get_tail(&outputs[1], 1000000, &err);
+  CHECK_ERR(err);
+  TEST_ASSERT_EQUAL(32, a->head);
+  TEST_ASSERT_EQUAL(32, b->head);
+  TEST_ASSERT_EQUAL(0, a->t_ns);
+  bb_del_tail(&outputs[0]);
+  bb_del_tail(&outputs[1]);
+  TEST_ASSERT_TRUE(elapsed_ms(&t0) < 1000);
+
+  /* Both inputs now idle: stop must not wait out the timeout */
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  CHECK_ERR(filt_stop(&sync_filt.base));
+  TEST_ASSERT_TRUE(elapsed_ms(&t0) < 1000);
+}
+
+void test_rejects_invalid_config(void)
+{
+  Synchroniser_config_t config = {
+      .name = "sync", .buff_config = in_config, .n_inputs = 1};
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    synchroniser_init(&sync_filt, config));
+  config.n_inputs = MAX_INPUTS + 1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    synchroniser_init(&sync_filt, config));
+  config.n_inputs = 2;
+  config.buff_config.dtype = DTYPE_RECORD;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG,
+                    synchroniser_init(&sync_filt, config));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_trims_leading_samples_and_rechunks);
+  RUN_TEST(test_gap_realigns_all_ports);
+  RUN_TEST(test_metrics_count_partial_batches);
+  RUN_TEST(test_mismatched_period_releases_batch);
+  RUN_TEST(test_idle_input_does_not_stall_active_input);
+  RUN_TEST(test_rejects_invalid_config);
+  return UNITY_END();
+}
@@ -1,7 +1,9 @@
 #ifndef TEST_UTILS_H
 #define TEST_UTILS_H
 
+#include <string.h>
 #include "bperr.h"
+#include "core.h"
 #include "unity.h"
 
 /* Common test macro for checking error codes */
@@ -12,4 +14,48 @@
     TEST_ASSERT_EQUAL_INT_MESSAGE(Bp_EC_OK, _ec, err_lut[_ec]); \
   } while (false)
 
+/* Helpers for driving one filter by hand: its input buffers are fed from
+ * the test thread and its first output is a buffer owned by the test. */
+
+/* Connect `out` to output 0 of an initialised filter and start both */
+static inline void test_filt_start(Filter_t *f, Batch_buff_t *out,
+                                   BatchBuffer_config out_config)
+{
+  CHECK_ERR(bb_init(out, "test_out", out_config));
+  CHECK_ERR(filt_sink_connect(f, 0, out));
+  CHECK_ERR(bb_start(out));
+  CHECK_ERR(filt_start(f));
+}
+
+/* Undo test_filt_start; for tearDown */
+static inline void test_filt_stop(Filter_t *f, Batch_buff_t *out)
+{
+  CHECK_ERR(filt_stop(f));
+  CHECK_ERR(filt_deinit(f));
+  bb_stop(out);
+  bb_deinit(out);
+}
+
+/* Submit `n` interleaved frames, starting at `t_ns` */
+static inline void test_push(Batch_buff_t *in, const void *frames, size_t n,
+                             long long t_ns, unsigned period_ns)
+{
+  Batch_t *batch = bb_get_head(in);
+  memcpy(batch->data, frames, n * bb_frame_size(in));
+  batch->head = n;
+  batch->t_ns = t_ns;
+  batch->period_ns = period_ns;
+  batch->ec = Bp_EC_OK;
+  CHECK_ERR(bb_submit(in, 100000));
+}
+
+/* Wait for the next batch; the caller releases it with bb_del_tail */
+static inline Batch_t *test_pull(Batch_buff_t *out)
+{
+  Bp_EC err;
+  Batch_t *batch = bb_get_tail(out, 1000000, &err);
+  CHECK_ERR(err);
+  return batch;
+}
+
 #endif /* TEST_UTILS_H */
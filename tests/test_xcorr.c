@@ -0,0 +1,185 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../bpipe/xcorr.h"
+#include "core.h"
+#include "test_utils.h"
+#include "unity.h"
+
+#define BATCH_CAPACITY_EXPO 6
+#define RING_CAPACITY_EXPO 4
+#define BATCH_CAPACITY (1 << BATCH_CAPACITY_EXPO)
+#define BLOCK_EXPO 8
+#define BLOCK_N (1 << BLOCK_EXPO)
+#define PERIOD_NS 1000
+
+typedef struct {
+  XCorr_t xc;
+  Batch_buff_t output;
+} TestFixture;
+
+static TestFixture fixture;
+static float noise[4 * BLOCK_N + 64];
+
+static void start(bool phat, size_t max_lag)
+{
+  XCorr_config_t config = {
+      .name = "xcorr",
+      .buff_config = {.dtype = DTYPE_FLOAT,
+                      .batch_capacity_expo = BATCH_CAPACITY_EXPO,
+                      .ring_capacity_expo = RING_CAPACITY_EXPO},
+      .block_expo = BLOCK_EXPO,
+      .max_lag = max_lag,
+      .phat = phat,
+      .timeout_us = 10000};
+  CHECK_ERR(xcorr_init(&fixture.xc, config));
+  test_filt_start(&fixture.xc.base, &fixture.output,
+                  (BatchBuffer_config){.dtype = DTYPE_FLOAT,
+                                       .batch_capacity_expo = 2,
+                                       .ring_capacity_expo = RING_CAPACITY_EXPO,
+                                       .n_channels = 2});
+}
+
+typedef float (*SignalFn)(double t);
+
+/* One block on both inputs, x1[n] = x0 delayed by `delay` samples; returns
+ * the [lag, peak] frame */
+static void push_block(SignalFn s, size_t block, double delay, float* lag,
+                       float* peak)
+{
+  for (size_t b = 0; b < BLOCK_N / BATCH_CAPACITY; b++) {
+    size_t n0 = block * BLOCK_N + b * BATCH_CAPACITY;
+    for (size_t i = 0; i < 2; i++) {
+      float d[BATCH_CAPACITY];
+      for (size_t k = 0; k < BATCH_CAPACITY; k++) {
+        d[k] = s((double) (n0 + k) - (i == 1 ? delay : 0.0));
+      }
+      test_push(fixture.xc.base.input_buffers[i], d, BATCH_CAPACITY,
+                (long long) n0 * PERIOD_NS, PERIOD_NS);
+    }
+  }
+
+  Batch_t* out = test_pull(&fixture.output);
+  *lag = ((float*) out->data)[0];
+  *peak = ((float*) out->data)[1];
+  CHECK_ERR(bb_del_tail(&fixture.output));
+}
+
+/* White noise, looked up at integer times */
+static float white(double t) { return noise[(size_t) (t + 32.0)]; }
+
+/* Smooth multi-tone signal, defined at any time */
+static float tones(double t)
+{
+  return (float) (sin(0.11 * t) + 0.6 * sin(0.23 * t + 1.0) +
+                  0.3 * cos(0.05 * t));
+}
+
+void setUp(void)
+{
+  memset(&fixture, 0, sizeof(fixture));
+  srand(7);
+  for (size_t i = 0; i < sizeof(noise) / sizeof(noise[0]); i++) {
+    noise[i] = (float) rand() / (float) RAND_MAX - 0.5f;
+  }
+}
+
+void tearDown(void)
+{
+  if (fixture.xc.base.worker != NULL) {
+    test_filt_stop(&fixture.xc.base, &fixture.output);
+  }
+}
+
+void test_integer_delay_plain(void)
+{
+  start(false, 0);
+  float lag, peak;
+  push_block(white, 0, 7.0, &lag, &peak);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, 7.0f, lag);
+  TEST_ASSERT_TRUE(peak > 0.9f && peak <= 1.0f);
+
+  push_block(white, 1, -12.0, &lag, &peak);
+  TEST_ASSERT_FLOAT_WITHIN(0.1f, -12.0f, lag);
+  TEST_ASSERT_EQUAL(2, fixture.xc.blocks_emitted);
+}
+
+void test_gcc_phat_delay(void)
+{
+  start(true, 32);
+  float lag, peak;
+  for (size_t block = 0; block < 3; block++) {
+    push_block(white, block, 20.0, &lag, &peak);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 20.0f, lag);
+    TEST_ASSERT_TRUE(peak > 0.5f);
+  }
+}
+
+void test_sub_sample_delay(void)
+{
+  start(false, 16);
+  float lag, peak;
+  push_block(tones, 0, 2.4, &lag, &peak);
+  TEST_ASSERT_FLOAT_WITHIN(0.15f, 2.4f, lag);
+  push_block(tones, 1, -0.7, &lag, &peak);
+  TEST_ASSERT_FLOAT_WITHIN(0.15f, -0.7f, lag);
+}
+
+void test_complete_propagates(void)
+{
+  start(false, 0);
+  Batch_t* in = bb_get_head(fixture.xc.base.input_buffers[1]);
+  in->head = 0;
+  in->ec = Bp_EC_COMPLETE;
+  CHECK_ERR(bb_submit(fixture.xc.base.input_buffers[1], 100000));
+
+  Batch_t* out = test_pull(&fixture.output);
+  TEST_ASSERT_EQUAL(Bp_EC_COMPLETE, out->ec);
+  CHECK_ERR(bb_del_tail(&fixture.output));
+}
+
+void test_rejects_invalid_config(void)
+{
+  XCorr_config_t config = {.name = "xcorr",
+                           .buff_config = {.dtype = DTYPE_I32,
+                                           .batch_capacity_expo =
+                                               BATCH_CAPACITY_EXPO,
+                                           .ring_capacity_expo =
+                                               RING_CAPACITY_EXPO},
+                           .block_expo = BLOCK_EXPO};
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, xcorr_init(&fixture.xc, config));
+  config.buff_config.dtype = DTYPE_FLOAT;
+  config.buff_config.n_channels = 2;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, xcorr_init(&fixture.xc, config));
+  config.buff_config.n_channels = 1;
+  config.max_lag = BLOCK_N / 2 + 1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, xcorr_init(&fixture.xc, config));
+  config.max_lag = 0;
+  config.block_expo = XCORR_MAX_BLOCK_EXPO + 1;
+  TEST_ASSERT_EQUAL(Bp_EC_INVALID_CONFIG, xcorr_init(&fixture.xc, config));
+
+  /* Output frames are [lag, peak] */
+  config.block_expo = BLOCK_EXPO;
+  CHECK_ERR(xcorr_init(&fixture.xc, config));
+  Batch_buff_t narrow;
+  BatchBuffer_config narrow_config = {.dtype = DTYPE_FLOAT,
+                                      .batch_capacity_expo = 2,
+                                      .ring_capacity_expo = 2};
+  CHECK_ERR(bb_init(&narrow, "narrow", narrow_config));
+  TEST_ASSERT_EQUAL(Bp_EC_WIDTH_MISMATCH,
+                    filt_sink_connect(&fixture.xc.base, 0, &narrow));
+  bb_deinit(&narrow);
+  CHECK_ERR(filt_deinit(&fixture.xc.base));
+  memset(&fixture, 0, sizeof(fixture));
+}
+
+int main(void)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_integer_delay_plain);
+  RUN_TEST(test_gcc_phat_delay);
+  RUN_TEST(test_sub_sample_delay);
+  RUN_TEST(test_complete_propagates);
+  RUN_TEST(test_rejects_invalid_config);
+  return UNITY_END();
+}